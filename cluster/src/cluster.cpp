@@ -0,0 +1,124 @@
+#include "cluster.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace cluster {
+
+namespace {
+
+/**
+ * \brief Return names of the given nodes.
+ *
+ * \param nodes Cluster nodes.
+ *
+ * \return Node names, in the same order.
+ */
+std::vector<std::string> getNames(const std::vector<Node>& nodes) {
+  std::vector<std::string> names;
+  names.reserve(nodes.size());
+  for (const auto& node : nodes) {
+    names.push_back(node.name);
+  }
+
+  return names;
+}
+
+/**
+ * \brief Find the local node.
+ *
+ * \param config Cluster configuration.
+ *
+ * \return Index of the local node.
+ *
+ * \throw std::invalid_argument If the configuration is not valid.
+ */
+std::size_t findSelf(const ClusterConfig& config) {
+  if (config.nodes.empty() || (config.virtual_nodes == 0)) {
+    throw std::invalid_argument{"Cluster has no nodes"};
+  }
+
+  std::unordered_set<std::string> names;
+  for (const auto& node : config.nodes) {
+    if (!names.insert(node.name).second) {
+      throw std::invalid_argument{"Duplicate cluster node: " + node.name};
+    }
+  }
+
+  const auto self = std::find_if(
+      config.nodes.cbegin(), config.nodes.cend(),
+      [&config](const auto& node) { return node.name == config.self; });
+  if (self == config.nodes.cend()) {
+    throw std::invalid_argument{"Local node is not a cluster member: " +
+                                config.self};
+  }
+
+  return self - config.nodes.cbegin();
+}
+
+}  // namespace
+
+ClusterConfig parseClusterConfig(std::istream& stream) {
+  ClusterConfig config;
+  std::string line;
+  for (std::size_t number = 1; std::getline(stream, line); number++) {
+    std::istringstream tokens{line};
+    std::string directive;
+    if (!(tokens >> directive) || (directive[0] == '#')) {
+      continue;
+    }
+
+    std::string extra;
+    if (directive == "node") {
+      Node node;
+      if ((tokens >> node.name >> node.address >> node.port) &&
+          !(tokens >> extra)) {
+        config.nodes.push_back(std::move(node));
+        continue;
+      }
+    } else if (directive == "virtual_nodes") {
+      if ((tokens >> config.virtual_nodes) && !(tokens >> extra)) {
+        continue;
+      }
+    } else if (directive == "request_timeout") {
+      std::chrono::milliseconds::rep timeout{0};
+      if ((tokens >> timeout) && (timeout > 0) && !(tokens >> extra)) {
+        config.request_timeout = std::chrono::milliseconds{timeout};
+        continue;
+      }
+    }
+
+    throw std::runtime_error{"Malformed cluster configuration (line " +
+                             std::to_string(number) + "): " + line};
+  }
+
+  return config;
+}
+
+ClusterConfig loadClusterConfig(const std::string& path) {
+  std::ifstream file{path};
+  if (!file) {
+    throw std::runtime_error{"Failed to open cluster configuration: " + path};
+  }
+
+  return parseClusterConfig(file);
+}
+
+Cluster::Cluster(const ClusterConfig& config)
+    : nodes_{config.nodes},
+      self_{findSelf(config)},
+      ring_{getNames(config.nodes), config.virtual_nodes},
+      request_timeout_{config.request_timeout} {}
+
+const Node& Cluster::getOwner(std::string_view key) const noexcept {
+  return nodes_[ring_.getOwner(key)];
+}
+
+bool Cluster::isLocal(std::string_view key) const noexcept {
+  return ring_.getOwner(key) == self_;
+}
+
+}  // namespace cluster
@@ -0,0 +1,150 @@
+#ifndef CLUSTER_SRC_CLUSTER_HPP
+#define CLUSTER_SRC_CLUSTER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "hash_ring.hpp"
+
+namespace cluster {
+
+/// Request header marking listings and directory removals which must not be
+/// fanned out again (lowercase, as header names are matched by the HTTP
+/// parser).
+constexpr std::string_view kLocalRequestHeader{"x-cluster-local"};
+
+/**
+ * \brief Cluster node.
+ */
+struct Node {
+  std::string name;     ///< Unique node name.
+  std::string address;  ///< IPv4 address clients reach the node at.
+  std::uint16_t port;   ///< HTTP/FTP port of the node.
+};
+
+/**
+ * \brief Cluster configuration.
+ */
+struct ClusterConfig {
+  std::vector<Node> nodes;  ///< Cluster members (empty disables clustering).
+  std::string self;         ///< Name of the local node.
+
+  /// Number of ring points per node.
+  std::size_t virtual_nodes{128};
+
+  /// Maximum time to wait for another node to respond to a listing or a
+  /// directory removal, before treating it as unreachable.
+  std::chrono::milliseconds request_timeout{5000};
+};
+
+/**
+ * \brief Parse cluster membership.
+ *
+ * The configuration is line-based, empty lines and lines starting with '#'
+ * are ignored:
+ *
+ *     virtual_nodes <count>
+ *     request_timeout <milliseconds>
+ *     node <name> <address> <port>
+ *
+ * \param stream Stream to read the configuration from.
+ *
+ * \return Cluster configuration (without the local node name).
+ *
+ * \throw std::runtime_error If the configuration is malformed.
+ */
+ClusterConfig parseClusterConfig(std::istream& stream);
+
+/**
+ * \brief Load cluster membership from a static configuration file.
+ *
+ * \param path Path to the configuration file (see parseClusterConfig()).
+ *
+ * \return Cluster configuration (without the local node name).
+ *
+ * \throw std::runtime_error If the file cannot be read or is malformed.
+ */
+ClusterConfig loadClusterConfig(const std::string& path);
+
+/**
+ * \brief Static cluster of object storage nodes.
+ *
+ * Every node owns the part of the keyspace assigned to it by a consistent-hash
+ * ring. Membership is static: all nodes are configured with the same list of
+ * nodes, so they agree on the owner of every key without coordination.
+ */
+class Cluster {
+ public:
+  /**
+   * \brief Create a cluster.
+   *
+   * \param config Cluster configuration.
+   *
+   * \throw std::invalid_argument If there are no nodes, node names are not
+   * unique or the local node is not a member.
+   */
+  explicit Cluster(const ClusterConfig& config);
+
+  /**
+   * \brief Return the node owning the given key.
+   *
+   * \param key Object key.
+   *
+   * \return Owner of the key.
+   */
+  [[nodiscard]] const Node& getOwner(std::string_view key) const noexcept;
+
+  /**
+   * \brief Check if the given key is owned by the local node.
+   *
+   * \param key Object key.
+   *
+   * \return True if key is owned by the local node, false otherwise.
+   */
+  [[nodiscard]] bool isLocal(std::string_view key) const noexcept;
+
+  /**
+   * \brief Return the local node.
+   *
+   * \return Local node.
+   */
+  [[nodiscard]] inline const Node& getSelf() const noexcept {
+    return nodes_[self_];
+  }
+
+  /**
+   * \brief Return all cluster nodes.
+   *
+   * \return Cluster nodes (including the local node).
+   */
+  [[nodiscard]] inline const std::vector<Node>& getNodes() const noexcept {
+    return nodes_;
+  }
+
+  /**
+   * \brief Return the maximum time to wait for another node to respond.
+   *
+   * \return Request timeout.
+   */
+  [[nodiscard]] inline std::chrono::milliseconds getRequestTimeout()
+      const noexcept {
+    return request_timeout_;
+  }
+
+ private:
+  std::vector<Node> nodes_;  ///< Cluster nodes.
+  std::size_t self_;         ///< Index of the local node.
+  HashRing ring_;            ///< Keyspace partitioning.
+
+  /// Maximum time to wait for another node to respond.
+  std::chrono::milliseconds request_timeout_;
+};
+
+}  // namespace cluster
+
+#endif  // CLUSTER_SRC_CLUSTER_HPP
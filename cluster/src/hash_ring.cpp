@@ -0,0 +1,45 @@
+#include "hash_ring.hpp"
+
+#include <algorithm>
+
+namespace cluster {
+
+HashRing::HashRing(const std::vector<std::string>& nodes,
+                   std::size_t virtual_nodes) {
+  points_.reserve(nodes.size() * virtual_nodes);
+  for (std::size_t node = 0; node < nodes.size(); node++) {
+    for (std::size_t i = 0; i < virtual_nodes; i++) {
+      points_.emplace_back(hash(nodes[node] + '#' + std::to_string(i)), node);
+    }
+  }
+
+  std::sort(points_.begin(), points_.end());
+}
+
+std::size_t HashRing::getOwner(std::string_view key) const noexcept {
+  const auto point =
+      std::lower_bound(points_.cbegin(), points_.cend(),
+                       std::make_pair(hash(key), std::size_t{0}));
+
+  // Keys past the last point wrap around to the first one.
+  return point == points_.cend() ? points_.front().second : point->second;
+}
+
+std::uint64_t HashRing::hash(std::string_view key) noexcept {
+  // FNV-1a, followed by the MurmurHash3 finalizer to spread similar keys
+  // (such as virtual node names) over the whole ring.
+  std::uint64_t hash{0xcbf29ce484222325};
+  for (const auto byte : key) {
+    hash ^= static_cast<unsigned char>(byte);
+    hash *= 0x100000001b3;
+  }
+
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccd;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+}  // namespace cluster
@@ -0,0 +1,68 @@
+#ifndef CLUSTER_SRC_HASH_RING_HPP
+#define CLUSTER_SRC_HASH_RING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace cluster {
+
+/**
+ * \brief Consistent-hash ring mapping keys to nodes.
+ *
+ * Each node is placed on the ring at several points (virtual nodes), so that
+ * the keyspace is split evenly between nodes and adding or removing a node
+ * only moves the keys of that node. A key belongs to the node owning the
+ * first point at or after the hash of the key.
+ *
+ * The hash function is fixed (it does not depend on the standard library), so
+ * all nodes of a cluster agree on the owner of every key.
+ */
+class HashRing {
+ public:
+  /**
+   * \brief Create a ring of the given nodes.
+   *
+   * \param nodes Node names (unique).
+   * \param virtual_nodes Number of ring points per node.
+   */
+  HashRing(const std::vector<std::string>& nodes, std::size_t virtual_nodes);
+
+  /**
+   * \brief Return the node owning the given key.
+   *
+   * \note The ring must not be empty.
+   *
+   * \param key Key to look up.
+   *
+   * \return Index of the owner in the list of nodes the ring was created with.
+   */
+  [[nodiscard]] std::size_t getOwner(std::string_view key) const noexcept;
+
+  /**
+   * \brief Check if the ring has no nodes.
+   *
+   * \return True if ring is empty, false otherwise.
+   */
+  [[nodiscard]] inline bool empty() const noexcept { return points_.empty(); }
+
+  /**
+   * \brief Hash a key onto the ring.
+   *
+   * \param key Key to hash.
+   *
+   * \return 64-bit hash of the key.
+   */
+  [[nodiscard]] static std::uint64_t hash(std::string_view key) noexcept;
+
+ private:
+  /// Ring points (hash, node index), sorted by hash.
+  std::vector<std::pair<std::uint64_t, std::size_t>> points_;
+};
+
+}  // namespace cluster
+
+#endif  // CLUSTER_SRC_HASH_RING_HPP
@@ -0,0 +1,193 @@
+#include "peer_client.hpp"
+
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <cctype>
+#include <chrono>
+#include <istream>
+#include <limits>
+
+#include "utils/src/utils.hpp"
+
+namespace cluster {
+
+namespace {
+
+/// Response header holding the size of the response body.
+constexpr std::string_view kContentLength{"content-length:"};
+
+/**
+ * \brief Read response headers and find response body size.
+ *
+ * \param headers Response headers (one per line, up to the empty line).
+ *
+ * \return Body size, or nothing if Content-Length header is missing.
+ */
+std::optional<std::size_t> getContentLength(std::istream& headers) {
+  std::optional<std::size_t> content_length;
+  std::string line;
+  while (std::getline(headers, line) && (line != "\r")) {
+    std::string name{line.substr(0, kContentLength.size())};
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    if (name == kContentLength) {
+      auto value = std::string_view{line}.substr(kContentLength.size());
+      while (!value.empty() && (value.front() == ' ')) {
+        value.remove_prefix(1);
+      }
+      if (!value.empty() && (value.back() == '\r')) {
+        value.remove_suffix(1);
+      }
+      content_length = utils::toNumber(value);
+    }
+  }
+
+  return content_length;
+}
+
+/**
+ * \brief Run an asynchronous socket operation until it completes or the
+ * deadline passes.
+ *
+ * \param socket Socket the operation runs on (closed on timeout).
+ * \param deadline Time by which the operation has to complete.
+ * \param operation Function starting the operation with the given handler.
+ *
+ * \return Error code of the operation (timed_out if the deadline passed).
+ */
+template <typename Operation>
+boost::system::error_code runUntil(
+    boost::asio::ip::tcp::socket& socket,
+    std::chrono::steady_clock::time_point deadline, Operation&& operation) {
+  boost::system::error_code result{boost::asio::error::would_block};
+  operation([&result](const boost::system::error_code& error_code,
+                      auto&&...) { result = error_code; });
+
+  auto& io_service = static_cast<boost::asio::io_service&>(
+      socket.get_executor().context());
+  io_service.restart();
+  io_service.run_until(deadline);
+  if (result != boost::asio::error::would_block) {
+    return result;
+  }
+
+  // The cancelled operation completes once the socket is closed.
+  boost::system::error_code error_code{};
+  socket.close(error_code);
+  io_service.restart();
+  io_service.run();
+  return boost::asio::error::timed_out;
+}
+
+/**
+ * \brief Send a blocking HTTP request to another cluster node.
+ *
+ * The request is marked with kLocalRequestHeader and has no body. A node
+ * which does not respond in time is treated as unreachable, so that a stalled
+ * node never holds up the calling thread for long.
+ *
+ * \param node Node to send the request to.
+ * \param method HTTP method.
+ * \param target Request target (URI path and query).
+ * \param authorization Value of the Authorization header to forward (if any).
+ * \param timeout Maximum time for the whole request.
+ *
+ * \return Response body, or nothing if the node could not be reached, did
+ * not respond in time or did not respond with 200 OK.
+ */
+std::optional<std::string> sendRequest(
+    const Node& node, std::string_view method, const std::string& target,
+    const std::optional<std::string>& authorization,
+    std::chrono::milliseconds timeout) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  boost::asio::io_service io_service;
+  boost::asio::ip::tcp::socket socket{io_service};
+  boost::system::error_code error_code{};
+
+  const boost::asio::ip::tcp::endpoint endpoint{
+      boost::asio::ip::make_address(node.address, error_code), node.port};
+  if (!error_code) {
+    error_code = runUntil(socket, deadline, [&](auto handler) {
+      socket.async_connect(endpoint, handler);
+    });
+  }
+
+  std::string request{std::string{method} + ' ' + target +
+                      " HTTP/1.1\r\nHost: " + node.address + ':' +
+                      std::to_string(node.port) + "\r\n"};
+  request += std::string{kLocalRequestHeader} + ": 1\r\n";
+  if (authorization) {
+    request += "Authorization: " + *authorization + "\r\n";
+  }
+  request += "\r\n";
+
+  if (!error_code) {
+    error_code = runUntil(socket, deadline, [&](auto handler) {
+      boost::asio::async_write(socket, boost::asio::buffer(request), handler);
+    });
+  }
+
+  boost::asio::streambuf buffer;
+  if (!error_code) {
+    error_code = runUntil(socket, deadline, [&](auto handler) {
+      boost::asio::async_read_until(socket, buffer, "\r\n\r\n", handler);
+    });
+  }
+  if (error_code) {
+    return std::nullopt;
+  }
+
+  std::istream response{&buffer};
+  std::string version;
+  int status{0};
+  response >> version >> status;
+  response.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+  const auto content_length = getContentLength(response);
+  if ((status != 200) || !content_length) {
+    return std::nullopt;
+  }
+
+  // Part of the body may already be buffered.
+  if (buffer.size() < *content_length) {
+    error_code = runUntil(socket, deadline, [&](auto handler) {
+      boost::asio::async_read(
+          socket, buffer,
+          boost::asio::transfer_exactly(*content_length - buffer.size()),
+          handler);
+    });
+    if (error_code) {
+      return std::nullopt;
+    }
+  }
+
+  std::string body(*content_length, '\0');
+  response.read(body.data(), static_cast<std::streamsize>(body.size()));
+  return body;
+}
+
+}  // namespace
+
+std::optional<std::string> listPeer(
+    const Node& node, const std::optional<std::string>& authorization,
+    std::chrono::milliseconds timeout) {
+  return sendRequest(node, "GET", "/", authorization, timeout);
+}
+
+std::optional<std::size_t> removePeerDirectory(
+    const Node& node, const std::string& directory,
+    const std::optional<std::string>& authorization,
+    std::chrono::milliseconds timeout) {
+  const auto body = sendRequest(node, "DELETE", directory + "?recursive",
+                                authorization, timeout);
+  if (!body) {
+    return std::nullopt;
+  }
+
+  std::string_view count{*body};
+  if (!count.empty() && (count.back() == '\n')) {
+    count.remove_suffix(1);
+  }
+  return utils::toNumber(count);
+}
+
+}  // namespace cluster
@@ -0,0 +1,53 @@
+#ifndef CLUSTER_SRC_PEER_CLIENT_HPP
+#define CLUSTER_SRC_PEER_CLIENT_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <string>
+
+#include "cluster.hpp"
+
+namespace cluster {
+
+/**
+ * \brief List objects stored locally on another cluster node.
+ *
+ * Sends a blocking HTTP 'GET /' request marked with kLocalRequestHeader, so
+ * that the node does not fan the listing out any further.
+ *
+ * \param node Node to query.
+ * \param authorization Value of the Authorization header to forward (if any).
+ * \param timeout Maximum time to wait for the node.
+ *
+ * \return Listing returned by the node, or nothing if the node could not be
+ * reached in time or did not respond with 200 OK.
+ */
+std::optional<std::string> listPeer(
+    const Node& node, const std::optional<std::string>& authorization,
+    std::chrono::milliseconds timeout);
+
+/**
+ * \brief Remove files stored locally on another cluster node under the given
+ * directory.
+ *
+ * Sends a blocking HTTP 'DELETE <directory>?recursive' request marked with
+ * kLocalRequestHeader, so that the node does not fan the removal out any
+ * further.
+ *
+ * \param node Node to send the request to.
+ * \param directory Directory path (ending with '/').
+ * \param authorization Value of the Authorization header to forward (if any).
+ * \param timeout Maximum time to wait for the node.
+ *
+ * \return Number of files removed by the node, or nothing if the node could
+ * not be reached in time or did not respond with 200 OK.
+ */
+std::optional<std::size_t> removePeerDirectory(
+    const Node& node, const std::string& directory,
+    const std::optional<std::string>& authorization,
+    std::chrono::milliseconds timeout);
+
+}  // namespace cluster
+
+#endif  // CLUSTER_SRC_PEER_CLIENT_HPP
@@ -0,0 +1,96 @@
+#include "cluster/src/cluster.hpp"
+
+#include <boost/asio.hpp>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+
+#include "cluster/src/peer_client.hpp"
+#include "gtest/gtest.h"
+
+using namespace cluster;
+
+TEST(ClusterConfig, Parse) {
+  std::istringstream stream{
+      "# Local cluster\n"
+      "\n"
+      "virtual_nodes 32\n"
+      "request_timeout 250\n"
+      "node a 127.0.0.1 1670\n"
+      "  node b 127.0.0.1 1671  \n"};
+  const auto config = parseClusterConfig(stream);
+
+  EXPECT_EQ(32, config.virtual_nodes);
+  EXPECT_EQ(std::chrono::milliseconds{250}, config.request_timeout);
+  ASSERT_EQ(2, config.nodes.size());
+  EXPECT_EQ("a", config.nodes[0].name);
+  EXPECT_EQ("127.0.0.1", config.nodes[0].address);
+  EXPECT_EQ(1670, config.nodes[0].port);
+  EXPECT_EQ("b", config.nodes[1].name);
+  EXPECT_EQ(1671, config.nodes[1].port);
+  EXPECT_TRUE(config.self.empty());
+}
+
+TEST(ClusterConfig, Malformed) {
+  for (const auto* text :
+       {"node a 127.0.0.1\n", "node a 127.0.0.1 port\n",
+        "node a 127.0.0.1 1670 extra\n", "virtual_nodes\n", "nodes a\n",
+        "request_timeout 0\n", "request_timeout soon\n"}) {
+    std::istringstream stream{text};
+    EXPECT_THROW(parseClusterConfig(stream), std::runtime_error) << text;
+  }
+}
+
+TEST(ClusterConfig, MissingFile) {
+  EXPECT_THROW(loadClusterConfig("/does/not/exist"), std::runtime_error);
+}
+
+TEST(Cluster, Invalid) {
+  EXPECT_THROW(Cluster{ClusterConfig{}}, std::invalid_argument);
+
+  ClusterConfig config{{{"a", "127.0.0.1", 1670}, {"b", "127.0.0.1", 1671}},
+                       "c"};
+  EXPECT_THROW(Cluster{config}, std::invalid_argument);
+
+  config.nodes.push_back({"a", "127.0.0.1", 1672});
+  config.self = "a";
+  EXPECT_THROW(Cluster{config}, std::invalid_argument);
+}
+
+TEST(Cluster, Ownership) {
+  ClusterConfig config{{{"a", "127.0.0.1", 1670}, {"b", "127.0.0.1", 1671}},
+                       "a"};
+  const Cluster a{config};
+  config.self = "b";
+  const Cluster b{config};
+
+  EXPECT_EQ("a", a.getSelf().name);
+  EXPECT_EQ(2, a.getNodes().size());
+
+  // Every key is owned by exactly one node, and both nodes agree on it.
+  std::size_t local_to_a{0};
+  for (int i = 0; i < 100; i++) {
+    const auto key = "/" + std::to_string(i);
+    EXPECT_NE(a.isLocal(key), b.isLocal(key));
+    EXPECT_EQ(a.getOwner(key).name, b.getOwner(key).name);
+    EXPECT_EQ(a.isLocal(key), a.getOwner(key).name == "a");
+    local_to_a += a.isLocal(key) ? 1 : 0;
+  }
+
+  EXPECT_GT(local_to_a, 0);
+  EXPECT_LT(local_to_a, 100);
+}
+
+TEST(PeerClient, Timeout) {
+  // The peer accepts the connection (the kernel does), but never responds.
+  boost::asio::io_service io_service;
+  boost::asio::ip::tcp::acceptor acceptor{
+      io_service, {boost::asio::ip::make_address("127.0.0.1"), 0}};
+  const Node node{"a", "127.0.0.1", acceptor.local_endpoint().port()};
+
+  const auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(listPeer(node, std::nullopt, std::chrono::milliseconds{100}));
+  EXPECT_FALSE(removePeerDirectory(node, "/a/", std::nullopt,
+                                   std::chrono::milliseconds{100}));
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{2});
+}
@@ -0,0 +1,59 @@
+#include "cluster/src/hash_ring.hpp"
+
+#include <map>
+
+#include "gtest/gtest.h"
+
+using namespace cluster;
+
+TEST(HashRing, SingleNode) {
+  const HashRing ring{{"a"}, 16};
+  EXPECT_FALSE(ring.empty());
+  EXPECT_EQ(0, ring.getOwner("/key"));
+  EXPECT_EQ(0, ring.getOwner(""));
+}
+
+TEST(HashRing, Deterministic) {
+  const HashRing ring1{{"a", "b", "c"}, 64};
+  const HashRing ring2{{"a", "b", "c"}, 64};
+  for (int i = 0; i < 1000; i++) {
+    const auto key = "/key/" + std::to_string(i);
+    EXPECT_EQ(ring1.getOwner(key), ring2.getOwner(key));
+  }
+
+  EXPECT_EQ(HashRing::hash("/key"), HashRing::hash("/key"));
+  EXPECT_NE(HashRing::hash("/key1"), HashRing::hash("/key2"));
+}
+
+TEST(HashRing, Balanced) {
+  const HashRing ring{{"a", "b", "c", "d"}, 128};
+  std::map<std::size_t, std::size_t> keys_per_node;
+  constexpr std::size_t kKeyCount{40000};
+  for (std::size_t i = 0; i < kKeyCount; i++) {
+    keys_per_node[ring.getOwner("/object/" + std::to_string(i))]++;
+  }
+
+  ASSERT_EQ(4, keys_per_node.size());
+  for (const auto& [node, keys] : keys_per_node) {
+    EXPECT_GT(keys, kKeyCount / 4 * 3 / 4) << "node " << node;
+    EXPECT_LT(keys, kKeyCount / 4 * 5 / 4) << "node " << node;
+  }
+}
+
+TEST(HashRing, MinimalMovement) {
+  // Adding a node only moves keys to the new node.
+  const HashRing before{{"a", "b", "c"}, 128};
+  const HashRing after{{"a", "b", "c", "d"}, 128};
+  std::size_t moved{0};
+  constexpr std::size_t kKeyCount{10000};
+  for (std::size_t i = 0; i < kKeyCount; i++) {
+    const auto key = "/object/" + std::to_string(i);
+    if (before.getOwner(key) != after.getOwner(key)) {
+      EXPECT_EQ(3, after.getOwner(key));
+      moved++;
+    }
+  }
+
+  EXPECT_GT(moved, kKeyCount / 8);
+  EXPECT_LT(moved, kKeyCount / 2);
+}
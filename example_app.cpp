@@ -7,6 +7,7 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 
 #include "server/object_storage/src/object_storage.hpp"
@@ -17,9 +18,10 @@ using namespace server::object_storage;
 int main(int argc, char *argv[]) {
   // ObjectStorage server{"127.0.0.1", 1670, LogLevel::Debug};
 
-  if (argc != 6) {
+  if ((argc != 6) && (argc != 8)) {
     std::cout << "Usage ./object_storage <address> <port> <threads> "
-                 "<auth|no_auth> <ftp_port_range>\n";
+                 "<auth|no_auth> <ftp_port_range> "
+                 "[<cluster_config> <node_name>]\n";
     return -1;
   }
 
@@ -33,10 +35,36 @@ int main(int argc, char *argv[]) {
   std::uint16_t ftp_port_min = std::atoi(ftp_port_range[0].data());
   std::uint16_t ftp_port_max = std::atoi(ftp_port_range[1].data());
 
+  ObjectStorageConfig config;
+  config.address = address;
+  config.port = port;
+  config.authenticate = authenticate;
+  config.ftp_port_range = {ftp_port_min, ftp_port_max};
+
+  // Load cluster membership (if running as a cluster node)
+  if (argc == 8) {
+    try {
+      config.cluster = cluster::loadClusterConfig(argv[6]);  // NOLINT
+    } catch (const std::runtime_error& error) {
+      std::cout << error.what() << '\n';
+      return -1;
+    }
+    config.cluster.self = argv[7];  // NOLINT
+  }
+
+  // Keep recent mutations for the change feed (GET /_changes), serve hot
+  // objects from per-thread caches, keep a Merkle tree of the files
+  // (GET /_merkle), and free removed objects in the background
+  config.fs.log.max_entries = 10000;
+  config.fs.cache.slots = 1024;
+  config.fs.merkle.leaves = 4096;
+  config.fs.reclaimer.enabled = true;
+
+  // Profile a sample of the requests (GET /_profile)
+  config.profiler.enabled = true;
+
   // Instantiate the Object storage server
-  ObjectStorage server{
-      address, port, LogLevel::Info, authenticate, {ftp_port_min, ftp_port_max},
-  };
+  ObjectStorage server{config};
 
   // Add users (for authentication)
   server.addUser("Nord", "VPN");
@@ -1,24 +1,93 @@
 #ifndef FILESYSTEM_FILESYSTEM_HPP
 #define FILESYSTEM_FILESYSTEM_HPP
 
+#include <chrono>
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <tuple>
 #include <vector>
 
+#include "filesystem/object/src/checksum.hpp"
+#include "filesystem/object/src/object.hpp"
+
 namespace fs {
 
 /**
  * \brief Filesystem operation result.
  */
 enum class Status {
-  Success,        ///< Filesystem operation completed successfully.
-  FileNotFound,   ///< Specified file was not found.
-  AlreadyExists,  ///< File already exists at the specified path.
+  Success,             ///< Filesystem operation completed successfully.
+  FileNotFound,        ///< Specified file was not found.
+  AlreadyExists,       ///< File already exists at the specified path.
+  InvalidRange,        ///< Specified byte range lies outside of the file.
+  IoError,             ///< File could not be read from (or written to) storage.
+  PreconditionFailed,  ///< File state did not match the precondition.
+};
+
+/**
+ * \brief File version.
+ *
+ * Every modification gives the file a new version, which never repeats for
+ * the same path. Versions of different files are not related.
+ */
+using Version = std::uint64_t;
+
+/**
+ * \brief Multipart upload identifier.
+ */
+using UploadId = std::uint64_t;
+
+/**
+ * \brief File metadata.
+ */
+struct FileInfo {
+  std::size_t size;  ///< File size (in bytes).
+  Version version;   ///< File version.
+
+  /// Time of the last modification.
+  std::chrono::system_clock::time_point modified;
+
+  /// Checksum of the file contents, if it was recorded (see put()).
+  std::optional<Checksum> checksum{};
 };
 
 /**
- * \brief File representation.
+ * \brief Space taken by the files under a directory.
  */
-using File = std::string;
+struct Usage {
+  std::size_t objects{0};  ///< Number of files.
+  std::size_t bytes{0};    ///< Total size of the files (in bytes).
+};
+
+/**
+ * \brief Condition on the current state of a file, checked atomically with the
+ * mutation it guards.
+ */
+struct Precondition {
+  /// File must exist (true) or must not exist (false), any state if empty.
+  std::optional<bool> exists;
+
+  /// File must exist and have this version, any version if empty.
+  std::optional<Version> version;
+};
+
+/**
+ * \brief Check if a file satisfies a precondition.
+ *
+ * \param precondition Condition to check.
+ * \param version Version of the file, or nothing if there is no file.
+ *
+ * \return True if the precondition holds, false otherwise.
+ */
+inline bool satisfies(const Precondition& precondition,
+                      std::optional<Version> version) noexcept {
+  if (precondition.exists && (*precondition.exists != version.has_value())) {
+    return false;
+  }
+
+  return !precondition.version || (version == precondition.version);
+}
 
 /**
  * \brief List of filenames (paths)
@@ -39,7 +108,56 @@ class IFilesystem {
    *
    * \return Operation result and the file (if successfull).
    */
-  [[nodiscard]] virtual std::pair<Status, const File&> get(
+  [[nodiscard]] virtual std::pair<Status, Object> get(
+      const std::string& path) const noexcept = 0;
+
+  /**
+   * \brief Get file and its metadata from the specified path.
+   *
+   * \param path Path to the file to get.
+   *
+   * \return Operation result, the file and its metadata (if successfull).
+   */
+  [[nodiscard]] virtual std::tuple<Status, Object, FileInfo> getWithInfo(
+      const std::string& path) const noexcept = 0;
+
+  /**
+   * \brief Get file and its metadata, unless that would block (e.g. to read
+   * the file from disk).
+   *
+   * \param path Path to the file to get.
+   *
+   * \return Same as getWithInfo(), or nothing if the file has to be read with
+   * getWithInfo(), outside of latency sensitive threads.
+   */
+  [[nodiscard]] virtual std::optional<std::tuple<Status, Object, FileInfo>>
+  tryGet(const std::string& path) const noexcept {
+    return getWithInfo(path);
+  }
+
+  /**
+   * \brief Check if a file is stored on disk rather than in memory.
+   *
+   * Appending to or writing a file stored on disk reads it from disk first,
+   * which blocks. Such modifications are better made outside of latency
+   * sensitive threads.
+   *
+   * \param path Path to the file.
+   *
+   * \return True if the file is stored on disk, false otherwise.
+   */
+  [[nodiscard]] virtual bool isOnDisk(const std::string& path) const noexcept {
+    return false;
+  }
+
+  /**
+   * \brief Get metadata of the file at the specified path.
+   *
+   * \param path Path to the file.
+   *
+   * \return Operation result and the file metadata (if successfull).
+   */
+  [[nodiscard]] virtual std::pair<Status, FileInfo> stat(
       const std::string& path) const noexcept = 0;
 
   /**
@@ -52,6 +170,121 @@ class IFilesystem {
    */
   virtual Status add(const std::string& path, const File& file) noexcept = 0;
 
+  /**
+   * \brief Store file at the specified path if the precondition holds.
+   *
+   * Unlike add(), an existing file is replaced.
+   *
+   * A checksum computed by the writer while the contents were received is
+   * recorded with the new version, and reported by stat() and getWithInfo()
+   * until the file is modified. Filesystems which keep no checksums ignore
+   * it.
+   *
+   * \param path Path at which to store the file.
+   * \param file File to store.
+   * \param precondition Condition on the file currently stored at the path.
+   * \param checksum Checksum of the file contents, if known.
+   *
+   * \return Status of the put operation (PreconditionFailed if the condition
+   * does not hold) and the new version of the file (if successfull).
+   */
+  virtual std::pair<Status, Version> put(
+      const std::string& path, const File& file,
+      const Precondition& precondition,
+      std::optional<Checksum> checksum = std::nullopt) noexcept = 0;
+
+  /**
+   * \brief Start a multipart upload of a file.
+   *
+   * Parts of the file are uploaded separately (possibly concurrently), the
+   * file is only stored once the upload is completed.
+   *
+   * \param path Path at which to store the file.
+   *
+   * \return Identifier of the upload.
+   */
+  virtual UploadId createUpload(const std::string& path) noexcept = 0;
+
+  /**
+   * \brief Upload a part of a file.
+   *
+   * A part uploaded again replaces the previous one.
+   *
+   * \param upload Identifier of the upload.
+   * \param path Path at which the file is going to be stored.
+   * \param number Part number (parts are stitched together in this order).
+   * \param data Part contents.
+   *
+   * \return Status of the upload operation (FileNotFound if there is no such
+   * upload of the path, InvalidRange if the part number is out of range).
+   */
+  virtual Status uploadPart(UploadId upload, const std::string& path,
+                            std::size_t number, const File& data) noexcept = 0;
+
+  /**
+   * \brief Complete a multipart upload, storing the file if the precondition
+   * holds.
+   *
+   * The file is made of all uploaded parts, in order of their numbers.
+   *
+   * \param upload Identifier of the upload.
+   * \param path Path at which to store the file.
+   * \param precondition Condition on the file currently stored at the path.
+   *
+   * \return Status of the operation (FileNotFound if there is no such upload
+   * of the path) and the new version of the file (if successfull). The upload
+   * can be completed again if the precondition does not hold.
+   */
+  virtual std::pair<Status, Version> completeUpload(
+      UploadId upload, const std::string& path,
+      const Precondition& precondition) noexcept = 0;
+
+  /**
+   * \brief Abort a multipart upload, dropping all its parts.
+   *
+   * \param upload Identifier of the upload.
+   * \param path Path at which the file was going to be stored.
+   *
+   * \return Status of the operation (FileNotFound if there is no such upload
+   * of the path).
+   */
+  virtual Status abortUpload(UploadId upload,
+                             const std::string& path) noexcept = 0;
+
+  /**
+   * \brief Drop multipart uploads which were idle for too long.
+   *
+   * \return Number of dropped uploads.
+   */
+  virtual std::size_t expireUploads() = 0;
+
+  /**
+   * \brief Append data to the file at the specified path.
+   *
+   * The file is created if it does not exist yet.
+   *
+   * \param path Path to the file to append to.
+   * \param data Data to append.
+   *
+   * \return Status of the append operation.
+   */
+  virtual Status append(const std::string& path, const File& data) noexcept = 0;
+
+  /**
+   * \brief Overwrite part of the file at the specified path.
+   *
+   * The write must start within the file (or right at its end), but it may
+   * extend the file.
+   *
+   * \param path Path to the file to write to.
+   * \param offset Position of the first byte to overwrite.
+   * \param data Data to write.
+   *
+   * \return Status of the write operation.
+   */
+  virtual Status write(const std::string& path, std::size_t offset,
+                       const File& data) noexcept = 0;
+
   /**
    * \brief List all stored objects.
    *
@@ -67,6 +300,65 @@ class IFilesystem {
    * \return Status of the remove operation.
    */
   virtual Status remove(const std::string& path) noexcept = 0;
+
+  /**
+   * \brief Remove file from the specified path if the precondition holds.
+   *
+   * \param path Path to the file to remove.
+   * \param precondition Condition on the file to remove.
+   *
+   * \return Status of the remove operation (PreconditionFailed if the
+   * condition does not hold).
+   */
+  virtual Status remove(const std::string& path,
+                        const Precondition& precondition) noexcept = 0;
+
+  /**
+   * \brief Remove all files whose path starts with the given prefix.
+   *
+   * \note Files added while the prefix is being removed may be kept.
+   *
+   * \param prefix Path prefix (e.g. a directory path ending with '/').
+   *
+   * \return Number of removed files.
+   */
+  virtual std::size_t removePrefix(const std::string& prefix) noexcept = 0;
+
+  /**
+   * \brief Return the number and total size of files under a directory.
+   *
+   * \param directory Directory path ending with '/' (e.g. "/team/x/", or "/"
+   * for all files).
+   *
+   * \return Usage of the directory (all zeros if it holds no files).
+   */
+  [[nodiscard]] virtual Usage getUsage(
+      const std::string& directory) const noexcept = 0;
+
+  /**
+   * \brief Copy file to another path.
+   *
+   * The copy shares contents with the original, the contents are only
+   * duplicated once either of them is modified.
+   *
+   * \param source Path to the file to copy.
+   * \param destination Path at which to add the copy.
+   *
+   * \return Status of the copy operation.
+   */
+  virtual Status copy(const std::string& source,
+                      const std::string& destination) noexcept = 0;
+
+  /**
+   * \brief Move file to another path.
+   *
+   * \param source Path to the file to move.
+   * \param destination Path to move the file to.
+   *
+   * \return Status of the rename operation.
+   */
+  virtual Status rename(const std::string& source,
+                        const std::string& destination) noexcept = 0;
 };
 
 }  // namespace fs
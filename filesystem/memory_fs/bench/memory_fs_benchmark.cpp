@@ -0,0 +1,223 @@
+#include <malloc.h>
+
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "filesystem/memory_fs/src/memory_fs.hpp"
+
+using namespace fs;
+
+namespace {
+
+/// Number of objects stored by the tiny object workload.
+constexpr std::size_t kObjectCount{100000};
+
+/// Size of a tiny object (in bytes), e.g. a feature flag or small JSON.
+constexpr std::size_t kObjectSize{48};
+
+/**
+ * \brief Return paths of the tiny object workload.
+ *
+ * \return Object paths.
+ */
+std::vector<std::string> getPaths() {
+  std::vector<std::string> paths;
+  paths.reserve(kObjectCount);
+  for (std::size_t i = 0; i < kObjectCount; i++) {
+    paths.push_back("/flags/" + std::to_string(i));
+  }
+
+  return paths;
+}
+
+/**
+ * \brief Create a filesystem configuration with the inline threshold given by
+ * the benchmark argument.
+ *
+ * \param state Benchmark state.
+ *
+ * \return Filesystem configuration.
+ */
+MemoryFsConfig getConfig(const benchmark::State& state) {
+  MemoryFsConfig config;
+  config.inline_threshold = static_cast<std::size_t>(state.range(0));
+  return config;
+}
+
+/**
+ * \brief Store the tiny object workload.
+ *
+ * \param ms Filesystem to store the objects in.
+ * \param paths Object paths.
+ */
+void fill(MemoryFs& ms, const std::vector<std::string>& paths) {
+  const File file(kObjectSize, 'x');
+  for (const auto& path : paths) {
+    ms.add(path, file);
+  }
+}
+
+/**
+ * \brief Return number of bytes allocated from the heap.
+ *
+ * \return Heap bytes in use.
+ */
+std::size_t getHeapBytes() { return mallinfo2().uordblks; }
+
+}  // namespace
+
+/**
+ * \brief Memory taken per tiny object: index, heap allocations and arena.
+ *
+ * \param state Benchmark state (argument: inline threshold).
+ */
+static void BM_TinyObjectMemory(benchmark::State& state) {
+  const auto paths = getPaths();
+
+  for (auto _ : state) {
+    const auto heap_bytes = getHeapBytes();
+    MemoryFs ms{getConfig(state)};
+    fill(ms, paths);
+
+    const auto bytes = getHeapBytes() - heap_bytes +
+                       ms.getMemoryStats().mapped_bytes;
+    state.counters["bytes_per_object"] =
+        static_cast<double>(bytes) / static_cast<double>(kObjectCount);
+  }
+}
+BENCHMARK(BM_TinyObjectMemory)
+    ->ArgName("inline_threshold")
+    ->Arg(0)
+    ->Arg(Entry::kMaxInlineSize)
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond);
+
+/**
+ * \brief Latency of reading tiny objects, copying their contents out as the
+ * server does.
+ *
+ * \param state Benchmark state (argument: inline threshold).
+ */
+static void BM_TinyObjectGet(benchmark::State& state) {
+  const auto paths = getPaths();
+  MemoryFs ms{getConfig(state)};
+  fill(ms, paths);
+
+  std::size_t i{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ms.get(paths[i]).second.str());
+    i = (i + 1) % paths.size();
+  }
+}
+BENCHMARK(BM_TinyObjectGet)
+    ->ArgName("inline_threshold")
+    ->Arg(0)
+    ->Arg(Entry::kMaxInlineSize);
+
+/// Number of hot objects read by the hot GET workload.
+constexpr std::size_t kHotObjectCount{256};
+
+/**
+ * \brief Return filesystem shared by all threads of the hot GET workload.
+ *
+ * \param cache Serve reads from per-thread object caches.
+ *
+ * \return Shared filesystem holding the hot objects.
+ */
+MemoryFs& getHotFs(bool cache) {
+  static const auto fill_hot = [](MemoryFs& ms) {
+    const File file(1024, 'x');
+    for (std::size_t i = 0; i < kHotObjectCount; i++) {
+      ms.add("/hot/" + std::to_string(i), file);
+    }
+  };
+
+  static MemoryFs uncached{};
+  static MemoryFs cached{[] {
+    MemoryFsConfig config;
+    config.cache.slots = 1024;
+    return config;
+  }()};
+  static const auto filled = (fill_hot(uncached), fill_hot(cached), true);
+  (void)filled;
+
+  return cache ? cached : uncached;
+}
+
+/**
+ * \brief Throughput of reads of a few hundred hot objects from many threads.
+ *
+ * \param state Benchmark state (argument: object cache disabled/enabled).
+ */
+static void BM_HotGet(benchmark::State& state) {
+  auto& ms = getHotFs(state.range(0) != 0);
+  std::vector<std::string> paths;
+  for (std::size_t i = 0; i < kHotObjectCount; i++) {
+    paths.push_back("/hot/" + std::to_string(i));
+  }
+
+  std::size_t i{0};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ms.get(paths[i]));
+    i = (i + 1) % paths.size();
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HotGet)
+    ->ArgName("cache")
+    ->Arg(0)
+    ->Arg(1)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+
+/**
+ * \brief Return filesystem shared by all threads of the small PUT workload.
+ *
+ * \param combine_writes Apply concurrent writes in batches.
+ *
+ * \return Shared filesystem.
+ */
+MemoryFs& getSharedFs(bool combine_writes) {
+  static MemoryFs locking{};
+  static MemoryFs combining{[] {
+    MemoryFsConfig config;
+    config.combine_writes = true;
+    return config;
+  }()};
+  return combine_writes ? combining : locking;
+}
+
+/**
+ * \brief Throughput of small PUTs from many threads. Each object is removed
+ * right after it is stored, so that the filesystem size stays constant.
+ *
+ * \param state Benchmark state (argument: write combining disabled/enabled).
+ */
+static void BM_SmallPut(benchmark::State& state) {
+  auto& ms = getSharedFs(state.range(0) != 0);
+  const File file(kObjectSize, 'x');
+  const auto prefix =
+      "/" + std::to_string(std::hash<std::thread::id>{}(
+                std::this_thread::get_id())) +
+      '/';
+
+  std::size_t i{0};
+  for (auto _ : state) {
+    const auto path = prefix + std::to_string(i++ % 1024);
+    ms.add(path, file);
+    ms.remove(path);
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SmallPut)
+    ->ArgName("combine_writes")
+    ->Arg(0)
+    ->Arg(1)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
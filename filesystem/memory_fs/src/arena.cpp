@@ -0,0 +1,188 @@
+#include "arena.hpp"
+
+#include <sys/mman.h>
+
+#include <cstring>
+#include <new>
+
+namespace fs {
+
+Arena::Arena(const ArenaConfig& config) : state_{std::make_shared<State>()} {
+  state_->config = config;
+}
+
+Object Arena::allocate(const char* data, std::size_t size) {
+  if (size == 0) {
+    return {};
+  }
+
+  auto [block, buffer] = reserve(size);
+  std::memcpy(block, data, size);
+  return Object{std::move(buffer), size};
+}
+
+Object Arena::allocate(const Object& object) {
+  if (object.empty()) {
+    return {};
+  }
+
+  auto [block, buffer] = reserve(object.size());
+  for (const auto& extent : object.getExtents()) {
+    std::memcpy(block, extent.buffer.get(), extent.size);
+    block += extent.size;
+  }
+
+  return Object{std::move(buffer), object.size()};
+}
+
+std::size_t Arena::selectForEvacuation(double occupancy_threshold) {
+  std::size_t selected{0};
+  std::scoped_lock lock(state_->mutex);
+
+  for (auto& [base, region] : state_->regions) {
+    const auto occupancy =
+        static_cast<double>(region->live) / static_cast<double>(region->size);
+    region->evacuating =
+        region.get() != state_->current && occupancy < occupancy_threshold;
+    selected += region->evacuating ? 1 : 0;
+  }
+
+  return selected;
+}
+
+bool Arena::isEvacuating(const Object& object) const {
+  std::scoped_lock lock(state_->mutex);
+
+  for (const auto& extent : object.getExtents()) {
+    // Find the region with the greatest base address not above the extent.
+    auto region = state_->regions.upper_bound(extent.buffer.get());
+    if (region == state_->regions.begin()) {
+      continue;
+    }
+    region--;
+
+    const auto* base = region->second->base;
+    const auto in_region = extent.buffer.get() < base + region->second->size;
+    if (in_region && region->second->evacuating) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+ArenaStats Arena::getStats() const {
+  ArenaStats stats{};
+  std::scoped_lock lock(state_->mutex);
+
+  for (const auto& [base, region] : state_->regions) {
+    stats.regions++;
+    stats.mapped_bytes += region->size;
+    stats.live_bytes += region->live;
+  }
+
+  return stats;
+}
+
+std::pair<char*, Buffer> Arena::reserve(std::size_t size) {
+  std::unique_ptr<Region> unused;
+  std::unique_lock lock(state_->mutex);
+
+  Region* region{};
+  if (size > state_->config.max_block_size) {
+    // Large blocks get a region of their own, so that it can be returned to
+    // the OS as soon as the block is freed.
+    region = map(size);
+  } else {
+    auto* current = state_->current;
+    if (!current || align(current->used) + size > current->size) {
+      // The current region is full. If nothing in it is alive anymore, it can
+      // go back to the OS straight away, once the mutex is released.
+      auto* next = map(state_->config.region_size);
+      if (current && current->live == 0) {
+        unused = state_->detach(current);
+      }
+      state_->current = next;
+    }
+
+    region = state_->current;
+    region->used = align(region->used);
+  }
+
+  char* block = region->base + region->used;
+  region->used += size;
+  region->live += size;
+  lock.unlock();
+  State::unmap(std::move(unused));
+
+  // The deleter keeps arena internals alive for as long as the block exists.
+  Buffer buffer{block, [state = state_, region, size](const char*) {
+                  state->release(region, size);
+                }};
+  return {block, std::move(buffer)};
+}
+
+std::size_t Arena::align(std::size_t offset) noexcept {
+  return (offset + kBlockAlignment - 1) / kBlockAlignment * kBlockAlignment;
+}
+
+Arena::Region* Arena::map(std::size_t size) {
+  auto* base = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED) {
+    throw std::bad_alloc{};
+  }
+
+  auto region = std::make_unique<Region>(
+      Region{static_cast<char*>(base), size, 0, 0, false});
+  auto* raw_region = region.get();
+  state_->regions.emplace(raw_region->base, std::move(region));
+  return raw_region;
+}
+
+Arena::State::~State() {
+  for (auto& [base, region] : regions) {
+    munmap(region->base, region->size);
+  }
+}
+
+void Arena::State::release(Region* region, std::size_t size) noexcept {
+  std::unique_ptr<Region> unused;
+  {
+    std::scoped_lock lock(mutex);
+    region->live -= size;
+
+    // An empty current region is simply rewound and filled again, all other
+    // empty regions go back to the OS.
+    if (region->live == 0) {
+      if (region == current) {
+        region->used = 0;
+      } else {
+        unused = detach(region);
+      }
+    }
+  }
+
+  // Unmapping takes time in proportion to the region size, allocations do not
+  // wait for it.
+  unmap(std::move(unused));
+}
+
+std::unique_ptr<Arena::Region> Arena::State::detach(Region* region) noexcept {
+  if (region == current) {
+    current = nullptr;
+  }
+
+  const auto found = regions.find(region->base);
+  auto detached = std::move(found->second);
+  regions.erase(found);
+  return detached;
+}
+
+void Arena::State::unmap(std::unique_ptr<Region> region) noexcept {
+  if (region) {
+    munmap(region->base, region->size);
+  }
+}
+
+}  // namespace fs
@@ -0,0 +1,209 @@
+#ifndef FILESYSTEM_MEMORY_FS_SRC_ARENA_HPP
+#define FILESYSTEM_MEMORY_FS_SRC_ARENA_HPP
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "filesystem/object/src/object.hpp"
+
+namespace fs {
+
+/**
+ * \brief Memory arena configuration.
+ */
+struct ArenaConfig {
+  /// Size of a single region mapped from the OS (in bytes).
+  std::size_t region_size{4 * 1024 * 1024};
+
+  /// Blocks larger than this are given a dedicated mapping of their own.
+  std::size_t max_block_size{512 * 1024};
+};
+
+/**
+ * \brief Memory arena statistics.
+ */
+struct ArenaStats {
+  std::size_t regions;       ///< Number of regions currently mapped.
+  std::size_t mapped_bytes;  ///< Total number of bytes mapped from the OS.
+  std::size_t live_bytes;    ///< Number of bytes held by live blocks.
+};
+
+/**
+ * \brief Region-based memory arena for object payloads.
+ *
+ * Memory is mapped from the OS in fixed-size regions and handed out to objects
+ * by bumping a pointer in the current region. Freed blocks are only accounted
+ * for, so a region is returned to the OS as soon as all of its blocks are
+ * freed. Sparsely populated regions can be selected for evacuation: their
+ * live blocks are then relocated by the compactor, which eventually empties
+ * and unmaps them.
+ *
+ * Blocks hold a reference to the arena internals, so it is safe for blocks to
+ * outlive the arena itself.
+ */
+class Arena {
+ public:
+  /**
+   * \brief Create a memory arena.
+   *
+   * \param config Arena configuration.
+   */
+  explicit Arena(const ArenaConfig& config = {});
+
+  ~Arena() = default;
+
+  // Arena is non-copyable and non-moveable, blocks refer to its internals.
+  Arena(const Arena& other) = delete;
+  Arena(Arena&& other) = delete;
+  Arena& operator=(const Arena& other) = delete;
+  Arena& operator=(Arena&&) = delete;
+
+  /**
+   * \brief Allocate an object in the arena and copy the given data into it.
+   *
+   * \throw std::bad_alloc If memory could not be mapped from the OS.
+   *
+   * \param data Object contents.
+   * \param size Object size (in bytes).
+   *
+   * \return Object backed by the arena memory.
+   */
+  [[nodiscard]] Object allocate(const char* data, std::size_t size);
+
+  /**
+   * \brief Allocate a single contiguous block in the arena and copy all
+   * extents of the given object into it.
+   *
+   * \throw std::bad_alloc If memory could not be mapped from the OS.
+   *
+   * \param object Object to copy.
+   *
+   * \return Copy of the object backed by the arena memory.
+   */
+  [[nodiscard]] Object allocate(const Object& object);
+
+  /**
+   * \brief Select sparsely populated regions for evacuation.
+   *
+   * The region currently used for allocations is never selected.
+   *
+   * \param occupancy_threshold Regions with live/mapped bytes ratio below this
+   * threshold are selected.
+   *
+   * \return Number of regions selected for evacuation.
+   */
+  std::size_t selectForEvacuation(double occupancy_threshold);
+
+  /**
+   * \brief Check if the given object should be relocated.
+   *
+   * \param object Object to check.
+   *
+   * \return True if any part of the object lives in a region selected for
+   * evacuation.
+   */
+  [[nodiscard]] bool isEvacuating(const Object& object) const;
+
+  /**
+   * \brief Return arena statistics.
+   *
+   * \return Arena statistics.
+   */
+  [[nodiscard]] ArenaStats getStats() const;
+
+ private:
+  /// Memory region mapped from the OS.
+  struct Region {
+    char* base;        ///< First byte of the region.
+    std::size_t size;  ///< Region size (in bytes).
+    std::size_t used;  ///< Number of bytes handed out (bump pointer).
+    std::size_t live;  ///< Number of bytes held by live blocks.
+    bool evacuating;   ///< Region was selected for evacuation.
+  };
+
+  /// Arena internals shared with all blocks allocated in the arena.
+  struct State {
+    ~State();
+
+    /**
+     * \brief Release a block allocated from the given region.
+     *
+     * \param region Region the block was allocated from.
+     * \param size Block size (in bytes).
+     */
+    void release(Region* region, std::size_t size) noexcept;
+
+    /**
+     * \brief Forget about a region.
+     *
+     * \note Must be called with the mutex held.
+     *
+     * \param region Region to forget.
+     *
+     * \return The region, to be unmapped once the mutex is released.
+     */
+    std::unique_ptr<Region> detach(Region* region) noexcept;
+
+    /**
+     * \brief Unmap a region.
+     *
+     * \param region Detached region (or nullptr).
+     */
+    static void unmap(std::unique_ptr<Region> region) noexcept;
+
+    /// Arena configuration.
+    ArenaConfig config;
+
+    /// Mapped regions indexed by their base address.
+    std::map<const char*, std::unique_ptr<Region>> regions;
+
+    /// Region from which small blocks are currently allocated.
+    Region* current{nullptr};
+
+    /// Protects regions and their accounting.
+    mutable std::mutex mutex;
+  };
+
+  /**
+   * \brief Reserve a block of memory in the arena.
+   *
+   * \throw std::bad_alloc If memory could not be mapped from the OS.
+   *
+   * \param size Block size (in bytes), greater than zero.
+   *
+   * \return Pointer to the block and the buffer releasing it once unused.
+   */
+  std::pair<char*, Buffer> reserve(std::size_t size);
+
+  /**
+   * \brief Map a new region from the OS.
+   *
+   * \throw std::bad_alloc If memory could not be mapped.
+   *
+   * \param size Region size (in bytes).
+   *
+   * \return Newly mapped region.
+   */
+  Region* map(std::size_t size);
+
+  /**
+   * \brief Round offset up to the block alignment.
+   *
+   * \param offset Offset within a region.
+   *
+   * \return Aligned offset.
+   */
+  static std::size_t align(std::size_t offset) noexcept;
+
+  /// Alignment of blocks allocated in a shared region.
+  static constexpr std::size_t kBlockAlignment{16};
+
+  std::shared_ptr<State> state_;  ///< Arena internals.
+};
+
+}  // namespace fs
+
+#endif  // FILESYSTEM_MEMORY_FS_SRC_ARENA_HPP
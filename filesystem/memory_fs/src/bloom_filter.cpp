@@ -0,0 +1,45 @@
+#include "bloom_filter.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace fs {
+
+BloomFilter::BloomFilter(std::size_t capacity, std::size_t bits_per_key)
+    : bit_count_{std::max<std::size_t>(capacity * bits_per_key, 64)},
+      // k = ln(2) * m / n minimizes the false positive rate.
+      hash_count_{std::clamp<std::size_t>(bits_per_key * 69 / 100, 1, 30)},
+      capacity_{capacity} {
+  bits_.resize((bit_count_ + 63) / 64);
+}
+
+void BloomFilter::add(std::string_view key) noexcept {
+  // Double hashing: bit i is h1 + i * h2, both derived from a single hash.
+  const std::uint64_t hash = std::hash<std::string_view>{}(key);
+  const std::uint64_t delta = (hash >> 33) | (hash << 31) | 1;
+
+  std::uint64_t position = hash;
+  for (std::size_t i = 0; i < hash_count_; i++, position += delta) {
+    const auto bit = position % bit_count_;
+    bits_[bit / 64] |= std::uint64_t{1} << (bit % 64);
+  }
+
+  size_++;
+}
+
+bool BloomFilter::mayContain(std::string_view key) const noexcept {
+  const std::uint64_t hash = std::hash<std::string_view>{}(key);
+  const std::uint64_t delta = (hash >> 33) | (hash << 31) | 1;
+
+  std::uint64_t position = hash;
+  for (std::size_t i = 0; i < hash_count_; i++, position += delta) {
+    const auto bit = position % bit_count_;
+    if ((bits_[bit / 64] & (std::uint64_t{1} << (bit % 64))) == 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace fs
@@ -0,0 +1,70 @@
+#ifndef FILESYSTEM_MEMORY_FS_SRC_BLOOM_FILTER_HPP
+#define FILESYSTEM_MEMORY_FS_SRC_BLOOM_FILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace fs {
+
+/**
+ * \brief Probabilistic set of keys.
+ *
+ * Answers "definitely not present" or "possibly present". Keys cannot be
+ * removed, the filter has to be rebuilt instead.
+ */
+class BloomFilter {
+ public:
+  /**
+   * \brief Create an empty bloom filter.
+   *
+   * \param capacity Number of keys the filter is sized for.
+   * \param bits_per_key Number of bits per key (10 gives ~1% false positives).
+   */
+  explicit BloomFilter(std::size_t capacity = 1024,
+                       std::size_t bits_per_key = 10);
+
+  /**
+   * \brief Add a key to the filter.
+   *
+   * \param key Key to add.
+   */
+  void add(std::string_view key) noexcept;
+
+  /**
+   * \brief Check if a key may be in the filter.
+   *
+   * \param key Key to check.
+   *
+   * \return False if the key was never added, true if it probably was.
+   */
+  [[nodiscard]] bool mayContain(std::string_view key) const noexcept;
+
+  /**
+   * \brief Return number of keys the filter is sized for.
+   *
+   * \return Filter capacity.
+   */
+  [[nodiscard]] inline std::size_t getCapacity() const noexcept {
+    return capacity_;
+  }
+
+  /**
+   * \brief Return number of keys added to the filter.
+   *
+   * \return Number of keys added.
+   */
+  [[nodiscard]] inline std::size_t size() const noexcept { return size_; }
+
+ private:
+  std::vector<std::uint64_t> bits_;  ///< Filter bit array.
+  std::size_t bit_count_;            ///< Number of bits in the filter.
+  std::size_t hash_count_;           ///< Number of bits set per key.
+  std::size_t capacity_;             ///< Number of keys filter is sized for.
+  std::size_t size_{0};              ///< Number of keys added.
+};
+
+}  // namespace fs
+
+#endif  // FILESYSTEM_MEMORY_FS_SRC_BLOOM_FILTER_HPP
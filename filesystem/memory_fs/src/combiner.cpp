@@ -0,0 +1,99 @@
+#include "combiner.hpp"
+
+#include <functional>
+#include <thread>
+
+namespace fs {
+
+Combiner::Combiner(std::shared_mutex& mutex) noexcept : mutex_{mutex} {}
+
+std::size_t Combiner::getPasses() const noexcept {
+  return passes_.load(std::memory_order_relaxed);
+}
+
+std::size_t Combiner::getOperations() const noexcept {
+  return operations_.load(std::memory_order_relaxed);
+}
+
+void Combiner::execute(void* context, void (*invoke)(void* context)) noexcept {
+  if (mutex_.try_lock()) {
+    invoke(context);
+    const auto applied = 1 + combine();
+    mutex_.unlock();
+
+    passes_.fetch_add(1, std::memory_order_relaxed);
+    operations_.fetch_add(applied, std::memory_order_relaxed);
+    return;
+  }
+
+  auto& slot = claim();
+  slot.context = context;
+  slot.invoke = invoke;
+  pending_.fetch_add(1, std::memory_order_relaxed);
+  slot.state.store(State::Pending, std::memory_order_release);
+
+  for (std::size_t spins = 0;
+       slot.state.load(std::memory_order_acquire) != State::Done; spins++) {
+    if (spins < kMaxSpins) {
+      if (!mutex_.try_lock()) {
+        std::this_thread::yield();
+        continue;
+      }
+    } else {
+      // Readers may hold the lock for a while, stop spinning.
+      mutex_.lock();
+    }
+
+    const auto applied = combine();
+    mutex_.unlock();
+
+    if (applied > 0) {
+      passes_.fetch_add(1, std::memory_order_relaxed);
+      operations_.fetch_add(applied, std::memory_order_relaxed);
+    }
+  }
+
+  slot.state.store(State::Free, std::memory_order_release);
+}
+
+Combiner::Slot& Combiner::claim() noexcept {
+  // Threads start probing at different slots, so that they rarely contend
+  // for the same one.
+  thread_local const auto first =
+      std::hash<std::thread::id>{}(std::this_thread::get_id());
+
+  for (auto i = first;; i++) {
+    auto& slot = slots_[i % kSlotCount];
+    auto expected = State::Free;
+    if (slot.state.compare_exchange_weak(expected, State::Claimed,
+                                         std::memory_order_acquire)) {
+      return slot;
+    }
+
+    if ((i - first) % kSlotCount == kSlotCount - 1) {
+      // More threads than slots, wait for one to be released.
+      std::this_thread::yield();
+    }
+  }
+}
+
+std::size_t Combiner::combine() noexcept {
+  // Operations published after the check are applied by their owners.
+  if (pending_.load(std::memory_order_acquire) == 0) {
+    return 0;
+  }
+
+  std::size_t applied{0};
+  for (auto& slot : slots_) {
+    if (slot.state.load(std::memory_order_acquire) == State::Pending) {
+      slot.invoke(slot.context);
+      slot.state.store(State::Done, std::memory_order_release);
+      applied++;
+    }
+  }
+
+  pending_.fetch_sub(applied, std::memory_order_relaxed);
+  return applied;
+}
+
+}  // namespace fs
@@ -0,0 +1,134 @@
+#ifndef FILESYSTEM_MEMORY_FS_SRC_COMBINER_HPP
+#define FILESYSTEM_MEMORY_FS_SRC_COMBINER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+
+namespace fs {
+
+/**
+ * \brief Flat combining of operations which need an exclusive lock.
+ *
+ * Threads publish their operations in slots of a shared publication array
+ * instead of queueing up on the lock. Whichever thread gets the lock applies
+ * all published operations in a single critical section, so that a burst of
+ * small mutations costs one lock hand-off rather than one per mutation.
+ * Threads whose operations were applied by another thread return without
+ * ever taking the lock. Operations are only published if the lock is taken,
+ * uncontended ones are applied right away.
+ *
+ * Operations are called on an arbitrary thread, while the caller waits. They
+ * may therefore refer to the caller's stack, and should leave anything
+ * expensive to free (e.g. removed objects) to the caller.
+ */
+class Combiner {
+ public:
+  /**
+   * \brief Create a combiner of operations guarded by the given lock.
+   *
+   * \param mutex Lock guarding the data the operations modify.
+   */
+  explicit Combiner(std::shared_mutex& mutex) noexcept;
+
+  // Combiner is non-copyable and non-moveable, as are the slots.
+  Combiner(const Combiner& other) = delete;
+  Combiner(Combiner&& other) = delete;
+  Combiner& operator=(const Combiner& other) = delete;
+  Combiner& operator=(Combiner&&) = delete;
+
+  /**
+   * \brief Apply an operation under the exclusive lock.
+   *
+   * \note Returns once the operation was applied, by this thread or another
+   * one. The operation must not throw.
+   *
+   * \param operation Operation to apply (callable without arguments).
+   */
+  template <typename Operation>
+  void execute(Operation& operation) noexcept {
+    execute(&operation,
+            [](void* context) { (*static_cast<Operation*>(context))(); });
+  }
+
+  /**
+   * \brief Return number of critical sections which applied operations.
+   *
+   * \return Number of combining passes.
+   */
+  [[nodiscard]] std::size_t getPasses() const noexcept;
+
+  /**
+   * \brief Return number of operations applied.
+   *
+   * \return Number of applied operations.
+   */
+  [[nodiscard]] std::size_t getOperations() const noexcept;
+
+ private:
+  /**
+   * \brief Slot state.
+   */
+  enum class State : std::uint8_t {
+    Free,     ///< Slot can be claimed.
+    Claimed,  ///< Slot is being filled in by its owner.
+    Pending,  ///< Operation is waiting to be applied.
+    Done,     ///< Operation was applied, result can be read by the owner.
+  };
+
+  /**
+   * \brief Publication slot, on a cache line of its own.
+   */
+  struct alignas(64) Slot {
+    std::atomic<State> state{State::Free};   ///< Slot state.
+    void* context{nullptr};                  ///< Operation to apply.
+    void (*invoke)(void* context){nullptr};  ///< Applies the operation.
+  };
+
+  /// Number of publication slots (concurrently published operations).
+  static constexpr std::size_t kSlotCount{64};
+
+  /// Failed attempts to take the lock before blocking on it.
+  static constexpr std::size_t kMaxSpins{64};
+
+  /**
+   * \brief Apply a type-erased operation under the exclusive lock.
+   *
+   * \param context Operation to apply.
+   * \param invoke Function applying the operation.
+   */
+  void execute(void* context, void (*invoke)(void* context)) noexcept;
+
+  /**
+   * \brief Claim a free slot, preferably the one of the calling thread.
+   *
+   * \return Claimed slot.
+   */
+  Slot& claim() noexcept;
+
+  /**
+   * \brief Apply all pending operations.
+   *
+   * \note Must be called with the exclusive lock held.
+   *
+   * \return Number of applied operations.
+   */
+  std::size_t combine() noexcept;
+
+  std::shared_mutex& mutex_;  ///< Lock guarding the data.
+
+  std::array<Slot, kSlotCount> slots_;  ///< Publication array.
+
+  /// Number of published operations, so that the slots are only scanned if
+  /// there are any.
+  alignas(64) std::atomic<std::size_t> pending_{0};
+
+  std::atomic<std::size_t> passes_{0};      ///< Number of combining passes.
+  std::atomic<std::size_t> operations_{0};  ///< Number of operations applied.
+};
+
+}  // namespace fs
+
+#endif  // FILESYSTEM_MEMORY_FS_SRC_COMBINER_HPP
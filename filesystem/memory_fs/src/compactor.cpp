@@ -0,0 +1,75 @@
+#include "compactor.hpp"
+
+#include <algorithm>
+
+#include "memory_fs.hpp"
+
+namespace fs {
+
+Compactor::Compactor(MemoryFs& filesystem,
+                     const CompactorConfig& config) noexcept
+    : filesystem_{filesystem}, config_{config} {}
+
+void Compactor::start() {
+  std::scoped_lock lock(mutex_);
+  if (running_) {
+    return;
+  }
+
+  running_ = true;
+  worker_ = std::thread{[this] { run(); }};
+}
+
+void Compactor::stop() {
+  {
+    std::scoped_lock lock(mutex_);
+    running_ = false;
+  }
+
+  wake_up_.notify_all();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+CompactorStats Compactor::getStats() const noexcept {
+  return {passes_, objects_moved_, bytes_moved_};
+}
+
+void Compactor::run() {
+  using Clock = std::chrono::steady_clock;
+  using Seconds = std::chrono::duration<double>;
+
+  const auto cpu_budget = std::clamp(config_.cpu_budget, 0.001, 1.0);
+  const auto bandwidth_budget =
+      static_cast<double>(std::max<std::size_t>(config_.bandwidth_budget, 1));
+
+  std::unique_lock lock(mutex_);
+  while (running_) {
+    lock.unlock();
+
+    const auto step_start = Clock::now();
+    const auto result = filesystem_.compact(config_.batch_size);
+    const Seconds work_time = Clock::now() - step_start;
+
+    objects_moved_ += result.objects_moved;
+    bytes_moved_ += result.bytes_moved;
+
+    // Sleep long enough for the time spent working to stay within the CPU
+    // budget and for the bytes copied to stay within the bandwidth budget.
+    Seconds pause = work_time * ((1.0 - cpu_budget) / cpu_budget);
+    pause = std::max(pause,
+                     Seconds{static_cast<double>(result.bytes_moved) /
+                             bandwidth_budget});
+
+    if (result.pass_completed) {
+      passes_++;
+      pause = std::max<Seconds>(pause, config_.pass_interval);
+    }
+
+    lock.lock();
+    wake_up_.wait_for(lock, pause, [this] { return !running_; });
+  }
+}
+
+}  // namespace fs
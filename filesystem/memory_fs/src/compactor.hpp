@@ -0,0 +1,111 @@
+#ifndef FILESYSTEM_MEMORY_FS_SRC_COMPACTOR_HPP
+#define FILESYSTEM_MEMORY_FS_SRC_COMPACTOR_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+namespace fs {
+
+class MemoryFs;
+
+/**
+ * \brief Background compactor configuration.
+ */
+struct CompactorConfig {
+  /// Run the compactor in the background.
+  bool enabled{false};
+
+  /// Arena regions with live/mapped bytes ratio below this are evacuated.
+  double occupancy_threshold{0.5};
+
+  /// Maximum number of objects relocated in a single step.
+  std::size_t batch_size{64};
+
+  /// Fraction of a single CPU core the compactor is allowed to use.
+  double cpu_budget{0.05};
+
+  /// Maximum number of bytes relocated per second.
+  std::size_t bandwidth_budget{64 * 1024 * 1024};
+
+  /// Delay between two consecutive compaction passes.
+  std::chrono::milliseconds pass_interval{1000};
+};
+
+/**
+ * \brief Background compactor statistics.
+ */
+struct CompactorStats {
+  std::size_t passes;         ///< Number of completed compaction passes.
+  std::size_t objects_moved;  ///< Number of objects relocated.
+  std::size_t bytes_moved;    ///< Number of bytes relocated.
+};
+
+/**
+ * \brief Incremental background compactor of object memory.
+ *
+ * Periodically walks the filesystem in small steps and relocates objects out
+ * of sparsely populated arena regions. Each step is followed by a pause long
+ * enough to keep the compactor within its CPU and bandwidth budget, so that
+ * foreground requests are not affected.
+ */
+class Compactor {
+ public:
+  /**
+   * \brief Create a compactor for the given filesystem.
+   *
+   * \param filesystem Filesystem to compact.
+   * \param config Compactor configuration.
+   */
+  Compactor(MemoryFs& filesystem, const CompactorConfig& config) noexcept;
+
+  ~Compactor() { stop(); }
+
+  // Compactor is non-copyable and non-moveable, it owns a running thread.
+  Compactor(const Compactor& other) = delete;
+  Compactor(Compactor&& other) = delete;
+  Compactor& operator=(const Compactor& other) = delete;
+  Compactor& operator=(Compactor&&) = delete;
+
+  /**
+   * \brief Start compacting in the background.
+   */
+  void start();
+
+  /**
+   * \brief Stop the background compaction and wait for it to finish.
+   */
+  void stop();
+
+  /**
+   * \brief Return compactor statistics.
+   *
+   * \return Compactor statistics.
+   */
+  [[nodiscard]] CompactorStats getStats() const noexcept;
+
+ private:
+  /**
+   * \brief Compactor thread main loop.
+   */
+  void run();
+
+  MemoryFs& filesystem_;    ///< Filesystem to compact.
+  CompactorConfig config_;  ///< Compactor configuration.
+
+  std::thread worker_;               ///< Compactor thread.
+  bool running_{false};              ///< Is compactor thread running?
+  std::mutex mutex_;                 ///< Protects running flag.
+  std::condition_variable wake_up_;  ///< Wakes up the compactor thread.
+
+  std::atomic<std::size_t> passes_{0};         ///< Completed passes.
+  std::atomic<std::size_t> objects_moved_{0};  ///< Relocated objects.
+  std::atomic<std::size_t> bytes_moved_{0};    ///< Relocated bytes.
+};
+
+}  // namespace fs
+
+#endif  // FILESYSTEM_MEMORY_FS_SRC_COMPACTOR_HPP
@@ -0,0 +1,290 @@
+#include "disk_tier.hpp"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <vector>
+
+namespace fs {
+
+DiskTier::DiskTier(const DiskTierConfig& config) : config_{config} {
+  std::string directory{config_.directory + "/object_storage-XXXXXX"};
+  if (::mkdtemp(directory.data()) == nullptr) {
+    throw std::system_error{errno, std::generic_category(),
+                            "Failed to create disk tier directory"};
+  }
+
+  directory_ = std::move(directory);
+}
+
+DiskTier::~DiskTier() {
+  segments_.clear();
+  ::rmdir(directory_.c_str());
+}
+
+DiskTier::Segment::~Segment() {
+  if (fd >= 0) {
+    ::close(fd);
+    ::unlink(path.c_str());
+  }
+}
+
+std::optional<DiskLocation> DiskTier::write(const Object& object) noexcept {
+  std::shared_ptr<Segment> segment;
+  DiskLocation location{};
+  {
+    std::unique_lock lock(mutex_);
+
+    // Start a new segment once the current one is full. Objects larger than a
+    // segment get a segment of their own.
+    auto current = segments_.find(current_segment_);
+    if ((current == segments_.end()) ||
+        ((current->second->size > 0) &&
+         (current->second->size + object.size() > config_.segment_size))) {
+      auto new_segment = std::make_shared<Segment>();
+      new_segment->path =
+          directory_ + "/segment-" + std::to_string(next_segment_);
+      new_segment->fd =
+          ::open(new_segment->path.c_str(),
+                 O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+      if (new_segment->fd < 0) {
+        return {};
+      }
+
+      // The previous segment may have been emptied while being written to.
+      if ((current != segments_.end()) && (current->second->live == 0)) {
+        segments_.erase(current);
+      }
+
+      current_segment_ = next_segment_++;
+      current =
+          segments_.emplace(current_segment_, std::move(new_segment)).first;
+    }
+
+    // Reserve space in the segment, the data is written outside of the lock.
+    segment = current->second;
+    location = {current_segment_, segment->size, object.size()};
+    segment->size += object.size();
+    segment->live += object.size();
+  }
+
+  // Write all extents with as few system calls as possible.
+  std::vector<iovec> iov;
+  for (const auto& extent : object.getExtents()) {
+    iov.push_back({const_cast<char*>(extent.buffer.get()), extent.size});
+  }
+
+  auto offset = static_cast<off_t>(location.offset);
+  auto first = iov.begin();
+  while (first != iov.end()) {
+    const auto count = std::min<std::ptrdiff_t>(iov.end() - first, IOV_MAX);
+    const auto written = ::pwritev(segment->fd, &*first, count, offset);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      release(location);
+      return {};
+    }
+
+    // Skip the extents written completely, and the written part of the next
+    // one.
+    offset += written;
+    auto remaining = static_cast<std::size_t>(written);
+    while ((first != iov.end()) && (remaining >= first->iov_len)) {
+      remaining -= first->iov_len;
+      first++;
+    }
+
+    if (remaining > 0) {
+      first->iov_base = static_cast<char*>(first->iov_base) + remaining;
+      first->iov_len -= remaining;
+    }
+  }
+
+  return location;
+}
+
+void DiskTier::insert(const std::string& path, const DiskLocation& location) {
+  std::unique_lock lock(mutex_);
+  insertLocked(path, location);
+}
+
+void DiskTier::link(const std::string& path, const DiskLocation& location) {
+  std::unique_lock lock(mutex_);
+
+  // Linked bytes are accounted for once per object, so that the segment
+  // outlives all of them.
+  const auto segment = segments_.find(location.segment);
+  if (segment != segments_.end()) {
+    segment->second->live += location.size;
+  }
+
+  insertLocked(path, location);
+}
+
+void DiskTier::insertLocked(const std::string& path,
+                            const DiskLocation& location) {
+  auto [entry, inserted] = index_.try_emplace(path, location);
+  if (!inserted) {
+    releaseLocked(entry->second);
+    entry->second = location;
+  }
+
+  filter_.add(path);
+  maybeRebuildFilter();
+}
+
+bool DiskTier::mayContain(const std::string& path) const noexcept {
+  std::shared_lock lock(mutex_);
+  return filter_.mayContain(path);
+}
+
+std::optional<DiskLocation> DiskTier::find(
+    const std::string& path) const noexcept {
+  std::shared_lock lock(mutex_);
+
+  const auto entry = index_.find(path);
+  if (entry == index_.end()) {
+    return {};
+  }
+
+  return entry->second;
+}
+
+std::tuple<Status, DiskLocation, Object> DiskTier::read(
+    const std::string& path) const noexcept {
+  std::shared_ptr<Segment> segment;
+  DiskLocation location{};
+  {
+    std::shared_lock lock(mutex_);
+
+    const auto entry = index_.find(path);
+    if (entry == index_.end()) {
+      return {Status::FileNotFound, {}, {}};
+    }
+
+    location = entry->second;
+    if (location.size == 0) {
+      return {Status::Success, location, {}};
+    }
+
+    // Holding the segment keeps the file open, even if the object is removed
+    // while it is being read.
+    segment = segments_.at(location.segment);
+  }
+
+  std::shared_ptr<char> buffer{new (std::nothrow) char[location.size],
+                               std::default_delete<char[]>()};
+  if (!buffer) {
+    return {Status::IoError, location, {}};
+  }
+
+  std::size_t done{0};
+  while (done < location.size) {
+    const auto result =
+        ::pread(segment->fd, buffer.get() + done, location.size - done,
+                static_cast<off_t>(location.offset + done));
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (result <= 0) {
+      return {Status::IoError, location, {}};
+    }
+
+    done += static_cast<std::size_t>(result);
+  }
+
+  // The object is cached in memory by the caller, there is no point in
+  // keeping it in the page cache as well.
+  ::posix_fadvise(segment->fd, static_cast<off_t>(location.offset),
+                  static_cast<off_t>(location.size), POSIX_FADV_DONTNEED);
+
+  return {Status::Success, location, Object{std::move(buffer), location.size}};
+}
+
+bool DiskTier::erase(const std::string& path) noexcept {
+  std::unique_lock lock(mutex_);
+
+  const auto entry = index_.find(path);
+  if (entry == index_.end()) {
+    return false;
+  }
+
+  releaseLocked(entry->second);
+  index_.erase(entry);
+  removed_since_rebuild_++;
+  maybeRebuildFilter();
+
+  return true;
+}
+
+void DiskTier::release(const DiskLocation& location) noexcept {
+  std::unique_lock lock(mutex_);
+  releaseLocked(location);
+}
+
+FileList DiskTier::list() const {
+  FileList list;
+  std::shared_lock lock(mutex_);
+
+  for (const auto& entry : index_) {
+    list.emplace_back(entry.first);
+  }
+
+  return list;
+}
+
+DiskTierStats DiskTier::getStats() const noexcept {
+  std::shared_lock lock(mutex_);
+
+  DiskTierStats stats{index_.size(), segments_.size(), 0, 0};
+  for (const auto& segment : segments_) {
+    stats.disk_bytes += segment.second->size;
+    stats.live_bytes += segment.second->live;
+  }
+
+  return stats;
+}
+
+void DiskTier::releaseLocked(const DiskLocation& location) noexcept {
+  const auto segment = segments_.find(location.segment);
+  if (segment == segments_.end()) {
+    return;
+  }
+
+  // Segments are never reused, so a segment with no live objects left can be
+  // deleted as soon as no more objects are appended to it.
+  segment->second->live -= location.size;
+  if ((segment->second->live == 0) && (location.segment != current_segment_)) {
+    segments_.erase(segment);
+  }
+}
+
+void DiskTier::maybeRebuildFilter() {
+  // Removed paths can only be dropped from the filter by rebuilding it, which
+  // is also when the filter is resized to the index. Rebuilding only once
+  // there are more stale paths than live ones keeps the cost amortized O(1).
+  if ((index_.size() <= filter_.getCapacity()) &&
+      (removed_since_rebuild_ <= index_.size())) {
+    return;
+  }
+
+  filter_ = BloomFilter{std::max(kMinFilterCapacity, index_.size() * 2)};
+  for (const auto& entry : index_) {
+    filter_.add(entry.first);
+  }
+
+  removed_since_rebuild_ = 0;
+}
+
+}  // namespace fs
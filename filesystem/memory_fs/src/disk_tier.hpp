@@ -0,0 +1,299 @@
+#ifndef FILESYSTEM_MEMORY_FS_SRC_DISK_TIER_HPP
+#define FILESYSTEM_MEMORY_FS_SRC_DISK_TIER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+#include "bloom_filter.hpp"
+#include "filesystem/ifilesystem.hpp"
+
+namespace fs {
+
+/**
+ * \brief Disk tier configuration.
+ */
+struct DiskTierConfig {
+  /// Spill cold objects to disk.
+  bool enabled{false};
+
+  /// Directory in which segment files are created.
+  std::string directory{"/tmp"};
+
+  /// Object bytes kept in memory before cold objects are moved to disk.
+  std::size_t memory_budget{1024 * 1024 * 1024};
+
+  /// Size of a single segment file (in bytes).
+  std::size_t segment_size{64 * 1024 * 1024};
+
+  /// Move objects between tiers in a background thread (otherwise only on
+  /// MemoryFs::migrate() calls).
+  bool migrate_in_background{true};
+
+  /// Maximum number of objects moved between tiers in a single step.
+  std::size_t batch_size{64};
+
+  /// Delay between migration steps, when there is nothing to migrate.
+  std::chrono::milliseconds interval{100};
+
+  /// Number of threads serving reads of objects resident on disk.
+  std::size_t io_threads{4};
+};
+
+/**
+ * \brief Location of an object on disk.
+ */
+struct DiskLocation {
+  std::uint64_t segment;  ///< Segment ID.
+  std::size_t offset;     ///< Position within the segment (in bytes).
+  std::size_t size;       ///< Object size (in bytes).
+
+  /// Version of the object (carried over from memory, not stored on disk).
+  Version version{0};
+
+  /// Time of the last modification of the object (carried over from memory).
+  std::chrono::system_clock::time_point modified{};
+
+  /**
+   * \brief Compare two locations.
+   *
+   * \param other Location to compare with.
+   *
+   * \return True if both locations point to the same object copy.
+   */
+  inline bool operator==(const DiskLocation& other) const noexcept {
+    return (segment == other.segment) && (offset == other.offset) &&
+           (size == other.size);
+  }
+
+  /**
+   * \brief Compare two locations.
+   *
+   * \param other Location to compare with.
+   *
+   * \return True if locations point to different object copies.
+   */
+  inline bool operator!=(const DiskLocation& other) const noexcept {
+    return !(*this == other);
+  }
+};
+
+/**
+ * \brief Disk tier statistics.
+ */
+struct DiskTierStats {
+  std::size_t objects;     ///< Number of objects on disk.
+  std::size_t segments;    ///< Number of segment files.
+  std::size_t disk_bytes;  ///< Total size of segment files.
+  /// Number of bytes held by live objects (contents linked to several
+  /// objects count once per object).
+  std::size_t live_bytes;
+};
+
+/**
+ * \brief Log-structured on-disk object store.
+ *
+ * Objects are appended to fixed-size segment files and read back with pread().
+ * The index of objects on disk and a bloom filter over their paths are kept in
+ * memory, so neither lookups of objects which are not on disk nor lookups of
+ * object locations touch the disk. Segment files with no live objects left are
+ * deleted.
+ *
+ * Contents do not survive the tier: segment files live in a private directory
+ * which is removed when the tier is destroyed.
+ */
+class DiskTier {
+ public:
+  /**
+   * \brief Create a disk tier.
+   *
+   * \throw std::system_error If the segment directory cannot be created.
+   *
+   * \param config Disk tier configuration.
+   */
+  explicit DiskTier(const DiskTierConfig& config);
+  ~DiskTier();
+
+  // DiskTier is non-copyable and non-moveable, it owns files on disk.
+  DiskTier(const DiskTier& other) = delete;
+  DiskTier(DiskTier&& other) = delete;
+  DiskTier& operator=(const DiskTier& other) = delete;
+  DiskTier& operator=(DiskTier&&) = delete;
+
+  /**
+   * \brief Append an object to the current segment.
+   *
+   * \note The object is not indexed until insert() is called, call release()
+   * to discard it instead.
+   *
+   * \param object Object to write.
+   *
+   * \return Location of the written object, or nothing if writing failed.
+   */
+  [[nodiscard]] std::optional<DiskLocation> write(
+      const Object& object) noexcept;
+
+  /**
+   * \brief Index an object written to disk.
+   *
+   * \param path Object path.
+   * \param location Object location returned by write().
+   */
+  void insert(const std::string& path, const DiskLocation& location);
+
+  /**
+   * \brief Index another object sharing the contents of an indexed object.
+   *
+   * The contents are neither read nor copied. They stay on disk until every
+   * object linked to them is erased.
+   *
+   * \param path Path of the new object.
+   * \param location Location of the shared contents (with the version of
+   * the new object).
+   */
+  void link(const std::string& path, const DiskLocation& location);
+
+  /**
+   * \brief Check if an object may be stored on disk.
+   *
+   * \note This check is cheap and never touches the disk.
+   *
+   * \param path Object path.
+   *
+   * \return False if the object is definitely not on disk, true otherwise.
+   */
+  [[nodiscard]] bool mayContain(const std::string& path) const noexcept;
+
+  /**
+   * \brief Look up the location of an object.
+   *
+   * \param path Object path.
+   *
+   * \return Object location, or nothing if the object is not on disk.
+   */
+  [[nodiscard]] std::optional<DiskLocation> find(
+      const std::string& path) const noexcept;
+
+  /**
+   * \brief Read an object from disk.
+   *
+   * \note This method blocks on disk IO.
+   *
+   * \param path Object path.
+   *
+   * \return Operation result (FileNotFound, IoError or Success), object
+   * location and the object.
+   */
+  [[nodiscard]] std::tuple<Status, DiskLocation, Object> read(
+      const std::string& path) const noexcept;
+
+  /**
+   * \brief Remove an object from the index and discard its copy on disk.
+   *
+   * \param path Object path.
+   *
+   * \return True if object was removed, false if it was not on disk.
+   */
+  bool erase(const std::string& path) noexcept;
+
+  /**
+   * \brief Discard an object written to disk but never indexed.
+   *
+   * \param location Object location returned by write().
+   */
+  void release(const DiskLocation& location) noexcept;
+
+  /**
+   * \brief List all objects on disk.
+   *
+   * \return Paths of all objects on disk.
+   */
+  [[nodiscard]] FileList list() const;
+
+  /**
+   * \brief Return disk tier statistics.
+   *
+   * \return Disk tier statistics.
+   */
+  [[nodiscard]] DiskTierStats getStats() const noexcept;
+
+ private:
+  /**
+   * \brief Append-only segment file.
+   */
+  struct Segment {
+    /**
+     * \brief Close and delete the segment file.
+     */
+    ~Segment();
+
+    std::string path;     ///< Segment file path.
+    int fd{-1};           ///< Segment file descriptor.
+    std::size_t size{0};  ///< Number of bytes written (or reserved).
+    std::size_t live{0};  ///< Number of bytes held by live objects.
+  };
+
+  /**
+   * \brief Release object bytes from a segment.
+   *
+   * \note Must be called with the exclusive lock held.
+   *
+   * \param location Location of the released object.
+   */
+  void releaseLocked(const DiskLocation& location) noexcept;
+
+  /**
+   * \brief Index an object, replacing the previous object with its path.
+   *
+   * \note Must be called with the exclusive lock held.
+   *
+   * \param path Object path.
+   * \param location Object location.
+   */
+  void insertLocked(const std::string& path, const DiskLocation& location);
+
+  /**
+   * \brief Rebuild the bloom filter if it got too full or too stale.
+   *
+   * \note Must be called with the exclusive lock held.
+   */
+  void maybeRebuildFilter();
+
+  /// Minimum number of keys the bloom filter is sized for.
+  static constexpr std::size_t kMinFilterCapacity{1024};
+
+  DiskTierConfig config_;  ///< Disk tier configuration.
+  std::string directory_;  ///< Private directory holding segment files.
+
+  /// Protects the index, bloom filter and segment bookkeeping.
+  mutable std::shared_mutex mutex_;
+
+  /// Mapping from object paths to their locations on disk.
+  std::unordered_map<std::string, DiskLocation> index_;
+
+  /// Bloom filter over all paths in the index.
+  BloomFilter filter_{kMinFilterCapacity};
+
+  /// Number of paths removed from the index since the filter was rebuilt.
+  std::size_t removed_since_rebuild_{0};
+
+  /// Segment files, shared with readers so that a file stays open while it
+  /// is being read.
+  std::unordered_map<std::uint64_t, std::shared_ptr<Segment>> segments_;
+
+  /// ID of the segment currently being appended to.
+  std::uint64_t current_segment_{0};
+
+  /// ID of the next segment to create.
+  std::uint64_t next_segment_{0};
+};
+
+}  // namespace fs
+
+#endif  // FILESYSTEM_MEMORY_FS_SRC_DISK_TIER_HPP
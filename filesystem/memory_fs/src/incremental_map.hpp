@@ -0,0 +1,371 @@
+#ifndef FILESYSTEM_MEMORY_FS_SRC_INCREMENTAL_MAP_HPP
+#define FILESYSTEM_MEMORY_FS_SRC_INCREMENTAL_MAP_HPP
+
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+
+namespace fs {
+
+/**
+ * \brief Incremental map growth statistics.
+ */
+struct IncrementalMapStats {
+  std::size_t growths;        ///< Number of times the map started growing.
+  std::size_t spare_growths;  ///< Growths into a table offered by the owner.
+};
+
+/**
+ * \brief Hash map which grows without rehashing all of its entries at once.
+ *
+ * Small maps grow as std::unordered_map does. Once a large map fills up, its
+ * table is set aside and a table twice the size takes its place. Entries are
+ * then moved over a few at a time by each subsequent mutation, rather than
+ * all at once by the mutation which hit the load factor. Until the old table
+ * is drained, lookups check both tables.
+ *
+ * Entries never move in memory (nodes are relinked, not copied), so that
+ * pointers to them stay valid until they are removed.
+ *
+ * The owner may allocate the next table and release the drained one outside
+ * of the lock it serializes the map with (see getSpareBucketCount(),
+ * offerSpare() and takeDrained()). Otherwise, the map does it itself.
+ *
+ * \note Not thread-safe, mutations must be serialized with lookups as with
+ * std::unordered_map.
+ *
+ * \tparam Key Key type.
+ * \tparam Value Mapped type.
+ */
+template <typename Key, typename Value>
+class IncrementalMap {
+ public:
+  using Map = std::unordered_map<Key, Value>;   ///< Underlying table type.
+  using value_type = typename Map::value_type;  ///< Key-value pair.
+  using node_type = typename Map::node_type;    ///< Extracted entry.
+
+  /// Local iterator over a single bucket.
+  using const_local_iterator = typename Map::const_local_iterator;
+
+  /// Maps smaller than this are rehashed at once.
+  static constexpr std::size_t kMinIncrementalSize{4096};
+
+  /// Number of entries moved to the new table by each mutation.
+  static constexpr std::size_t kMigrationBatch{16};
+
+  /**
+   * \brief Allocate buckets for the given number of entries, so that the map
+   * does not grow until it holds more.
+   *
+   * \param count Expected number of entries.
+   */
+  void reserve(std::size_t count) {
+    migrate(previous_.size());
+    current_.reserve(count);
+  }
+
+  /**
+   * \brief Return number of entries.
+   *
+   * \return Number of entries in both tables.
+   */
+  [[nodiscard]] std::size_t size() const noexcept {
+    return current_.size() + previous_.size();
+  }
+
+  /**
+   * \brief Check if the map is empty.
+   *
+   * \return True if there are no entries, false otherwise.
+   */
+  [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+  /**
+   * \brief Check if entries are being moved to a new table.
+   *
+   * \return True if the old table still holds entries, false otherwise.
+   */
+  [[nodiscard]] bool isMigrating() const noexcept {
+    return !previous_.empty();
+  }
+
+  /**
+   * \brief Find an entry.
+   *
+   * \param key Key to look up.
+   *
+   * \return Entry with the given key, or nullptr if there is none.
+   */
+  [[nodiscard]] value_type* find(const Key& key) {
+    auto found = current_.find(key);
+    if (found != current_.end()) {
+      return &*found;
+    }
+
+    found = previous_.find(key);
+    return (found != previous_.end()) ? &*found : nullptr;
+  }
+
+  /**
+   * \copydoc find()
+   */
+  [[nodiscard]] const value_type* find(const Key& key) const {
+    return const_cast<IncrementalMap*>(this)->find(key);
+  }
+
+  /**
+   * \brief Add an entry, unless there is one with the same key.
+   *
+   * \param key Key of the entry.
+   * \param args Arguments to construct the value from.
+   *
+   * \return Entry with the given key, and whether it was added.
+   */
+  template <typename... Args>
+  std::pair<value_type*, bool> emplace(const Key& key, Args&&... args) {
+    if (auto* found = find(key)) {
+      return {found, false};
+    }
+
+    prepareInsert();
+    return {&*current_.try_emplace(key, std::forward<Args>(args)...).first,
+            true};
+  }
+
+  /**
+   * \brief Access an entry, adding a default-constructed one if there is
+   * none.
+   *
+   * \param key Key of the entry.
+   *
+   * \return Value of the entry.
+   */
+  Value& operator[](const Key& key) { return emplace(key).first->second; }
+
+  /**
+   * \brief Add an extracted entry.
+   *
+   * \note There must be no entry with the same key.
+   *
+   * \param node Entry to add.
+   */
+  void insert(node_type&& node) {
+    prepareInsert();
+    current_.insert(std::move(node));
+  }
+
+  /**
+   * \brief Remove an entry without destroying it.
+   *
+   * \param key Key of the entry.
+   *
+   * \return Removed entry (empty if there is no entry with the given key).
+   */
+  node_type extract(const Key& key) {
+    auto node = current_.extract(key);
+    if (node.empty() && isMigrating()) {
+      node = previous_.extract(key);
+    }
+
+    migrate(kMigrationBatch);
+    return node;
+  }
+
+  /**
+   * \brief Remove and destroy an entry.
+   *
+   * \param key Key of the entry.
+   *
+   * \return Number of removed entries (0 or 1).
+   */
+  std::size_t erase(const Key& key) { return extract(key).empty() ? 0 : 1; }
+
+  /**
+   * \brief Call a function for every entry, in no particular order.
+   *
+   * \param function Function called with each entry (const value_type&).
+   */
+  template <typename Function>
+  void forEach(Function&& function) const {
+    for (const auto& entry : previous_) {
+      function(entry);
+    }
+    for (const auto& entry : current_) {
+      function(entry);
+    }
+  }
+
+  /**
+   * \brief Return number of buckets of both tables.
+   *
+   * Buckets of the old table come first. Bucket numbers change when the map
+   * grows, as they do when std::unordered_map is rehashed.
+   *
+   * \return Number of buckets.
+   */
+  [[nodiscard]] std::size_t bucket_count() const noexcept {
+    return previous_.bucket_count() + current_.bucket_count();
+  }
+
+  /**
+   * \brief Return iterator to the first entry of a bucket.
+   *
+   * \param bucket Bucket number (less than bucket_count()).
+   *
+   * \return Local iterator.
+   */
+  [[nodiscard]] const_local_iterator cbegin(std::size_t bucket) const {
+    return (bucket < previous_.bucket_count())
+               ? previous_.cbegin(bucket)
+               : current_.cbegin(bucket - previous_.bucket_count());
+  }
+
+  /**
+   * \brief Return iterator past the last entry of a bucket.
+   *
+   * \param bucket Bucket number (less than bucket_count()).
+   *
+   * \return Local iterator.
+   */
+  [[nodiscard]] const_local_iterator cend(std::size_t bucket) const {
+    return (bucket < previous_.bucket_count())
+               ? previous_.cend(bucket)
+               : current_.cend(bucket - previous_.bucket_count());
+  }
+
+  /**
+   * \brief Exchange contents with another map.
+   *
+   * \param other Map to exchange contents with.
+   */
+  void swap(IncrementalMap& other) noexcept {
+    current_.swap(other.current_);
+    previous_.swap(other.previous_);
+    spare_.swap(other.spare_);
+    drained_.swap(other.drained_);
+  }
+
+  /**
+   * \brief Return number of buckets of the table the map grows into next, if
+   * the map is about to grow and has no such table yet.
+   *
+   * \return Number of buckets to allocate (0 if no table is needed).
+   */
+  [[nodiscard]] std::size_t getSpareBucketCount() const noexcept {
+    const auto limit = getGrowthLimit();
+    const auto needed = 2 * current_.bucket_count();
+    return (!isMigrating() && (limit >= kMinIncrementalSize) &&
+            (4 * current_.size() >= 3 * limit) &&
+            (spare_.bucket_count() < needed))
+               ? needed
+               : 0;
+  }
+
+  /**
+   * \brief Offer an empty table for the map to grow into.
+   *
+   * \param table Table with at least getSpareBucketCount() buckets. It is
+   * exchanged for the previous spare table if the map takes it.
+   */
+  void offerSpare(Map& table) noexcept {
+    if (table.empty() &&
+        (table.bucket_count() > spare_.bucket_count()) &&
+        (table.bucket_count() >= 2 * current_.bucket_count())) {
+      table.swap(spare_);
+    }
+  }
+
+  /**
+   * \brief Take the drained table, so that its buckets are released by the
+   * caller.
+   *
+   * \param table Table exchanged for the drained one.
+   */
+  void takeDrained(Map& table) noexcept { table.swap(drained_); }
+
+  /**
+   * \brief Check if the owner has tables to allocate or release.
+   *
+   * \return True if a spare table is needed or a drained one is left.
+   */
+  [[nodiscard]] bool needsTables() const noexcept {
+    return (drained_.bucket_count() > 1) || (getSpareBucketCount() > 0);
+  }
+
+  /**
+   * \brief Return growth statistics.
+   *
+   * \note Statistics are not exchanged by swap().
+   *
+   * \return Growth statistics.
+   */
+  [[nodiscard]] IncrementalMapStats getStats() const noexcept {
+    return stats_;
+  }
+
+  /**
+   * \brief Move entries from the old table to the new one.
+   *
+   * \param count Maximum number of entries to move.
+   */
+  void migrate(std::size_t count) {
+    for (std::size_t i = 0; (i < count) && isMigrating(); i++) {
+      current_.insert(previous_.extract(previous_.cbegin()));
+    }
+
+    if (!isMigrating() && (previous_.bucket_count() > 1)) {
+      // The drained table is kept for the owner to release. A drained table
+      // the owner did not take is released here.
+      drained_.swap(previous_);
+      Map{}.swap(previous_);
+    }
+  }
+
+ private:
+  /// Load factor at which a large map starts growing. It is below the
+  /// maximum load factor, so that the tables never rehash on their own.
+  static constexpr float kGrowthLoadFactor{0.875F};
+
+  /**
+   * \brief Make room for a new entry, starting to grow the map if it is full.
+   */
+  void prepareInsert() {
+    migrate(kMigrationBatch);
+
+    const auto full = current_.size() + 1 > getGrowthLimit();
+    if (full && !isMigrating() && (current_.size() >= kMinIncrementalSize)) {
+      // Only the (empty) bucket array of the new table is allocated here,
+      // unless the owner offered one.
+      previous_.swap(current_);
+      stats_.growths++;
+      if (spare_.bucket_count() >= 2 * previous_.bucket_count()) {
+        current_.swap(spare_);
+        stats_.spare_growths++;
+      } else {
+        current_.rehash(2 * previous_.bucket_count());
+      }
+    }
+  }
+
+  /**
+   * \brief Return number of entries at which the map starts growing.
+   *
+   * \return Maximum number of entries of the current table.
+   */
+  [[nodiscard]] std::size_t getGrowthLimit() const noexcept {
+    return static_cast<std::size_t>(
+        kGrowthLoadFactor * static_cast<float>(current_.bucket_count()) *
+        current_.max_load_factor());
+  }
+
+  Map current_;   ///< Table receiving new entries.
+  Map previous_;  ///< Table being drained (empty unless the map grows).
+  Map spare_;     ///< Empty table offered to grow into next.
+  Map drained_;   ///< Drained table, left for the owner to release.
+
+  IncrementalMapStats stats_{};  ///< Growth statistics.
+};
+
+}  // namespace fs
+
+#endif  // FILESYSTEM_MEMORY_FS_SRC_INCREMENTAL_MAP_HPP
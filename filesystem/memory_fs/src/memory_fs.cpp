@@ -1,26 +1,509 @@
 #include "memory_fs.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
 using namespace fs;
 
-std::pair<Status, const File&> MemoryFs::get(
+namespace {
+
+/**
+ * \brief Mark an index entry as recently accessed.
+ *
+ * \param entry Accessed entry.
+ */
+void touch(const Entry& entry) noexcept {
+  // Avoid writing to the shared cache line of hot objects.
+  if (!entry.referenced.load(std::memory_order_relaxed)) {
+    entry.referenced.store(true, std::memory_order_relaxed);
+  }
+}
+
+/**
+ * \brief Give an index entry a new version, modified now.
+ *
+ * \param entry Modified entry.
+ * \param version New version of the object.
+ */
+void stamp(Entry& entry, Version version) noexcept {
+  entry.version = version;
+  entry.modified = std::chrono::system_clock::now();
+  entry.checksum.reset();
+}
+
+/**
+ * \brief Return metadata of an object resident in memory.
+ *
+ * \param entry Index entry of the object.
+ *
+ * \return Object metadata.
+ */
+FileInfo getInfo(const Entry& entry) noexcept {
+  return {entry.size(), entry.version, entry.modified, entry.checksum};
+}
+
+/**
+ * \brief Return metadata of an object resident on disk.
+ *
+ * \param location Location of the object.
+ *
+ * \return Object metadata.
+ */
+FileInfo getInfo(const DiskLocation& location) noexcept {
+  return {location.size, location.version, location.modified};
+}
+
+/**
+ * \brief Copy object contents into a contiguous buffer.
+ *
+ * \param object Object to copy.
+ * \param destination Buffer of at least object.size() bytes.
+ */
+void copyTo(const Object& object, char* destination) noexcept {
+  for (const auto& extent : object.getExtents()) {
+    std::memcpy(destination, extent.buffer.get(), extent.size);
+    destination += extent.size;
+  }
+}
+
+/// Identifier never given to a filesystem.
+constexpr std::uint64_t kNoId{~std::uint64_t{0}};
+
+/**
+ * \brief Return a new filesystem identifier.
+ *
+ * \return Identifier never given to another filesystem.
+ */
+std::uint64_t nextId() noexcept {
+  static std::atomic<std::uint64_t> next{0};
+  return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+Entry::~Entry() {
+  if (!isInline()) {
+    object_.~Object();
+  }
+}
+
+Object Entry::load() const {
+  if (!isInline()) {
+    return object_;
+  }
+
+  if (inline_size_ == 0) {
+    return {};
+  }
+
+  // A single allocation holds both the reference count and the contents.
+  auto block = std::make_shared<std::array<char, kMaxInlineSize>>();
+  std::memcpy(block->data(), data_, inline_size_);
+  return Object{Buffer{block, block->data()}, inline_size_};
+}
+
+void Entry::store(Object object) noexcept {
+  if (isInline()) {
+    new (&object_) Object{std::move(object)};
+    inline_size_ = kNotInline;
+  } else {
+    object_ = std::move(object);
+  }
+}
+
+void Entry::store(std::string_view data) noexcept {
+  if (!isInline()) {
+    object_.~Object();
+  }
+
+  std::memcpy(data_, data.data(), data.size());
+  inline_size_ = static_cast<std::uint8_t>(data.size());
+}
+
+MemoryFs::MemoryFs(const MemoryFsConfig& config)
+    : merkle_{(config.merkle.leaves > 0)
+                  ? std::make_unique<MerkleTree>(config.merkle)
+                  : nullptr},
+      arena_{config.arena},
+      inline_threshold_{
+          std::min(config.inline_threshold, Entry::kMaxInlineSize)},
+      verify_checksums_{config.verify_checksums},
+      combiner_{config.combine_writes ? std::make_unique<Combiner>(mutex_)
+                                      : nullptr},
+      log_{config.log},
+      occupancy_threshold_{config.compactor.occupancy_threshold},
+      memory_budget_{config.disk.memory_budget},
+      upload_timeout_{config.upload_timeout},
+      id_{nextId()},
+      cache_config_{config.cache} {
+  // Allocate the index up front rather than growing it step by step.
+  fs_.reserve(config.expected_objects);
+
+  if (config.compactor.enabled) {
+    compactor_ = std::make_unique<Compactor>(*this, config.compactor);
+    compactor_->start();
+  }
+
+  if (config.reclaimer.enabled) {
+    reclaimer_ = std::make_unique<Reclaimer>(config.reclaimer);
+    reclaimer_->start();
+  }
+
+  if (config.disk.enabled) {
+    disk_ = std::make_unique<DiskTier>(config.disk);
+    if (config.disk.migrate_in_background) {
+      migrator_ = std::make_unique<Migrator>(*this, config.disk.batch_size,
+                                             config.disk.interval);
+      migrator_->start();
+    }
+  }
+}
+
+MemoryFs::~MemoryFs() {
+  // Stop background threads before the filesystem they are working on goes
+  // away.
+  migrator_.reset();
+  compactor_.reset();
+  reclaimer_.reset();
+}
+
+std::pair<Status, Object> MemoryFs::get(
+    const std::string& path) const noexcept {
+  auto [status, object, info] = getWithInfo(path);
+  return {status, std::move(object)};
+}
+
+std::tuple<Status, Object, FileInfo> MemoryFs::getWithInfo(
     const std::string& path) const noexcept {
+  if (auto cached = findCached(path)) {
+    const auto status = verify(cached->first, cached->second);
+    return {status, std::move(cached->first), cached->second};
+  }
+
+  {
+    std::shared_lock lock(mutex_);
+
+    const auto file = fs_.find(path);
+    if (file != nullptr) {
+      touch(file->second);
+      auto object = file->second.load();
+      const auto info = getInfo(file->second);
+      cache(path, object, info);
+
+      // The object stays valid without the lock, it is checked without it.
+      lock.unlock();
+      return {verify(object, info), std::move(object), info};
+    }
+
+    // Objects only move between tiers under the exclusive lock, so the bloom
+    // filter gives a definite answer here.
+    if (!disk_ || !disk_->mayContain(path)) {
+      return {Status::FileNotFound, {}, {}};
+    }
+  }
+
+  return readFromDisk(path);
+}
+
+std::pair<Status, FileInfo> MemoryFs::stat(
+    const std::string& path) const noexcept {
+  if (const auto cached = findCached(path)) {
+    return {Status::Success, cached->second};
+  }
+
+  // Metadata of disk resident objects is kept in memory, nothing is read.
   std::shared_lock lock(mutex_);
 
-  if (!exists(path)) {
-    return {Status::FileNotFound, {}};
+  const auto file = fs_.find(path);
+  if (file != nullptr) {
+    return {Status::Success, getInfo(file->second)};
+  }
+
+  if (disk_ && disk_->mayContain(path)) {
+    if (const auto location = disk_->find(path)) {
+      return {Status::Success, getInfo(*location)};
+    }
   }
 
-  return {Status::Success, fs_.at(path)};
+  return {Status::FileNotFound, {}};
+}
+
+std::optional<std::tuple<Status, Object, FileInfo>> MemoryFs::tryGet(
+    const std::string& path) const noexcept {
+  if (auto cached = findCached(path)) {
+    const auto status = verify(cached->first, cached->second);
+    return std::tuple{status, std::move(cached->first), cached->second};
+  }
+
+  std::shared_lock lock(mutex_);
+
+  const auto file = fs_.find(path);
+  if (file != nullptr) {
+    touch(file->second);
+    auto object = file->second.load();
+    const auto info = getInfo(file->second);
+    cache(path, object, info);
+    lock.unlock();
+    return std::tuple{verify(object, info), std::move(object), info};
+  }
+
+  if (disk_ && disk_->mayContain(path)) {
+    return {};
+  }
+
+  return std::tuple{Status::FileNotFound, Object{}, FileInfo{}};
 }
 
 Status MemoryFs::add(const std::string& path, const File& file) noexcept {
-  std::unique_lock lock(mutex_);
+  const auto status = put(path, file, Precondition{false}).first;
+  return (status == Status::PreconditionFailed) ? Status::AlreadyExists
+                                                : status;
+}
 
-  if (exists(path)) {
-    return Status::AlreadyExists;
+std::pair<Status, Version> MemoryFs::put(
+    const std::string& path, const File& file,
+    const Precondition& precondition,
+    std::optional<Checksum> checksum) noexcept {
+  // Copy file contents before taking the lock, so that writers of large files
+  // do not stall everyone else. Tiny files are copied into the index instead,
+  // they only get a buffer of their own if the mutation log keeps them.
+  const auto tiny = file.size() <= inline_threshold_;
+  Object object;
+  if (!tiny) {
+    object = arena_.allocate(file.data(), file.size());
+  } else if (log_.isEnabled()) {
+    object = Object{file};
+  }
+
+  return store(path, std::move(object),
+               tiny ? std::optional<std::string_view>{file} : std::nullopt,
+               precondition, checksum);
+}
+
+UploadId MemoryFs::createUpload(const std::string& path) noexcept {
+  std::scoped_lock lock(upload_mutex_);
+
+  UploadId upload{0};
+  while ((upload == 0) || (uploads_.count(upload) > 0)) {
+    upload = upload_ids_();
+  }
+
+  uploads_.emplace(upload,
+                   Upload{path, {}, std::chrono::steady_clock::now()});
+  return upload;
+}
+
+Status MemoryFs::uploadPart(UploadId upload, const std::string& path,
+                            std::size_t number, const File& data) noexcept {
+  if ((number == 0) || (number > kMaxUploadParts)) {
+    return Status::InvalidRange;
+  }
+
+  // Parts are copied concurrently, only their registration is serialized.
+  auto part = data.empty() ? Object{}
+                           : arena_.allocate(data.data(), data.size());
+
+  // A replaced part is freed once the lock is released.
+  Object replaced;
+  {
+    std::scoped_lock lock(upload_mutex_);
+
+    const auto found = uploads_.find(upload);
+    if ((found == uploads_.end()) || (found->second.path != path)) {
+      return Status::FileNotFound;
+    }
+
+    auto& current = found->second.parts[number];
+    replaced = std::move(current);
+    current = std::move(part);
+    found->second.last_activity = std::chrono::steady_clock::now();
+  }
+
+  return Status::Success;
+}
+
+std::pair<Status, Version> MemoryFs::completeUpload(
+    UploadId upload, const std::string& path,
+    const Precondition& precondition) noexcept {
+  Upload completed;
+  {
+    std::scoped_lock lock(upload_mutex_);
+
+    const auto found = uploads_.find(upload);
+    if ((found == uploads_.end()) || (found->second.path != path)) {
+      return {Status::FileNotFound, 0};
+    }
+
+    completed = std::move(found->second);
+    uploads_.erase(found);
+  }
+
+  // Parts are stitched together by reference, nothing is copied.
+  Object object;
+  for (const auto& [number, part] : completed.parts) {
+    object.append(part);
+  }
+
+  const auto result =
+      (object.size() <= inline_threshold_)
+          ? put(path, object.str(), precondition)
+          : store(path, object, std::nullopt, precondition, std::nullopt);
+
+  // The client may retry with another precondition.
+  if (result.first != Status::Success) {
+    completed.last_activity = std::chrono::steady_clock::now();
+
+    std::scoped_lock lock(upload_mutex_);
+    uploads_.emplace(upload, std::move(completed));
   }
 
-  fs_[path] = file;
+  return result;
+}
+
+Status MemoryFs::abortUpload(UploadId upload,
+                             const std::string& path) noexcept {
+  // Parts are freed once the lock is released.
+  Upload aborted;
+  {
+    std::scoped_lock lock(upload_mutex_);
+
+    const auto found = uploads_.find(upload);
+    if ((found == uploads_.end()) || (found->second.path != path)) {
+      return Status::FileNotFound;
+    }
+
+    aborted = std::move(found->second);
+    uploads_.erase(found);
+  }
+
+  return Status::Success;
+}
+
+std::size_t MemoryFs::expireUploads() {
+  const auto deadline = std::chrono::steady_clock::now() - upload_timeout_;
+
+  // Parts are freed once the lock is released.
+  std::vector<Upload> expired;
+  {
+    std::scoped_lock lock(upload_mutex_);
+
+    for (auto upload = uploads_.begin(); upload != uploads_.end();) {
+      if (upload->second.last_activity <= deadline) {
+        expired.push_back(std::move(upload->second));
+        upload = uploads_.erase(upload);
+      } else {
+        upload++;
+      }
+    }
+  }
+
+  return expired.size();
+}
+
+std::pair<Status, Version> MemoryFs::store(
+    const std::string& path, Object object,
+    std::optional<std::string_view> inline_data,
+    const Precondition& precondition, std::optional<Checksum> checksum) {
+  const auto digest = inline_data ? hash(*inline_data) : hash(object);
+
+  // The replaced index node (and the object it holds) is freed once the lock
+  // is released.
+  Fs::node_type replaced;
+  std::pair result{Status::PreconditionFailed, Version{0}};
+  mutate([&]() {
+    if (!satisfies(precondition, findVersion(path))) {
+      return;
+    }
+
+    replaced = fs_.extract(path);
+    const auto previous = replaced.empty()
+                              ? eraseFromDisk(path)
+                              : std::optional{replaced.mapped().size()};
+
+    const auto version = record(MutationType::Put, path, 0, object, checksum);
+    const auto added = inline_data ? fs_.emplace(path, *inline_data)
+                                   : fs_.emplace(path, std::move(object));
+    stamp(added.first->second, version);
+    added.first->second.checksum = checksum;
+    account(path, previous, added.first->second.size());
+    if (merkle_) {
+      merkle_->put(path, digest, added.first->second.size());
+    }
+    result = {Status::Success, version};
+  });
+
+  retire(std::move(replaced));
+  return result;
+}
+
+Status MemoryFs::append(const std::string& path, const File& data) noexcept {
+  // Only the appended data is copied, existing contents are left in place.
+  auto tail = arena_.allocate(data.data(), data.size());
+  const auto digest = hash(std::string_view{data});
+
+  MutationLock lock(*this);
+  const auto status = lockResident(path, lock);
+  if (status != Status::Success) {
+    return status;
+  }
+
+  const auto [found, added] = fs_.emplace(path);
+  auto& file = found->second;
+  const auto previous = file.size();
+  touch(file);
+
+  // Replicas apply writes to existing files only, a created file is logged as
+  // a put of its contents.
+  stamp(file, record(added ? MutationType::Put : MutationType::Write, path,
+                     previous, tail));
+  Object replaced;
+  overwrite(path, file, previous, tail, digest, replaced);
+  account(path, added ? std::nullopt : std::optional{previous}, file.size());
+  lock.unlock();
+
+  retire(std::move(replaced));
+  return Status::Success;
+}
+
+Status MemoryFs::write(const std::string& path, std::size_t offset,
+                       const File& data) noexcept {
+  auto patch = arena_.allocate(data.data(), data.size());
+  const auto digest = hash(std::string_view{data});
+
+  // Hashing the overwritten range takes as long as hashing the data, so it is
+  // not done under the exclusive lock unless the object changes meanwhile.
+  const auto replaced_hash =
+      merkle_ ? hashReplaced(path, offset, data.size()) : std::nullopt;
+
+  MutationLock lock(*this);
+  const auto status = lockResident(path, lock);
+  if (status != Status::Success) {
+    return status;
+  }
+
+  auto file = fs_.find(path);
+  if (file == nullptr) {
+    return Status::FileNotFound;
+  }
+
+  touch(file->second);
+  const auto previous = file->second.size();
+  Object replaced;
+  if (!overwrite(path, file->second, offset, patch, digest, replaced,
+                 replaced_hash)) {
+    return Status::InvalidRange;
+  }
+
+  stamp(file->second, record(MutationType::Write, path, offset, patch));
+  usage_.resize(path, previous, file->second.size());
+  lock.unlock();
+
+  retire(std::move(replaced));
   return Status::Success;
 }
 
@@ -28,18 +511,1031 @@ FileList MemoryFs::list() const noexcept {
   FileList list;
   std::shared_lock lock(mutex_);
 
-  for (const auto& file : fs_) {
-    list.emplace_back(file.first);
+  fs_.forEach([&list](const auto& file) { list.emplace_back(file.first); });
+
+  if (disk_) {
+    const auto on_disk = disk_->list();
+    list.insert(list.end(), on_disk.cbegin(), on_disk.cend());
   }
 
   return list;
 }
 
 Status MemoryFs::remove(const std::string& path) noexcept {
-  std::unique_lock lock(mutex_);
-  return fs_.erase(path) == 1 ? Status::Success : Status::FileNotFound;
+  return remove(path, Precondition{});
+}
+
+Status MemoryFs::remove(const std::string& path,
+                        const Precondition& precondition) noexcept {
+  const auto conditional = precondition.exists || precondition.version;
+
+  // The index node (and the object it holds) is freed once the lock is
+  // released.
+  Fs::node_type node;
+  auto status = Status::FileNotFound;
+  mutate([&]() {
+    if (conditional && !satisfies(precondition, findVersion(path))) {
+      status = Status::PreconditionFailed;
+      return;
+    }
+
+    node = fs_.extract(path);
+    const auto size = node.empty() ? eraseFromDisk(path)
+                                   : std::optional{node.mapped().size()};
+    if (size) {
+      record(MutationType::Remove, path, 0, {});
+      usage_.remove(path, *size);
+      if (merkle_) {
+        merkle_->remove(path);
+      }
+      status = Status::Success;
+    }
+  });
+
+  retire(std::move(node));
+  return status;
+}
+
+std::size_t MemoryFs::removePrefix(const std::string& prefix) noexcept {
+  const auto matches = [&prefix](std::string_view path) {
+    return path.substr(0, prefix.size()) == prefix;
+  };
+
+  FileList paths;
+  {
+    std::shared_lock lock(mutex_);
+    fs_.forEach([&](const auto& file) {
+      if (matches(file.first)) {
+        paths.push_back(file.first);
+      }
+    });
+
+    if (disk_) {
+      for (auto& path : disk_->list()) {
+        if (matches(path)) {
+          paths.push_back(std::move(path));
+        }
+      }
+    }
+  }
+
+  std::size_t removed{0};
+  std::vector<Fs::node_type> nodes;
+  nodes.reserve(std::min(paths.size(), kRemoveBatchSize));
+  for (std::size_t first = 0; first < paths.size();
+       first += kRemoveBatchSize) {
+    const auto last = std::min(first + kRemoveBatchSize, paths.size());
+    {
+      MutationLock lock(*this);
+      lock.lock();
+      for (auto i = first; i < last; i++) {
+        auto node = fs_.extract(paths[i]);
+        std::optional<std::size_t> size;
+        if (!node.empty()) {
+          size = node.mapped().size();
+          nodes.push_back(std::move(node));
+        } else if (size = eraseFromDisk(paths[i]); !size) {
+          continue;
+        }
+
+        record(MutationType::Remove, paths[i], 0, {});
+        usage_.remove(paths[i], *size);
+        if (merkle_) {
+          merkle_->remove(paths[i]);
+        }
+        removed++;
+      }
+    }
+
+    // Extracted index nodes (and objects they hold) are freed without the
+    // lock, so that readers and writers are not kept waiting.
+    for (auto& node : nodes) {
+      retire(std::move(node));
+    }
+    nodes.clear();
+  }
+
+  return removed;
+}
+
+Status MemoryFs::copy(const std::string& source,
+                      const std::string& destination) noexcept {
+  // Objects on disk are linked under the new path where they are, unless the
+  // mutation log needs their contents.
+  MutationLock lock(*this);
+  if (!log_.isEnabled()) {
+    lock.lock();
+  } else if (const auto status = lockResident(source, lock);
+             status != Status::Success) {
+    return status;
+  }
+
+  const auto file = fs_.find(source);
+  if (file == nullptr) {
+    return linkOnDisk(source, destination, true);
+  }
+
+  if (exists(destination)) {
+    return Status::AlreadyExists;
+  }
+
+  // Only the extents list is copied, the buffers are shared.
+  touch(file->second);
+  const auto version = record(MutationType::Put, destination, 0,
+                              getLogged(file->second), file->second.checksum);
+  const auto* object = file->second.getObject();
+  const auto added =
+      object ? fs_.emplace(destination, *object)
+             : fs_.emplace(destination, file->second.getInline());
+  stamp(added.first->second, version);
+  added.first->second.checksum = file->second.checksum;
+  usage_.add(destination, file->second.size());
+  if (merkle_) {
+    merkle_->put(destination, merkle_->find(source).value_or(0),
+                 file->second.size());
+  }
+  return Status::Success;
+}
+
+Status MemoryFs::rename(const std::string& source,
+                        const std::string& destination) noexcept {
+  // Objects on disk are linked under the new path where they are, unless the
+  // mutation log needs their contents.
+  MutationLock lock(*this);
+  if (!log_.isEnabled()) {
+    lock.lock();
+  } else if (const auto status = lockResident(source, lock);
+             status != Status::Success) {
+    return status;
+  }
+
+  const auto file = fs_.find(source);
+  if (file == nullptr) {
+    return linkOnDisk(source, destination, false);
+  }
+
+  if (exists(destination)) {
+    return Status::AlreadyExists;
+  }
+
+  const auto checksum = file->second.checksum;
+  stamp(file->second, record(MutationType::Put, destination, 0,
+                             getLogged(file->second), checksum));
+  file->second.checksum = checksum;
+  record(MutationType::Remove, source, 0, {});
+  usage_.remove(source, file->second.size());
+  usage_.add(destination, file->second.size());
+  if (merkle_) {
+    merkle_->put(destination, merkle_->find(source).value_or(0),
+                 file->second.size());
+    merkle_->remove(source);
+  }
+
+  // The index node is relinked under the new path, the entry stays in place.
+  auto node = fs_.extract(source);
+  node.key() = destination;
+  fs_.insert(std::move(node));
+  return Status::Success;
+}
+
+bool MemoryFs::isOnDisk(const std::string& path) const noexcept {
+  if (!disk_) {
+    return false;
+  }
+
+  std::shared_lock lock(mutex_);
+  return (fs_.find(path) == nullptr) && disk_->mayContain(path) &&
+         disk_->find(path);
+}
+
+Status MemoryFs::apply(const Mutation& mutation) noexcept {
+  // Data received from elsewhere is copied to the arena outside of the lock.
+  // Tiny objects are copied into the index.
+  const auto tiny = (mutation.type == MutationType::Put) &&
+                    (mutation.data.size() <= inline_threshold_);
+  auto data = tiny ? mutation.data : arena_.allocate(mutation.data);
+  const auto digest = hash(mutation.data);
+
+  // Replaced contents and removed index nodes are released once the lock is.
+  Object replaced;
+  Fs::node_type removed;
+
+  // Only writes need the previous contents in memory.
+  MutationLock lock(*this);
+  auto status = Status::Success;
+  if (mutation.type == MutationType::Write) {
+    status = lockResident(mutation.path, lock);
+    if (status != Status::Success) {
+      return status;
+    }
+  } else {
+    lock.lock();
+  }
+
+  invalidate(mutation.path);
+  switch (mutation.type) {
+    case MutationType::Put: {
+      auto previous = eraseFromDisk(mutation.path);
+      const auto [found, added] = fs_.emplace(mutation.path);
+      auto& file = found->second;
+      if (!added) {
+        previous = file.size();
+        if (auto* object = file.getObject()) {
+          replaced = std::move(*object);
+        }
+      }
+
+      if (tiny) {
+        std::array<char, Entry::kMaxInlineSize> bytes;
+        copyTo(data, bytes.data());
+        file.store(std::string_view{bytes.data(), data.size()});
+      } else {
+        file.store(data);
+      }
+      stamp(file, mutation.sequence);
+      file.checksum = mutation.checksum;
+      account(mutation.path, previous, file.size());
+      if (merkle_) {
+        merkle_->put(mutation.path, digest, file.size());
+      }
+      break;
+    }
+
+    case MutationType::Write: {
+      auto file = fs_.find(mutation.path);
+      const auto previous = file ? file->second.size() : 0;
+      if (file == nullptr) {
+        status = Status::FileNotFound;
+      } else if (!overwrite(mutation.path, file->second, mutation.offset, data,
+                            digest, replaced)) {
+        status = Status::InvalidRange;
+      } else {
+        stamp(file->second, mutation.sequence);
+        usage_.resize(mutation.path, previous, file->second.size());
+      }
+      break;
+    }
+
+    case MutationType::Remove: {
+      removed = fs_.extract(mutation.path);
+      const auto size = removed.empty()
+                            ? eraseFromDisk(mutation.path)
+                            : std::optional{removed.mapped().size()};
+      if (size) {
+        usage_.remove(mutation.path, *size);
+        if (merkle_) {
+          merkle_->remove(mutation.path);
+        }
+      } else {
+        status = Status::FileNotFound;
+      }
+      break;
+    }
+  }
+
+  // The mutation is logged under its original sequence number even if it
+  // had no effect, so that the log stays gapless.
+  if (mutation.sequence > sequence_) {
+    sequence_ = mutation.sequence;
+    log_.push({sequence_, mutation.type, mutation.path, mutation.offset,
+               std::move(data), mutation.checksum});
+  }
+  lock.unlock();
+
+  retire(std::move(replaced));
+  retire(std::move(removed));
+  return status;
+}
+
+void MemoryFs::reset(std::uint64_t sequence) { load(sequence, {}); }
+
+void MemoryFs::load(std::uint64_t sequence,
+                    const std::vector<Mutation>& snapshot) {
+  // The snapshot is copied to the arena, hashed and indexed outside of the
+  // lock. Tiny objects are copied into the index.
+  Fs loaded;
+  loaded.reserve(snapshot.size());
+  std::vector<std::pair<const std::string*, ContentHash>> digests;
+  for (const auto& mutation : snapshot) {
+    if (mutation.type != MutationType::Put) {
+      continue;
+    }
+
+    auto& file = loaded.emplace(mutation.path).first->second;
+    if (mutation.data.size() <= inline_threshold_) {
+      std::array<char, Entry::kMaxInlineSize> bytes;
+      copyTo(mutation.data, bytes.data());
+      file.store(std::string_view{bytes.data(), mutation.data.size()});
+    } else {
+      file.store(arena_.allocate(mutation.data));
+    }
+    stamp(file, sequence);
+    file.checksum = mutation.checksum;
+    if (merkle_) {
+      digests.emplace_back(&mutation.path, hash(mutation.data));
+    }
+  }
+
+  Fs removed;
+  {
+    MutationLock lock(*this);
+    lock.lock();
+    removed.swap(fs_);
+    fs_.swap(loaded);
+    usage_.clear();
+    fs_.forEach([this](const auto& file) {
+      usage_.add(file.first, file.second.size());
+    });
+    if (merkle_) {
+      merkle_->clear();
+      for (const auto& [path, digest] : digests) {
+        merkle_->put(*path, digest, fs_.find(*path)->second.size());
+      }
+    }
+    if (disk_) {
+      for (const auto& path : disk_->list()) {
+        disk_->erase(path);
+      }
+    }
+
+    sequence_ = sequence;
+    log_.reset(sequence);
+
+    for (auto& epoch : cache_epochs_) {
+      epoch.fetch_add(1, std::memory_order_release);
+    }
+  }
+
+  // Objects are released outside of the lock.
+}
+
+std::uint64_t MemoryFs::getSequence() const noexcept {
+  std::shared_lock lock(mutex_);
+  return sequence_;
+}
+
+std::optional<std::vector<Mutation>> MemoryFs::getMutations(
+    std::uint64_t since, std::size_t max_count,
+    std::chrono::milliseconds timeout) const {
+  return log_.read(since, max_count, timeout);
+}
+
+MutationLog::WaitId MemoryFs::asyncWaitForMutations(
+    std::uint64_t since, MutationLog::WaitHandler handler) {
+  return log_.asyncWait(since, std::move(handler));
+}
+
+void MemoryFs::cancelMutationWait(MutationLog::WaitId id) {
+  log_.cancelWait(id);
+}
+
+CompactionResult MemoryFs::compact(std::size_t max_objects) {
+  std::scoped_lock compaction_lock(compaction_mutex_);
+  CompactionResult result{};
+
+  // Every pass starts by choosing the arena regions worth evacuating.
+  if (compaction_cursor_ == 0) {
+    arena_.selectForEvacuation(occupancy_threshold_);
+  }
+
+  // Collect objects to relocate, walking the index bucket by bucket.
+  std::vector<std::pair<std::string, Object>> candidates;
+  {
+    std::shared_lock lock(mutex_);
+    const auto scan_limit = max_objects * kScanFactor;
+    std::size_t scanned{0};
+
+    while ((compaction_cursor_ < fs_.bucket_count()) &&
+           (candidates.size() < max_objects) && (scanned < scan_limit)) {
+      auto file = fs_.cbegin(compaction_cursor_);
+      for (; (file != fs_.cend(compaction_cursor_)) &&
+             (candidates.size() < max_objects);
+           file++) {
+        const auto* object = file->second.getObject();
+        if ((object != nullptr) &&
+            (isFragmented(*object) || arena_.isEvacuating(*object))) {
+          candidates.emplace_back(file->first, *object);
+        }
+        scanned++;
+      }
+
+      // A bucket not walked through entirely is revisited by the next step.
+      // Objects relocated by then are not picked again.
+      if (file == fs_.cend(compaction_cursor_)) {
+        compaction_cursor_++;
+      }
+    }
+
+    if (compaction_cursor_ >= fs_.bucket_count()) {
+      compaction_cursor_ = 0;
+      result.pass_completed = true;
+    }
+  }
+
+  // Copy each object (into a single extent) outside of the lock and only swap
+  // it in under the lock.
+  // Objects modified in the meantime are skipped. The old copies are released
+  // once the candidate list goes out of scope, i.e. outside of the lock.
+  // Objects sharing their contents with an object relocated earlier in the
+  // pass (copies) get the same relocated contents, rather than a copy each.
+  for (const auto& [path, object] : candidates) {
+    const auto* shared = findRelocation(object);
+    auto relocated = shared ? *shared : arena_.allocate(object);
+
+    std::unique_lock lock(mutex_);
+    auto file = fs_.find(path);
+    if ((file != nullptr) && file->second.getObject() &&
+        file->second.getObject()->isSameAs(object)) {
+      file->second.store(relocated);
+      result.objects_moved++;
+      result.bytes_moved += shared ? 0 : object.size();
+
+      // Other references to the previous contents may be other entries.
+      if (!shared &&
+          (object.getExtents().front().buffer.use_count() > 1)) {
+        relocations_.insert_or_assign(object.getExtents().front().buffer.get(),
+                                      Relocation{object, relocated});
+      }
+    }
+  }
+
+  if (result.pass_completed) {
+    relocations_.clear();
+  }
+
+  return result;
+}
+
+MemoryFs::Relocation::Relocation(const Object& original, Object relocated)
+    : relocated{std::move(relocated)} {
+  for (const auto& extent : original.getExtents()) {
+    extents.push_back({extent.buffer.get(), extent.buffer, extent.size});
+  }
+}
+
+const Object* MemoryFs::findRelocation(const Object& object) const {
+  const auto& extents = object.getExtents();
+  const auto relocation = relocations_.find(extents.front().buffer.get());
+  if (relocation == relocations_.end()) {
+    return nullptr;
+  }
+
+  // The object holds its buffers, so a buffer sharing its owner with a
+  // recorded one (kept by the weak pointer) is the same buffer.
+  const auto same = std::equal(
+      extents.cbegin(), extents.cend(), relocation->second.extents.cbegin(),
+      relocation->second.extents.cend(),
+      [](const Extent& extent, const Relocation::WeakExtent& original) {
+        return (extent.buffer.get() == original.data) &&
+               (extent.size == original.size) &&
+               !extent.buffer.owner_before(original.owner) &&
+               !original.owner.owner_before(extent.buffer);
+      });
+  return same ? &relocation->second.relocated : nullptr;
+}
+
+bool MemoryFs::isFragmented(const Object& object) noexcept {
+  const auto extents = object.getExtents().size();
+  return (extents > kMaxExtents) && (object.size() / extents < kMinExtentSize);
+}
+
+ArenaStats MemoryFs::getMemoryStats() const noexcept {
+  return arena_.getStats();
+}
+
+MigrationResult MemoryFs::migrate(std::size_t max_objects) {
+  std::scoped_lock migration_lock(migration_mutex_);
+  MigrationResult result{};
+
+  if (!disk_) {
+    return result;
+  }
+
+  // Promote objects read from disk. They are copied to the arena outside of
+  // the lock.
+  std::vector<Promotion> promotions;
+  {
+    std::scoped_lock lock(promotion_mutex_);
+    promotions.swap(promotions_);
+  }
+
+  for (auto& promotion : promotions) {
+    auto resident = arena_.allocate(promotion.object);
+
+    MutationLock lock(*this);
+    lock.lock();
+    if (promote(promotion.path, promotion.location, std::move(resident))) {
+      result.objects_promoted++;
+    }
+  }
+
+  const auto resident_bytes = arena_.getStats().live_bytes;
+  if (resident_bytes <= memory_budget_) {
+    return result;
+  }
+
+  // Sweep the index bucket by bucket, giving recently accessed objects a
+  // second chance, until enough cold objects are collected.
+  const auto excess_bytes = resident_bytes - memory_budget_;
+  std::size_t candidate_bytes{0};
+  std::vector<std::pair<std::string, Object>> candidates;
+  {
+    std::shared_lock lock(mutex_);
+    const auto scan_limit = max_objects * kScanFactor;
+    std::size_t scanned{0};
+
+    while ((migration_cursor_ < fs_.bucket_count()) &&
+           (candidates.size() < max_objects) &&
+           (candidate_bytes < excess_bytes) && (scanned < scan_limit)) {
+      auto file = fs_.cbegin(migration_cursor_);
+      for (; (file != fs_.cend(migration_cursor_)) &&
+             (candidates.size() < max_objects) &&
+             (candidate_bytes < excess_bytes);
+           file++) {
+        // Inline objects do not take arena memory, demoting them is useless.
+        const auto* object = file->second.getObject();
+        if ((object != nullptr) && !file->second.referenced.exchange(
+                                       false, std::memory_order_relaxed)) {
+          candidates.emplace_back(file->first, *object);
+          candidate_bytes += object->size();
+        }
+        scanned++;
+      }
+
+      if (file == fs_.cend(migration_cursor_)) {
+        migration_cursor_++;
+      }
+    }
+
+    if (migration_cursor_ >= fs_.bucket_count()) {
+      migration_cursor_ = 0;
+    }
+
+    result.more_work = !fs_.empty();
+  }
+
+  // Write each object to disk outside of the lock and only drop it from memory
+  // under the lock. Objects modified or accessed in the meantime stay.
+  for (const auto& [path, object] : candidates) {
+    const auto location = disk_->write(object);
+    if (!location) {
+      continue;
+    }
+
+    MutationLock lock(*this);
+    lock.lock();
+    auto file = fs_.find(path);
+    if ((file != nullptr) && file->second.getObject() &&
+        file->second.getObject()->isSameAs(object) &&
+        !file->second.referenced.load(std::memory_order_relaxed)) {
+      auto demoted = *location;
+      demoted.version = file->second.version;
+      demoted.modified = file->second.modified;
+      disk_->insert(path, demoted);
+      fs_.erase(path);
+      result.objects_demoted++;
+      result.bytes_demoted += object.size();
+    } else {
+      disk_->release(*location);
+    }
+  }
+
+  return result;
+}
+
+DiskTierStats MemoryFs::getDiskStats() const noexcept {
+  return disk_ ? disk_->getStats() : DiskTierStats{};
+}
+
+ReclaimerStats MemoryFs::getReclaimerStats() const noexcept {
+  return reclaimer_ ? reclaimer_->getStats() : ReclaimerStats{};
+}
+
+IncrementalMapStats MemoryFs::getIndexStats() const noexcept {
+  std::shared_lock lock(mutex_);
+  return fs_.getStats();
+}
+
+void MemoryFs::drainReclaimer() {
+  if (reclaimer_) {
+    reclaimer_->drain();
+  }
+}
+
+void MemoryFs::maintainIndex() {
+  Fs::Map drained;
+  std::size_t spare_buckets{0};
+  {
+    std::unique_lock lock(mutex_);
+    fs_.takeDrained(drained);
+    spare_buckets = fs_.getSpareBucketCount();
+  }
+
+  if (spare_buckets > 0) {
+    Fs::Map spare;
+    spare.rehash(spare_buckets);
+
+    // A spare table not taken (or replaced) is released with the lock
+    // dropped.
+    std::unique_lock lock(mutex_);
+    fs_.offerSpare(spare);
+  }
+}
+
+void MemoryFs::retire(Object object) {
+  if (reclaimer_) {
+    reclaimer_->retire(std::move(object));
+  }
+}
+
+void MemoryFs::retire(Fs::node_type node) {
+  if (node.empty()) {
+    return;
+  }
+
+  // The index node is freed here, only the object is worth handing over.
+  if (auto* object = node.mapped().getObject()) {
+    retire(std::move(*object));
+  }
+}
+
+std::vector<ObjectCacheStats> MemoryFs::getCacheStats() const {
+  std::scoped_lock lock(cache_mutex_);
+
+  std::vector<ObjectCacheStats> stats;
+  stats.reserve(thread_caches_.size());
+  for (const auto& cache : thread_caches_) {
+    stats.push_back(cache->getStats());
+  }
+
+  return stats;
+}
+
+Version MemoryFs::record(MutationType type, const std::string& path,
+                         std::size_t offset, const Object& data,
+                         std::optional<Checksum> checksum) {
+  invalidate(path);
+  log_.push({++sequence_, type, path, offset, data, checksum});
+  return sequence_;
+}
+
+ObjectCache* MemoryFs::getThreadCache() const {
+  if (cache_config_.slots == 0) {
+    return nullptr;
+  }
+
+  // Filesystems are told apart by identifiers rather than addresses, which
+  // may be reused once a filesystem is destroyed. Threads mostly read from a
+  // single filesystem, the last one is looked up first.
+  thread_local std::pair<std::uint64_t, ObjectCache*> last{kNoId, nullptr};
+  if (last.first == id_) {
+    return last.second;
+  }
+
+  thread_local std::unordered_map<std::uint64_t, ObjectCache*> caches;
+  auto& cache = caches[id_];
+  if (cache == nullptr) {
+    std::scoped_lock lock(cache_mutex_);
+    thread_caches_.push_back(
+        std::make_unique<ObjectCache>(cache_config_.slots));
+    cache = thread_caches_.back().get();
+  }
+
+  last = {id_, cache};
+  return cache;
+}
+
+std::optional<std::pair<Object, FileInfo>> MemoryFs::findCached(
+    const std::string& path) const noexcept {
+  auto* cache = getThreadCache();
+  if (cache == nullptr) {
+    return {};
+  }
+
+  // Epochs are only read here: hot objects are served without writing any
+  // shared memory.
+  const auto hash = std::hash<std::string>{}(path);
+  const auto epoch =
+      cache_epochs_[hash % kCacheEpochs].load(std::memory_order_acquire);
+  return cache->find(path, hash, epoch);
+}
+
+void MemoryFs::cache(const std::string& path, const Object& object,
+                     const FileInfo& info) const {
+  auto* cache = getThreadCache();
+  if ((cache == nullptr) || (object.size() > cache_config_.max_object_size)) {
+    return;
+  }
+
+  // Epochs only change under the exclusive lock.
+  const auto hash = std::hash<std::string>{}(path);
+  const auto epoch =
+      cache_epochs_[hash % kCacheEpochs].load(std::memory_order_relaxed);
+  cache->insert(path, hash, epoch, object, info);
+}
+
+void MemoryFs::invalidate(const std::string& path) noexcept {
+  if (cache_config_.slots > 0) {
+    const auto hash = std::hash<std::string>{}(path);
+    cache_epochs_[hash % kCacheEpochs].fetch_add(1,
+                                                 std::memory_order_release);
+  }
+}
+
+Object MemoryFs::getLogged(const Entry& entry) const {
+  if (const auto* object = entry.getObject()) {
+    return *object;
+  }
+
+  return log_.isEnabled() ? entry.load() : Object{};
+}
+
+Status MemoryFs::verify(const Object& object,
+                        const FileInfo& info) const noexcept {
+  if (!verify_checksums_ || !info.checksum ||
+      (crc32c(object) == *info.checksum)) {
+    return Status::Success;
+  }
+
+  return Status::IoError;
 }
 
 bool MemoryFs::exists(const std::string& path) const {
-  return fs_.find(path) != fs_.end();
+  return (fs_.find(path) != nullptr) ||
+         (disk_ && disk_->mayContain(path) && disk_->find(path));
+}
+
+Usage MemoryFs::getUsage(const std::string& directory) const noexcept {
+  std::shared_lock lock(mutex_);
+  return usage_.get(directory);
+}
+
+std::optional<MerkleNode> MemoryFs::getMerkleNode(std::size_t index) const {
+  if (!merkle_) {
+    return {};
+  }
+
+  std::shared_lock lock(mutex_);
+  return merkle_->getNode(index);
+}
+
+std::optional<std::size_t> MemoryFs::eraseFromDisk(const std::string& path) {
+  if (!disk_ || !disk_->mayContain(path)) {
+    return {};
+  }
+
+  const auto location = disk_->find(path);
+  if (!location) {
+    return {};
+  }
+
+  disk_->erase(path);
+  return location->size;
+}
+
+void MemoryFs::account(const std::string& path,
+                       std::optional<std::size_t> previous, std::size_t size) {
+  if (previous) {
+    usage_.resize(path, *previous, size);
+  } else {
+    usage_.add(path, size);
+  }
+}
+
+std::optional<Version> MemoryFs::findVersion(const std::string& path) const {
+  const auto file = fs_.find(path);
+  if (file != nullptr) {
+    return file->second.version;
+  }
+
+  if (disk_ && disk_->mayContain(path)) {
+    if (const auto location = disk_->find(path)) {
+      return location->version;
+    }
+  }
+
+  return {};
+}
+
+std::tuple<Status, Object, FileInfo> MemoryFs::readFromDisk(
+    const std::string& path) const {
+  auto [status, location, object] = disk_->read(path);
+
+  if (status == Status::FileNotFound) {
+    // The object may have been promoted in the meantime.
+    std::shared_lock lock(mutex_);
+    const auto file = fs_.find(path);
+    if (file != nullptr) {
+      return {Status::Success, file->second.load(), getInfo(file->second)};
+    }
+  }
+
+  if (status != Status::Success) {
+    return {status, {}, {}};
+  }
+
+  {
+    std::scoped_lock lock(promotion_mutex_);
+    if (promotions_.size() < kMaxPendingPromotions) {
+      promotions_.push_back({path, location, object});
+    }
+  }
+
+  if (migrator_) {
+    migrator_->notify();
+  }
+
+  return {Status::Success, std::move(object), getInfo(location)};
+}
+
+Status MemoryFs::lockResident(const std::string& path, MutationLock& lock) {
+  lock.lock();
+
+  while (disk_ && (fs_.find(path) == nullptr) &&
+         disk_->mayContain(path) && disk_->find(path)) {
+    // Read the object without holding the lock, then try to promote it. If
+    // the object changed in the meantime, start over.
+    lock.unlock();
+    auto [status, location, object] = disk_->read(path);
+    if (status == Status::IoError) {
+      lock.lock();
+      return status;
+    }
+
+    auto resident = arena_.allocate(object);
+    lock.lock();
+    if (status == Status::Success) {
+      promote(path, location, std::move(resident));
+    }
+  }
+
+  return Status::Success;
+}
+
+Status MemoryFs::linkOnDisk(const std::string& source,
+                            const std::string& destination,
+                            bool keep_source) {
+  const auto location = (disk_ && disk_->mayContain(source))
+                            ? disk_->find(source)
+                            : std::nullopt;
+  if (!location) {
+    return Status::FileNotFound;
+  }
+
+  if (exists(destination)) {
+    return Status::AlreadyExists;
+  }
+
+  // The mutation log is disabled, so the contents are not logged.
+  auto linked = *location;
+  linked.version = record(MutationType::Put, destination, 0, {});
+  linked.modified = std::chrono::system_clock::now();
+  disk_->link(destination, linked);
+  usage_.add(destination, location->size);
+  if (merkle_) {
+    merkle_->put(destination, merkle_->find(source).value_or(0),
+                 location->size);
+  }
+
+  if (!keep_source) {
+    record(MutationType::Remove, source, 0, {});
+    disk_->erase(source);
+    usage_.remove(source, location->size);
+    if (merkle_) {
+      merkle_->remove(source);
+    }
+  }
+
+  return Status::Success;
+}
+
+bool MemoryFs::promote(const std::string& path, const DiskLocation& location,
+                       Object object) {
+  if ((fs_.find(path) != nullptr) || (disk_->find(path) != location)) {
+    return false;
+  }
+
+  disk_->erase(path);
+  auto& file = fs_.emplace(path, std::move(object)).first->second;
+  file.version = location.version;
+  file.modified = location.modified;
+  return true;
+}
+
+bool MemoryFs::overwrite(
+    const std::string& path, Entry& entry, std::size_t offset,
+    const Object& data, ContentHash data_hash, Object& released,
+    const std::optional<std::pair<Version, ContentHash>>& replaced_hash) {
+  const auto previous = entry.size();
+  if (offset > previous) {
+    return false;
+  }
+
+  // Only the replaced range is hashed again, see replaceHash(). Appends
+  // replace nothing.
+  const auto replaced = std::min(data.size(), previous - offset);
+  if (merkle_) {
+    const auto* object = entry.getObject();
+    ContentHash replaced_contents{0};
+    if (replaced_hash && (replaced_hash->first == entry.version)) {
+      replaced_contents = replaced_hash->second;
+    } else if (replaced > 0) {
+      replaced_contents =
+          object ? hashContents(object->slice(offset, replaced))
+                 : hashContents(entry.getInline().substr(offset, replaced));
+    }
+    const auto updated = replaceHash(
+        merkle_->find(path).value_or(0), replaced_contents, replaced,
+        data_hash, data.size(), previous - offset - replaced);
+    merkle_->put(path, updated, std::max(previous, offset + data.size()));
+  }
+
+  if (auto* object = entry.getObject()) {
+    // Only the extents of the replaced range are kept, so that the buffers
+    // they reference are released with them.
+    if (replaced > 0) {
+      released = object->slice(offset, replaced);
+    }
+    object->overwrite(offset, data);
+    if (offset + data.size() >= previous) {
+      released.append(coalesceTail(*object));
+    }
+    return true;
+  }
+
+  const auto contents = entry.getInline();
+  const auto size = std::max(contents.size(), offset + data.size());
+  if (size <= inline_threshold_) {
+    std::array<char, Entry::kMaxInlineSize> bytes;
+    std::memcpy(bytes.data(), contents.data(), contents.size());
+    copyTo(data, bytes.data() + offset);
+    entry.store(std::string_view{bytes.data(), size});
+    return true;
+  }
+
+  // The object outgrew the index, so it moves to the arena.
+  auto object = arena_.allocate(contents.data(), contents.size());
+  object.overwrite(offset, data);
+  entry.store(std::move(object));
+  return true;
+}
+
+std::optional<std::pair<Version, ContentHash>> MemoryFs::hashReplaced(
+    const std::string& path, std::size_t offset, std::size_t size) const {
+  Object object;
+  Version version{0};
+  {
+    std::shared_lock lock(mutex_);
+    const auto* file = fs_.find(path);
+    if ((file == nullptr) || (file->second.getObject() == nullptr)) {
+      return std::nullopt;
+    }
+
+    object = *file->second.getObject();
+    version = file->second.version;
+  }
+
+  if (offset > object.size()) {
+    return std::nullopt;
+  }
+
+  const auto replaced = std::min(size, object.size() - offset);
+  return std::pair{version,
+                   (replaced > 0) ? hashContents(object.slice(offset, replaced))
+                                  : ContentHash{0}};
+}
+
+Object MemoryFs::coalesceTail(Object& object) {
+  // Like carries of a binary counter, the last extent absorbs the extents
+  // before it as long as they are not larger than itself. Every byte is thus
+  // copied a logarithmic number of times and only a logarithmic number of
+  // small extents is left at the end of the object.
+  const auto& extents = object.getExtents();
+  auto first = extents.size();
+  std::size_t size{0};
+  while (first > 0) {
+    const auto extent_size = extents[first - 1].size;
+    if ((size > 0) && ((extent_size > size) ||
+                       (size + extent_size > kMinExtentSize))) {
+      break;
+    }
+    size += extent_size;
+    first--;
+  }
+
+  Object merged;
+  if (extents.size() - first < 2) {
+    return merged;
+  }
+
+  for (auto extent = extents.cbegin() + first; extent != extents.cend();
+       extent++) {
+    merged.append(Object{extent->buffer, extent->size});
+  }
+
+  // The merged extents are handed back, their buffers are released once the
+  // lock is.
+  object.truncate(object.size() - size);
+  object.append(arena_.allocate(merged));
+  return merged;
 }
@@ -1,13 +1,169 @@
 #ifndef FILESYSTEM_MEMORY_FS_SRC_MEMORY_FS_HPP
 #define FILESYSTEM_MEMORY_FS_SRC_MEMORY_FS_HPP
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
 #include <shared_mutex>
+#include <string_view>
+#include <tuple>
 #include <unordered_map>
+#include <vector>
 
+#include "arena.hpp"
+#include "combiner.hpp"
+#include "compactor.hpp"
+#include "disk_tier.hpp"
+#include "incremental_map.hpp"
 #include "filesystem/ifilesystem.hpp"
+#include "merkle_tree.hpp"
+#include "migrator.hpp"
+#include "mutation_log.hpp"
+#include "object_cache.hpp"
+#include "reclaimer.hpp"
+#include "usage_index.hpp"
 
 namespace fs {
 
+/**
+ * \brief Filesystem index entry.
+ *
+ * Tiny objects are stored inline, in the entry itself, rather than in the
+ * arena. They cost no allocation besides the index node and reading them only
+ * touches the node.
+ */
+class Entry {
+ public:
+  /// Maximum size of objects stored inline (in bytes).
+  static constexpr std::size_t kMaxInlineSize{64};
+
+  /**
+   * \brief Create an index entry for an empty object.
+   */
+  Entry() noexcept : inline_size_{0} {}
+
+  /**
+   * \brief Create an index entry for the given object.
+   *
+   * \param object Object contents.
+   */
+  explicit Entry(Object object) noexcept
+      : object_{std::move(object)}, inline_size_{kNotInline} {}
+
+  /**
+   * \brief Create an index entry holding a tiny object inline.
+   *
+   * \param data Object contents (at most kMaxInlineSize bytes).
+   */
+  explicit Entry(std::string_view data) noexcept : inline_size_{0} {
+    store(data);
+  }
+
+  ~Entry();
+
+  // Entry is non-copyable and non-moveable, as is the reference flag.
+  Entry(const Entry& other) = delete;
+  Entry(Entry&& other) = delete;
+  Entry& operator=(const Entry& other) = delete;
+  Entry& operator=(Entry&&) = delete;
+
+  /**
+   * \brief Check if the object is stored inline.
+   *
+   * \return True if object contents are held by the entry itself.
+   */
+  [[nodiscard]] inline bool isInline() const noexcept {
+    return inline_size_ != kNotInline;
+  }
+
+  /**
+   * \brief Return object size.
+   *
+   * \return Object size in bytes.
+   */
+  [[nodiscard]] inline std::size_t size() const noexcept {
+    return isInline() ? inline_size_ : object_.size();
+  }
+
+  /**
+   * \brief Return contents of an inline object.
+   *
+   * \return Object contents (empty if the object is not inline).
+   */
+  [[nodiscard]] inline std::string_view getInline() const noexcept {
+    return isInline() ? std::string_view{data_, inline_size_}
+                      : std::string_view{};
+  }
+
+  /**
+   * \brief Return the object, unless it is stored inline.
+   *
+   * \return Object, or nullptr if the object is stored inline.
+   */
+  [[nodiscard]] inline Object* getObject() noexcept {
+    return isInline() ? nullptr : &object_;
+  }
+
+  /**
+   * \copydoc getObject()
+   */
+  [[nodiscard]] inline const Object* getObject() const noexcept {
+    return isInline() ? nullptr : &object_;
+  }
+
+  /**
+   * \brief Return the object contents.
+   *
+   * \note Inline contents are copied into a new buffer.
+   *
+   * \return Object contents.
+   */
+  [[nodiscard]] Object load() const;
+
+  /**
+   * \brief Replace the object.
+   *
+   * \param object New object contents.
+   */
+  void store(Object object) noexcept;
+
+  /**
+   * \brief Replace the object with a tiny object stored inline.
+   *
+   * \param data New object contents (at most kMaxInlineSize bytes).
+   */
+  void store(std::string_view data) noexcept;
+
+  /// Version of the object: sequence number of its last mutation.
+  Version version{0};
+
+  /// Time of the last modification of the object.
+  std::chrono::system_clock::time_point modified{};
+
+  /// Checksum of the object contents, if recorded for the current version.
+  std::optional<Checksum> checksum{};
+
+  /// Object was accessed since the last demotion sweep went past it.
+  mutable std::atomic<bool> referenced{true};
+
+ private:
+  /// Inline size marking entries which hold an Object.
+  static constexpr std::uint8_t kNotInline{0xff};
+
+  union {
+    Object object_;              ///< Object contents (unless inline).
+    char data_[kMaxInlineSize];  ///< Inline object contents.
+  };
+
+  std::uint8_t inline_size_;  ///< Size of the inline object, or kNotInline.
+};
+
 /**
  * \brief Filesystem representation.
  *
@@ -18,19 +174,142 @@ namespace fs {
  * under the root directory.
  *
  * Additionally, there is no requirement on the order of files returned.
+ *
+ * With the disk tier enabled, only objects resident in memory are mapped here.
+ *
+ * The index grows incrementally (see IncrementalMap), so that no single
+ * request pays for rehashing all of the entries.
+ */
+using Fs = IncrementalMap<std::string, Entry>;
+
+/**
+ * \brief In-memory filesystem configuration.
+ */
+struct MemoryFsConfig {
+  ArenaConfig arena;          ///< Object memory arena configuration.
+  CompactorConfig compactor;  ///< Background compactor configuration.
+  DiskTierConfig disk;        ///< Disk tier configuration.
+  MutationLogConfig log;      ///< Mutation log configuration.
+
+  /// Objects up to this size (in bytes) are stored inline in the index, see
+  /// Entry (0 disables, at most Entry::kMaxInlineSize).
+  std::size_t inline_threshold{Entry::kMaxInlineSize};
+
+  /// Apply concurrent adds and removes in batches, see Combiner.
+  bool combine_writes{false};
+
+  /// Number of objects the index is sized for at startup (0 lets it grow
+  /// from empty).
+  std::size_t expected_objects{0};
+
+  /// Multipart uploads idle for longer are dropped by
+  /// MemoryFs::expireUploads().
+  std::chrono::milliseconds upload_timeout{60 * 60 * 1000};
+
+  ObjectCacheConfig cache;    ///< Per-thread object cache configuration.
+  MerkleTreeConfig merkle;    ///< Merkle tree configuration.
+  ReclaimerConfig reclaimer;  ///< Background reclaimer configuration.
+
+  /// Check objects against their recorded checksums whenever they are read,
+  /// see MemoryFs::put().
+  bool verify_checksums{false};
+};
+
+/**
+ * \brief Result of a single compaction step.
+ */
+struct CompactionResult {
+  std::size_t objects_moved;  ///< Number of objects relocated.
+  std::size_t bytes_moved;    ///< Number of bytes relocated.
+  bool pass_completed;        ///< Whole filesystem has been walked through.
+};
+
+/**
+ * \brief Result of a single tier migration step.
  */
-using Fs = std::unordered_map<std::string, File>;
+struct MigrationResult {
+  std::size_t objects_promoted;  ///< Objects moved from disk to memory.
+  std::size_t objects_demoted;   ///< Objects moved from memory to disk.
+  std::size_t bytes_demoted;     ///< Bytes moved from memory to disk.
+  bool more_work;                ///< Memory is still over budget.
+};
 
 /**
  * \brief In-memory thread-safe filesystem.
  *
  * Non-persistent filesystem which allows multiple threads to read from it
  * but only one thread to modify the filesystem at any given time.
+ *
+ * Object contents are kept in a region-based memory arena. Sparse regions left
+ * behind by removed objects are compacted incrementally (see compact()), either
+ * on demand or by the background compactor. Tiny objects are stored inline in
+ * the index instead, they are neither compacted nor moved to disk.
+ *
+ * Appends cost the size of the appended data, whatever the size of the
+ * object: the extents are added to the object in place and small extents at
+ * its end are merged as they are written (see coalesceTail()).
+ *
+ * With write combining enabled, concurrent adds and removes are published to
+ * a Combiner and applied in batches, by whichever writer gets the exclusive
+ * lock.
+ *
+ * Removed and overwritten objects are only unlinked from the index under the
+ * lock, they are always freed outside of it. With the reclaimer enabled, they
+ * are handed over to a background thread instead (see Reclaimer), so that
+ * removing an object takes the same time whatever its size.
+ *
+ * With the disk tier enabled, cold objects are moved to disk whenever memory
+ * holds more object bytes than its budget (see migrate()). Objects which are
+ * read from disk are promoted back to memory. Cold objects are chosen with
+ * the CLOCK algorithm: an object is demoted only if it was not accessed since
+ * the previous sweep went past it. Objects on disk are copied and renamed by
+ * linking their contents under the new path, without reading them (unless
+ * the mutation log needs them).
+ *
+ * Every mutation gets a sequence number and is recorded in a bounded mutation
+ * log, from which it can be shipped elsewhere (see getMutations() and
+ * apply()). Copies are logged as puts of the shared contents, renames as a
+ * put followed by a remove. The sequence number of the last mutation of an
+ * object doubles as its version, so replicas agree on versions.
+ *
+ * Parts of multipart uploads are copied to the arena as they arrive, outside
+ * of the filesystem lock. Completing an upload stitches the parts together by
+ * reference, so the resulting object is made of one extent per part. Parts
+ * are neither listed nor logged, only the completed object is.
+ *
+ * The number and total size of files under every directory are kept up to
+ * date by each mutation (see UsageIndex), so that getUsage() does not scan
+ * the filesystem.
+ *
+ * Reads of small objects may be served by a cache private to the calling
+ * thread (see ObjectCache), without taking the lock or writing any shared
+ * memory. Every mutation bumps the epoch of its path (paths share a fixed
+ * number of epochs by their hashes), which invalidates all cached copies.
+ * Cache hits do not mark objects as recently accessed, so hot objects may
+ * still be moved to disk; threads keep serving their cached copies.
+ *
+ * With the Merkle tree enabled, every mutation also updates the digest of
+ * the file in a MerkleTree, so that two filesystems can be compared without
+ * listing all of their files (see getMerkleNode()). Contents are hashed
+ * outside of the lock; appends and writes only hash the data written and the
+ * range they replace, never the whole object.
+ *
+ * Checksums computed by writers as they receive the contents are recorded
+ * along with the object they put (see put()). Any mutation of the object drops
+ * its checksum, so that it never describes other contents, while copies and
+ * renames keep it. With MemoryFsConfig::verify_checksums set, objects are
+ * checked against their checksums whenever they are read, outside of the
+ * lock. Objects moved to disk lose their checksums.
  */
 class MemoryFs : public IFilesystem {
  public:
-  MemoryFs() = default;
-  ~MemoryFs() = default;
+  /**
+   * \brief Create an in-memory filesystem.
+   *
+   * \param config Filesystem configuration.
+   */
+  explicit MemoryFs(const MemoryFsConfig& config = {});
+  ~MemoryFs() override;
 
   // MemoryFs is non-copyable and non-moveable because the semantics of
   // these operations would not be trivial. Moveover, there is no req to allow
@@ -41,27 +320,793 @@ class MemoryFs : public IFilesystem {
   MemoryFs& operator=(const MemoryFs& other) = delete;
   MemoryFs& operator=(MemoryFs&&) = delete;
 
-  std::pair<Status, const File&> get(
+  std::pair<Status, Object> get(
+      const std::string& path) const noexcept override;
+  std::tuple<Status, Object, FileInfo> getWithInfo(
+      const std::string& path) const noexcept override;
+  std::pair<Status, FileInfo> stat(
       const std::string& path) const noexcept override;
   Status add(const std::string& path, const File& file) noexcept override;
+  std::pair<Status, Version> put(
+      const std::string& path, const File& file,
+      const Precondition& precondition,
+      std::optional<Checksum> checksum = std::nullopt) noexcept override;
+  UploadId createUpload(const std::string& path) noexcept override;
+  Status uploadPart(UploadId upload, const std::string& path,
+                    std::size_t number, const File& data) noexcept override;
+  std::pair<Status, Version> completeUpload(
+      UploadId upload, const std::string& path,
+      const Precondition& precondition) noexcept override;
+  Status abortUpload(UploadId upload,
+                     const std::string& path) noexcept override;
+  Status append(const std::string& path, const File& data) noexcept override;
+  Status write(const std::string& path, std::size_t offset,
+               const File& data) noexcept override;
   FileList list() const noexcept override;
   Status remove(const std::string& path) noexcept override;
+  Status remove(const std::string& path,
+                const Precondition& precondition) noexcept override;
+
+  /**
+   * \copydoc IFilesystem::removePrefix()
+   *
+   * Matching paths are collected under the shared lock, then removed in
+   * batches of kRemoveBatchSize, each under a separate exclusive lock. Memory
+   * of removed objects is released outside of the lock.
+   */
+  std::size_t removePrefix(const std::string& prefix) noexcept override;
+  Status copy(const std::string& source,
+              const std::string& destination) noexcept override;
+  Status rename(const std::string& source,
+                const std::string& destination) noexcept override;
+  bool isOnDisk(const std::string& path) const noexcept override;
+  Usage getUsage(const std::string& directory) const noexcept override;
+
+  /**
+   * \brief Get file from the specified path, unless it has to be read from
+   * disk.
+   *
+   * \param path Path to the file to get.
+   *
+   * \return Operation result, the file and its metadata (if successfull), or
+   * nothing if the file may be on disk. Use getWithInfo() to read it,
+   * outside of latency sensitive threads.
+   */
+  [[nodiscard]] std::optional<std::tuple<Status, Object, FileInfo>> tryGet(
+      const std::string& path) const noexcept override;
+
+  /**
+   * \brief Return lookup statistics of the per-thread object caches.
+   *
+   * \return Statistics of each thread which read from this filesystem, in
+   * order of their first read (empty if caching is disabled).
+   */
+  [[nodiscard]] std::vector<ObjectCacheStats> getCacheStats() const;
+
+  /**
+   * \brief Drop multipart uploads which were idle for longer than the upload
+   * timeout.
+   *
+   * \return Number of dropped uploads.
+   */
+  std::size_t expireUploads() override;
+
+  /**
+   * \brief Apply a mutation recorded by another filesystem.
+   *
+   * Puts replace existing objects. The filesystem sequence number is advanced
+   * to the sequence number of the mutation. Mutations with sequence numbers
+   * not past the current one are replays: they are applied, but not logged.
+   *
+   * \param mutation Mutation to apply.
+   *
+   * \return Status of the mutation (it is logged even if it had no effect).
+   */
+  Status apply(const Mutation& mutation) noexcept;
+
+  /**
+   * \brief Remove all objects and restart from the given sequence number.
+   *
+   * Used before loading a snapshot of another filesystem.
+   *
+   * \param sequence Sequence number the filesystem continues from.
+   */
+  void reset(std::uint64_t sequence);
+
+  /**
+   * \brief Replace all objects with a snapshot of another filesystem, and
+   * restart from the given sequence number.
+   *
+   * The snapshot is indexed outside of the lock and swapped in at once, so
+   * that readers see either the previous objects or the snapshot, never a
+   * partially loaded filesystem.
+   *
+   * \param sequence Sequence number the filesystem continues from.
+   * \param snapshot Puts of the objects in the snapshot (other mutations are
+   * ignored).
+   */
+  void load(std::uint64_t sequence, const std::vector<Mutation>& snapshot);
+
+  /**
+   * \brief Return sequence number of the last mutation.
+   *
+   * \return Last sequence number (0 if there were no mutations).
+   */
+  [[nodiscard]] std::uint64_t getSequence() const noexcept;
+
+  /**
+   * \brief Read mutations following the given sequence number.
+   *
+   * Waits until there is at least one mutation to return, or until timeout.
+   *
+   * \param since Sequence number of the last mutation already seen.
+   * \param max_count Maximum number of mutations to return.
+   * \param timeout Maximum time to wait for new mutations.
+   *
+   * \return Mutations in sequence number order (empty on timeout), or nothing
+   * if the mutation log no longer holds all mutations following the given
+   * sequence number.
+   */
+  [[nodiscard]] std::optional<std::vector<Mutation>> getMutations(
+      std::uint64_t since, std::size_t max_count,
+      std::chrono::milliseconds timeout) const;
+
+  /**
+   * \brief Wait for mutations following the given sequence number, without
+   * blocking.
+   *
+   * \note The handler is called once, either right away or by the thread
+   * performing the next mutation (with the filesystem lock held). It must
+   * not block, e.g. it should only post work elsewhere.
+   *
+   * \param since Sequence number of the last mutation already seen.
+   * \param handler Handler to call once there are new mutations.
+   *
+   * \return Wait identifier, to cancel the wait.
+   */
+  MutationLog::WaitId asyncWaitForMutations(std::uint64_t since,
+                                            MutationLog::WaitHandler handler);
+
+  /**
+   * \brief Cancel a wait for mutations, without calling its handler.
+   *
+   * \param id Wait identifier.
+   */
+  void cancelMutationWait(MutationLog::WaitId id);
+
+  /**
+   * \brief Perform a single incremental compaction step.
+   *
+   * Objects living in sparsely populated arena regions, as well as objects
+   * split into many extents by overwrites, are copied into dense regions
+   * outside of the filesystem lock. The exclusive lock is only taken for a
+   * short time per object, to swap the object for its copy. Once a sparse
+   * region has no live objects left, it is returned to the OS.
+   *
+   * \param max_objects Maximum number of objects to relocate in this step.
+   *
+   * \return Compaction step result.
+   */
+  CompactionResult compact(std::size_t max_objects);
+
+  /**
+   * \brief Return statistics of the object memory.
+   *
+   * \return Object memory arena statistics.
+   */
+  [[nodiscard]] ArenaStats getMemoryStats() const noexcept;
+
+  /**
+   * \brief Perform a single tier migration step.
+   *
+   * Objects read from disk since the last step are promoted to memory. Then,
+   * if memory holds more object bytes than its budget, cold objects are
+   * written to disk outside of the filesystem lock and only dropped from
+   * memory under the lock.
+   *
+   * \param max_objects Maximum number of objects to demote in this step.
+   *
+   * \return Migration step result.
+   */
+  MigrationResult migrate(std::size_t max_objects);
+
+  /**
+   * \brief Return statistics of the disk tier.
+   *
+   * \return Disk tier statistics (all zeros if the disk tier is disabled).
+   */
+  [[nodiscard]] DiskTierStats getDiskStats() const noexcept;
+
+  /**
+   * \brief Return statistics of the background reclaimer.
+   *
+   * \return Reclaimer statistics (all zeros if the reclaimer is disabled).
+   */
+  [[nodiscard]] ReclaimerStats getReclaimerStats() const noexcept;
+
+  /**
+   * \brief Return growth statistics of the index.
+   *
+   * \return Index growth statistics.
+   */
+  [[nodiscard]] IncrementalMapStats getIndexStats() const noexcept;
+
+  /**
+   * \brief Wait until all objects removed (or overwritten) so far are freed.
+   */
+  void drainReclaimer();
+
+  /**
+   * \brief Check if the filesystem keeps a Merkle tree of its files.
+   *
+   * \return True if the Merkle tree is enabled, false otherwise.
+   */
+  [[nodiscard]] bool hasMerkleTree() const noexcept {
+    return merkle_ != nullptr;
+  }
+
+  /**
+   * \brief Return a node of the Merkle tree of the files.
+   *
+   * \param index Node index (1 for the root).
+   *
+   * \return Node, or nothing if there is no such node or the Merkle tree is
+   * disabled.
+   */
+  [[nodiscard]] std::optional<MerkleNode> getMerkleNode(
+      std::size_t index) const;
 
  private:
+  /**
+   * \brief Object read from disk, waiting to be promoted to memory.
+   */
+  struct Promotion {
+    std::string path;       ///< Object path.
+    DiskLocation location;  ///< Location the object was read from.
+    Object object;          ///< Object contents.
+  };
+
+  /**
+   * \brief Object relocated by the current compaction pass, whose previous
+   * contents were shared with other references (e.g. copies of the object).
+   */
+  struct Relocation {
+    /**
+     * \brief Extent which does not keep its buffer alive.
+     */
+    struct WeakExtent {
+      const char* data;                  ///< First byte of the extent.
+      std::weak_ptr<const char> owner;   ///< Buffer holding the extent.
+      std::size_t size;                  ///< Extent size (in bytes).
+    };
+
+    /**
+     * \brief Record a relocated object.
+     *
+     * \param original Previous contents of the object.
+     * \param relocated Relocated contents.
+     */
+    Relocation(const Object& original, Object relocated);
+
+    /// Extents of the previous contents. Their buffers are released as soon
+    /// as all objects sharing them are relocated.
+    std::vector<WeakExtent> extents;
+
+    Object relocated;  ///< Relocated contents.
+  };
+
+  /**
+   * \brief Multipart upload in progress.
+   */
+  struct Upload {
+    std::string path;                       ///< Path of the uploaded file.
+    std::map<std::size_t, Object> parts;    ///< Parts by their numbers.
+    std::chrono::steady_clock::time_point last_activity;  ///< Last part time.
+  };
+
+  /**
+   * \brief Exclusive lock for mutations not applied through mutate(). The
+   * index is maintained each time it is released, as mutate() does.
+   */
+  class MutationLock {
+   public:
+    /**
+     * \brief Constructor, the lock is not acquired yet.
+     *
+     * \param owner Filesystem to lock.
+     */
+    explicit MutationLock(MemoryFs& owner) noexcept : owner_{owner} {}
+
+    MutationLock(const MutationLock&) = delete;
+    MutationLock& operator=(const MutationLock&) = delete;
+
+    ~MutationLock() { unlock(); }
+
+    /**
+     * \brief Acquire the exclusive lock.
+     */
+    void lock() { lock_.lock(); }
+
+    /**
+     * \brief Release the exclusive lock (if held), then maintain the index if
+     * it needs tables.
+     */
+    void unlock() {
+      if (!lock_.owns_lock()) {
+        return;
+      }
+
+      const auto needs_tables = owner_.fs_.needsTables();
+      lock_.unlock();
+      if (needs_tables) {
+        owner_.maintainIndex();
+      }
+    }
+
+   private:
+    MemoryFs& owner_;  ///< Locked filesystem.
+
+    /// Lock on the filesystem mutex.
+    std::unique_lock<std::shared_mutex> lock_{owner_.mutex_, std::defer_lock};
+  };
+
+  /**
+   * \brief Store an object if the precondition holds, replacing the current
+   * one.
+   *
+   * \param path Path at which to store the object.
+   * \param object Object contents (allocated in the arena), or contents to
+   * log if the object is stored inline.
+   * \param inline_data Contents of a tiny object to store inline, if any.
+   * \param precondition Condition on the file currently stored at the path.
+   * \param checksum Checksum of the object contents, if known.
+   *
+   * \return Status of the operation and the new version of the object.
+   */
+  std::pair<Status, Version> store(const std::string& path, Object object,
+                                   std::optional<std::string_view> inline_data,
+                                   const Precondition& precondition,
+                                   std::optional<Checksum> checksum);
+
+  /**
+   * \brief Return the object cache of the calling thread, creating it on the
+   * thread's first read.
+   *
+   * \return Object cache, or nullptr if caching is disabled.
+   */
+  ObjectCache* getThreadCache() const;
+
+  /**
+   * \brief Look up an object in the cache of the calling thread.
+   *
+   * \param path Object path.
+   *
+   * \return Object and its metadata, if cached and up to date.
+   */
+  std::optional<std::pair<Object, FileInfo>> findCached(
+      const std::string& path) const noexcept;
+
+  /**
+   * \brief Cache an object read by the calling thread, if it is small
+   * enough.
+   *
+   * \note Must be called with the lock held, so that the object is current
+   * in the epoch read.
+   *
+   * \param path Object path.
+   * \param object Object contents.
+   * \param info Object metadata.
+   */
+  void cache(const std::string& path, const Object& object,
+             const FileInfo& info) const;
+
+  /**
+   * \brief Invalidate cached copies of an object.
+   *
+   * \note Must be called with the exclusive lock held.
+   *
+   * \param path Path of the mutated object.
+   */
+  void invalidate(const std::string& path) noexcept;
+
+  /**
+   * \brief Look up an object with the same contents, relocated earlier in
+   * the current compaction pass.
+   *
+   * \note Must be called with the compaction mutex held.
+   *
+   * \param object Non-empty object to relocate.
+   *
+   * \return Relocated contents to share, or nullptr if there are none.
+   */
+  const Object* findRelocation(const Object& object) const;
+
+  /**
+   * \brief Check if an object is worth coalescing into a single extent.
+   *
+   * \param object Object to check.
+   *
+   * \return True if the object is made of many small extents, false otherwise.
+   */
+  [[nodiscard]] static bool isFragmented(const Object& object) noexcept;
+
+  /**
+   * \brief Record a mutation under the next sequence number, and invalidate
+   * cached copies of the object.
+   *
+   * \note Must be called with the exclusive lock held.
+   *
+   * \param type Mutation type.
+   * \param path Path of the mutated object.
+   * \param offset Position of the written data.
+   * \param data Stored or written data.
+   * \param checksum Checksum of the stored object (Put only).
+   *
+   * \return Sequence number of the mutation (new version of the object).
+   */
+  Version record(MutationType type, const std::string& path,
+                 std::size_t offset, const Object& data,
+                 std::optional<Checksum> checksum = std::nullopt);
+
+  /**
+   * \brief Return object contents to record in the mutation log.
+   *
+   * \param entry Index entry of the object.
+   *
+   * \return Object contents, or an empty object if the contents are inline
+   * and the log does not keep them.
+   */
+  Object getLogged(const Entry& entry) const;
+
+  /**
+   * \brief Check an object read against its recorded checksum.
+   *
+   * \note Objects are only checked if MemoryFsConfig::verify_checksums is set
+   * and their checksum was recorded.
+   *
+   * \param object Object contents.
+   * \param info Object metadata.
+   *
+   * \return Success, or IoError if the contents do not match the checksum.
+   */
+  Status verify(const Object& object, const FileInfo& info) const noexcept;
+
+  /**
+   * \brief Apply a mutation under the exclusive lock, through the combiner if
+   * write combining is enabled.
+   *
+   * \param operation Mutation to apply (callable without arguments).
+   */
+  template <typename Operation>
+  void mutate(Operation&& operation) {
+    bool needs_tables{false};
+    auto mutation = [this, &operation, &needs_tables] {
+      operation();
+      needs_tables = fs_.needsTables();
+    };
+
+    if (combiner_) {
+      combiner_->execute(mutation);
+    } else {
+      std::unique_lock lock(mutex_);
+      mutation();
+    }
+
+    if (needs_tables) {
+      maintainIndex();
+    }
+  }
+
+  /**
+   * \brief Allocate the next index table and release the drained one,
+   * outside of the exclusive lock.
+   *
+   * \note Must be called without the lock held.
+   */
+  void maintainIndex();
+
   /**
    * \brief Check if a file with the given path exists.
    *
+   * \note Must be called with the lock held.
+   *
    * \param path Path at which to check.
    *
-   * \return True if file exists, false otherwise.
+   * \return True if file exists (in memory or on disk), false otherwise.
    */
   bool exists(const std::string& path) const;
 
+  /**
+   * \brief Remove a file from disk, if it is stored there.
+   *
+   * \note Must be called with the exclusive lock held.
+   *
+   * \param path Path to the file.
+   *
+   * \return Size of the removed file, or nothing if it was not on disk.
+   */
+  std::optional<std::size_t> eraseFromDisk(const std::string& path);
+
+  /**
+   * \brief Account for a stored file in the directory usage.
+   *
+   * \note Must be called with the exclusive lock held.
+   *
+   * \param path Path to the file.
+   * \param previous Size of the replaced file, or nothing if the file is new.
+   * \param size New file size.
+   */
+  void account(const std::string& path, std::optional<std::size_t> previous,
+               std::size_t size);
+
+  /**
+   * \brief Return version of the file with the given path.
+   *
+   * \note Must be called with the lock held.
+   *
+   * \param path Path to the file.
+   *
+   * \return File version (in memory or on disk), or nothing if the file does
+   * not exist.
+   */
+  std::optional<Version> findVersion(const std::string& path) const;
+
+  /**
+   * \brief Read a file from disk and queue it for promotion.
+   *
+   * \param path Path to the file to read.
+   *
+   * \return Operation result, the file and its metadata (if successfull).
+   */
+  std::tuple<Status, Object, FileInfo> readFromDisk(
+      const std::string& path) const;
+
+  /**
+   * \brief Lock the filesystem exclusively, with the given file resident in
+   * memory (if it exists).
+   *
+   * \param path Path to the file to bring to memory.
+   * \param lock Lock to acquire (not held yet).
+   *
+   * \return Success, or IoError if the file could not be read from disk.
+   */
+  Status lockResident(const std::string& path, MutationLock& lock);
+
+  /**
+   * \brief Copy or move an object stored on disk, by linking its contents
+   * under the new path. Nothing is read from disk.
+   *
+   * \note Must be called with the exclusive lock held, with the mutation log
+   * disabled (it would need the contents).
+   *
+   * \param source Path to the object.
+   * \param destination Path at which to link the object.
+   * \param keep_source Copy the object rather than move it.
+   *
+   * \return Status of the operation.
+   */
+  Status linkOnDisk(const std::string& source, const std::string& destination,
+                    bool keep_source);
+
+  /**
+   * \brief Move an object read from disk to memory.
+   *
+   * \note Must be called with the exclusive lock held.
+   *
+   * \param path Object path.
+   * \param location Location the object was read from.
+   * \param object Object contents (allocated in the arena).
+   *
+   * \return True if object was promoted, false if it changed in the meantime.
+   */
+  bool promote(const std::string& path, const DiskLocation& location,
+               Object object);
+
+  /**
+   * \brief Overwrite part of an object, moving it in or out of the index
+   * according to its new size.
+   *
+   * \note Must be called with the exclusive lock held.
+   *
+   * \param path Object path.
+   * \param entry Index entry of the object.
+   * \param offset Position of the first byte to overwrite.
+   * \param data Data to write.
+   * \param data_hash Hash of the data (only used by the Merkle tree).
+   * \param released Set to the previous contents, to be retired once the lock
+   * is released.
+   * \param replaced_hash Hash of the overwritten range, if it was computed
+   * beforehand (see hashReplaced()). It is only used if the object is still
+   * at the version it was computed from.
+   *
+   * \return True if the object was modified, false if offset is out of range.
+   */
+  bool overwrite(
+      const std::string& path, Entry& entry, std::size_t offset,
+      const Object& data, ContentHash data_hash, Object& released,
+      const std::optional<std::pair<Version, ContentHash>>& replaced_hash =
+          std::nullopt);
+
+  /**
+   * \brief Hash the range of an object a write is about to overwrite, for the
+   * Merkle tree, from a snapshot of the object.
+   *
+   * \note Must be called without the lock held. Only the shared lock is taken,
+   * to snapshot the object.
+   *
+   * \param path Object path.
+   * \param offset Position of the first byte to overwrite.
+   * \param size Size of the written data.
+   *
+   * \return Version of the snapshot and hash of the overwritten range, or
+   * nothing if the object is not stored in the arena or the offset is out of
+   * range.
+   */
+  [[nodiscard]] std::optional<std::pair<Version, ContentHash>> hashReplaced(
+      const std::string& path, std::size_t offset, std::size_t size) const;
+
+  /**
+   * \brief Merge small extents at the end of an object, so that appends do
+   * not leave it fragmented.
+   *
+   * \note Must be called with the exclusive lock held. Only the trailing
+   * extents are visited, at most kMinExtentSize bytes are copied.
+   *
+   * \param object Object which was just written at its end.
+   *
+   * \return Merged extents, to be retired once the lock is released.
+   */
+  Object coalesceTail(Object& object);
+
+  /**
+   * \brief Release an object which is no longer part of the filesystem, in
+   * the background if the reclaimer is enabled.
+   *
+   * \note Must be called without the lock held.
+   *
+   * \param object Object to release.
+   */
+  void retire(Object object);
+
+  /**
+   * \brief Release an index node removed from the filesystem, in the
+   * background if the reclaimer is enabled.
+   *
+   * \note Must be called without the lock held.
+   *
+   * \param node Extracted index node (may be empty).
+   */
+  void retire(Fs::node_type node);
+
+  /**
+   * \brief Hash data for the Merkle tree, if it is enabled.
+   *
+   * \param data Data to hash.
+   *
+   * \return Hash of the data, or 0 if the Merkle tree is disabled.
+   */
+  template <typename Data>
+  [[nodiscard]] ContentHash hash(const Data& data) const noexcept {
+    return merkle_ ? hashContents(data) : 0;
+  }
+
+  /// Maximum number of index entries inspected per compaction (or migration)
+  /// step, for each object to be moved. Bounds the shared lock hold time.
+  static constexpr std::size_t kScanFactor{16};
+
+  /// Objects made of more extents than this are coalesced by compaction,
+  /// unless their extents are large enough (see kMinExtentSize).
+  static constexpr std::size_t kMaxExtents{16};
+
+  /// Average extent size (in bytes) above which an object is not coalesced.
+  /// Parts of multipart uploads are not copied only to be put back together.
+  static constexpr std::size_t kMinExtentSize{64 * 1024};
+
+  /// Maximum part number of multipart uploads.
+  static constexpr std::size_t kMaxUploadParts{10000};
+
+  /// Maximum number of files removed per exclusive lock by removePrefix().
+  static constexpr std::size_t kRemoveBatchSize{256};
+
+  /// Maximum number of objects read from disk waiting to be promoted.
+  static constexpr std::size_t kMaxPendingPromotions{1024};
+
+  /// Number of epochs of cached objects.
+  static constexpr std::size_t kCacheEpochs{4096};
+
   Fs fs_;  ///< Mapping from paths to files.
 
+  /// Number and total size of files under every directory.
+  UsageIndex usage_;
+
+  /// Digests of all files (if enabled).
+  std::unique_ptr<MerkleTree> merkle_;
+
   /// Reader/Writer lock to allow mutiple threads to read the filesystem, but
   /// only one thread to write to the filestystem.
   mutable std::shared_mutex mutex_;
+
+  Arena arena_;  ///< Memory arena holding object contents.
+
+  /// Objects up to this size are stored inline in the index.
+  std::size_t inline_threshold_;
+
+  /// Check objects against their recorded checksums when they are read.
+  bool verify_checksums_;
+
+  /// Combiner of concurrent adds and removes (if enabled).
+  std::unique_ptr<Combiner> combiner_;
+
+  std::uint64_t sequence_{0};  ///< Sequence number of the last mutation.
+  MutationLog log_;            ///< Most recent mutations.
+
+  /// Arena regions with live/mapped bytes ratio below this are compacted.
+  double occupancy_threshold_;
+
+  /// Serializes compaction steps.
+  std::mutex compaction_mutex_;
+
+  /// Index bucket at which the next compaction step starts.
+  std::size_t compaction_cursor_{0};
+
+  /// Objects with shared contents relocated by the current compaction pass,
+  /// by the first byte of their previous contents.
+  std::unordered_map<const char*, Relocation> relocations_;
+
+  /// Background compactor (if enabled).
+  std::unique_ptr<Compactor> compactor_;
+
+  /// Disk tier holding cold objects (if enabled).
+  std::unique_ptr<DiskTier> disk_;
+
+  /// Object bytes kept in memory before cold objects are moved to disk.
+  std::size_t memory_budget_;
+
+  /// Serializes migration steps.
+  std::mutex migration_mutex_;
+
+  /// Index bucket at which the next demotion sweep starts.
+  std::size_t migration_cursor_{0};
+
+  /// Protects the promotion queue.
+  mutable std::mutex promotion_mutex_;
+
+  /// Objects read from disk, waiting to be promoted to memory. Reads do not
+  /// modify the index themselves, so that they can be served concurrently.
+  mutable std::vector<Promotion> promotions_;
+
+  /// Background migrator (if enabled).
+  std::unique_ptr<Migrator> migrator_;
+
+  /// Background reclaimer of released objects (if enabled).
+  std::unique_ptr<Reclaimer> reclaimer_;
+
+  /// Multipart uploads idle for longer are dropped.
+  std::chrono::milliseconds upload_timeout_;
+
+  /// Protects the multipart uploads.
+  std::mutex upload_mutex_;
+
+  /// Generates identifiers of multipart uploads, so that they are not easily
+  /// guessed.
+  std::mt19937_64 upload_ids_{std::random_device{}()};
+
+  /// Multipart uploads in progress.
+  std::unordered_map<UploadId, Upload> uploads_;
+
+  /// Identifies the filesystem to per-thread lookups of its caches.
+  std::uint64_t id_;
+
+  ObjectCacheConfig cache_config_;  ///< Per-thread object cache configuration.
+
+  /// Epochs of cached objects, by hashes of their paths.
+  std::array<std::atomic<std::uint64_t>, kCacheEpochs> cache_epochs_{};
+
+  /// Protects the list of caches.
+  mutable std::mutex cache_mutex_;
+
+  /// Object caches of the threads which read from this filesystem.
+  mutable std::vector<std::unique_ptr<ObjectCache>> thread_caches_;
 };
 
 }  // namespace fs
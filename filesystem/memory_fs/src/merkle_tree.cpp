@@ -0,0 +1,295 @@
+#include "merkle_tree.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace fs {
+
+namespace {
+
+/// Modulus of content hashes (a Mersenne prime).
+constexpr std::uint64_t kPrime{(std::uint64_t{1} << 61) - 1};
+
+/// Base of content hashes, the polynomial is evaluated at this point.
+constexpr std::uint64_t kBase{0x1d6b9a3c5e7f2a41};
+
+/// Constants telling apart the inputs of digests.
+constexpr std::uint64_t kPathSalt{0x9e3779b97f4a7c15};
+constexpr std::uint64_t kSizeSalt{0xc2b2ae3d27d4eb4f};
+constexpr std::uint64_t kRightSalt{0x165667b19e3779f9};
+
+/**
+ * \brief Reduce a number modulo kPrime.
+ *
+ * \param value Number below 2^123.
+ *
+ * \return Reduced number.
+ */
+constexpr std::uint64_t reduce(unsigned __int128 value) noexcept {
+  auto result = static_cast<std::uint64_t>(value & kPrime) +
+                static_cast<std::uint64_t>(value >> 61);
+  result = (result & kPrime) + (result >> 61);
+  return (result >= kPrime) ? result - kPrime : result;
+}
+
+/**
+ * \brief Multiply two numbers modulo kPrime.
+ *
+ * \param a First factor (reduced).
+ * \param b Second factor (reduced).
+ *
+ * \return Product.
+ */
+constexpr std::uint64_t multiply(std::uint64_t a, std::uint64_t b) noexcept {
+  return reduce(static_cast<unsigned __int128>(a) * b);
+}
+
+/**
+ * \brief Add two numbers modulo kPrime.
+ *
+ * \param a First term (reduced).
+ * \param b Second term (reduced).
+ *
+ * \return Sum.
+ */
+constexpr std::uint64_t add(std::uint64_t a, std::uint64_t b) noexcept {
+  const auto sum = a + b;
+  return (sum >= kPrime) ? sum - kPrime : sum;
+}
+
+/**
+ * \brief Return kBase raised to the given power, modulo kPrime.
+ *
+ * \param exponent Exponent.
+ *
+ * \return Power of the base.
+ */
+constexpr std::uint64_t power(std::size_t exponent) noexcept {
+  std::uint64_t result{1};
+  for (auto base = kBase; exponent > 0; exponent >>= 1) {
+    if ((exponent & 1) != 0) {
+      result = multiply(result, base);
+    }
+    base = multiply(base, base);
+  }
+  return result;
+}
+
+/// Number of bytes hashed at once.
+constexpr std::size_t kWordSize{8};
+
+/// Terms of the bytes of a word, by position within the word and value.
+using WordTerms = std::array<std::array<std::uint64_t, 256>, kWordSize>;
+
+/**
+ * \brief Compute the terms of the bytes of a word.
+ *
+ * \return Terms: the byte at position i with value v adds
+ * (v + 1) * kBase^(kWordSize - 1 - i) to the hash of the word.
+ */
+constexpr WordTerms makeWordTerms() noexcept {
+  WordTerms terms{};
+  std::uint64_t weight{1};
+  for (auto position = kWordSize; position-- > 0;) {
+    for (std::size_t value = 0; value < terms[position].size(); value++) {
+      terms[position][value] = multiply(weight, value + 1);
+    }
+    weight = multiply(weight, kBase);
+  }
+  return terms;
+}
+
+/// Terms of the bytes of a word.
+constexpr WordTerms kWordTerms{makeWordTerms()};
+
+/// Factor shifting a hash by a word.
+constexpr std::uint64_t kWordShift{power(kWordSize)};
+
+/**
+ * \brief Extend a content hash with more data.
+ *
+ * \param hash Hash of the preceding data.
+ * \param data Data following it.
+ *
+ * \return Hash of both.
+ */
+std::uint64_t extend(std::uint64_t hash, std::string_view data) noexcept {
+  const auto* bytes = reinterpret_cast<const unsigned char*>(data.data());
+  auto size = data.size();
+
+  // A word takes a single multiplication: the terms of its bytes are looked
+  // up, and their sum (below kWordSize * kPrime) does not overflow.
+  for (; size >= kWordSize; bytes += kWordSize, size -= kWordSize) {
+    std::uint64_t word{0};
+    for (std::size_t position = 0; position < kWordSize; position++) {
+      word += kWordTerms[position][bytes[position]];
+    }
+    hash = reduce(static_cast<unsigned __int128>(hash) * kWordShift + word);
+  }
+
+  // Bytes are shifted by one, so that leading zero bytes count.
+  for (; size > 0; bytes++, size--) {
+    hash = add(multiply(hash, kBase), std::uint64_t{*bytes} + 1);
+  }
+  return hash;
+}
+
+/**
+ * \brief Scramble the bits of a number (finalizer of SplitMix64).
+ *
+ * \param value Number to scramble.
+ *
+ * \return Scrambled number.
+ */
+std::uint64_t mix(std::uint64_t value) noexcept {
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+  return value ^ (value >> 31);
+}
+
+/**
+ * \brief Return the digest of a file.
+ *
+ * \param path File path.
+ * \param hash Hash of the file contents.
+ * \param size File size.
+ *
+ * \return File digest.
+ */
+std::uint64_t digest(std::string_view path, ContentHash hash,
+                     std::size_t size) noexcept {
+  return mix(mix(hashContents(path) ^ kPathSalt) +
+             mix(hash + size * kSizeSalt));
+}
+
+/**
+ * \brief Return the digest of an inner node.
+ *
+ * \param left Digest of the left child.
+ * \param right Digest of the right child.
+ *
+ * \return Node digest.
+ */
+std::uint64_t combine(std::uint64_t left, std::uint64_t right) noexcept {
+  return mix(left ^ mix(right + kRightSalt));
+}
+
+}  // namespace
+
+ContentHash hashContents(std::string_view data) noexcept {
+  return extend(0, data);
+}
+
+ContentHash hashContents(const Object& object) noexcept {
+  std::uint64_t hash{0};
+  for (const auto& extent : object.getExtents()) {
+    hash = extend(hash, extent.view());
+  }
+  return hash;
+}
+
+ContentHash concatHashes(ContentHash head, ContentHash tail,
+                         std::size_t tail_size) noexcept {
+  return add(multiply(head, power(tail_size)), tail);
+}
+
+ContentHash replaceHash(ContentHash hash, ContentHash replaced,
+                        std::size_t replaced_size, ContentHash written,
+                        std::size_t written_size,
+                        std::size_t suffix_size) noexcept {
+  const auto shift = power(suffix_size);
+
+  // Take the replaced range out, leaving room for the written data, and put
+  // the written data in.
+  auto result = add(hash, kPrime - multiply(replaced, shift));
+  if (written_size > replaced_size) {
+    result = multiply(result, power(written_size - replaced_size));
+  }
+  return add(result, multiply(written, shift));
+}
+
+MerkleTree::MerkleTree(const MerkleTreeConfig& config) : leaves_{1} {
+  while (leaves_ < config.leaves) {
+    leaves_ *= 2;
+  }
+
+  files_.resize(leaves_);
+  nodes_.resize(2 * leaves_);
+  clear();
+}
+
+void MerkleTree::put(const std::string& path, ContentHash hash,
+                     std::size_t size) {
+  const auto leaf = getLeaf(path);
+  auto& files = files_[leaf];
+
+  auto change = digest(path, hash, size);
+  const auto [file, added] = files.try_emplace(path, Contents{hash, size});
+  if (!added) {
+    change -= digest(path, file->second.hash, file->second.size);
+    file->second = {hash, size};
+  }
+  propagate(leaf, change);
+}
+
+void MerkleTree::remove(const std::string& path) {
+  const auto leaf = getLeaf(path);
+  auto& files = files_[leaf];
+
+  const auto file = files.find(path);
+  if (file != files.end()) {
+    const auto change = digest(path, file->second.hash, file->second.size);
+    files.erase(file);
+    propagate(leaf, -change);
+  }
+}
+
+std::optional<ContentHash> MerkleTree::find(
+    const std::string& path) const noexcept {
+  const auto& files = files_[getLeaf(path)];
+  const auto file = files.find(path);
+  return (file != files.end()) ? std::optional{file->second.hash}
+                               : std::nullopt;
+}
+
+std::optional<MerkleNode> MerkleTree::getNode(std::size_t index) const {
+  if ((index == 0) || (index >= nodes_.size())) {
+    return {};
+  }
+
+  MerkleNode node{index, nodes_[index], {}, {}};
+  if (index < leaves_) {
+    node.children = {nodes_[2 * index], nodes_[2 * index + 1]};
+    return node;
+  }
+
+  for (const auto& [path, file] : files_[index - leaves_]) {
+    node.files.emplace_back(path, digest(path, file.hash, file.size));
+  }
+  return node;
+}
+
+void MerkleTree::clear() {
+  for (auto& files : files_) {
+    files.clear();
+  }
+
+  std::fill(nodes_.begin() + leaves_, nodes_.end(), 0);
+  for (auto index = leaves_ - 1; index > 0; index--) {
+    nodes_[index] = combine(nodes_[2 * index], nodes_[2 * index + 1]);
+  }
+}
+
+std::size_t MerkleTree::getLeaf(std::string_view path) const noexcept {
+  return mix(hashContents(path)) & (leaves_ - 1);
+}
+
+void MerkleTree::propagate(std::size_t leaf, std::uint64_t change) noexcept {
+  auto index = leaves_ + leaf;
+  nodes_[index] += change;
+  for (index /= 2; index > 0; index /= 2) {
+    nodes_[index] = combine(nodes_[2 * index], nodes_[2 * index + 1]);
+  }
+}
+
+}  // namespace fs
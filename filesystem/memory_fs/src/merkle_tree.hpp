@@ -0,0 +1,212 @@
+#ifndef FILESYSTEM_MEMORY_FS_SRC_MERKLE_TREE_HPP
+#define FILESYSTEM_MEMORY_FS_SRC_MERKLE_TREE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "filesystem/object/src/object.hpp"
+
+namespace fs {
+
+/**
+ * \brief Hash of file contents.
+ *
+ * Contents are hashed as a polynomial modulo the prime 2^61 - 1, so that the
+ * hash of modified contents follows from the hash of the previous contents
+ * and of the modified range only (see concatHashes() and replaceHash()).
+ */
+using ContentHash = std::uint64_t;
+
+/**
+ * \brief Hash data.
+ *
+ * \param data Data to hash.
+ *
+ * \return Hash of the data.
+ */
+[[nodiscard]] ContentHash hashContents(std::string_view data) noexcept;
+
+/**
+ * \brief Hash object contents.
+ *
+ * \param object Object to hash.
+ *
+ * \return Hash of the object contents.
+ */
+[[nodiscard]] ContentHash hashContents(const Object& object) noexcept;
+
+/**
+ * \brief Return the hash of concatenated contents.
+ *
+ * \param head Hash of the first part.
+ * \param tail Hash of the second part.
+ * \param tail_size Size of the second part (in bytes).
+ *
+ * \return Hash of both parts, one after the other.
+ */
+[[nodiscard]] ContentHash concatHashes(ContentHash head, ContentHash tail,
+                                       std::size_t tail_size) noexcept;
+
+/**
+ * \brief Return the hash of contents with a range overwritten.
+ *
+ * A write either lies within the contents or reaches past their end, so the
+ * replaced and the written ranges have the same size unless nothing follows
+ * them.
+ *
+ * \param hash Hash of the contents.
+ * \param replaced Hash of the overwritten range.
+ * \param replaced_size Size of the overwritten range.
+ * \param written Hash of the written data.
+ * \param written_size Size of the written data.
+ * \param suffix_size Number of bytes following the overwritten range.
+ *
+ * \return Hash of the modified contents.
+ */
+[[nodiscard]] ContentHash replaceHash(ContentHash hash, ContentHash replaced,
+                                      std::size_t replaced_size,
+                                      ContentHash written,
+                                      std::size_t written_size,
+                                      std::size_t suffix_size) noexcept;
+
+/**
+ * \brief Merkle tree configuration.
+ */
+struct MerkleTreeConfig {
+  /// Number of leaves, rounded up to a power of two (0 disables the tree).
+  std::size_t leaves{0};
+};
+
+/**
+ * \brief Node of a Merkle tree, as seen by someone walking it.
+ */
+struct MerkleNode {
+  std::size_t index;     ///< Node index (1 for the root).
+  std::uint64_t digest;  ///< Digest of all files under the node.
+
+  /// Digests of the children (indexes 2 * index and 2 * index + 1), empty
+  /// for leaves.
+  std::vector<std::uint64_t> children;
+
+  /// Paths and digests of the files of a leaf, sorted by path.
+  std::vector<std::pair<std::string, std::uint64_t>> files;
+};
+
+/**
+ * \brief Merkle tree over file digests, for finding which files differ
+ * between two filesystems.
+ *
+ * Files are spread over a fixed number of leaves by the hashes of their
+ * paths. The digest of a file covers its path, its size and the hash of its
+ * contents; the digest of a leaf is the sum of the digests of its files, so
+ * that a file is added or removed without rehashing its neighbours. Inner
+ * nodes hash the digests of their two children. Nodes are numbered as in a
+ * binary heap: the root is 1, the children of node i are 2i and 2i + 1.
+ *
+ * Updating a file costs O(log leaves). Two trees with the same number of
+ * leaves are compared top-down, descending only into nodes whose digests
+ * differ, which takes O(differences * log leaves) node reads.
+ *
+ * \note Not thread-safe, the owner serializes updates with lookups.
+ */
+class MerkleTree {
+ public:
+  /**
+   * \brief Create an empty tree.
+   *
+   * \param config Tree configuration (with at least one leaf).
+   */
+  explicit MerkleTree(const MerkleTreeConfig& config);
+
+  /**
+   * \brief Add or replace a file.
+   *
+   * \param path File path.
+   * \param hash Hash of the file contents.
+   * \param size File size.
+   */
+  void put(const std::string& path, ContentHash hash, std::size_t size);
+
+  /**
+   * \brief Remove a file (if present).
+   *
+   * \param path File path.
+   */
+  void remove(const std::string& path);
+
+  /**
+   * \brief Return the contents hash of a file.
+   *
+   * \param path File path.
+   *
+   * \return Hash of the file contents, or nothing if there is no such file.
+   */
+  [[nodiscard]] std::optional<ContentHash> find(
+      const std::string& path) const noexcept;
+
+  /**
+   * \brief Return a node of the tree.
+   *
+   * \param index Node index (1 for the root).
+   *
+   * \return Node, or nothing if there is no node with the given index.
+   */
+  [[nodiscard]] std::optional<MerkleNode> getNode(std::size_t index) const;
+
+  /**
+   * \brief Return the digest of all files.
+   *
+   * \return Digest of the root.
+   */
+  [[nodiscard]] std::uint64_t getRoot() const noexcept { return nodes_[1]; }
+
+  /**
+   * \brief Remove all files.
+   */
+  void clear();
+
+ private:
+  /**
+   * \brief Contents of a file of a leaf.
+   */
+  struct Contents {
+    ContentHash hash;  ///< Hash of the file contents.
+    std::size_t size;  ///< File size.
+  };
+
+  /**
+   * \brief Return the leaf holding a file.
+   *
+   * \param path File path.
+   *
+   * \return Leaf number (not the node index).
+   */
+  [[nodiscard]] std::size_t getLeaf(std::string_view path) const noexcept;
+
+  /**
+   * \brief Recompute the digests on the path from a leaf to the root.
+   *
+   * \param leaf Leaf number.
+   * \param change Change to the digest of the leaf (modulo 2^64).
+   */
+  void propagate(std::size_t leaf, std::uint64_t change) noexcept;
+
+  std::size_t leaves_;  ///< Number of leaves (a power of two).
+
+  /// Node digests, by node index (index 0 is not used).
+  std::vector<std::uint64_t> nodes_;
+
+  /// Files of every leaf, by path.
+  std::vector<std::map<std::string, Contents, std::less<>>> files_;
+};
+
+}  // namespace fs
+
+#endif  // FILESYSTEM_MEMORY_FS_SRC_MERKLE_TREE_HPP
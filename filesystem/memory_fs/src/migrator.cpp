@@ -0,0 +1,66 @@
+#include "migrator.hpp"
+
+#include "memory_fs.hpp"
+
+namespace fs {
+
+Migrator::Migrator(MemoryFs& filesystem, std::size_t batch_size,
+                   std::chrono::milliseconds interval) noexcept
+    : filesystem_{filesystem}, batch_size_{batch_size}, interval_{interval} {}
+
+void Migrator::start() {
+  std::scoped_lock lock(mutex_);
+  if (running_) {
+    return;
+  }
+
+  running_ = true;
+  worker_ = std::thread{[this] { run(); }};
+}
+
+void Migrator::stop() {
+  {
+    std::scoped_lock lock(mutex_);
+    running_ = false;
+  }
+
+  wake_up_.notify_all();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+void Migrator::notify() noexcept {
+  {
+    std::scoped_lock lock(mutex_);
+    pending_ = true;
+  }
+
+  wake_up_.notify_all();
+}
+
+MigratorStats Migrator::getStats() const noexcept {
+  return {objects_promoted_, objects_demoted_, bytes_demoted_};
+}
+
+void Migrator::run() {
+  std::unique_lock lock(mutex_);
+  while (running_) {
+    pending_ = false;
+    lock.unlock();
+
+    const auto result = filesystem_.migrate(batch_size_);
+    objects_promoted_ += result.objects_promoted;
+    objects_demoted_ += result.objects_demoted;
+    bytes_demoted_ += result.bytes_demoted;
+
+    // Keep going while there is work left, otherwise wait to be notified.
+    lock.lock();
+    if (!result.more_work) {
+      wake_up_.wait_for(lock, interval_,
+                        [this] { return !running_ || pending_; });
+    }
+  }
+}
+
+}  // namespace fs
@@ -0,0 +1,95 @@
+#ifndef FILESYSTEM_MEMORY_FS_SRC_MIGRATOR_HPP
+#define FILESYSTEM_MEMORY_FS_SRC_MIGRATOR_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+namespace fs {
+
+class MemoryFs;
+
+/**
+ * \brief Tier migration statistics.
+ */
+struct MigratorStats {
+  std::size_t objects_promoted;  ///< Objects moved from disk to memory.
+  std::size_t objects_demoted;   ///< Objects moved from memory to disk.
+  std::size_t bytes_demoted;     ///< Bytes moved from memory to disk.
+};
+
+/**
+ * \brief Background migrator of objects between memory and disk tier.
+ *
+ * Promotes objects read from disk back to memory and, whenever memory holds
+ * more than its budget, demotes cold objects to disk.
+ */
+class Migrator {
+ public:
+  /**
+   * \brief Create a migrator for the given filesystem.
+   *
+   * \param filesystem Filesystem to migrate objects of.
+   * \param batch_size Maximum number of objects moved in a single step.
+   * \param interval Delay between steps, when there is nothing to migrate.
+   */
+  Migrator(MemoryFs& filesystem, std::size_t batch_size,
+           std::chrono::milliseconds interval) noexcept;
+
+  ~Migrator() { stop(); }
+
+  // Migrator is non-copyable and non-moveable, it owns a running thread.
+  Migrator(const Migrator& other) = delete;
+  Migrator(Migrator&& other) = delete;
+  Migrator& operator=(const Migrator& other) = delete;
+  Migrator& operator=(Migrator&&) = delete;
+
+  /**
+   * \brief Start migrating in the background.
+   */
+  void start();
+
+  /**
+   * \brief Stop the background migration and wait for it to finish.
+   */
+  void stop();
+
+  /**
+   * \brief Wake up the migrator, there is work waiting.
+   */
+  void notify() noexcept;
+
+  /**
+   * \brief Return migrator statistics.
+   *
+   * \return Migrator statistics.
+   */
+  [[nodiscard]] MigratorStats getStats() const noexcept;
+
+ private:
+  /**
+   * \brief Migrator thread main loop.
+   */
+  void run();
+
+  MemoryFs& filesystem_;                ///< Filesystem to migrate.
+  std::size_t batch_size_;              ///< Objects moved per step.
+  std::chrono::milliseconds interval_;  ///< Delay between idle steps.
+
+  std::thread worker_;               ///< Migrator thread.
+  bool running_{false};              ///< Is migrator thread running?
+  bool pending_{false};              ///< Was migrator notified?
+  std::mutex mutex_;                 ///< Protects running/pending flags.
+  std::condition_variable wake_up_;  ///< Wakes up the migrator thread.
+
+  std::atomic<std::size_t> objects_promoted_{0};  ///< Promoted objects.
+  std::atomic<std::size_t> objects_demoted_{0};   ///< Demoted objects.
+  std::atomic<std::size_t> bytes_demoted_{0};     ///< Demoted bytes.
+};
+
+}  // namespace fs
+
+#endif  // FILESYSTEM_MEMORY_FS_SRC_MIGRATOR_HPP
@@ -0,0 +1,126 @@
+#include "mutation_log.hpp"
+
+#include <algorithm>
+
+namespace fs {
+
+namespace {
+
+/**
+ * \brief Return number of bytes held by a mutation.
+ *
+ * \param mutation Mutation to measure.
+ *
+ * \return Mutation size (in bytes).
+ */
+std::size_t sizeOf(const Mutation& mutation) noexcept {
+  return mutation.path.size() + mutation.data.size();
+}
+
+}  // namespace
+
+MutationLog::MutationLog(const MutationLogConfig& config) : config_{config} {}
+
+void MutationLog::push(Mutation mutation) {
+  std::map<WaitId, WaitHandler> waits;
+  {
+    std::scoped_lock lock(mutex_);
+    if (mutation.sequence != last_sequence_ + 1) {
+      entries_.clear();
+      bytes_ = 0;
+    }
+
+    last_sequence_ = mutation.sequence;
+    waits.swap(waits_);
+    if (config_.max_entries > 0) {
+      bytes_ += sizeOf(mutation);
+      entries_.push_back(std::move(mutation));
+
+      while ((entries_.size() > config_.max_entries) ||
+             (bytes_ > config_.max_bytes)) {
+        bytes_ -= sizeOf(entries_.front());
+        entries_.pop_front();
+      }
+    }
+  }
+
+  appended_.notify_all();
+  notify(waits);
+}
+
+void MutationLog::reset(std::uint64_t sequence) {
+  std::map<WaitId, WaitHandler> waits;
+  {
+    std::scoped_lock lock(mutex_);
+    entries_.clear();
+    bytes_ = 0;
+    last_sequence_ = sequence;
+    waits.swap(waits_);
+  }
+
+  appended_.notify_all();
+  notify(waits);
+}
+
+std::optional<std::vector<Mutation>> MutationLog::read(
+    std::uint64_t since, std::size_t max_count,
+    std::chrono::milliseconds timeout) const {
+  std::unique_lock lock(mutex_);
+  appended_.wait_for(lock, timeout,
+                     [this, since] { return last_sequence_ != since; });
+
+  // Mutations following 'since' must all still be in the log.
+  const auto first_sequence =
+      entries_.empty() ? last_sequence_ + 1 : entries_.front().sequence;
+  if ((since + 1 < first_sequence) || (since > last_sequence_)) {
+    return {};
+  }
+
+  std::vector<Mutation> mutations;
+  const auto first = entries_.cbegin() + (since + 1 - first_sequence);
+  const auto count = std::min<std::size_t>(entries_.cend() - first, max_count);
+  mutations.assign(first, first + count);
+
+  return mutations;
+}
+
+MutationLog::WaitId MutationLog::asyncWait(std::uint64_t since,
+                                           WaitHandler handler) {
+  WaitId id;
+  {
+    std::scoped_lock lock(mutex_);
+    id = next_wait_id_++;
+    if (last_sequence_ == since) {
+      waits_.emplace(id, std::move(handler));
+      return id;
+    }
+  }
+
+  handler();
+  return id;
+}
+
+void MutationLog::cancelWait(WaitId id) {
+  WaitHandler handler;
+  {
+    std::scoped_lock lock(mutex_);
+    if (const auto wait = waits_.find(id); wait != waits_.end()) {
+      // Released outside of the lock.
+      handler = std::move(wait->second);
+      waits_.erase(wait);
+    }
+  }
+}
+
+void MutationLog::notify(std::map<WaitId, WaitHandler>& waits) {
+  for (auto& [id, handler] : waits) {
+    handler();
+  }
+}
+
+std::uint64_t MutationLog::getLastSequence() const noexcept {
+  std::scoped_lock lock(mutex_);
+  return last_sequence_;
+}
+
+}  // namespace fs
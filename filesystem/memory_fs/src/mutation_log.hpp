@@ -0,0 +1,177 @@
+#ifndef FILESYSTEM_MEMORY_FS_SRC_MUTATION_LOG_HPP
+#define FILESYSTEM_MEMORY_FS_SRC_MUTATION_LOG_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "filesystem/object/src/checksum.hpp"
+#include "filesystem/object/src/object.hpp"
+
+namespace fs {
+
+/**
+ * \brief Filesystem mutation type.
+ */
+enum class MutationType : std::uint8_t {
+  Put,     ///< Object was stored (replacing any previous contents).
+  Write,   ///< Part of an object was overwritten (or appended to).
+  Remove,  ///< Object was removed.
+};
+
+/**
+ * \brief Single filesystem mutation.
+ *
+ * Mutations are idempotent when replayed in order: applying a mutation to a
+ * state which already reflects it yields the same result. Appends are thus
+ * recorded as writes at the previous end of the object.
+ */
+struct Mutation {
+  std::uint64_t sequence;  ///< Sequence number (starting at 1).
+  MutationType type;       ///< Mutation type.
+  std::string path;        ///< Path of the mutated object.
+  std::size_t offset;      ///< Position of the written data (Write only).
+  Object data;             ///< Stored or written data (Put and Write only).
+
+  /// Checksum of the stored object, if one was recorded (Put only).
+  std::optional<Checksum> checksum{};
+};
+
+/**
+ * \brief Mutation log configuration.
+ */
+struct MutationLogConfig {
+  /// Maximum number of mutations kept (0 disables the log).
+  std::size_t max_entries{0};
+
+  /// Maximum number of bytes kept. Logged data shares buffers with objects,
+  /// so it keeps memory of overwritten and removed objects alive.
+  std::size_t max_bytes{64 * 1024 * 1024};
+};
+
+/**
+ * \brief Bounded in-memory log of the most recent filesystem mutations.
+ */
+class MutationLog {
+ public:
+  /// Identifier of an asynchronous wait for mutations.
+  using WaitId = std::uint64_t;
+
+  /// Handler called once there are new mutations.
+  using WaitHandler = std::function<void()>;
+
+  /**
+   * \brief Create an empty mutation log.
+   *
+   * \param config Mutation log configuration.
+   */
+  explicit MutationLog(const MutationLogConfig& config = {});
+
+  /**
+   * \brief Append a mutation to the log, dropping the oldest ones if needed.
+   *
+   * \note The log only holds consecutive mutations. It is cleared if the
+   * sequence number does not follow the last one.
+   *
+   * \param mutation Mutation with the next sequence number.
+   */
+  void push(Mutation mutation);
+
+  /**
+   * \brief Drop all mutations and continue from the given sequence number.
+   *
+   * \param sequence Sequence number of the last mutation.
+   */
+  void reset(std::uint64_t sequence);
+
+  /**
+   * \brief Read mutations following the given sequence number.
+   *
+   * Waits until there is at least one mutation to return, or until timeout.
+   *
+   * \param since Sequence number of the last mutation already seen.
+   * \param max_count Maximum number of mutations to return.
+   * \param timeout Maximum time to wait for new mutations.
+   *
+   * \return Mutations in sequence number order (empty on timeout), or nothing
+   * if the log no longer holds all mutations following the given sequence
+   * number.
+   */
+  [[nodiscard]] std::optional<std::vector<Mutation>> read(
+      std::uint64_t since, std::size_t max_count,
+      std::chrono::milliseconds timeout) const;
+
+  /**
+   * \brief Wait for mutations following the given sequence number, without
+   * blocking.
+   *
+   * \note The handler is called once, either right away or by the thread
+   * appending the next mutation (or resetting the log), outside of the log
+   * lock. It must not block.
+   *
+   * \param since Sequence number of the last mutation already seen.
+   * \param handler Handler to call once there are new mutations.
+   *
+   * \return Wait identifier, to cancel the wait.
+   */
+  WaitId asyncWait(std::uint64_t since, WaitHandler handler);
+
+  /**
+   * \brief Cancel a wait for mutations, without calling its handler.
+   *
+   * \note Waits whose handler was already called are ignored.
+   *
+   * \param id Wait identifier.
+   */
+  void cancelWait(WaitId id);
+
+  /**
+   * \brief Return sequence number of the last mutation.
+   *
+   * \return Last sequence number (0 if there were no mutations).
+   */
+  [[nodiscard]] std::uint64_t getLastSequence() const noexcept;
+
+  /**
+   * \brief Check if the log keeps mutations.
+   *
+   * \return True if mutations are kept, false if only sequence numbers are.
+   */
+  [[nodiscard]] inline bool isEnabled() const noexcept {
+    return config_.max_entries > 0;
+  }
+
+ private:
+  MutationLogConfig config_;  ///< Mutation log configuration.
+
+  mutable std::mutex mutex_;                  ///< Protects the log.
+  mutable std::condition_variable appended_;  ///< Signals new mutations.
+
+  std::deque<Mutation> entries_;    ///< Logged mutations.
+  std::size_t bytes_{0};            ///< Bytes held by logged mutations.
+  std::uint64_t last_sequence_{0};  ///< Sequence number of last mutation.
+
+  std::map<WaitId, WaitHandler> waits_;  ///< Pending asynchronous waits.
+  WaitId next_wait_id_{0};               ///< Identifier of the next wait.
+
+  /**
+   * \brief Call handlers of asynchronous waits.
+   *
+   * \note Must be called without the log lock held.
+   *
+   * \param waits Waits taken out of the pending ones.
+   */
+  static void notify(std::map<WaitId, WaitHandler>& waits);
+};
+
+}  // namespace fs
+
+#endif  // FILESYSTEM_MEMORY_FS_SRC_MUTATION_LOG_HPP
@@ -0,0 +1,44 @@
+#include "object_cache.hpp"
+
+#include <algorithm>
+
+namespace fs {
+
+ObjectCache::ObjectCache(std::size_t slots)
+    : slots_(std::max<std::size_t>(slots, 1)) {}
+
+std::optional<std::pair<Object, FileInfo>> ObjectCache::find(
+    const std::string& path, std::size_t hash, std::uint64_t epoch) noexcept {
+  const auto& slot = slots_[hash % slots_.size()];
+  if ((slot.epoch != epoch) || slot.path.empty() || (slot.path != path)) {
+    increment(misses_);
+    return {};
+  }
+
+  increment(hits_);
+  return std::pair{slot.object, slot.info};
+}
+
+void ObjectCache::insert(const std::string& path, std::size_t hash,
+                         std::uint64_t epoch, const Object& object,
+                         const FileInfo& info) {
+  auto& slot = slots_[hash % slots_.size()];
+  slot.path = path;
+  slot.epoch = epoch;
+  slot.object = Object{object.str()};
+  slot.info = info;
+}
+
+ObjectCacheStats ObjectCache::getStats() const noexcept {
+  return {hits_.load(std::memory_order_relaxed),
+          misses_.load(std::memory_order_relaxed)};
+}
+
+void ObjectCache::increment(std::atomic<std::size_t>& counter) noexcept {
+  // A plain store is enough with a single writer, and cheaper than an atomic
+  // read-modify-write.
+  counter.store(counter.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+}
+
+}  // namespace fs
@@ -0,0 +1,126 @@
+#ifndef FILESYSTEM_MEMORY_FS_SRC_OBJECT_CACHE_HPP
+#define FILESYSTEM_MEMORY_FS_SRC_OBJECT_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "filesystem/ifilesystem.hpp"
+
+namespace fs {
+
+/**
+ * \brief Per-thread object cache configuration.
+ */
+struct ObjectCacheConfig {
+  /// Number of objects cached by each thread (0 disables caching).
+  std::size_t slots{0};
+
+  /// Objects larger than this (in bytes) are never cached.
+  std::size_t max_object_size{16 * 1024};
+};
+
+/**
+ * \brief Lookup statistics of a single thread's object cache.
+ */
+struct ObjectCacheStats {
+  std::size_t hits;    ///< Lookups served by the cache.
+  std::size_t misses;  ///< Lookups which went to the shared index.
+};
+
+/**
+ * \brief Cache of hot objects private to a single thread.
+ *
+ * The cache is direct-mapped: the hash of a path picks its only slot, and a
+ * newly cached object evicts whichever one was there. Cached objects are
+ * private copies, so that serving them writes no memory shared with other
+ * threads, not even reference counts.
+ *
+ * Each copy is tagged with the epoch its path had when it was read. Epochs
+ * are kept by the filesystem and bumped on every mutation, copies tagged
+ * with an older epoch than the current one are never served.
+ *
+ * \note Only the owning thread may look objects up and insert them. Statistics
+ * may be read by any thread.
+ */
+class ObjectCache {
+ public:
+  /**
+   * \brief Create an empty cache.
+   *
+   * \param slots Number of cached objects (at least 1).
+   */
+  explicit ObjectCache(std::size_t slots);
+
+  // ObjectCache is non-copyable and non-moveable, it is owned by the
+  // filesystem and referred to by its thread.
+  ObjectCache(const ObjectCache& other) = delete;
+  ObjectCache(ObjectCache&& other) = delete;
+  ObjectCache& operator=(const ObjectCache& other) = delete;
+  ObjectCache& operator=(ObjectCache&&) = delete;
+
+  /**
+   * \brief Look up a cached object.
+   *
+   * \param path Object path.
+   * \param hash Hash of the path.
+   * \param epoch Current epoch of the path.
+   *
+   * \return Object and its metadata, if cached in the given epoch.
+   */
+  [[nodiscard]] std::optional<std::pair<Object, FileInfo>> find(
+      const std::string& path, std::size_t hash, std::uint64_t epoch) noexcept;
+
+  /**
+   * \brief Cache a private copy of an object, evicting the object sharing
+   * its slot (if any).
+   *
+   * \param path Object path.
+   * \param hash Hash of the path.
+   * \param epoch Epoch of the path when the object was read.
+   * \param object Object to cache.
+   * \param info Object metadata.
+   */
+  void insert(const std::string& path, std::size_t hash, std::uint64_t epoch,
+              const Object& object, const FileInfo& info);
+
+  /**
+   * \brief Return lookup statistics.
+   *
+   * \return Number of hits and misses so far.
+   */
+  [[nodiscard]] ObjectCacheStats getStats() const noexcept;
+
+ private:
+  /**
+   * \brief Cached object.
+   */
+  struct Slot {
+    std::string path;        ///< Object path (empty if the slot is free).
+    std::uint64_t epoch{0};  ///< Epoch of the path when it was cached.
+    Object object;           ///< Private copy of the object.
+    FileInfo info{};         ///< Object metadata.
+  };
+
+  /**
+   * \brief Add one to a counter only written by the owning thread.
+   *
+   * \param counter Counter to increment.
+   */
+  static void increment(std::atomic<std::size_t>& counter) noexcept;
+
+  std::vector<Slot> slots_;  ///< Cached objects, indexed by path hashes.
+
+  /// Number of hits. Counters are on a cache line of their own, so that
+  /// caches of different threads never share one.
+  alignas(64) std::atomic<std::size_t> hits_{0};
+  std::atomic<std::size_t> misses_{0};  ///< Number of misses.
+};
+
+}  // namespace fs
+
+#endif  // FILESYSTEM_MEMORY_FS_SRC_OBJECT_CACHE_HPP
@@ -0,0 +1,113 @@
+#include "reclaimer.hpp"
+
+#include <chrono>
+#include <vector>
+
+namespace fs {
+
+Reclaimer::Reclaimer(const ReclaimerConfig& config) noexcept
+    : config_{config} {}
+
+void Reclaimer::start() {
+  std::scoped_lock lock(mutex_);
+  if (running_) {
+    return;
+  }
+
+  running_ = true;
+  worker_ = std::thread{[this] { run(); }};
+}
+
+void Reclaimer::stop() {
+  {
+    std::scoped_lock lock(mutex_);
+    running_ = false;
+  }
+
+  wake_up_.notify_all();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+void Reclaimer::retire(Object object) {
+  if (object.empty()) {
+    return;
+  }
+
+  {
+    std::scoped_lock lock(mutex_);
+    if (!running_ ||
+        (pending_bytes_ + object.size() > config_.max_pending_bytes)) {
+      // The object is freed here, once the lock is released.
+      return;
+    }
+
+    pending_bytes_ += object.size();
+    pending_.push_back(std::move(object));
+  }
+
+  wake_up_.notify_one();
+}
+
+void Reclaimer::drain() {
+  std::unique_lock lock(mutex_);
+  drained_.wait(lock, [this] {
+    return (pending_.empty() && (in_progress_ == 0)) || !running_;
+  });
+}
+
+ReclaimerStats Reclaimer::getStats() const noexcept {
+  std::scoped_lock lock(mutex_);
+  return {objects_freed_, bytes_freed_, pending_bytes_};
+}
+
+void Reclaimer::run() {
+  using Clock = std::chrono::steady_clock;
+  using Seconds = std::chrono::duration<double>;
+
+  std::unique_lock lock(mutex_);
+  while (true) {
+    wake_up_.wait(lock, [this] { return !pending_.empty() || !running_; });
+    if (pending_.empty()) {
+      break;
+    }
+
+    // Objects are freed one by one, so that the budget is respected however
+    // many of them were queued at once.
+    auto object = std::move(pending_.front());
+    pending_.pop_front();
+    pending_bytes_ -= object.size();
+    in_progress_++;
+    const auto stopping = !running_;
+    lock.unlock();
+
+    const auto size = object.size();
+    const auto start = Clock::now();
+    object = Object{};
+    objects_freed_++;
+    bytes_freed_ += size;
+
+    // Once stopping, the remaining objects are freed without pauses.
+    Seconds pause{0};
+    if ((config_.bandwidth_budget > 0) && !stopping) {
+      pause = Seconds{static_cast<double>(size) /
+                      static_cast<double>(config_.bandwidth_budget)} -
+              (Clock::now() - start);
+    }
+
+    lock.lock();
+    in_progress_--;
+    if (pending_.empty()) {
+      drained_.notify_all();
+    }
+
+    if (pause.count() > 0) {
+      wake_up_.wait_for(lock, pause, [this] { return !running_; });
+    }
+  }
+
+  drained_.notify_all();
+}
+
+}  // namespace fs
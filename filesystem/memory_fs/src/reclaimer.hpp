@@ -0,0 +1,126 @@
+#ifndef FILESYSTEM_MEMORY_FS_SRC_RECLAIMER_HPP
+#define FILESYSTEM_MEMORY_FS_SRC_RECLAIMER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "filesystem/object/src/object.hpp"
+
+namespace fs {
+
+/**
+ * \brief Background reclaimer configuration.
+ */
+struct ReclaimerConfig {
+  /// Free removed and overwritten objects in the background.
+  bool enabled{false};
+
+  /// Maximum number of bytes freed per second (0 for no limit).
+  std::size_t bandwidth_budget{1024 * 1024 * 1024};
+
+  /// Maximum number of bytes waiting to be freed. Beyond it, objects are
+  /// freed by the threads releasing them.
+  std::size_t max_pending_bytes{4ULL * 1024 * 1024 * 1024};
+};
+
+/**
+ * \brief Background reclaimer statistics.
+ */
+struct ReclaimerStats {
+  std::size_t objects_freed;  ///< Number of objects freed in the background.
+  std::size_t bytes_freed;    ///< Number of bytes freed in the background.
+  std::size_t pending_bytes;  ///< Number of bytes waiting to be freed.
+};
+
+/**
+ * \brief Background reclaimer of object memory.
+ *
+ * Freeing an object may unmap its arena region, which takes time in
+ * proportion to the region size. Objects which are no longer part of the
+ * filesystem are handed over to the reclaimer instead, which drops the last
+ * references to them on its own thread. Handing an object over takes constant
+ * time, whatever its size.
+ *
+ * The reclaimer frees at most ReclaimerConfig::bandwidth_budget bytes per
+ * second, so that unmapping large objects does not compete with foreground
+ * requests. Once ReclaimerConfig::max_pending_bytes are waiting, the threads
+ * releasing objects free them themselves, so that memory use stays bounded.
+ */
+class Reclaimer {
+ public:
+  /**
+   * \brief Create a reclaimer.
+   *
+   * \param config Reclaimer configuration.
+   */
+  explicit Reclaimer(const ReclaimerConfig& config) noexcept;
+
+  ~Reclaimer() { stop(); }
+
+  // Reclaimer is non-copyable and non-moveable, it owns a running thread.
+  Reclaimer(const Reclaimer& other) = delete;
+  Reclaimer(Reclaimer&& other) = delete;
+  Reclaimer& operator=(const Reclaimer& other) = delete;
+  Reclaimer& operator=(Reclaimer&&) = delete;
+
+  /**
+   * \brief Start freeing objects in the background.
+   */
+  void start();
+
+  /**
+   * \brief Free all objects waiting, then stop the background thread.
+   */
+  void stop();
+
+  /**
+   * \brief Hand over an object to be freed in the background.
+   *
+   * \note The object is freed by the calling thread if too many bytes are
+   * already waiting, or if the reclaimer is not running.
+   *
+   * \param object Object no longer referenced by the filesystem.
+   */
+  void retire(Object object);
+
+  /**
+   * \brief Wait until all objects handed over so far are freed.
+   */
+  void drain();
+
+  /**
+   * \brief Return reclaimer statistics.
+   *
+   * \return Reclaimer statistics.
+   */
+  [[nodiscard]] ReclaimerStats getStats() const noexcept;
+
+ private:
+  /**
+   * \brief Reclaimer thread main loop.
+   */
+  void run();
+
+  ReclaimerConfig config_;  ///< Reclaimer configuration.
+
+  std::thread worker_;               ///< Reclaimer thread.
+  bool running_{false};              ///< Is reclaimer thread running?
+  mutable std::mutex mutex_;         ///< Protects the queue and the flags.
+  std::condition_variable wake_up_;  ///< Wakes up the reclaimer thread.
+  std::condition_variable drained_;  ///< Signals that the queue was freed.
+
+  std::deque<Object> pending_;     ///< Objects waiting to be freed.
+  std::size_t pending_bytes_{0};   ///< Total size of the waiting objects.
+  std::size_t in_progress_{0};     ///< Objects taken off the queue, not freed.
+
+  std::atomic<std::size_t> objects_freed_{0};  ///< Freed objects.
+  std::atomic<std::size_t> bytes_freed_{0};    ///< Freed bytes.
+};
+
+}  // namespace fs
+
+#endif  // FILESYSTEM_MEMORY_FS_SRC_RECLAIMER_HPP
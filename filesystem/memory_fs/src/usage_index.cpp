@@ -0,0 +1,26 @@
+#include "usage_index.hpp"
+
+namespace fs {
+
+Usage UsageIndex::get(const std::string& directory) const noexcept {
+  const auto usage = directories_.find(directory);
+  return (usage != directories_.end()) ? usage->second : Usage{};
+}
+
+void UsageIndex::update(std::string_view path, std::int64_t objects,
+                        std::int64_t bytes) {
+  for (auto end = path.find('/'); end != std::string_view::npos;
+       end = path.find('/', end + 1)) {
+    key_.assign(path.data(), end + 1);
+    auto& usage = directories_[key_];
+
+    // Sizes wrap around, so that negative changes are applied as they are.
+    usage.objects += static_cast<std::size_t>(objects);
+    usage.bytes += static_cast<std::size_t>(bytes);
+    if (usage.objects == 0) {
+      directories_.erase(key_);
+    }
+  }
+}
+
+}  // namespace fs
@@ -0,0 +1,105 @@
+#ifndef FILESYSTEM_MEMORY_FS_SRC_USAGE_INDEX_HPP
+#define FILESYSTEM_MEMORY_FS_SRC_USAGE_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "filesystem/ifilesystem.hpp"
+
+namespace fs {
+
+/**
+ * \brief Number and total size of files under every directory.
+ *
+ * Directories are the prefixes of file paths ending with '/': "/team/x/a" is
+ * under "/", "/team/" and "/team/x/". Every change to a file updates all of
+ * its directories, so that it costs O(depth) and the usage of a directory is
+ * a single lookup. Directories are dropped once they hold no files.
+ *
+ * \note Not thread-safe, the owner serializes updates with lookups.
+ */
+class UsageIndex {
+ public:
+  /**
+   * \brief Account for a new file.
+   *
+   * \param path File path.
+   * \param size File size.
+   */
+  void add(std::string_view path, std::size_t size) {
+    update(path, 1, static_cast<std::int64_t>(size));
+  }
+
+  /**
+   * \brief Account for a removed file.
+   *
+   * \param path File path.
+   * \param size File size.
+   */
+  void remove(std::string_view path, std::size_t size) {
+    update(path, -1, -static_cast<std::int64_t>(size));
+  }
+
+  /**
+   * \brief Account for a file changing its size.
+   *
+   * \param path File path.
+   * \param previous Previous file size.
+   * \param size New file size.
+   */
+  void resize(std::string_view path, std::size_t previous, std::size_t size) {
+    if (size != previous) {
+      update(path, 0,
+             static_cast<std::int64_t>(size) -
+                 static_cast<std::int64_t>(previous));
+    }
+  }
+
+  /**
+   * \brief Return usage of a directory.
+   *
+   * \param directory Directory path ending with '/'.
+   *
+   * \return Number and total size of the files under the directory.
+   */
+  [[nodiscard]] Usage get(const std::string& directory) const noexcept;
+
+  /**
+   * \brief Forget all files.
+   */
+  void clear() noexcept { directories_.clear(); }
+
+  /**
+   * \brief Return number of directories holding files.
+   *
+   * \return Number of tracked directories.
+   */
+  [[nodiscard]] std::size_t size() const noexcept {
+    return directories_.size();
+  }
+
+ private:
+  /**
+   * \brief Update usage of all directories of a file.
+   *
+   * \param path File path.
+   * \param objects Change in the number of files.
+   * \param bytes Change in the total size of files.
+   */
+  void update(std::string_view path, std::int64_t objects,
+              std::int64_t bytes);
+
+  /// Usage by directory path.
+  std::unordered_map<std::string, Usage> directories_;
+
+  /// Directory path being looked up, kept so that updates of existing
+  /// directories do not allocate.
+  std::string key_;
+};
+
+}  // namespace fs
+
+#endif  // FILESYSTEM_MEMORY_FS_SRC_USAGE_INDEX_HPP
@@ -0,0 +1,104 @@
+#include "filesystem/memory_fs/src/arena.hpp"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace fs;
+
+TEST(ArenaTest, Empty) {
+  Arena arena;
+  const auto stats = arena.getStats();
+  EXPECT_EQ(0, stats.regions);
+  EXPECT_EQ(0, stats.mapped_bytes);
+  EXPECT_EQ(0, stats.live_bytes);
+  EXPECT_TRUE(arena.allocate(nullptr, 0).empty());
+}
+
+TEST(ArenaTest, Allocate) {
+  Arena arena{{4096, 1024}};
+  const File file{"I like trains"};
+  const auto object = arena.allocate(file.data(), file.size());
+  EXPECT_EQ(file, object);
+  const auto* block = object.getExtents().front().buffer.get();
+  EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(block) % 16);
+
+  const auto stats = arena.getStats();
+  EXPECT_EQ(1, stats.regions);
+  EXPECT_EQ(4096, stats.mapped_bytes);
+  EXPECT_EQ(file.size(), stats.live_bytes);
+}
+
+TEST(ArenaTest, SmallObjectsShareRegion) {
+  Arena arena{{4096, 1024}};
+  const File file(100, 'a');
+  std::vector<Object> objects;
+  for (int i = 0; i < 10; i++) {
+    objects.push_back(arena.allocate(file.data(), file.size()));
+  }
+
+  EXPECT_EQ(1, arena.getStats().regions);
+  EXPECT_EQ(1000, arena.getStats().live_bytes);
+  for (const auto& object : objects) {
+    EXPECT_EQ(file, object);
+  }
+}
+
+TEST(ArenaTest, LargeObjectGetsOwnRegion) {
+  Arena arena{{4096, 1024}};
+  const File file(2000, 'b');
+  {
+    const auto object = arena.allocate(file.data(), file.size());
+    EXPECT_EQ(file, object);
+    EXPECT_EQ(1, arena.getStats().regions);
+    EXPECT_EQ(2000, arena.getStats().mapped_bytes);
+  }
+
+  EXPECT_EQ(0, arena.getStats().regions);
+}
+
+TEST(ArenaTest, EmptyRegionReturnedToOs) {
+  Arena arena{{4096, 1024}};
+  const File file(1000, 'c');
+  std::vector<Object> objects;
+  for (int i = 0; i < 8; i++) {
+    objects.push_back(arena.allocate(file.data(), file.size()));
+  }
+  EXPECT_EQ(2, arena.getStats().regions);
+
+  // Free all blocks of the first (full) region.
+  objects.erase(objects.begin(), objects.begin() + 4);
+  EXPECT_EQ(1, arena.getStats().regions);
+  EXPECT_EQ(4000, arena.getStats().live_bytes);
+}
+
+TEST(ArenaTest, SelectForEvacuation) {
+  Arena arena{{4096, 1024}};
+  const File file(1000, 'd');
+  std::vector<Object> objects;
+  for (int i = 0; i < 8; i++) {
+    objects.push_back(arena.allocate(file.data(), file.size()));
+  }
+
+  // Leave a single object in the first region.
+  objects.erase(objects.begin() + 1, objects.begin() + 4);
+  EXPECT_EQ(1, arena.selectForEvacuation(0.5));
+  EXPECT_TRUE(arena.isEvacuating(objects[0]));
+  EXPECT_FALSE(arena.isEvacuating(objects[1]));
+  EXPECT_FALSE(arena.isEvacuating(Object{file}));
+
+  // Region currently used for allocations is never evacuated.
+  EXPECT_EQ(0, arena.selectForEvacuation(0.1));
+  EXPECT_FALSE(arena.isEvacuating(objects[0]));
+}
+
+TEST(ArenaTest, BlocksOutliveArena) {
+  Object object;
+  {
+    Arena arena;
+    const File file{"survivor"};
+    object = arena.allocate(file.data(), file.size());
+  }
+
+  EXPECT_EQ(File{"survivor"}, object);
+}
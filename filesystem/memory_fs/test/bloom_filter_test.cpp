@@ -0,0 +1,41 @@
+#include "filesystem/memory_fs/src/bloom_filter.hpp"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+using namespace fs;
+
+TEST(BloomFilter, Empty) {
+  BloomFilter filter;
+  EXPECT_EQ(0, filter.size());
+  EXPECT_FALSE(filter.mayContain(""));
+  EXPECT_FALSE(filter.mayContain("/some/path"));
+}
+
+TEST(BloomFilter, NoFalseNegatives) {
+  BloomFilter filter{1000};
+  for (int i = 0; i < 1000; i++) {
+    filter.add("/data/" + std::to_string(i));
+  }
+
+  EXPECT_EQ(1000, filter.size());
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_TRUE(filter.mayContain("/data/" + std::to_string(i)));
+  }
+}
+
+TEST(BloomFilter, FalsePositiveRate) {
+  BloomFilter filter{10000};
+  for (int i = 0; i < 10000; i++) {
+    filter.add("/data/" + std::to_string(i));
+  }
+
+  // 10 bits per key give ~1% false positives.
+  int false_positives{0};
+  for (int i = 0; i < 10000; i++) {
+    false_positives += filter.mayContain("/other/" + std::to_string(i));
+  }
+
+  EXPECT_LT(false_positives, 300);
+}
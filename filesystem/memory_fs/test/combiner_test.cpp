@@ -0,0 +1,61 @@
+#include "filesystem/memory_fs/src/combiner.hpp"
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace fs;
+
+TEST(CombinerTest, SingleThread) {
+  std::shared_mutex mutex;
+  Combiner combiner{mutex};
+
+  int value{0};
+  auto increment = [&value]() { value++; };
+  combiner.execute(increment);
+  combiner.execute(increment);
+
+  EXPECT_EQ(2, value);
+  EXPECT_EQ(2, combiner.getPasses());
+  EXPECT_EQ(2, combiner.getOperations());
+}
+
+TEST(CombinerTest, AppliedUnderLock) {
+  std::shared_mutex mutex;
+  Combiner combiner{mutex};
+
+  // Operations see the lock taken, by whichever thread applies them.
+  bool locked{false};
+  auto check = [&mutex, &locked]() { locked = !mutex.try_lock_shared(); };
+  combiner.execute(check);
+  EXPECT_TRUE(locked);
+}
+
+TEST(CombinerTest, ManyThreads) {
+  constexpr int kThreadCount{96};
+  constexpr int kOperationCount{1000};
+
+  std::shared_mutex mutex;
+  Combiner combiner{mutex};
+
+  // Plain (non-atomic) counter, only consistent if operations are serialized.
+  long value{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreadCount; i++) {
+    threads.emplace_back([&combiner, &value]() {
+      for (int j = 0; j < kOperationCount; j++) {
+        auto increment = [&value]() { value++; };
+        combiner.execute(increment);
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(kThreadCount * kOperationCount, value);
+  EXPECT_EQ(kThreadCount * kOperationCount, combiner.getOperations());
+  EXPECT_LE(combiner.getPasses(), combiner.getOperations());
+}
@@ -0,0 +1,161 @@
+#include "filesystem/memory_fs/src/disk_tier.hpp"
+
+#include <algorithm>
+
+#include "gtest/gtest.h"
+
+using namespace fs;
+
+TEST(DiskTier, WriteRead) {
+  DiskTier disk{{}};
+  const Object object{File{"cold data"}};
+
+  const auto location = disk.write(object);
+  ASSERT_TRUE(location);
+  EXPECT_EQ(object.size(), location->size);
+  disk.insert("/cold", *location);
+
+  EXPECT_TRUE(disk.mayContain("/cold"));
+  EXPECT_EQ(location, disk.find("/cold"));
+
+  const auto [status, read_location, read_object] = disk.read("/cold");
+  ASSERT_EQ(Status::Success, status);
+  EXPECT_EQ(*location, read_location);
+  EXPECT_EQ(File{"cold data"}, read_object);
+}
+
+TEST(DiskTier, WriteExtents) {
+  DiskTier disk{{}};
+  Object object{File{"head"}};
+  object.append(Object{File{"-"}});
+  object.append(Object{File{"tail"}});
+
+  const auto location = disk.write(object);
+  ASSERT_TRUE(location);
+  disk.insert("/object", *location);
+  EXPECT_EQ(File{"head-tail"}, std::get<Object>(disk.read("/object")));
+}
+
+TEST(DiskTier, EmptyObject) {
+  DiskTier disk{{}};
+  const auto location = disk.write(Object{});
+  ASSERT_TRUE(location);
+  disk.insert("/empty", *location);
+
+  const auto [status, read_location, read_object] = disk.read("/empty");
+  ASSERT_EQ(Status::Success, status);
+  EXPECT_TRUE(read_object.empty());
+}
+
+TEST(DiskTier, NotFound) {
+  DiskTier disk{{}};
+  EXPECT_FALSE(disk.mayContain("/missing"));
+  EXPECT_FALSE(disk.find("/missing"));
+  EXPECT_EQ(Status::FileNotFound, std::get<Status>(disk.read("/missing")));
+  EXPECT_FALSE(disk.erase("/missing"));
+}
+
+TEST(DiskTier, Erase) {
+  DiskTier disk{{}};
+  const auto location = disk.write(Object{File{"data"}});
+  ASSERT_TRUE(location);
+  disk.insert("/data", *location);
+  EXPECT_EQ(FileList{"/data"}, disk.list());
+
+  EXPECT_TRUE(disk.erase("/data"));
+  EXPECT_FALSE(disk.find("/data"));
+  EXPECT_TRUE(disk.list().empty());
+  EXPECT_EQ(0, disk.getStats().live_bytes);
+}
+
+TEST(DiskTier, DeletesDeadSegments) {
+  DiskTierConfig config;
+  config.segment_size = 1024;
+  DiskTier disk{config};
+
+  for (int i = 0; i < 8; i++) {
+    const auto location = disk.write(Object{File(1000, 'x')});
+    ASSERT_TRUE(location);
+    disk.insert(std::to_string(i), *location);
+  }
+
+  auto stats = disk.getStats();
+  EXPECT_EQ(8, stats.objects);
+  EXPECT_EQ(8, stats.segments);
+  EXPECT_EQ(8000, stats.live_bytes);
+
+  // The segment currently appended to is kept.
+  for (int i = 0; i < 8; i++) {
+    ASSERT_TRUE(disk.erase(std::to_string(i)));
+  }
+
+  stats = disk.getStats();
+  EXPECT_EQ(0, stats.objects);
+  EXPECT_EQ(1, stats.segments);
+  EXPECT_EQ(0, stats.live_bytes);
+}
+
+TEST(DiskTier, Link) {
+  DiskTierConfig config;
+  config.segment_size = 1024;
+  DiskTier disk{config};
+
+  const auto location = disk.write(Object{File(1000, 'x')});
+  ASSERT_TRUE(location);
+  disk.insert("/a", *location);
+  disk.link("/b", *location);
+  EXPECT_EQ(2000, disk.getStats().live_bytes);
+
+  // Start another segment, so that the shared one may be deleted.
+  const auto other = disk.write(Object{File(1000, 'y')});
+  ASSERT_TRUE(other);
+  disk.insert("/c", *other);
+  EXPECT_EQ(2, disk.getStats().segments);
+
+  // The segment is kept until both objects are gone.
+  ASSERT_TRUE(disk.erase("/a"));
+  EXPECT_EQ(2, disk.getStats().segments);
+  EXPECT_EQ(File(1000, 'x'), std::get<Object>(disk.read("/b")));
+  ASSERT_TRUE(disk.erase("/b"));
+  EXPECT_EQ(1, disk.getStats().segments);
+  EXPECT_EQ(1000, disk.getStats().live_bytes);
+}
+
+TEST(DiskTier, Release) {
+  DiskTier disk{{}};
+  const auto location = disk.write(Object{File{"data"}});
+  ASSERT_TRUE(location);
+  EXPECT_EQ(4, disk.getStats().live_bytes);
+  disk.release(*location);
+  EXPECT_EQ(0, disk.getStats().live_bytes);
+  EXPECT_FALSE(disk.find("/data"));
+}
+
+TEST(DiskTier, FilterRebuild) {
+  DiskTier disk{{}};
+
+  // Grow the index past the initial filter capacity, then shrink it.
+  for (int i = 0; i < 5000; i++) {
+    const auto location = disk.write(Object{File{"x"}});
+    ASSERT_TRUE(location);
+    disk.insert(std::to_string(i), *location);
+  }
+
+  for (int i = 0; i < 5000; i++) {
+    ASSERT_TRUE(disk.mayContain(std::to_string(i)));
+  }
+
+  for (int i = 0; i < 4000; i++) {
+    ASSERT_TRUE(disk.erase(std::to_string(i)));
+  }
+
+  for (int i = 4000; i < 5000; i++) {
+    ASSERT_TRUE(disk.mayContain(std::to_string(i)));
+  }
+
+  int false_positives{0};
+  for (int i = 0; i < 4000; i++) {
+    false_positives += disk.mayContain(std::to_string(i));
+  }
+  EXPECT_LT(false_positives, 400);
+}
@@ -0,0 +1,171 @@
+#include "filesystem/memory_fs/src/incremental_map.hpp"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace fs;
+
+using Map = IncrementalMap<std::string, int>;
+
+/**
+ * \brief Fill a map until it starts growing incrementally.
+ *
+ * \param map Map to fill.
+ *
+ * \return Number of entries added.
+ */
+int fillUntilMigrating(Map& map) {
+  int count{0};
+  while (!map.isMigrating()) {
+    EXPECT_TRUE(map.emplace(std::to_string(count), count).second);
+    count++;
+  }
+
+  return count;
+}
+
+TEST(IncrementalMapTest, Basic) {
+  Map map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(nullptr, map.find("a"));
+
+  EXPECT_TRUE(map.emplace("a", 1).second);
+  EXPECT_FALSE(map.emplace("a", 2).second);
+  map["b"] = 3;
+  ASSERT_NE(nullptr, map.find("a"));
+  EXPECT_EQ(1, map.find("a")->second);
+  EXPECT_EQ(3, map["b"]);
+  EXPECT_EQ(2, map.size());
+
+  auto node = map.extract("a");
+  ASSERT_FALSE(node.empty());
+  node.key() = "c";
+  map.insert(std::move(node));
+  EXPECT_EQ(nullptr, map.find("a"));
+  EXPECT_EQ(1, map.find("c")->second);
+
+  EXPECT_EQ(1, map.erase("b"));
+  EXPECT_EQ(0, map.erase("b"));
+  EXPECT_EQ(1, map.size());
+}
+
+TEST(IncrementalMapTest, SmallMapsGrowAtOnce) {
+  Map map;
+  for (int i = 0; i < 1000; i++) {
+    map.emplace(std::to_string(i), i);
+    ASSERT_FALSE(map.isMigrating());
+  }
+}
+
+TEST(IncrementalMapTest, GrowsIncrementally) {
+  Map map;
+  const auto count = fillUntilMigrating(map);
+  EXPECT_GE(count, Map::kMinIncrementalSize);
+
+  // Entries of both tables are found while they are being moved.
+  int added{count};
+  while (map.isMigrating()) {
+    map.emplace(std::to_string(added), added);
+    added++;
+
+    ASSERT_EQ(added, map.size());
+    for (int i = 0; i < added; i += 97) {
+      const auto* entry = map.find(std::to_string(i));
+      ASSERT_NE(nullptr, entry);
+      EXPECT_EQ(i, entry->second);
+    }
+  }
+
+  // Each insert moves a batch of entries.
+  EXPECT_LE(added - count, count / Map::kMigrationBatch + 1);
+
+  int visited{0};
+  map.forEach([&visited](const auto&) { visited++; });
+  EXPECT_EQ(added, visited);
+}
+
+TEST(IncrementalMapTest, EntriesStayInPlace) {
+  Map map;
+  map.emplace("a", 1);
+  const auto* entry = map.find("a");
+  fillUntilMigrating(map);
+  while (map.isMigrating()) {
+    map.migrate(1);
+    ASSERT_EQ(entry, map.find("a"));
+  }
+}
+
+TEST(IncrementalMapTest, RemoveWhileMigrating) {
+  Map map;
+  const auto count = fillUntilMigrating(map);
+  for (int i = 0; i < count; i++) {
+    ASSERT_EQ(1, map.erase(std::to_string(i)));
+  }
+
+  EXPECT_TRUE(map.empty());
+  EXPECT_FALSE(map.isMigrating());
+}
+
+TEST(IncrementalMapTest, Buckets) {
+  Map map;
+  const auto count = fillUntilMigrating(map);
+  map.migrate(count / 2);
+  ASSERT_TRUE(map.isMigrating());
+
+  // Walking all buckets visits every entry once, in both tables.
+  std::vector<bool> visited(count, false);
+  for (std::size_t bucket = 0; bucket < map.bucket_count(); bucket++) {
+    for (auto entry = map.cbegin(bucket); entry != map.cend(bucket);
+         entry++) {
+      ASSERT_FALSE(visited[entry->second]);
+      visited[entry->second] = true;
+    }
+  }
+  EXPECT_EQ(std::vector<bool>(count, true), visited);
+}
+
+TEST(IncrementalMapTest, Reserve) {
+  Map map;
+  map.reserve(100000);
+  for (int i = 0; i < 80000; i++) {
+    map.emplace(std::to_string(i), i);
+    ASSERT_FALSE(map.isMigrating());
+  }
+}
+
+TEST(IncrementalMapTest, OwnerAllocatesTables) {
+  Map map;
+  int count{0};
+  while (map.getSpareBucketCount() == 0) {
+    ASSERT_FALSE(map.isMigrating());
+    map.emplace(std::to_string(count), count);
+    count++;
+  }
+
+  // The offered table is grown into.
+  Map::Map spare;
+  spare.rehash(map.getSpareBucketCount());
+  const auto spare_buckets = spare.bucket_count();
+  map.offerSpare(spare);
+  EXPECT_EQ(1, spare.bucket_count());
+  EXPECT_FALSE(map.needsTables());
+
+  // An empty old table still has a single bucket.
+  const auto buckets = map.bucket_count() - 1;
+  for (; !map.isMigrating(); count++) {
+    map.emplace(std::to_string(count), count);
+  }
+  EXPECT_EQ(buckets + spare_buckets, map.bucket_count());
+  EXPECT_EQ(1, map.getStats().growths);
+  EXPECT_EQ(1, map.getStats().spare_growths);
+
+  // The drained table is left for the owner to release.
+  map.migrate(map.size());
+  ASSERT_TRUE(map.needsTables());
+  Map::Map drained;
+  map.takeDrained(drained);
+  EXPECT_EQ(buckets, drained.bucket_count());
+  EXPECT_EQ(spare_buckets + 1, map.bucket_count());
+}
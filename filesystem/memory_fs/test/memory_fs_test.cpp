@@ -1,5 +1,11 @@
 #include "filesystem/memory_fs/src/memory_fs.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 using namespace fs;
@@ -79,3 +85,1477 @@ TEST(MemoryFsRemove, Success) {
   ASSERT_EQ(Status::Success, ms.remove("/tmp/temp.txt"));
   ASSERT_EQ(Status::FileNotFound, ms.remove("/tmp/temp.txt"));
 }
+
+TEST(MemoryFsRemovePrefix, NothingToRemove) {
+  MemoryFs ms;
+  ASSERT_EQ(Status::Success, ms.add("/a/x", File{"x"}));
+  EXPECT_EQ(0, ms.removePrefix("/b/"));
+  EXPECT_EQ(FileList{"/a/x"}, ms.list());
+}
+
+TEST(MemoryFsRemovePrefix, Success) {
+  MemoryFs ms;
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_EQ(Status::Success,
+              ms.add("/dir/" + std::to_string(i), File(100, 'x')));
+  }
+  ASSERT_EQ(Status::Success, ms.add("/dir/sub/a", File{"a"}));
+  ASSERT_EQ(Status::Success, ms.add("/dir", File{"dir"}));
+  ASSERT_EQ(Status::Success, ms.add("/dir2/a", File{"a"}));
+
+  EXPECT_EQ(1001, ms.removePrefix("/dir/"));
+  auto files = ms.list();
+  std::sort(files.begin(), files.end());
+  EXPECT_EQ((FileList{"/dir", "/dir2/a"}), files);
+}
+
+TEST(MemoryFsCombining, ConcurrentAddRemove) {
+  constexpr int kThreadCount{16};
+  constexpr int kFileCount{500};
+
+  MemoryFsConfig config;
+  config.combine_writes = true;
+  MemoryFs ms{config};
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreadCount; i++) {
+    threads.emplace_back([&ms, i]() {
+      for (int j = 0; j < kFileCount; j++) {
+        const auto path = std::to_string(i) + '/' + std::to_string(j);
+        EXPECT_EQ(Status::Success, ms.add(path, File(j, 'x')));
+        EXPECT_EQ(Status::AlreadyExists, ms.add(path, File{"x"}));
+        if (j % 2 == 0) {
+          EXPECT_EQ(Status::Success, ms.remove(path));
+        }
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(kThreadCount * kFileCount / 2, ms.list().size());
+  EXPECT_EQ(File(7, 'x'), ms.get("3/7").second);
+  EXPECT_EQ(Status::FileNotFound, ms.get("3/8").first);
+  EXPECT_EQ(kThreadCount * kFileCount * 3 / 2, ms.getSequence());
+}
+
+TEST(MemoryFsGet, OutlivesRemove) {
+  MemoryFs ms;
+  File file{"still here"};
+  ASSERT_EQ(Status::Success, ms.add("/tmp/temp.txt", file));
+  const auto retrieved_file = ms.get("/tmp/temp.txt");
+  ASSERT_EQ(Status::Success, ms.remove("/tmp/temp.txt"));
+  ASSERT_EQ(file, retrieved_file.second);
+}
+
+TEST(MemoryFsAppend, Success) {
+  MemoryFs ms;
+  ASSERT_EQ(Status::Success, ms.add("/var/log/syslog", File{"boot\n"}));
+  ASSERT_EQ(Status::Success, ms.append("/var/log/syslog", File{"login\n"}));
+  ASSERT_EQ(Status::Success, ms.append("/var/log/syslog", File{}));
+  EXPECT_EQ(File{"boot\nlogin\n"}, ms.get("/var/log/syslog").second);
+}
+
+TEST(MemoryFsAppend, CreatesFile) {
+  MemoryFs ms;
+  ASSERT_EQ(Status::Success, ms.append("/var/log/syslog", File{"boot\n"}));
+  EXPECT_EQ(File{"boot\n"}, ms.get("/var/log/syslog").second);
+}
+
+TEST(MemoryFsAppend, ReadersKeepPreviousContents) {
+  MemoryFs ms;
+  ASSERT_EQ(Status::Success, ms.add("/var/log/syslog", File{"boot\n"}));
+  const auto before = ms.get("/var/log/syslog").second;
+  ASSERT_EQ(Status::Success, ms.append("/var/log/syslog", File{"login\n"}));
+  EXPECT_EQ(File{"boot\n"}, before);
+}
+
+TEST(MemoryFsAppend, CoalescesSmallTails) {
+  MemoryFs ms;
+  File expected;
+  for (int i = 0; i < 1000; i++) {
+    const File chunk(100, static_cast<char>(i));
+    ASSERT_EQ(Status::Success, ms.append("a.out", chunk));
+    expected += chunk;
+  }
+
+  // Small appends are merged as they are written, without the compactor.
+  const auto object = ms.get("a.out").second;
+  EXPECT_LE(object.getExtents().size(), 16);
+  EXPECT_EQ(expected, object);
+  EXPECT_EQ(0, ms.compact(10).objects_moved);
+}
+
+TEST(MemoryFsAppend, LargeTailsStay) {
+  MemoryFs ms;
+  const File chunk(128 * 1024, 'x');
+  ASSERT_EQ(Status::Success, ms.add("a.out", chunk));
+  const auto before = ms.get("a.out").second;
+  ASSERT_EQ(Status::Success, ms.append("a.out", chunk));
+  ASSERT_EQ(Status::Success, ms.append("a.out", File{"!"}));
+
+  // Large extents are never copied again.
+  const auto after = ms.get("a.out").second;
+  ASSERT_EQ(3, after.getExtents().size());
+  EXPECT_EQ(before.getExtents().front().buffer.get(),
+            after.getExtents().front().buffer.get());
+  EXPECT_EQ(chunk + chunk + "!", after);
+}
+
+TEST(MemoryFsWrite, FileNotFound) {
+  MemoryFs ms;
+  EXPECT_EQ(Status::FileNotFound, ms.write("a.out", 0, File{"x"}));
+}
+
+TEST(MemoryFsWrite, InvalidRange) {
+  MemoryFs ms;
+  ASSERT_EQ(Status::Success, ms.add("a.out", File{"abc"}));
+  EXPECT_EQ(Status::InvalidRange, ms.write("a.out", 4, File{"x"}));
+  EXPECT_EQ(File{"abc"}, ms.get("a.out").second);
+}
+
+TEST(MemoryFsWrite, Success) {
+  MemoryFs ms;
+  ASSERT_EQ(Status::Success, ms.add("a.out", File{"abcdef"}));
+  ASSERT_EQ(Status::Success, ms.write("a.out", 2, File{"XY"}));
+  EXPECT_EQ(File{"abXYef"}, ms.get("a.out").second);
+  ASSERT_EQ(Status::Success, ms.write("a.out", 5, File{"123"}));
+  EXPECT_EQ(File{"abXYe123"}, ms.get("a.out").second);
+  ASSERT_EQ(Status::Success, ms.write("a.out", 8, File{"!"}));
+  EXPECT_EQ(File{"abXYe123!"}, ms.get("a.out").second);
+}
+
+TEST(MemoryFsCopy, FileNotFound) {
+  MemoryFs ms;
+  EXPECT_EQ(Status::FileNotFound, ms.copy("a", "b"));
+  EXPECT_TRUE(ms.list().empty());
+}
+
+TEST(MemoryFsCopy, AlreadyExists) {
+  MemoryFs ms;
+  ASSERT_EQ(Status::Success, ms.add("a", File{"a"}));
+  ASSERT_EQ(Status::Success, ms.add("b", File{"b"}));
+  EXPECT_EQ(Status::AlreadyExists, ms.copy("a", "b"));
+  EXPECT_EQ(Status::AlreadyExists, ms.copy("a", "a"));
+  EXPECT_EQ(File{"b"}, ms.get("b").second);
+}
+
+TEST(MemoryFsCopy, SharesContents) {
+  const File file(1000, 'x');
+  MemoryFs ms;
+  ASSERT_EQ(Status::Success, ms.add("a", file));
+  ASSERT_EQ(Status::Success, ms.copy("a", "b"));
+  EXPECT_EQ(file.size(), ms.getMemoryStats().live_bytes);
+  EXPECT_TRUE(ms.get("a").second.isSameAs(ms.get("b").second));
+
+  // Modifying either object does not affect the other one.
+  ASSERT_EQ(Status::Success, ms.write("a", 0, File{"a"}));
+  ASSERT_EQ(Status::Success, ms.append("b", File{"b"}));
+  EXPECT_EQ(File{"a"} + file.substr(1), ms.get("a").second);
+  EXPECT_EQ(file + "b", ms.get("b").second);
+}
+
+TEST(MemoryFsCopy, Inline) {
+  MemoryFs ms;
+  ASSERT_EQ(Status::Success, ms.add("a", File{"on"}));
+  ASSERT_EQ(Status::Success, ms.copy("a", "b"));
+  ASSERT_EQ(Status::Success, ms.write("a", 0, File{"no"}));
+  EXPECT_EQ(File{"no"}, ms.get("a").second);
+  EXPECT_EQ(File{"on"}, ms.get("b").second);
+}
+
+TEST(MemoryFsRename, FileNotFound) {
+  MemoryFs ms;
+  EXPECT_EQ(Status::FileNotFound, ms.rename("a", "b"));
+}
+
+TEST(MemoryFsRename, AlreadyExists) {
+  MemoryFs ms;
+  ASSERT_EQ(Status::Success, ms.add("a", File{"a"}));
+  ASSERT_EQ(Status::Success, ms.add("b", File{"b"}));
+  EXPECT_EQ(Status::AlreadyExists, ms.rename("a", "b"));
+  EXPECT_EQ(File{"a"}, ms.get("a").second);
+  EXPECT_EQ(File{"b"}, ms.get("b").second);
+}
+
+TEST(MemoryFsRename, Success) {
+  const File file(1000, 'x');
+  MemoryFs ms;
+  ASSERT_EQ(Status::Success, ms.add("a", file));
+  const auto before = ms.get("a").second;
+
+  ASSERT_EQ(Status::Success, ms.rename("a", "b"));
+  EXPECT_EQ(Status::FileNotFound, ms.get("a").first);
+  EXPECT_EQ(FileList{"b"}, ms.list());
+  EXPECT_TRUE(before.isSameAs(ms.get("b").second));
+}
+
+TEST(MemoryFsConditional, Versions) {
+  MemoryFs ms;
+  EXPECT_EQ(Status::FileNotFound, std::get<0>(ms.getWithInfo("a")));
+  ASSERT_EQ(Status::Success, ms.add("a", File{"abc"}));
+  ASSERT_EQ(Status::Success, ms.add("b", File{"b"}));
+  const auto [status, file, info] = ms.getWithInfo("a");
+  ASSERT_EQ(Status::Success, status);
+  EXPECT_EQ(File{"abc"}, file);
+  const auto version = info.version;
+
+  // Every modification gives a new version.
+  ASSERT_EQ(Status::Success, ms.append("a", File{"d"}));
+  const auto appended = std::get<2>(ms.getWithInfo("a")).version;
+  EXPECT_GT(appended, version);
+  ASSERT_EQ(Status::Success, ms.write("a", 0, File{"X"}));
+  EXPECT_GT(std::get<2>(ms.getWithInfo("a")).version, appended);
+
+  // Copies and renames are new versions of the destination.
+  ASSERT_EQ(Status::Success, ms.copy("a", "c"));
+  EXPECT_EQ(ms.getSequence(), std::get<2>(ms.getWithInfo("c")).version);
+  ASSERT_EQ(Status::Success, ms.rename("c", "d"));
+  EXPECT_EQ(ms.getSequence() - 1, std::get<2>(ms.getWithInfo("d")).version);
+}
+
+TEST(MemoryFsConditional, Stat) {
+  MemoryFs ms;
+  EXPECT_EQ(Status::FileNotFound, ms.stat("a").first);
+
+  const auto before = std::chrono::system_clock::now();
+  const auto version = ms.put("a", File(100, 'a'), {}).second;
+  const auto [status, info] = ms.stat("a");
+  ASSERT_EQ(Status::Success, status);
+  EXPECT_EQ(100, info.size);
+  EXPECT_EQ(version, info.version);
+  EXPECT_LE(before, info.modified);
+  EXPECT_GE(std::chrono::system_clock::now(), info.modified);
+
+  ASSERT_EQ(Status::Success, ms.append("a", File{"b"}));
+  EXPECT_EQ(101, ms.stat("a").second.size);
+  EXPECT_LE(info.modified, ms.stat("a").second.modified);
+}
+
+TEST(MemoryFsConditional, PutIfMatch) {
+  MemoryFs ms;
+  EXPECT_EQ(Status::PreconditionFailed,
+            ms.put("a", File{"a"}, {true}).first);
+  EXPECT_EQ(Status::PreconditionFailed,
+            ms.put("a", File{"a"}, {{}, 1}).first);
+  const auto [status, version] = ms.put("a", File{"a"}, {});
+  ASSERT_EQ(Status::Success, status);
+  EXPECT_EQ(version, std::get<2>(ms.getWithInfo("a")).version);
+
+  const auto [replaced, next] = ms.put("a", File(1000, 'b'), {{}, version});
+  ASSERT_EQ(Status::Success, replaced);
+  EXPECT_GT(next, version);
+  EXPECT_EQ(File(1000, 'b'), ms.get("a").second);
+
+  // The old version no longer matches.
+  EXPECT_EQ(Status::PreconditionFailed,
+            ms.put("a", File{"c"}, {{}, version}).first);
+  EXPECT_EQ(Status::Success, ms.put("a", File{"c"}, {true}).first);
+  EXPECT_EQ(File{"c"}, ms.get("a").second);
+  EXPECT_EQ(FileList{"a"}, ms.list());
+}
+
+TEST(MemoryFsConditional, PutIfNoneMatch) {
+  MemoryFs ms;
+  EXPECT_EQ(Status::Success, ms.put("a", File{"a"}, {false}).first);
+  EXPECT_EQ(Status::PreconditionFailed,
+            ms.put("a", File{"b"}, {false}).first);
+  EXPECT_EQ(Status::AlreadyExists, ms.add("a", File{"b"}));
+  EXPECT_EQ(File{"a"}, ms.get("a").second);
+}
+
+TEST(MemoryFsConditional, RemoveIfMatch) {
+  MemoryFs ms;
+  EXPECT_EQ(Status::PreconditionFailed, ms.remove("a", {true}));
+  EXPECT_EQ(Status::FileNotFound, ms.remove("a", {}));
+  const auto version = ms.put("a", File{"a"}, {}).second;
+
+  EXPECT_EQ(Status::PreconditionFailed, ms.remove("a", {false}));
+  EXPECT_EQ(Status::PreconditionFailed, ms.remove("a", {{}, version + 1}));
+  EXPECT_EQ(Status::Success, ms.remove("a", {{}, version}));
+  EXPECT_EQ(Status::FileNotFound, ms.get("a").first);
+}
+
+TEST(MemoryFsUpload, Compose) {
+  const File first(100 * 1024, 'a');
+  const File second(100 * 1024, 'b');
+  const File third(1000, 'c');
+  MemoryFs ms;
+  const auto upload = ms.createUpload("a");
+  ASSERT_EQ(Status::Success, ms.uploadPart(upload, "a", 3, third));
+  ASSERT_EQ(Status::Success, ms.uploadPart(upload, "a", 1, first));
+  ASSERT_EQ(Status::Success, ms.uploadPart(upload, "a", 2, File{"x"}));
+  ASSERT_EQ(Status::Success, ms.uploadPart(upload, "a", 2, second));
+  EXPECT_EQ(Status::FileNotFound, ms.get("a").first);
+  EXPECT_TRUE(ms.list().empty());
+
+  const auto [status, version] = ms.completeUpload(upload, "a", {});
+  ASSERT_EQ(Status::Success, status);
+  EXPECT_EQ(version, ms.stat("a").second.version);
+  EXPECT_EQ(first + second + third, ms.get("a").second);
+
+  // Parts are stitched together without being copied, even by compaction.
+  const auto size = first.size() + second.size() + third.size();
+  EXPECT_EQ(3, ms.get("a").second.getExtents().size());
+  EXPECT_EQ(size, ms.getMemoryStats().live_bytes);
+  EXPECT_EQ(0, ms.compact(10).objects_moved);
+
+  // The upload is gone.
+  EXPECT_EQ(Status::FileNotFound, ms.uploadPart(upload, "a", 1, first));
+  EXPECT_EQ(Status::FileNotFound, ms.completeUpload(upload, "a", {}).first);
+}
+
+TEST(MemoryFsUpload, Tiny) {
+  MemoryFs ms;
+  const auto upload = ms.createUpload("a");
+  ASSERT_EQ(Status::Success, ms.uploadPart(upload, "a", 2, File{"lo"}));
+  ASSERT_EQ(Status::Success, ms.uploadPart(upload, "a", 1, File{"hel"}));
+  ASSERT_EQ(Status::Success, ms.completeUpload(upload, "a", {}).first);
+  EXPECT_EQ(File{"hello"}, ms.get("a").second);
+  EXPECT_EQ(0, ms.getMemoryStats().live_bytes);
+}
+
+TEST(MemoryFsUpload, ConcurrentParts) {
+  constexpr std::size_t kPartCount{64};
+  constexpr std::size_t kThreadCount{4};
+  MemoryFs ms;
+  const auto upload = ms.createUpload("a");
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < kThreadCount; i++) {
+    threads.emplace_back([&ms, upload, i]() {
+      for (auto part = i + 1; part <= kPartCount; part += kThreadCount) {
+        EXPECT_EQ(Status::Success,
+                  ms.uploadPart(upload, "a", part,
+                                File(1000, static_cast<char>(part))));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  File expected;
+  for (std::size_t part = 1; part <= kPartCount; part++) {
+    expected += File(1000, static_cast<char>(part));
+  }
+  ASSERT_EQ(Status::Success, ms.completeUpload(upload, "a", {}).first);
+  EXPECT_EQ(expected, ms.get("a").second);
+}
+
+TEST(MemoryFsUpload, NotFound) {
+  MemoryFs ms;
+  EXPECT_EQ(Status::FileNotFound, ms.uploadPart(1, "a", 1, File{"a"}));
+  EXPECT_EQ(Status::FileNotFound, ms.completeUpload(1, "a", {}).first);
+  EXPECT_EQ(Status::FileNotFound, ms.abortUpload(1, "a"));
+
+  // Uploads are bound to their paths.
+  const auto upload = ms.createUpload("a");
+  EXPECT_NE(upload, ms.createUpload("a"));
+  EXPECT_EQ(Status::FileNotFound, ms.uploadPart(upload, "b", 1, File{"a"}));
+  EXPECT_EQ(Status::FileNotFound, ms.completeUpload(upload, "b", {}).first);
+  EXPECT_EQ(Status::InvalidRange, ms.uploadPart(upload, "a", 0, File{"a"}));
+  EXPECT_EQ(Status::InvalidRange,
+            ms.uploadPart(upload, "a", 100000, File{"a"}));
+}
+
+TEST(MemoryFsUpload, Abort) {
+  MemoryFs ms;
+  const auto upload = ms.createUpload("a");
+  ASSERT_EQ(Status::Success, ms.uploadPart(upload, "a", 1, File(1000, 'a')));
+  EXPECT_EQ(1000, ms.getMemoryStats().live_bytes);
+
+  EXPECT_EQ(Status::Success, ms.abortUpload(upload, "a"));
+  EXPECT_EQ(0, ms.getMemoryStats().live_bytes);
+  EXPECT_EQ(Status::FileNotFound, ms.completeUpload(upload, "a", {}).first);
+  EXPECT_EQ(Status::FileNotFound, ms.get("a").first);
+}
+
+TEST(MemoryFsUpload, Precondition) {
+  MemoryFs ms;
+  const auto version = ms.put("a", File{"a"}, {}).second;
+  const auto upload = ms.createUpload("a");
+  ASSERT_EQ(Status::Success, ms.uploadPart(upload, "a", 1, File(1000, 'b')));
+
+  // A failed completion can be retried.
+  EXPECT_EQ(Status::PreconditionFailed,
+            ms.completeUpload(upload, "a", {false}).first);
+  EXPECT_EQ(File{"a"}, ms.get("a").second);
+  EXPECT_EQ(Status::Success,
+            ms.completeUpload(upload, "a", {{}, version}).first);
+  EXPECT_EQ(File(1000, 'b'), ms.get("a").second);
+}
+
+TEST(MemoryFsUpload, Expire) {
+  MemoryFsConfig config;
+  config.upload_timeout = std::chrono::milliseconds{50};
+  MemoryFs ms{config};
+  const auto upload = ms.createUpload("a");
+  ASSERT_EQ(Status::Success, ms.uploadPart(upload, "a", 1, File(1000, 'a')));
+  EXPECT_EQ(0, ms.expireUploads());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  const auto active = ms.createUpload("b");
+  EXPECT_EQ(1, ms.expireUploads());
+  EXPECT_EQ(0, ms.getMemoryStats().live_bytes);
+  EXPECT_EQ(Status::FileNotFound, ms.completeUpload(upload, "a", {}).first);
+  EXPECT_EQ(Status::Success, ms.completeUpload(active, "b", {}).first);
+}
+
+TEST(MemoryFsIndex, Growth) {
+  MemoryFsConfig config;
+  config.expected_objects = 100;
+  MemoryFs ms{config};
+
+  // The index grows incrementally well before the last file is added, and
+  // files are renamed, listed and removed while it does.
+  constexpr int kFiles{20000};
+  for (int i = 0; i < kFiles; i++) {
+    ASSERT_EQ(Status::Success, ms.add("d/" + std::to_string(i), File{"a"}));
+  }
+  ASSERT_EQ(Status::Success, ms.rename("d/0", "e/0"));
+  EXPECT_EQ(kFiles, ms.list().size());
+  for (int i = 1; i < kFiles; i += 1000) {
+    EXPECT_EQ(File{"a"}, ms.get("d/" + std::to_string(i)).second);
+  }
+
+  EXPECT_EQ(kFiles - 1, ms.removePrefix("d/"));
+  EXPECT_EQ(1, ms.list().size());
+  EXPECT_EQ(File{"a"}, ms.get("e/0").second);
+}
+
+TEST(MemoryFsIndex, SpareTables) {
+  MemoryFs ms;
+
+  // Replicated and copied files do not go through the combiner, the index
+  // still grows into tables allocated outside of the lock.
+  constexpr std::uint64_t kFiles{20000};
+  for (std::uint64_t i = 0; i < kFiles; i++) {
+    ASSERT_EQ(Status::Success,
+              ms.apply({i + 1, MutationType::Put, "d/" + std::to_string(i), 0,
+                        Object{File{"a"}}}));
+  }
+  const auto applied = ms.getIndexStats();
+  EXPECT_GT(applied.growths, 0);
+  EXPECT_EQ(applied.growths, applied.spare_growths);
+
+  for (std::uint64_t i = 0; i < kFiles; i++) {
+    ASSERT_EQ(Status::Success, ms.copy("d/" + std::to_string(i),
+                                       "e/" + std::to_string(i)));
+  }
+  const auto copied = ms.getIndexStats();
+  EXPECT_GT(copied.growths, applied.growths);
+  EXPECT_EQ(copied.growths, copied.spare_growths);
+  EXPECT_EQ(2 * kFiles, ms.list().size());
+}
+
+/**
+ * \brief Create a filesystem configuration with per-thread caching.
+ *
+ * \return Filesystem configuration.
+ */
+MemoryFsConfig cachingConfig() {
+  MemoryFsConfig config;
+  config.cache.slots = 64;
+  config.cache.max_object_size = 1000;
+  return config;
+}
+
+TEST(MemoryFsCache, Disabled) {
+  MemoryFs ms;
+  ASSERT_EQ(Status::Success, ms.add("a", File{"a"}));
+  EXPECT_EQ(File{"a"}, ms.get("a").second);
+  EXPECT_TRUE(ms.getCacheStats().empty());
+}
+
+TEST(MemoryFsCache, Hits) {
+  MemoryFs ms{cachingConfig()};
+  ASSERT_EQ(Status::Success, ms.add("a", File(1000, 'a')));
+  ASSERT_EQ(Status::Success, ms.add("b", File(1001, 'b')));
+
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(File(1000, 'a'), ms.get("a").second);
+    EXPECT_EQ(File(1001, 'b'), ms.get("b").second);
+  }
+  const auto [status, object, info] = *ms.tryGet("a");
+  EXPECT_EQ(File(1000, 'a'), object);
+  EXPECT_EQ(ms.stat("a").second.version, info.version);
+
+  // Objects above the size limit are never cached.
+  const auto stats = ms.getCacheStats();
+  ASSERT_EQ(1, stats.size());
+  EXPECT_EQ(4, stats[0].hits);
+  EXPECT_EQ(4, stats[0].misses);
+}
+
+TEST(MemoryFsCache, Invalidation) {
+  MemoryFs ms{cachingConfig()};
+  ASSERT_EQ(Status::Success, ms.add("a", File{"a"}));
+  ASSERT_EQ(File{"a"}, ms.get("a").second);
+
+  ASSERT_EQ(Status::Success, ms.put("a", File{"b"}, {}).first);
+  EXPECT_EQ(File{"b"}, ms.get("a").second);
+  ASSERT_EQ(Status::Success, ms.append("a", File{"c"}));
+  EXPECT_EQ(File{"bc"}, ms.get("a").second);
+  ASSERT_EQ(Status::Success, ms.write("a", 0, File{"d"}));
+  EXPECT_EQ(File{"dc"}, ms.get("a").second);
+
+  ASSERT_EQ(Status::Success, ms.rename("a", "b"));
+  EXPECT_EQ(Status::FileNotFound, ms.get("a").first);
+  EXPECT_EQ(File{"dc"}, ms.get("b").second);
+  ASSERT_EQ(Status::Success, ms.remove("b"));
+  EXPECT_EQ(Status::FileNotFound, ms.get("b").first);
+  EXPECT_EQ(Status::FileNotFound, ms.stat("b").first);
+
+  ASSERT_EQ(Status::Success, ms.add("c", File{"c"}));
+  ASSERT_EQ(File{"c"}, ms.get("c").second);
+  ms.reset(0);
+  EXPECT_EQ(Status::FileNotFound, ms.get("c").first);
+}
+
+TEST(MemoryFsCache, PerThread) {
+  MemoryFs ms{cachingConfig()};
+  ASSERT_EQ(Status::Success, ms.add("a", File{"a"}));
+  ASSERT_EQ(File{"a"}, ms.get("a").second);
+
+  // Other threads have caches of their own.
+  std::thread reader{[&ms]() {
+    for (int i = 0; i < 10; i++) {
+      EXPECT_EQ(File{"a"}, ms.get("a").second);
+    }
+  }};
+  reader.join();
+
+  const auto stats = ms.getCacheStats();
+  ASSERT_EQ(2, stats.size());
+  EXPECT_EQ(0, stats[0].hits);
+  EXPECT_EQ(1, stats[0].misses);
+  EXPECT_EQ(9, stats[1].hits);
+  EXPECT_EQ(1, stats[1].misses);
+}
+
+TEST(MemoryFsCache, ConcurrentWriter) {
+  constexpr int kVersionCount{10000};
+  MemoryFs ms{cachingConfig()};
+  ASSERT_EQ(Status::Success, ms.add("a", File{"0"}));
+
+  // Readers never see a version older than one they have already seen.
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&ms, &done]() {
+      std::size_t last{0};
+      while (!done.load()) {
+        const auto value = std::stoul(ms.get("a").second.str());
+        EXPECT_LE(last, value);
+        last = value;
+      }
+    });
+  }
+
+  for (int i = 1; i <= kVersionCount; i++) {
+    ASSERT_EQ(Status::Success,
+              ms.put("a", File{std::to_string(i)}, {}).first);
+  }
+  done.store(true);
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(File{std::to_string(kVersionCount)}, ms.get("a").second);
+}
+
+TEST(MemoryFsCompact, CoalescesExtents) {
+  MemoryFs ms;
+  File expected(6400, '.');
+  ASSERT_EQ(Status::Success, ms.add("a.out", expected));
+  for (int i = 0; i < 32; i++) {
+    const File chunk(100, static_cast<char>(i));
+    ASSERT_EQ(Status::Success, ms.write("a.out", i * 200, chunk));
+    expected.replace(i * 200, chunk.size(), chunk);
+  }
+
+  ASSERT_EQ(64, ms.get("a.out").second.getExtents().size());
+  EXPECT_EQ(1, ms.compact(10).objects_moved);
+  ASSERT_EQ(1, ms.get("a.out").second.getExtents().size());
+  EXPECT_EQ(expected, ms.get("a.out").second);
+}
+
+/**
+ * \brief Create a filesystem with small arena regions, fill it with objects
+ * and remove most of them, leaving sparse regions behind.
+ *
+ * \param ms Filesystem to fragment.
+ * \param count Number of objects to add.
+ *
+ * \return Number of objects left in the filesystem.
+ */
+std::size_t fragment(MemoryFs& ms, std::size_t count) {
+  std::size_t left{0};
+  for (std::size_t i = 0; i < count; i++) {
+    EXPECT_EQ(Status::Success,
+              ms.add(std::to_string(i), File(1000, static_cast<char>(i))));
+  }
+
+  for (std::size_t i = 0; i < count; i++) {
+    if (i % 8 != 0) {
+      EXPECT_EQ(Status::Success, ms.remove(std::to_string(i)));
+    } else {
+      left++;
+    }
+  }
+
+  return left;
+}
+
+TEST(MemoryFsCompact, NothingToCompact) {
+  MemoryFs ms;
+  const auto result = ms.compact(10);
+  EXPECT_TRUE(result.pass_completed);
+  EXPECT_EQ(0, result.objects_moved);
+  EXPECT_EQ(0, result.bytes_moved);
+}
+
+TEST(MemoryFsCompact, ReleasesSparseRegions) {
+  MemoryFs ms{{{64 * 1024, 16 * 1024}, {}}};
+  const auto left = fragment(ms, 1000);
+  const auto before = ms.getMemoryStats();
+  EXPECT_LT(before.live_bytes, before.mapped_bytes / 4);
+
+  std::size_t objects_moved{0};
+  while (true) {
+    const auto result = ms.compact(7);
+    EXPECT_LE(result.objects_moved, 7);
+    objects_moved += result.objects_moved;
+    if (result.pass_completed) {
+      break;
+    }
+  }
+
+  const auto after = ms.getMemoryStats();
+  EXPECT_GT(objects_moved, 0);
+  EXPECT_LE(objects_moved, left);
+  EXPECT_EQ(before.live_bytes, after.live_bytes);
+  EXPECT_LT(after.regions, before.regions);
+  EXPECT_LT(after.mapped_bytes, before.mapped_bytes);
+
+  // All remaining objects are intact.
+  ASSERT_EQ(left, ms.list().size());
+  for (std::size_t i = 0; i < 1000; i += 8) {
+    const auto [status, file] = ms.get(std::to_string(i));
+    ASSERT_EQ(Status::Success, status);
+    ASSERT_EQ(File(1000, static_cast<char>(i)), file);
+  }
+}
+
+TEST(MemoryFsCompact, ReadersKeepRelocatedObjects) {
+  MemoryFs ms{{{64 * 1024, 16 * 1024}, {}}};
+  fragment(ms, 1000);
+  const auto [status, file] = ms.get("0");
+  ASSERT_EQ(Status::Success, status);
+
+  while (!ms.compact(1000).pass_completed) {
+  }
+
+  EXPECT_EQ(File(1000, static_cast<char>(0)), file);
+  EXPECT_FALSE(file.isSameAs(ms.get("0").second));
+}
+
+TEST(MemoryFsCompact, CopiesStayShared) {
+  MemoryFs ms{{{64 * 1024, 16 * 1024}, {}}};
+  fragment(ms, 1000);
+  ASSERT_EQ(Status::Success, ms.copy("0", "copy"));
+  const auto before = ms.getMemoryStats();
+
+  // Relocate a single object per step, so the copies are moved separately.
+  std::size_t bytes_moved{0};
+  while (true) {
+    const auto result = ms.compact(1);
+    bytes_moved += result.bytes_moved;
+    if (result.pass_completed) {
+      break;
+    }
+  }
+
+  const auto original = ms.get("0").second;
+  const auto copy = ms.get("copy").second;
+  EXPECT_EQ(File(1000, static_cast<char>(0)), copy);
+  EXPECT_TRUE(copy.isSameAs(original));
+  EXPECT_EQ(before.live_bytes, ms.getMemoryStats().live_bytes);
+  EXPECT_LE(bytes_moved, before.live_bytes);
+}
+
+TEST(MemoryFsCompact, BackgroundCompactor) {
+  CompactorConfig compactor_config;
+  compactor_config.enabled = true;
+  compactor_config.cpu_budget = 0.5;
+  compactor_config.pass_interval = std::chrono::milliseconds{1};
+  MemoryFs ms{{{64 * 1024, 16 * 1024}, compactor_config}};
+
+  const auto left = fragment(ms, 1000);
+  const auto before = ms.getMemoryStats();
+
+  // Wait for the compactor to catch up.
+  for (int i = 0; i < 500; i++) {
+    if (ms.getMemoryStats().mapped_bytes < before.mapped_bytes / 2) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+
+  EXPECT_LT(ms.getMemoryStats().mapped_bytes, before.mapped_bytes / 2);
+  ASSERT_EQ(left, ms.list().size());
+  EXPECT_EQ(File(1000, static_cast<char>(16)), ms.get("16").second);
+}
+
+TEST(MemoryFsInline, StoredInIndex) {
+  MemoryFs ms;
+  ASSERT_EQ(Status::Success, ms.add("flag", File{"on"}));
+  ASSERT_EQ(Status::Success, ms.add("empty", File{}));
+  EXPECT_EQ(0, ms.getMemoryStats().live_bytes);
+
+  EXPECT_EQ(File{"on"}, ms.get("flag").second);
+  EXPECT_EQ(File{}, ms.get("empty").second);
+  const auto file = ms.tryGet("flag");
+  ASSERT_TRUE(file);
+  EXPECT_EQ(File{"on"}, std::get<1>(*file));
+}
+
+TEST(MemoryFsInline, ModifyInPlace) {
+  MemoryFs ms;
+  ASSERT_EQ(Status::Success, ms.add("counter", File{"0001"}));
+  ASSERT_EQ(Status::Success, ms.write("counter", 3, File{"2"}));
+  ASSERT_EQ(Status::Success, ms.append("counter", File{"!"}));
+  EXPECT_EQ(Status::InvalidRange, ms.write("counter", 6, File{"x"}));
+
+  EXPECT_EQ(File{"0002!"}, ms.get("counter").second);
+  EXPECT_TRUE(ms.compact(10).pass_completed);
+  EXPECT_EQ(0, ms.getMemoryStats().live_bytes);
+}
+
+TEST(MemoryFsInline, Outgrown) {
+  const File head(Entry::kMaxInlineSize, 'h');
+  MemoryFs ms;
+  ASSERT_EQ(Status::Success, ms.add("a", head));
+  const auto before = ms.get("a").second;
+
+  // Readers keep the inline contents they have read.
+  ASSERT_EQ(Status::Success, ms.append("a", File{"tail"}));
+  EXPECT_EQ(head + "tail", ms.get("a").second);
+  EXPECT_EQ(head, before);
+  EXPECT_EQ(head.size() + 4, ms.getMemoryStats().live_bytes);
+}
+
+TEST(MemoryFsInline, Disabled) {
+  MemoryFsConfig config;
+  config.inline_threshold = 0;
+  MemoryFs ms{config};
+  ASSERT_EQ(Status::Success, ms.add("flag", File{"on"}));
+  EXPECT_EQ(2, ms.getMemoryStats().live_bytes);
+  EXPECT_EQ(File{"on"}, ms.get("flag").second);
+}
+
+TEST(MemoryFsInline, Replay) {
+  MemoryFs primary{{{}, {}, {}, {16}}};
+  ASSERT_EQ(Status::Success, primary.add("a", File{"tiny"}));
+  ASSERT_EQ(Status::Success, primary.append("a", File{"!"}));
+
+  const auto mutations =
+      primary.getMutations(0, 10, std::chrono::milliseconds{0});
+  ASSERT_TRUE(mutations);
+  ASSERT_EQ(2, mutations->size());
+  EXPECT_EQ(File{"tiny"}, mutations->front().data);
+
+  MemoryFs follower;
+  for (const auto& mutation : *mutations) {
+    ASSERT_EQ(Status::Success, follower.apply(mutation));
+  }
+  EXPECT_EQ(File{"tiny!"}, follower.get("a").second);
+  EXPECT_EQ(0, follower.getMemoryStats().live_bytes);
+}
+
+/**
+ * \brief Create a filesystem configuration with a small memory budget and
+ * migration steps performed by the test itself.
+ *
+ * \param memory_budget Object bytes kept in memory.
+ *
+ * \return Filesystem configuration.
+ */
+MemoryFsConfig tieredConfig(std::size_t memory_budget) {
+  MemoryFsConfig config;
+  config.disk.enabled = true;
+  config.disk.migrate_in_background = false;
+  config.disk.memory_budget = memory_budget;
+  config.disk.segment_size = 64 * 1024;
+  // Tiny objects would be kept in the index, rather than moved to disk.
+  config.inline_threshold = 0;
+  return config;
+}
+
+TEST(MemoryFsTier, UnderBudget) {
+  MemoryFs ms{tieredConfig(1024 * 1024)};
+  ASSERT_EQ(Status::Success, ms.add("a", File(1000, 'a')));
+
+  const auto result = ms.migrate(10);
+  EXPECT_EQ(0, result.objects_demoted);
+  EXPECT_FALSE(result.more_work);
+  EXPECT_EQ(0, ms.getDiskStats().objects);
+}
+
+TEST(MemoryFsTier, DemotesColdObjects) {
+  MemoryFs ms{tieredConfig(10 * 1000)};
+  for (int i = 0; i < 20; i++) {
+    ASSERT_EQ(Status::Success,
+              ms.add(std::to_string(i), File(1000, static_cast<char>(i))));
+  }
+
+  // The first sweep only clears the access bits.
+  while (ms.getMemoryStats().live_bytes > 10 * 1000) {
+    ASSERT_TRUE(ms.migrate(4).more_work);
+  }
+
+  EXPECT_EQ(10, ms.getDiskStats().objects);
+  EXPECT_EQ(20, ms.list().size());
+  for (int i = 0; i < 20; i++) {
+    const auto [status, file] = ms.get(std::to_string(i));
+    ASSERT_EQ(Status::Success, status);
+    EXPECT_EQ(File(1000, static_cast<char>(i)), file);
+  }
+}
+
+TEST(MemoryFsTier, PromotesOnAccess) {
+  MemoryFs ms{tieredConfig(0)};
+  ASSERT_EQ(Status::Success, ms.add("cold", File{"cold data"}));
+  ms.migrate(10);
+  ms.migrate(10);
+  ASSERT_EQ(1, ms.getDiskStats().objects);
+
+  // Disk resident objects are not returned without blocking.
+  EXPECT_FALSE(ms.tryGet("cold"));
+  EXPECT_EQ(File{"cold data"}, ms.get("cold").second);
+
+  EXPECT_EQ(1, ms.migrate(0).objects_promoted);
+  EXPECT_EQ(0, ms.getDiskStats().objects);
+  const auto file = ms.tryGet("cold");
+  ASSERT_TRUE(file);
+  EXPECT_EQ(File{"cold data"}, std::get<1>(*file));
+}
+
+TEST(MemoryFsTier, TryGetNotFound) {
+  MemoryFs ms{tieredConfig(0)};
+  const auto file = ms.tryGet("missing");
+  ASSERT_TRUE(file);
+  EXPECT_EQ(Status::FileNotFound, std::get<0>(*file));
+  EXPECT_EQ(Status::FileNotFound, ms.get("missing").first);
+}
+
+TEST(MemoryFsTier, ModifyDiskResident) {
+  MemoryFs ms{tieredConfig(0)};
+  ASSERT_EQ(Status::Success, ms.add("log", File{"boot\n"}));
+  ms.migrate(10);
+  ms.migrate(10);
+  ASSERT_EQ(1, ms.getDiskStats().objects);
+
+  EXPECT_EQ(Status::AlreadyExists, ms.add("log", File{}));
+  ASSERT_EQ(Status::Success, ms.append("log", File{"login\n"}));
+  EXPECT_EQ(0, ms.getDiskStats().objects);
+  EXPECT_EQ(File{"boot\nlogin\n"}, ms.get("log").second);
+}
+
+TEST(MemoryFsTier, RemoveDiskResident) {
+  MemoryFs ms{tieredConfig(0)};
+  ASSERT_EQ(Status::Success, ms.add("a", File{"a"}));
+  ms.migrate(10);
+  ms.migrate(10);
+  ASSERT_EQ(1, ms.getDiskStats().objects);
+
+  ASSERT_EQ(Status::Success, ms.remove("a"));
+  EXPECT_EQ(Status::FileNotFound, ms.remove("a"));
+  EXPECT_EQ(Status::FileNotFound, ms.get("a").first);
+  EXPECT_TRUE(ms.list().empty());
+}
+
+TEST(MemoryFsTier, RemovePrefixDiskResident) {
+  MemoryFs ms{tieredConfig(0)};
+  ASSERT_EQ(Status::Success, ms.add("/d/a", File{"a"}));
+  ms.migrate(10);
+  ms.migrate(10);
+  ASSERT_EQ(1, ms.getDiskStats().objects);
+  ASSERT_EQ(Status::Success, ms.add("/d/b", File{"b"}));
+
+  EXPECT_EQ(2, ms.removePrefix("/d/"));
+  EXPECT_EQ(0, ms.getDiskStats().objects);
+  EXPECT_TRUE(ms.list().empty());
+}
+
+TEST(MemoryFsTier, RenameDiskResident) {
+  MemoryFs ms{tieredConfig(0)};
+  ASSERT_EQ(Status::Success, ms.add("a", File{"a"}));
+  ms.migrate(10);
+  ms.migrate(10);
+  ASSERT_EQ(1, ms.getDiskStats().objects);
+
+  // The object is relinked on disk, not brought to memory.
+  ASSERT_EQ(Status::Success, ms.rename("a", "b"));
+  EXPECT_EQ(1, ms.getDiskStats().objects);
+  EXPECT_EQ(0, ms.getMemoryStats().live_bytes);
+  EXPECT_EQ(Status::AlreadyExists, ms.copy("b", "b"));
+  EXPECT_EQ(Status::FileNotFound, ms.rename("a", "c"));
+  EXPECT_EQ(FileList{"b"}, ms.list());
+  EXPECT_EQ(File{"a"}, ms.get("b").second);
+}
+
+TEST(MemoryFsTier, CopyDiskResident) {
+  MemoryFs ms{tieredConfig(0)};
+  ASSERT_EQ(Status::Success, ms.add("/a", File{"abc"}));
+  ms.migrate(10);
+  ms.migrate(10);
+  ASSERT_TRUE(ms.isOnDisk("/a"));
+
+  // Both objects share the contents on disk, which outlive either of them.
+  const auto version = ms.stat("/a").second.version;
+  ASSERT_EQ(Status::Success, ms.copy("/a", "/b"));
+  EXPECT_TRUE(ms.isOnDisk("/b"));
+  EXPECT_EQ(0, ms.getMemoryStats().live_bytes);
+  EXPECT_GT(ms.stat("/b").second.version, version);
+  EXPECT_EQ(2, ms.getDiskStats().objects);
+  EXPECT_EQ(6, ms.getUsage("/").bytes);
+
+  ASSERT_EQ(Status::Success, ms.remove("/a"));
+  EXPECT_EQ(File{"abc"}, std::get<1>(ms.getWithInfo("/b")));
+  ASSERT_EQ(Status::Success, ms.remove("/b"));
+  EXPECT_EQ(0, ms.getDiskStats().live_bytes);
+}
+
+TEST(MemoryFsTier, IsOnDisk) {
+  MemoryFs ms{tieredConfig(0)};
+  ASSERT_EQ(Status::Success, ms.add("a", File{"a"}));
+  EXPECT_FALSE(ms.isOnDisk("a"));
+  ms.migrate(10);
+  ms.migrate(10);
+  EXPECT_TRUE(ms.isOnDisk("a"));
+  EXPECT_FALSE(ms.isOnDisk("missing"));
+  EXPECT_FALSE(MemoryFs{}.isOnDisk("a"));
+}
+
+TEST(MemoryFsTier, VersionsOfDiskResident) {
+  MemoryFs ms{tieredConfig(0)};
+  const auto version = ms.put("a", File{"a"}, {}).second;
+  ms.migrate(10);
+  ms.migrate(10);
+  ASSERT_EQ(1, ms.getDiskStats().objects);
+
+  // Versions are checked without reading objects back from disk.
+  EXPECT_EQ(Status::PreconditionFailed, ms.put("a", File{"b"}, {false}).first);
+  const auto [status, info] = ms.stat("a");
+  ASSERT_EQ(Status::Success, status);
+  EXPECT_EQ(1, info.size);
+  EXPECT_EQ(1, ms.getDiskStats().objects);
+  EXPECT_EQ(version, std::get<2>(ms.getWithInfo("a")).version);
+  EXPECT_EQ(1, ms.migrate(10).objects_promoted);
+  EXPECT_EQ(info.modified, ms.stat("a").second.modified);
+  EXPECT_EQ(version, std::get<2>(*ms.tryGet("a")).version);
+
+  ms.migrate(10);
+  ms.migrate(10);
+  ASSERT_EQ(1, ms.getDiskStats().objects);
+  EXPECT_EQ(Status::Success, ms.put("a", File{"b"}, {{}, version}).first);
+  EXPECT_EQ(0, ms.getDiskStats().objects);
+  EXPECT_EQ(File{"b"}, ms.get("a").second);
+}
+
+TEST(MemoryFsTier, BackgroundMigrator) {
+  auto config = tieredConfig(0);
+  config.disk.migrate_in_background = true;
+  config.disk.interval = std::chrono::milliseconds{1};
+  MemoryFs ms{config};
+  ASSERT_EQ(Status::Success, ms.add("a", File{"a"}));
+
+  for (int i = 0; (i < 1000) && (ms.getDiskStats().objects == 0); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+
+  EXPECT_EQ(1, ms.getDiskStats().objects);
+  EXPECT_EQ(File{"a"}, ms.get("a").second);
+}
+
+TEST(MemoryFsMutations, SequenceNumbers) {
+  MemoryFs ms{{{}, {}, {}, {16}}};
+  EXPECT_EQ(0, ms.getSequence());
+  ASSERT_EQ(Status::Success, ms.add("a", File{"abc"}));
+  ASSERT_EQ(Status::AlreadyExists, ms.add("a", File{"abc"}));
+  ASSERT_EQ(Status::Success, ms.append("a", File{"de"}));
+  ASSERT_EQ(Status::Success, ms.write("a", 1, File{"X"}));
+  ASSERT_EQ(Status::Success, ms.remove("a"));
+  ASSERT_EQ(Status::FileNotFound, ms.remove("a"));
+  EXPECT_EQ(4, ms.getSequence());
+
+  const auto mutations = ms.getMutations(0, 10, std::chrono::milliseconds{0});
+  ASSERT_TRUE(mutations);
+  ASSERT_EQ(4, mutations->size());
+  EXPECT_EQ(MutationType::Put, (*mutations)[0].type);
+  EXPECT_EQ(File{"abc"}, (*mutations)[0].data);
+  EXPECT_EQ(MutationType::Write, (*mutations)[1].type);
+  EXPECT_EQ(3, (*mutations)[1].offset);
+  EXPECT_EQ(File{"de"}, (*mutations)[1].data);
+  EXPECT_EQ(MutationType::Write, (*mutations)[2].type);
+  EXPECT_EQ(1, (*mutations)[2].offset);
+  EXPECT_EQ(MutationType::Remove, (*mutations)[3].type);
+  EXPECT_EQ("a", (*mutations)[3].path);
+}
+
+TEST(MemoryFsMutations, Replay) {
+  MemoryFs primary{{{}, {}, {}, {16}}};
+  ASSERT_EQ(Status::Success, primary.add("a", File{"abc"}));
+  ASSERT_EQ(Status::Success, primary.append("a", File{"de"}));
+  ASSERT_EQ(Status::Success, primary.add("b", File{"b"}));
+  ASSERT_EQ(Status::Success, primary.write("a", 0, File{"X"}));
+  ASSERT_EQ(Status::Success, primary.remove("b"));
+  ASSERT_EQ(Status::Success, primary.append("c", File{"new"}));
+
+  const auto mutations =
+      primary.getMutations(0, 10, std::chrono::milliseconds{0});
+  ASSERT_TRUE(mutations);
+
+  // Replaying twice gives the same result.
+  MemoryFs replica;
+  for (int i = 0; i < 2; i++) {
+    for (const auto& mutation : *mutations) {
+      replica.apply(mutation);
+    }
+  }
+
+  EXPECT_EQ(6, replica.getSequence());
+  auto files = replica.list();
+  std::sort(files.begin(), files.end());
+  EXPECT_EQ((FileList{"a", "c"}), files);
+  EXPECT_EQ(File{"Xbcde"}, replica.get("a").second);
+  EXPECT_EQ(File{"new"}, replica.get("c").second);
+  EXPECT_EQ(std::get<2>(primary.getWithInfo("c")).version,
+            std::get<2>(replica.getWithInfo("c")).version);
+
+  // Replicas agree on versions.
+  EXPECT_EQ(std::get<2>(primary.getWithInfo("a")).version,
+            std::get<2>(replica.getWithInfo("a")).version);
+}
+
+TEST(MemoryFsMutations, CopyAndRename) {
+  MemoryFs primary{{{}, {}, {}, {16}}};
+  ASSERT_EQ(Status::Success, primary.add("a", File(100, 'a')));
+  ASSERT_EQ(Status::Success, primary.add("t", File{"tiny"}));
+  ASSERT_EQ(Status::Success, primary.copy("a", "b"));
+  ASSERT_EQ(Status::Success, primary.copy("t", "u"));
+  ASSERT_EQ(Status::Success, primary.rename("a", "c"));
+  EXPECT_EQ(6, primary.getSequence());
+
+  const auto mutations =
+      primary.getMutations(0, 10, std::chrono::milliseconds{0});
+  ASSERT_TRUE(mutations);
+
+  MemoryFs replica;
+  for (const auto& mutation : *mutations) {
+    replica.apply(mutation);
+  }
+
+  auto files = replica.list();
+  std::sort(files.begin(), files.end());
+  EXPECT_EQ((FileList{"b", "c", "t", "u"}), files);
+  EXPECT_EQ(File(100, 'a'), replica.get("c").second);
+  EXPECT_EQ(File{"tiny"}, replica.get("u").second);
+}
+
+TEST(MemoryFsMutations, RemovePrefix) {
+  MemoryFs primary{{{}, {}, {}, {16}}};
+  ASSERT_EQ(Status::Success, primary.add("/d/a", File{"a"}));
+  ASSERT_EQ(Status::Success, primary.add("/d/b", File{"b"}));
+  ASSERT_EQ(Status::Success, primary.add("/e", File{"e"}));
+
+  MemoryFs replica;
+  const auto added = primary.getMutations(0, 10, std::chrono::milliseconds{0});
+  ASSERT_TRUE(added);
+  for (const auto& mutation : *added) {
+    replica.apply(mutation);
+  }
+
+  ASSERT_EQ(2, primary.removePrefix("/d/"));
+  EXPECT_EQ(5, primary.getSequence());
+  const auto mutations =
+      primary.getMutations(3, 10, std::chrono::milliseconds{0});
+  ASSERT_TRUE(mutations);
+  for (const auto& mutation : *mutations) {
+    EXPECT_EQ(MutationType::Remove, mutation.type);
+    replica.apply(mutation);
+  }
+
+  EXPECT_EQ(FileList{"/e"}, replica.list());
+}
+
+TEST(MemoryFsMutations, Reset) {
+  MemoryFs ms{{{}, {}, {}, {16}}};
+  ASSERT_EQ(Status::Success, ms.add("a", File{"abc"}));
+
+  ms.reset(7);
+  EXPECT_EQ(7, ms.getSequence());
+  EXPECT_TRUE(ms.list().empty());
+  EXPECT_EQ(0, ms.getMemoryStats().live_bytes);
+
+  // Snapshot objects carry the snapshot sequence number and are not logged.
+  ms.apply({7, MutationType::Put, "b", 0, Object{File{"b"}}});
+  EXPECT_EQ(7, ms.getSequence());
+  ASSERT_TRUE(ms.getMutations(7, 10, std::chrono::milliseconds{0}));
+  EXPECT_TRUE(ms.getMutations(7, 10, std::chrono::milliseconds{0})->empty());
+  EXPECT_EQ(File{"b"}, ms.get("b").second);
+}
+
+/**
+ * \brief Check usage of a directory.
+ *
+ * \param ms Filesystem.
+ * \param directory Directory path.
+ * \param objects Expected number of files.
+ * \param bytes Expected total size of files.
+ */
+void expectUsage(const MemoryFs& ms, const std::string& directory,
+                 std::size_t objects, std::size_t bytes) {
+  const auto usage = ms.getUsage(directory);
+  EXPECT_EQ(objects, usage.objects) << directory;
+  EXPECT_EQ(bytes, usage.bytes) << directory;
+}
+
+TEST(MemoryFsUsage, Mutations) {
+  MemoryFs ms;
+  ASSERT_EQ(Status::Success, ms.add("/team/x/a", File(100, 'a')));
+  ASSERT_EQ(Status::Success, ms.add("/team/y/b", File{"b"}));
+  expectUsage(ms, "/", 2, 101);
+  expectUsage(ms, "/team/x/", 1, 100);
+
+  ASSERT_EQ(Status::Success, ms.put("/team/x/a", File(10, 'a'), {}).first);
+  ASSERT_EQ(Status::Success, ms.append("/team/y/b", File{"cd"}));
+  ASSERT_EQ(Status::Success, ms.append("/team/y/new", File{"e"}));
+  ASSERT_EQ(Status::Success, ms.write("/team/y/b", 2, File{"defg"}));
+  expectUsage(ms, "/team/x/", 1, 10);
+  expectUsage(ms, "/team/y/", 2, 7);
+
+  ASSERT_EQ(Status::Success, ms.copy("/team/x/a", "/team/z/a"));
+  ASSERT_EQ(Status::Success, ms.rename("/team/y/b", "/b"));
+  expectUsage(ms, "/", 4, 27);
+  expectUsage(ms, "/team/", 3, 21);
+  expectUsage(ms, "/team/y/", 1, 1);
+
+  ASSERT_EQ(Status::Success, ms.remove("/b"));
+  EXPECT_EQ(1, ms.removePrefix("/team/y/"));
+  expectUsage(ms, "/", 2, 20);
+  expectUsage(ms, "/team/y/", 0, 0);
+
+  ms.reset(0);
+  expectUsage(ms, "/", 0, 0);
+}
+
+TEST(MemoryFsUsage, DiskResident) {
+  MemoryFs ms{tieredConfig(0)};
+  ASSERT_EQ(Status::Success, ms.add("/d/a", File(100, 'a')));
+  ASSERT_EQ(Status::Success, ms.add("/d/b", File(200, 'b')));
+  ms.migrate(10);
+  ms.migrate(10);
+  ASSERT_EQ(2, ms.getDiskStats().objects);
+  expectUsage(ms, "/d/", 2, 300);
+
+  ASSERT_EQ(Status::Success, ms.put("/d/a", File(50, 'a'), {}).first);
+  ASSERT_EQ(Status::Success, ms.remove("/d/b"));
+  expectUsage(ms, "/d/", 1, 50);
+}
+
+TEST(MemoryFsUsage, Replay) {
+  MemoryFs primary{{{}, {}, {}, {16}}};
+  ASSERT_EQ(Status::Success, primary.add("/d/a", File{"abc"}));
+  ASSERT_EQ(Status::Success, primary.append("/d/a", File{"de"}));
+  ASSERT_EQ(Status::Success, primary.add("/d/b", File{"b"}));
+  ASSERT_EQ(Status::Success, primary.remove("/d/b"));
+
+  MemoryFs replica;
+  const auto mutations =
+      primary.getMutations(0, 10, std::chrono::milliseconds{0});
+  ASSERT_TRUE(mutations);
+  for (const auto& mutation : *mutations) {
+    replica.apply(mutation);
+  }
+
+  // Replays of the same mutations do not count files twice.
+  for (const auto& mutation : *mutations) {
+    replica.apply(mutation);
+  }
+
+  expectUsage(replica, "/d/", 1, 5);
+}
+
+/**
+ * \brief Return configuration of a filesystem keeping a Merkle tree.
+ *
+ * \return Filesystem configuration.
+ */
+MemoryFsConfig merkleConfig() {
+  MemoryFsConfig config;
+  config.merkle.leaves = 64;
+  config.log.max_entries = 64;
+  return config;
+}
+
+/**
+ * \brief Expect a filesystem to have the digests of another one, which
+ * stored its files from scratch.
+ *
+ * \param ms Filesystem to check.
+ */
+void expectDigests(const MemoryFs& ms) {
+  MemoryFs expected{merkleConfig()};
+  for (const auto& path : ms.list()) {
+    ASSERT_EQ(Status::Success, expected.add(path, ms.get(path).second.str()));
+  }
+  EXPECT_EQ(expected.getMerkleNode(1)->digest, ms.getMerkleNode(1)->digest);
+}
+
+TEST(MemoryFsMerkle, Disabled) {
+  MemoryFs ms;
+  EXPECT_FALSE(ms.hasMerkleTree());
+  EXPECT_FALSE(ms.getMerkleNode(1));
+}
+
+TEST(MemoryFsMerkle, Mutations) {
+  MemoryFs ms{merkleConfig()};
+  ASSERT_TRUE(ms.hasMerkleTree());
+  const auto empty = ms.getMerkleNode(1)->digest;
+
+  ASSERT_EQ(Status::Success, ms.add("/a", File(100, 'a')));
+  ASSERT_EQ(Status::Success, ms.add("/b", File{"tiny"}));
+  ASSERT_EQ(Status::Success, ms.append("/b", File(100, 'b')));
+  ASSERT_EQ(Status::Success, ms.append("/c", File{"c"}));
+  ASSERT_EQ(Status::Success, ms.write("/a", 10, File{"xyz"}));
+  ASSERT_EQ(Status::Success, ms.write("/a", 98, File{"past the end"}));
+  ASSERT_EQ(Status::Success, ms.write("/c", 0, File{"cd"}));
+  expectDigests(ms);
+
+  ASSERT_EQ(Status::Success, ms.copy("/a", "/d"));
+  ASSERT_EQ(Status::Success, ms.rename("/b", "/e"));
+  ASSERT_EQ(Status::Success, ms.put("/c", File(200, 'c'), {}).first);
+  expectDigests(ms);
+
+  ASSERT_EQ(Status::Success, ms.remove("/a"));
+  EXPECT_EQ(1, ms.removePrefix("/d"));
+  expectDigests(ms);
+
+  ms.reset(0);
+  EXPECT_EQ(empty, ms.getMerkleNode(1)->digest);
+}
+
+TEST(MemoryFsMerkle, Load) {
+  MemoryFs ms{merkleConfig()};
+  ASSERT_EQ(Status::Success, ms.add("/old", File(100, 'o')));
+
+  // The snapshot replaces all objects at once.
+  ms.load(7, {{7, MutationType::Put, "/d/a", 0, Object{File(100, 'a')}},
+              {7, MutationType::Put, "/t", 0, Object{File{"tiny"}}}});
+  EXPECT_EQ(7, ms.getSequence());
+  auto files = ms.list();
+  std::sort(files.begin(), files.end());
+  EXPECT_EQ((FileList{"/d/a", "/t"}), files);
+  EXPECT_EQ(File(100, 'a'), ms.get("/d/a").second);
+  EXPECT_EQ(File{"tiny"}, ms.get("/t").second);
+  EXPECT_EQ(7, ms.stat("/t").second.version);
+  expectUsage(ms, "/", 2, 104);
+  expectUsage(ms, "/d/", 1, 100);
+  EXPECT_TRUE(ms.getMutations(7, 10, std::chrono::milliseconds{0})->empty());
+  expectDigests(ms);
+}
+
+TEST(MemoryFsMerkle, ConcurrentWrites) {
+  MemoryFs ms{merkleConfig()};
+  ASSERT_EQ(Status::Success, ms.add("/a", File(1000, 'a')));
+
+  // Ranges hashed before a write are stale if another write came first.
+  std::vector<std::thread> writers;
+  for (char character : {'x', 'y', 'z'}) {
+    writers.emplace_back([&ms, character] {
+      for (std::size_t i = 0; i < 200; i++) {
+        EXPECT_EQ(Status::Success,
+                  ms.write("/a", i % 900, File(100, character)));
+      }
+    });
+  }
+  for (auto& writer : writers) {
+    writer.join();
+  }
+
+  expectDigests(ms);
+}
+
+TEST(MemoryFsMerkle, Replay) {
+  MemoryFs primary{merkleConfig()};
+  ASSERT_EQ(Status::Success, primary.add("/a", File(100, 'a')));
+  ASSERT_EQ(Status::Success, primary.append("/a", File{"de"}));
+  ASSERT_EQ(Status::Success, primary.write("/a", 1, File{"fg"}));
+  ASSERT_EQ(Status::Success, primary.add("/b", File{"b"}));
+  ASSERT_EQ(Status::Success, primary.rename("/b", "/c"));
+
+  MemoryFs replica{merkleConfig()};
+  const auto mutations =
+      primary.getMutations(0, 10, std::chrono::milliseconds{0});
+  ASSERT_TRUE(mutations);
+  for (const auto& mutation : *mutations) {
+    replica.apply(mutation);
+  }
+  EXPECT_EQ(primary.getMerkleNode(1)->digest,
+            replica.getMerkleNode(1)->digest);
+
+  // Trees of filesystems which differ lead to the leaf of the difference.
+  ASSERT_EQ(Status::Success, replica.append("/c", File{"!"}));
+  auto node = primary.getMerkleNode(1);
+  while (!node->children.empty()) {
+    const auto other = replica.getMerkleNode(node->index);
+    ASSERT_NE(node->digest, other->digest);
+    node = primary.getMerkleNode(
+        2 * node->index + ((node->children[0] != other->children[0]) ? 0 : 1));
+  }
+  EXPECT_TRUE(std::any_of(node->files.begin(), node->files.end(),
+                          [](const auto& file) { return file.first == "/c"; }));
+}
+
+TEST(MemoryFsReclaimer, Mutations) {
+  MemoryFsConfig config;
+  config.reclaimer.enabled = true;
+  config.reclaimer.bandwidth_budget = 0;
+  MemoryFs ms{config};
+  const File large(1024 * 1024, 'x');
+
+  ASSERT_EQ(Status::Success, ms.add("/a", large));
+  ASSERT_EQ(Status::Success, ms.add("/b", large));
+  ASSERT_EQ(Status::Success, ms.add("/c", large));
+  ASSERT_EQ(Status::Success, ms.put("/a", File{"small"}, {}).first);
+  ASSERT_EQ(Status::Success, ms.write("/b", 0, large));
+  ASSERT_EQ(Status::Success, ms.remove("/c"));
+  ms.drainReclaimer();
+
+  // Replaced and removed objects are freed by the reclaimer.
+  EXPECT_EQ(3, ms.getReclaimerStats().objects_freed);
+  EXPECT_EQ(1, ms.getMemoryStats().regions);
+  EXPECT_EQ(large.size(), ms.getMemoryStats().live_bytes);
+  EXPECT_EQ(large, ms.get("/b").second.str());
+
+  EXPECT_EQ(1, ms.removePrefix("/b"));
+  ms.drainReclaimer();
+  EXPECT_EQ(0, ms.getMemoryStats().regions);
+}
+
+TEST(MemoryFsReclaimer, Replay) {
+  MemoryFsConfig config;
+  config.reclaimer.enabled = true;
+  config.reclaimer.bandwidth_budget = 0;
+  config.log.max_entries = 16;
+  MemoryFs primary{config};
+  const File large(1024 * 1024, 'x');
+  ASSERT_EQ(Status::Success, primary.add("/a", large));
+  ASSERT_EQ(Status::Success, primary.put("/a", large, {}).first);
+  ASSERT_EQ(Status::Success, primary.write("/a", 0, large));
+  ASSERT_EQ(Status::Success, primary.remove("/a"));
+
+  MemoryFs replica{config};
+  const auto mutations =
+      primary.getMutations(0, 10, std::chrono::milliseconds{0});
+  ASSERT_TRUE(mutations);
+  for (const auto& mutation : *mutations) {
+    replica.apply(mutation);
+  }
+  replica.drainReclaimer();
+
+  // Contents are still referenced by the mutation log, only the filesystem's
+  // references are dropped by the reclaimer.
+  EXPECT_EQ(3, replica.getReclaimerStats().objects_freed);
+  EXPECT_EQ(Status::FileNotFound, replica.stat("/a").first);
+}
+
+TEST(MemoryFsChecksum, Record) {
+  MemoryFs ms;
+  const File file(1024, 'x');
+  ASSERT_EQ(Status::Success, ms.put("/a", file, {}).first);
+  EXPECT_FALSE(ms.stat("/a").second.checksum);
+
+  // Checksums are recorded with the version they were computed for.
+  const auto [status, version] = ms.put("/a", file, {}, crc32c(file));
+  ASSERT_EQ(Status::Success, status);
+  EXPECT_EQ(version, ms.stat("/a").second.version);
+  EXPECT_EQ(crc32c(file), ms.stat("/a").second.checksum);
+  EXPECT_EQ(crc32c(file), std::get<FileInfo>(ms.getWithInfo("/a")).checksum);
+  EXPECT_EQ(Status::PreconditionFailed,
+            ms.put("/a", File{"y"}, {false}, crc32c("y")).first);
+  EXPECT_EQ(crc32c(file), ms.stat("/a").second.checksum);
+
+  // Copies and renames keep the checksum, mutations drop it.
+  ASSERT_EQ(Status::Success, ms.copy("/a", "/b"));
+  ASSERT_EQ(Status::Success, ms.rename("/b", "/c"));
+  EXPECT_EQ(crc32c(file), ms.stat("/c").second.checksum);
+  ASSERT_EQ(Status::Success, ms.append("/a", File{"y"}));
+  EXPECT_FALSE(ms.stat("/a").second.checksum);
+  ASSERT_EQ(Status::Success, ms.write("/c", 0, File{"y"}));
+  EXPECT_FALSE(ms.stat("/c").second.checksum);
+}
+
+TEST(MemoryFsChecksum, Verify) {
+  MemoryFsConfig config;
+  config.verify_checksums = true;
+  config.cache.slots = 16;
+  MemoryFs ms{config};
+  const File file(1024, 'x');
+  ASSERT_EQ(Status::Success, ms.put("/a", file, {}, crc32c(file)).first);
+  ASSERT_EQ(Status::Success,
+            ms.put("/tiny", File{"tiny"}, {}, crc32c("tiny")).first);
+  EXPECT_EQ(Status::Success, ms.get("/a").first);
+  EXPECT_EQ(Status::Success, ms.get("/a").first);
+  EXPECT_EQ(Status::Success, ms.get("/tiny").first);
+
+  // Contents which do not match their checksum are reported, cached or not.
+  ASSERT_EQ(Status::Success, ms.put("/a", file, {}, 0).first);
+  EXPECT_EQ(Status::IoError, ms.get("/a").first);
+  EXPECT_EQ(Status::IoError, ms.get("/a").first);
+  const auto read = ms.tryGet("/a");
+  ASSERT_TRUE(read);
+  EXPECT_EQ(Status::IoError, std::get<Status>(*read));
+
+  MemoryFs unverified;
+  ASSERT_EQ(Status::Success, unverified.put("/a", file, {}, 0).first);
+  EXPECT_EQ(Status::Success, unverified.get("/a").first);
+}
+
+TEST(MemoryFsChecksum, Replicated) {
+  MemoryFs primary{{{}, {}, {}, {16}}};
+  const File file(1024, 'x');
+  ASSERT_EQ(Status::Success, primary.put("/a", file, {}, crc32c(file)).first);
+  ASSERT_EQ(Status::Success, primary.copy("/a", "/b"));
+  ASSERT_EQ(Status::Success, primary.rename("/b", "/c"));
+  ASSERT_EQ(Status::Success, primary.put("/d", file, {}).first);
+
+  const auto mutations =
+      primary.getMutations(0, 10, std::chrono::milliseconds{0});
+  ASSERT_TRUE(mutations);
+  MemoryFs replica;
+  for (const auto& mutation : *mutations) {
+    ASSERT_EQ(Status::Success, replica.apply(mutation));
+  }
+
+  std::vector<Mutation> snapshot;
+  for (const auto& path : primary.list()) {
+    auto [status, object, info] = primary.getWithInfo(path);
+    snapshot.push_back({primary.getSequence(), MutationType::Put, path, 0,
+                        std::move(object), info.checksum});
+  }
+  MemoryFs loaded;
+  loaded.load(primary.getSequence(), snapshot);
+
+  // Replicas record the checksums recorded by the primary.
+  for (const auto* ms : {&replica, &loaded}) {
+    EXPECT_EQ(crc32c(file), ms->stat("/a").second.checksum);
+    EXPECT_EQ(crc32c(file), ms->stat("/c").second.checksum);
+    EXPECT_FALSE(ms->stat("/d").second.checksum);
+  }
+}
@@ -0,0 +1,180 @@
+#include "filesystem/memory_fs/src/merkle_tree.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace fs;
+
+namespace {
+
+/**
+ * \brief Find the files which differ between two trees, walking them
+ * top-down.
+ *
+ * \param a First tree.
+ * \param b Second tree (with as many leaves).
+ * \param visited Incremented for every node read from either tree.
+ *
+ * \return Paths listed in a leaf of either tree with a different digest.
+ */
+std::vector<std::string> diff(const MerkleTree& a, const MerkleTree& b,
+                              std::size_t& visited) {
+  std::vector<std::string> paths;
+  std::vector<std::size_t> pending{1};
+  while (!pending.empty()) {
+    const auto index = pending.back();
+    pending.pop_back();
+    const auto left = a.getNode(index);
+    const auto right = b.getNode(index);
+    visited += 2;
+    if (left->digest == right->digest) {
+      continue;
+    }
+
+    if (!left->children.empty()) {
+      pending.push_back(2 * index);
+      pending.push_back(2 * index + 1);
+      continue;
+    }
+
+    for (const auto* files : {&left->files, &right->files}) {
+      for (const auto& file : *files) {
+        const auto& other = (files == &left->files) ? right->files
+                                                    : left->files;
+        if (std::find(other.begin(), other.end(), file) == other.end()) {
+          paths.push_back(file.first);
+        }
+      }
+    }
+  }
+  return paths;
+}
+
+}  // namespace
+
+TEST(ContentHash, Concat) {
+  const std::string data{"hello world"};
+  for (std::size_t split = 0; split <= data.size(); split++) {
+    const auto head = data.substr(0, split);
+    const auto tail = data.substr(split);
+    EXPECT_EQ(hashContents(data),
+              concatHashes(hashContents(head), hashContents(tail),
+                           tail.size()));
+  }
+
+  Object object{std::string{"hello "}};
+  object.append(Object{std::string{"world"}});
+  EXPECT_EQ(hashContents(data), hashContents(object));
+
+  // Leading zero bytes are not lost.
+  EXPECT_NE(hashContents(std::string_view{"\0a", 2}), hashContents("a"));
+}
+
+TEST(ContentHash, Words) {
+  std::string data;
+  for (int i = 0; i < 100; i++) {
+    data += static_cast<char>(i * 37);
+  }
+
+  // Data hashed a word at a time hashes as it does a byte at a time.
+  ContentHash expected{0};
+  for (std::size_t size = 0; size < data.size(); size++) {
+    expected = concatHashes(expected, hashContents(data.substr(size, 1)), 1);
+    ASSERT_EQ(expected, hashContents(data.substr(0, size + 1)));
+  }
+}
+
+TEST(ContentHash, Replace) {
+  const std::string data{"hello world"};
+  const auto hash = hashContents(data);
+
+  // Within the contents.
+  auto written = data;
+  written.replace(6, 3, "WOR");
+  EXPECT_EQ(hashContents(written),
+            replaceHash(hash, hashContents("wor"), 3, hashContents("WOR"), 3,
+                        2));
+
+  // Past the end.
+  written = data.substr(0, 9) + "DS!";
+  EXPECT_EQ(hashContents(written),
+            replaceHash(hash, hashContents("ld"), 2, hashContents("DS!"), 3,
+                        0));
+}
+
+TEST(MerkleTree, Digests) {
+  MerkleTree a{{16}};
+  MerkleTree b{{16}};
+  EXPECT_EQ(a.getRoot(), b.getRoot());
+
+  // Digests do not depend on the order of updates.
+  a.put("/a", hashContents("1"), 1);
+  a.put("/b", hashContents("2"), 1);
+  b.put("/b", hashContents("2"), 1);
+  b.put("/a", hashContents("x"), 1);
+  EXPECT_NE(a.getRoot(), b.getRoot());
+  b.put("/a", hashContents("1"), 1);
+  EXPECT_EQ(a.getRoot(), b.getRoot());
+  EXPECT_EQ(hashContents("1"), a.find("/a"));
+
+  const auto root = a.getRoot();
+  a.put("/c", hashContents(""), 0);
+  EXPECT_NE(root, a.getRoot());
+  a.remove("/c");
+  a.remove("/missing");
+  EXPECT_EQ(root, a.getRoot());
+  EXPECT_FALSE(a.find("/c"));
+
+  a.clear();
+  EXPECT_EQ(MerkleTree{{16}}.getRoot(), a.getRoot());
+}
+
+TEST(MerkleTree, Nodes) {
+  MerkleTree tree{{3}};
+  EXPECT_FALSE(tree.getNode(0));
+  EXPECT_FALSE(tree.getNode(8));
+
+  const auto root = tree.getNode(1);
+  ASSERT_TRUE(root);
+  EXPECT_EQ(2, root->children.size());
+  EXPECT_TRUE(tree.getNode(2)->files.empty());
+
+  // Leaves list their files, sorted by path.
+  std::size_t listed{0};
+  tree.put("/b", hashContents("b"), 1);
+  tree.put("/a", hashContents("a"), 1);
+  for (std::size_t index = 4; index < 8; index++) {
+    const auto leaf = tree.getNode(index);
+    ASSERT_TRUE(leaf->children.empty());
+    EXPECT_TRUE(std::is_sorted(leaf->files.begin(), leaf->files.end()));
+    listed += leaf->files.size();
+  }
+  EXPECT_EQ(2, listed);
+}
+
+TEST(MerkleTree, Diff) {
+  MerkleTree a{{1024}};
+  MerkleTree b{{1024}};
+  for (int i = 0; i < 10000; i++) {
+    const auto path = "/" + std::to_string(i);
+    a.put(path, hashContents(path), path.size());
+    b.put(path, hashContents(path), path.size());
+  }
+
+  std::size_t visited{0};
+  EXPECT_TRUE(diff(a, b, visited).empty());
+  EXPECT_EQ(2, visited);
+
+  // Only the paths to the differing leaves are walked.
+  b.put("/42", hashContents("changed"), 7);
+  b.remove("/4242");
+  a.put("/new", hashContents(""), 0);
+  visited = 0;
+  auto paths = diff(a, b, visited);
+  std::sort(paths.begin(), paths.end());
+  EXPECT_EQ((std::vector<std::string>{"/42", "/42", "/4242", "/new"}), paths);
+  EXPECT_LE(visited, 3 * 2 * 2 * 11);
+}
@@ -0,0 +1,146 @@
+#include "filesystem/memory_fs/src/mutation_log.hpp"
+
+#include <thread>
+
+#include "gtest/gtest.h"
+
+using namespace fs;
+using namespace std::chrono_literals;
+
+/**
+ * \brief Create a mutation with the given sequence number.
+ *
+ * \param sequence Sequence number.
+ * \param data Mutation data.
+ *
+ * \return Put mutation.
+ */
+Mutation put(std::uint64_t sequence, const File& data = "data") {
+  return {sequence, MutationType::Put, "/" + std::to_string(sequence), 0,
+          Object{data}};
+}
+
+TEST(MutationLog, Empty) {
+  MutationLog log{{16}};
+  EXPECT_EQ(0, log.getLastSequence());
+
+  const auto mutations = log.read(0, 10, 0ms);
+  ASSERT_TRUE(mutations);
+  EXPECT_TRUE(mutations->empty());
+}
+
+TEST(MutationLog, Read) {
+  MutationLog log{{16}};
+  for (std::uint64_t i = 1; i <= 5; i++) {
+    log.push(put(i));
+  }
+
+  EXPECT_EQ(5, log.getLastSequence());
+
+  auto mutations = log.read(0, 10, 0ms);
+  ASSERT_TRUE(mutations);
+  ASSERT_EQ(5, mutations->size());
+  EXPECT_EQ(1, mutations->front().sequence);
+  EXPECT_EQ("/1", mutations->front().path);
+  EXPECT_EQ(File{"data"}, mutations->front().data);
+
+  mutations = log.read(3, 1, 0ms);
+  ASSERT_TRUE(mutations);
+  ASSERT_EQ(1, mutations->size());
+  EXPECT_EQ(4, mutations->front().sequence);
+
+  mutations = log.read(5, 10, 0ms);
+  ASSERT_TRUE(mutations);
+  EXPECT_TRUE(mutations->empty());
+}
+
+TEST(MutationLog, TooOld) {
+  MutationLog log{{4}};
+  for (std::uint64_t i = 1; i <= 10; i++) {
+    log.push(put(i));
+  }
+
+  EXPECT_FALSE(log.read(0, 10, 0ms));
+  EXPECT_FALSE(log.read(5, 10, 0ms));
+  ASSERT_TRUE(log.read(6, 10, 0ms));
+  EXPECT_EQ(4, log.read(6, 10, 0ms)->size());
+
+  // Sequence numbers the log never reached are not served either.
+  EXPECT_FALSE(log.read(11, 10, 0ms));
+}
+
+TEST(MutationLog, ByteLimit) {
+  MutationLog log{{100, 100}};
+  log.push(put(1, File(60, 'a')));
+  log.push(put(2, File(60, 'b')));
+
+  EXPECT_FALSE(log.read(0, 10, 0ms));
+  ASSERT_TRUE(log.read(1, 10, 0ms));
+  EXPECT_EQ(1, log.read(1, 10, 0ms)->size());
+}
+
+TEST(MutationLog, Disabled) {
+  MutationLog log;
+  log.push(put(1));
+  EXPECT_EQ(1, log.getLastSequence());
+  EXPECT_FALSE(log.read(0, 10, 0ms));
+  ASSERT_TRUE(log.read(1, 10, 0ms));
+}
+
+TEST(MutationLog, WaitForMutation) {
+  MutationLog log{{16}};
+  std::thread writer{[&log] {
+    std::this_thread::sleep_for(10ms);
+    log.push(put(1));
+  }};
+
+  const auto mutations = log.read(0, 10, 10s);
+  writer.join();
+  ASSERT_TRUE(mutations);
+  ASSERT_EQ(1, mutations->size());
+}
+
+TEST(MutationLog, Reset) {
+  MutationLog log{{16}};
+  log.push(put(1));
+  log.push(put(2));
+
+  log.reset(10);
+  EXPECT_EQ(10, log.getLastSequence());
+  EXPECT_FALSE(log.read(2, 10, 0ms));
+  ASSERT_TRUE(log.read(10, 10, 0ms));
+
+  // Gaps in sequence numbers drop the older mutations.
+  log.push(put(11));
+  log.push(put(20));
+  EXPECT_FALSE(log.read(10, 10, 0ms));
+  ASSERT_TRUE(log.read(19, 10, 0ms));
+  EXPECT_EQ(1, log.read(19, 10, 0ms)->size());
+}
+
+TEST(MutationLog, AsyncWait) {
+  MutationLog log{{16}};
+  int calls{0};
+  log.asyncWait(0, [&calls] { calls++; });
+  EXPECT_EQ(0, calls);
+
+  log.push(put(1));
+  EXPECT_EQ(1, calls);
+  log.push(put(2));
+  EXPECT_EQ(1, calls);
+
+  // Waits for mutations already logged complete right away.
+  log.asyncWait(0, [&calls] { calls++; });
+  EXPECT_EQ(2, calls);
+}
+
+TEST(MutationLog, CancelWait) {
+  MutationLog log{{16}};
+  int calls{0};
+  const auto id = log.asyncWait(0, [&calls] { calls++; });
+  log.asyncWait(0, [&calls] { calls += 10; });
+
+  log.cancelWait(id);
+  log.reset(5);
+  EXPECT_EQ(10, calls);
+}
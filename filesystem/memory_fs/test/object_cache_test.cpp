@@ -0,0 +1,51 @@
+#include "filesystem/memory_fs/src/object_cache.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace fs;
+
+TEST(ObjectCacheTest, Empty) {
+  ObjectCache cache{4};
+  EXPECT_FALSE(cache.find("a", 0, 0));
+  EXPECT_FALSE(cache.find("", 0, 0));
+
+  const auto stats = cache.getStats();
+  EXPECT_EQ(0, stats.hits);
+  EXPECT_EQ(2, stats.misses);
+}
+
+TEST(ObjectCacheTest, Hit) {
+  const File file(100, 'a');
+  const Object object{file};
+  ObjectCache cache{4};
+  cache.insert("a", 1, 7, object, {file.size(), 3, {}});
+
+  const auto cached = cache.find("a", 1, 7);
+  ASSERT_TRUE(cached);
+  EXPECT_EQ(file, cached->first);
+  EXPECT_EQ(3, cached->second.version);
+
+  // Cached objects are private copies.
+  EXPECT_FALSE(cached->first.isSameAs(object));
+  EXPECT_EQ(1, cache.getStats().hits);
+}
+
+TEST(ObjectCacheTest, StaleEpoch) {
+  ObjectCache cache{4};
+  cache.insert("a", 1, 7, Object{File{"a"}}, {1, 3, {}});
+  EXPECT_FALSE(cache.find("a", 1, 8));
+  EXPECT_FALSE(cache.find("a", 1, 6));
+}
+
+TEST(ObjectCacheTest, Eviction) {
+  ObjectCache cache{4};
+  cache.insert("a", 1, 0, Object{File{"a"}}, {1, 1, {}});
+  cache.insert("b", 5, 0, Object{File{"b"}}, {1, 2, {}});
+  cache.insert("c", 2, 0, Object{File{"c"}}, {1, 3, {}});
+
+  // Paths hashed to the same slot evict each other.
+  EXPECT_FALSE(cache.find("a", 1, 0));
+  ASSERT_TRUE(cache.find("b", 5, 0));
+  ASSERT_TRUE(cache.find("c", 2, 0));
+  EXPECT_EQ(File{"c"}, cache.find("c", 2, 0)->first);
+}
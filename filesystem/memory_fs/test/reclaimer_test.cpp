@@ -0,0 +1,96 @@
+#include "filesystem/memory_fs/src/reclaimer.hpp"
+
+#include <chrono>
+#include <string>
+
+#include "filesystem/memory_fs/src/arena.hpp"
+#include "gtest/gtest.h"
+
+using namespace fs;
+
+namespace {
+
+/// Size of test objects, large enough to get arena regions of their own.
+constexpr std::size_t kObjectSize{1024 * 1024};
+
+/**
+ * \brief Allocate a test object in the arena.
+ *
+ * \param arena Arena to allocate from.
+ *
+ * \return Object of kObjectSize bytes.
+ */
+Object allocate(Arena& arena) {
+  const std::string data(kObjectSize, 'x');
+  return arena.allocate(data.data(), data.size());
+}
+
+}  // namespace
+
+TEST(ReclaimerTest, FreesInBackground) {
+  Arena arena;
+  Reclaimer reclaimer{{true, 0}};
+  reclaimer.start();
+
+  reclaimer.retire(allocate(arena));
+  reclaimer.retire(allocate(arena));
+  reclaimer.retire(Object{});
+  reclaimer.drain();
+
+  EXPECT_EQ(0, arena.getStats().regions);
+  const auto stats = reclaimer.getStats();
+  EXPECT_EQ(2, stats.objects_freed);
+  EXPECT_EQ(2 * kObjectSize, stats.bytes_freed);
+  EXPECT_EQ(0, stats.pending_bytes);
+}
+
+TEST(ReclaimerTest, FreedByCaller) {
+  Arena arena;
+
+  // Objects are freed straight away while the reclaimer is not running...
+  Reclaimer stopped{{true, 0}};
+  stopped.retire(allocate(arena));
+  EXPECT_EQ(0, arena.getStats().regions);
+  EXPECT_EQ(0, stopped.getStats().objects_freed);
+
+  // ...and once too many bytes are waiting.
+  Reclaimer full{{true, 0, kObjectSize - 1}};
+  full.start();
+  full.retire(allocate(arena));
+  EXPECT_EQ(0, arena.getStats().regions);
+  EXPECT_EQ(0, full.getStats().objects_freed);
+}
+
+TEST(ReclaimerTest, BandwidthBudget) {
+  Arena arena;
+  Reclaimer reclaimer{{true, 10 * kObjectSize}};
+  reclaimer.start();
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 3; i++) {
+    reclaimer.retire(allocate(arena));
+  }
+  reclaimer.drain();
+
+  // The first two objects are each followed by a pause of 100 ms.
+  EXPECT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds{180});
+  EXPECT_EQ(0, arena.getStats().regions);
+}
+
+TEST(ReclaimerTest, StopFreesPending) {
+  Arena arena;
+  Reclaimer reclaimer{{true, 1}};
+  reclaimer.start();
+  for (int i = 0; i < 4; i++) {
+    reclaimer.retire(allocate(arena));
+  }
+
+  // Stopping does not wait for the budget.
+  const auto start = std::chrono::steady_clock::now();
+  reclaimer.stop();
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::seconds{10});
+  EXPECT_EQ(0, arena.getStats().regions);
+  EXPECT_EQ(4, reclaimer.getStats().objects_freed);
+}
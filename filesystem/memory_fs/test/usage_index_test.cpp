@@ -0,0 +1,66 @@
+#include "filesystem/memory_fs/src/usage_index.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace fs;
+
+TEST(UsageIndex, Empty) {
+  UsageIndex index;
+  EXPECT_EQ(0, index.get("/").objects);
+  EXPECT_EQ(0, index.get("/").bytes);
+  EXPECT_EQ(0, index.size());
+}
+
+TEST(UsageIndex, Directories) {
+  UsageIndex index;
+  index.add("/team/x/a", 10);
+  index.add("/team/x/b", 20);
+  index.add("/team/y/a", 5);
+  index.add("/a", 1);
+
+  EXPECT_EQ(4, index.get("/").objects);
+  EXPECT_EQ(36, index.get("/").bytes);
+  EXPECT_EQ(3, index.get("/team/").objects);
+  EXPECT_EQ(35, index.get("/team/").bytes);
+  EXPECT_EQ(2, index.get("/team/x/").objects);
+  EXPECT_EQ(30, index.get("/team/x/").bytes);
+  EXPECT_EQ(5, index.get("/team/y/").bytes);
+
+  // Only directory paths are tracked, not files or partial names.
+  EXPECT_EQ(0, index.get("/team/x/a").objects);
+  EXPECT_EQ(0, index.get("/team").objects);
+  EXPECT_EQ(0, index.get("/te").objects);
+}
+
+TEST(UsageIndex, Updates) {
+  UsageIndex index;
+  index.add("/team/x/a", 10);
+  index.resize("/team/x/a", 10, 4);
+  EXPECT_EQ(1, index.get("/team/x/").objects);
+  EXPECT_EQ(4, index.get("/team/x/").bytes);
+
+  index.resize("/team/x/a", 4, 100);
+  EXPECT_EQ(100, index.get("/").bytes);
+
+  // Empty directories are dropped.
+  index.add("/team/y/a", 0);
+  EXPECT_EQ(4, index.size());
+  index.remove("/team/x/a", 100);
+  EXPECT_EQ(0, index.get("/team/x/").objects);
+  EXPECT_EQ(0, index.get("/team/x/").bytes);
+  EXPECT_EQ(1, index.get("/team/").objects);
+  EXPECT_EQ(3, index.size());
+
+  index.clear();
+  EXPECT_EQ(0, index.get("/").objects);
+  EXPECT_EQ(0, index.size());
+}
+
+TEST(UsageIndex, RelativePaths) {
+  UsageIndex index;
+  index.add("a", 1);
+  index.add("a/b", 2);
+  EXPECT_EQ(0, index.get("/").objects);
+  EXPECT_EQ(1, index.get("a/").objects);
+  EXPECT_EQ(2, index.get("a/").bytes);
+}
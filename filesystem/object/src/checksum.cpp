@@ -0,0 +1,128 @@
+#include "checksum.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace fs {
+
+namespace {
+
+/// CRC32C polynomial (reversed bit order).
+constexpr Checksum kPolynomial{0x82f63b78};
+
+/// Lookup tables of the software implementation, which consumes 8 bytes at a
+/// time: table[k][byte] is the CRC of the byte followed by k zero bytes.
+using Tables = std::array<std::array<Checksum, 256>, 8>;
+
+/**
+ * \brief Build the lookup tables of the software implementation.
+ *
+ * \return Lookup tables.
+ */
+Tables buildTables() noexcept {
+  Tables tables{};
+  for (Checksum byte = 0; byte < 256; byte++) {
+    auto crc = byte;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ ((crc & 1) ? kPolynomial : 0);
+    }
+    tables[0][byte] = crc;
+  }
+
+  for (std::size_t k = 1; k < tables.size(); k++) {
+    for (std::size_t byte = 0; byte < 256; byte++) {
+      const auto previous = tables[k - 1][byte];
+      tables[k][byte] = (previous >> 8) ^ tables[0][previous & 0xff];
+    }
+  }
+  return tables;
+}
+
+#if defined(__x86_64__)
+/**
+ * \brief Compute the CRC32C of data with the SSE4.2 CRC32 instruction.
+ *
+ * \param data Data to checksum.
+ * \param crc Checksum of the preceding data.
+ *
+ * \return Checksum of the preceding data followed by the given data.
+ */
+__attribute__((target("sse4.2"))) Checksum crc32cHardware(
+    std::string_view data, Checksum crc) noexcept {
+  const auto* bytes = data.data();
+  auto size = data.size();
+  std::uint64_t state = ~crc;
+
+  // Unaligned loads are as fast as aligned ones on the CPUs having SSE4.2.
+  for (; size >= 8; bytes += 8, size -= 8) {
+    std::uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+    state = _mm_crc32_u64(state, word);
+  }
+
+  auto state32 = static_cast<std::uint32_t>(state);
+  for (; size > 0; bytes++, size--) {
+    state32 = _mm_crc32_u8(state32, static_cast<unsigned char>(*bytes));
+  }
+  return ~state32;
+}
+
+/**
+ * \brief Check if the CPU has the SSE4.2 CRC32 instruction.
+ *
+ * \return True if crc32cHardware() can be used, false otherwise.
+ */
+bool hasHardwareCrc() noexcept {
+  static const bool supported = __builtin_cpu_supports("sse4.2");
+  return supported;
+}
+#endif
+
+}  // namespace
+
+Checksum crc32c(std::string_view data, Checksum crc) noexcept {
+#if defined(__x86_64__)
+  if (hasHardwareCrc()) {
+    return crc32cHardware(data, crc);
+  }
+#endif
+  return crc32cSoftware(data, crc);
+}
+
+Checksum crc32c(const Object& object) noexcept {
+  Checksum crc{0};
+  for (const auto& extent : object.getExtents()) {
+    crc = crc32c(extent.view(), crc);
+  }
+  return crc;
+}
+
+Checksum crc32cSoftware(std::string_view data, Checksum crc) noexcept {
+  static const Tables tables = buildTables();
+
+  const auto* bytes = reinterpret_cast<const unsigned char*>(data.data());
+  auto size = data.size();
+  crc = ~crc;
+
+  // Slicing-by-8: the 8 bytes of a word are looked up independently.
+  for (; size >= 8; bytes += 8, size -= 8) {
+    const auto low = crc ^ (Checksum{bytes[0]} | Checksum{bytes[1]} << 8 |
+                            Checksum{bytes[2]} << 16 |
+                            Checksum{bytes[3]} << 24);
+    crc = tables[7][low & 0xff] ^ tables[6][(low >> 8) & 0xff] ^
+          tables[5][(low >> 16) & 0xff] ^ tables[4][low >> 24] ^
+          tables[3][bytes[4]] ^ tables[2][bytes[5]] ^ tables[1][bytes[6]] ^
+          tables[0][bytes[7]];
+  }
+
+  for (; size > 0; bytes++, size--) {
+    crc = (crc >> 8) ^ tables[0][(crc ^ *bytes) & 0xff];
+  }
+  return ~crc;
+}
+
+}  // namespace fs
@@ -0,0 +1,56 @@
+#ifndef FILESYSTEM_OBJECT_SRC_CHECKSUM_HPP
+#define FILESYSTEM_OBJECT_SRC_CHECKSUM_HPP
+
+#include <cstdint>
+#include <string_view>
+
+#include "object.hpp"
+
+namespace fs {
+
+/**
+ * \brief CRC32C (Castagnoli) checksum of file contents.
+ */
+using Checksum = std::uint32_t;
+
+/**
+ * \brief Compute the CRC32C of data, or extend the CRC32C of preceding data.
+ *
+ * Checksums are extended chunk by chunk as data arrives, so that checksumming
+ * takes no pass over the data of its own: crc32c(b, crc32c(a)) equals
+ * crc32c(a + b).
+ *
+ * \note The SSE4.2 CRC32 instruction is used where the CPU supports it,
+ * crc32cSoftware() otherwise.
+ *
+ * \param data Data to checksum.
+ * \param crc Checksum of the preceding data (0 if there is none).
+ *
+ * \return Checksum of the preceding data followed by the given data.
+ */
+[[nodiscard]] Checksum crc32c(std::string_view data,
+                              Checksum crc = 0) noexcept;
+
+/**
+ * \brief Compute the CRC32C of object contents.
+ *
+ * \param object Object to checksum.
+ *
+ * \return Checksum of the object contents.
+ */
+[[nodiscard]] Checksum crc32c(const Object& object) noexcept;
+
+/**
+ * \brief Compute the CRC32C of data without special CPU instructions.
+ *
+ * \param data Data to checksum.
+ * \param crc Checksum of the preceding data (0 if there is none).
+ *
+ * \return Checksum of the preceding data followed by the given data.
+ */
+[[nodiscard]] Checksum crc32cSoftware(std::string_view data,
+                                      Checksum crc = 0) noexcept;
+
+}  // namespace fs
+
+#endif  // FILESYSTEM_OBJECT_SRC_CHECKSUM_HPP
@@ -0,0 +1,125 @@
+#include "object.hpp"
+
+#include <algorithm>
+
+namespace fs {
+
+Object::Object(const File& file) : size_{file.size()} {
+  if (!file.empty()) {
+    // Use the aliasing constructor so that the buffer keeps the file alive.
+    auto copy = std::make_shared<const File>(file);
+    extents_.push_back({Buffer{copy, copy->data()}, copy->size()});
+  }
+}
+
+Object::Object(Buffer buffer, std::size_t size) noexcept : size_{size} {
+  if (size > 0) {
+    extents_.push_back({std::move(buffer), size});
+  }
+}
+
+void Object::append(const Object& tail) {
+  extents_.insert(extents_.end(), tail.extents_.cbegin(),
+                  tail.extents_.cend());
+  size_ += tail.size_;
+}
+
+bool Object::overwrite(std::size_t offset, const Object& data) {
+  if (offset > size_) {
+    return false;
+  }
+
+  if (offset + data.size() >= size_) {
+    truncate(offset);
+    append(data);
+    return true;
+  }
+
+  auto result = slice(0, offset);
+  result.append(data);
+  if (offset + data.size() < size_) {
+    result.append(slice(offset + data.size(), size_));
+  }
+
+  *this = std::move(result);
+  return true;
+}
+
+void Object::truncate(std::size_t size) noexcept {
+  while (size_ > size) {
+    auto& last = extents_.back();
+    const auto excess = std::min(last.size, size_ - size);
+    last.size -= excess;
+    size_ -= excess;
+    if (last.size == 0) {
+      extents_.pop_back();
+    }
+  }
+}
+
+Object Object::slice(std::size_t offset, std::size_t length) const {
+  Object result;
+  length = std::min(length, size_ - std::min(offset, size_));
+
+  for (const auto& extent : extents_) {
+    if (length == 0) {
+      break;
+    }
+
+    if (offset >= extent.size) {
+      offset -= extent.size;
+      continue;
+    }
+
+    // Alias into the extent buffer, so that the slice keeps it alive.
+    const auto slice_size = std::min(length, extent.size - offset);
+    result.extents_.push_back(
+        {Buffer{extent.buffer, extent.buffer.get() + offset}, slice_size});
+    result.size_ += slice_size;
+    length -= slice_size;
+    offset = 0;
+  }
+
+  return result;
+}
+
+bool Object::isSameAs(const Object& other) const noexcept {
+  return std::equal(extents_.cbegin(), extents_.cend(),
+                    other.extents_.cbegin(), other.extents_.cend(),
+                    [](const auto& lhs, const auto& rhs) {
+                      return (lhs.buffer.get() == rhs.buffer.get()) &&
+                             (lhs.size == rhs.size);
+                    });
+}
+
+File Object::str() const {
+  File file;
+  file.reserve(size_);
+  for (const auto& extent : extents_) {
+    file += extent.view();
+  }
+
+  return file;
+}
+
+bool operator==(const Object& object, const File& file) noexcept {
+  if (object.size() != file.size()) {
+    return false;
+  }
+
+  std::size_t offset{0};
+  for (const auto& extent : object.getExtents()) {
+    if (file.compare(offset, extent.size, extent.view()) != 0) {
+      return false;
+    }
+    offset += extent.size;
+  }
+
+  return true;
+}
+
+bool operator==(const File& file, const Object& object) noexcept {
+  return object == file;
+}
+
+}  // namespace fs
@@ -0,0 +1,194 @@
+#ifndef FILESYSTEM_OBJECT_SRC_OBJECT_HPP
+#define FILESYSTEM_OBJECT_SRC_OBJECT_HPP
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs {
+
+/**
+ * \brief File representation.
+ */
+using File = std::string;
+
+/**
+ * \brief Reference-counted, read-only block of memory holding file contents.
+ */
+using Buffer = std::shared_ptr<const char>;
+
+/**
+ * \brief Contiguous part of object contents.
+ */
+struct Extent {
+  Buffer buffer;     ///< Pointer to the first byte of the extent.
+  std::size_t size;  ///< Extent size (in bytes).
+
+  /**
+   * \brief Return a view of the extent contents.
+   *
+   * \return Extent contents.
+   */
+  [[nodiscard]] inline std::string_view view() const noexcept {
+    return {buffer.get(), size};
+  }
+};
+
+/**
+ * \brief List of extents making up object contents.
+ */
+using Extents = std::vector<Extent>;
+
+/**
+ * \brief Stored object (file contents).
+ *
+ * Object contents are a sequence of extents, each referencing a read-only,
+ * reference-counted buffer. Buffers are never modified, so objects are cheap
+ * to copy and modifying an object (append, overwrite) never affects its
+ * copies: only the extents list is changed, the bytes which did not change are
+ * shared rather than copied.
+ *
+ * Buffers stay valid for as long as at least one object references them, even
+ * if the object was removed from (or relocated within) the filesystem in the
+ * meantime.
+ */
+class Object {
+ public:
+  /**
+   * \brief Create an empty object.
+   */
+  Object() noexcept = default;
+
+  /**
+   * \brief Create an object from a copy of the given file.
+   *
+   * \param file File contents.
+   */
+  explicit Object(const File& file);
+
+  /**
+   * \brief Create an object referencing an existing buffer.
+   *
+   * \param buffer Buffer holding the object contents.
+   * \param size Object size (in bytes).
+   */
+  Object(Buffer buffer, std::size_t size) noexcept;
+
+  /**
+   * \brief Return object size.
+   *
+   * \return Object size in bytes.
+   */
+  [[nodiscard]] inline std::size_t size() const noexcept { return size_; }
+
+  /**
+   * \brief Check if the object is empty.
+   *
+   * \return True if object has no contents, false otherwise.
+   */
+  [[nodiscard]] inline bool empty() const noexcept { return size_ == 0; }
+
+  /**
+   * \brief Return the extents making up the object contents.
+   *
+   * \return Object extents (empty objects have no extents).
+   */
+  [[nodiscard]] inline const Extents& getExtents() const noexcept {
+    return extents_;
+  }
+
+  /**
+   * \brief Append contents of another object to this object.
+   *
+   * \note Buffers of the other object are shared, not copied.
+   *
+   * \param tail Object to append.
+   */
+  void append(const Object& tail);
+
+  /**
+   * \brief Overwrite part of this object with contents of another object.
+   *
+   * The object is extended if the overwritten part reaches past its end.
+   * Writes reaching the end of the object (such as appends) only touch its
+   * trailing extents, other writes rebuild the extents list.
+   *
+   * \note Buffers of both objects are shared, not copied.
+   *
+   * \param offset Position of the first byte to overwrite (at most size()).
+   * \param data Object to write at the given position.
+   *
+   * \return True if the object was modified, false if offset is out of range.
+   */
+  bool overwrite(std::size_t offset, const Object& data);
+
+  /**
+   * \brief Drop the contents past the given size.
+   *
+   * \note Only the trailing extents are touched, the cost does not depend on
+   * the object size.
+   *
+   * \param size New object size (objects are never extended).
+   */
+  void truncate(std::size_t size) noexcept;
+
+  /**
+   * \brief Return part of the object.
+   *
+   * \note Buffers of this object are shared, not copied.
+   *
+   * \param offset Position of the first byte.
+   * \param length Maximum number of bytes.
+   *
+   * \return Object holding the given part of this object.
+   */
+  [[nodiscard]] Object slice(std::size_t offset, std::size_t length) const;
+
+  /**
+   * \brief Check if two objects reference exactly the same buffers.
+   *
+   * This is a cheap way to check if an object was changed (or relocated)
+   * since it was copied, without comparing the contents.
+   *
+   * \param other Object to compare with.
+   *
+   * \return True if both objects share all of their extents.
+   */
+  [[nodiscard]] bool isSameAs(const Object& other) const noexcept;
+
+  /**
+   * \brief Copy object contents into a file.
+   *
+   * \return File holding a copy of the object contents.
+   */
+  [[nodiscard]] File str() const;
+
+ private:
+  Extents extents_;     ///< Extents making up the object contents.
+  std::size_t size_{};  ///< Object size (in bytes).
+};
+
+/**
+ * \brief Compare object contents with a file.
+ *
+ * \param object Object to compare.
+ * \param file File to compare.
+ *
+ * \return True if contents are equal, false otherwise.
+ */
+bool operator==(const Object& object, const File& file) noexcept;
+
+/**
+ * \brief Compare object contents with a file.
+ *
+ * \param file File to compare.
+ * \param object Object to compare.
+ *
+ * \return True if contents are equal, false otherwise.
+ */
+bool operator==(const File& file, const Object& object) noexcept;
+
+}  // namespace fs
+
+#endif  // FILESYSTEM_OBJECT_SRC_OBJECT_HPP
@@ -0,0 +1,45 @@
+#include "filesystem/object/src/checksum.hpp"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+using namespace fs;
+
+TEST(ChecksumTest, KnownValues) {
+  EXPECT_EQ(0, crc32c(""));
+  EXPECT_EQ(0xe3069283, crc32c("123456789"));
+  EXPECT_EQ(0x8a9136aa, crc32c(std::string(32, '\0')));
+  EXPECT_EQ(0x62a8ab43, crc32c(std::string(32, '\xff')));
+
+  EXPECT_EQ(0xe3069283, crc32cSoftware("123456789"));
+  EXPECT_EQ(0x8a9136aa, crc32cSoftware(std::string(32, '\0')));
+}
+
+TEST(ChecksumTest, Incremental) {
+  std::string data;
+  for (int i = 0; i < 1000; i++) {
+    data += static_cast<char>(i * 7919);
+  }
+
+  // Chunks of any size and alignment extend the checksum of what precedes.
+  const auto expected = crc32cSoftware(data);
+  for (const std::size_t chunk : {1, 3, 8, 13, 64, 999}) {
+    Checksum crc{0};
+    Checksum software_crc{0};
+    for (std::size_t offset = 0; offset < data.size(); offset += chunk) {
+      const auto part = std::string_view{data}.substr(offset, chunk);
+      crc = crc32c(part, crc);
+      software_crc = crc32cSoftware(part, software_crc);
+    }
+    EXPECT_EQ(expected, crc);
+    EXPECT_EQ(expected, software_crc);
+  }
+}
+
+TEST(ChecksumTest, Object) {
+  Object object{File{"1234"}};
+  object.append(Object{File{"56789"}});
+  EXPECT_EQ(0xe3069283, crc32c(object));
+  EXPECT_EQ(0, crc32c(Object{}));
+}
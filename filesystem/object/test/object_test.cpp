@@ -0,0 +1,152 @@
+#include "filesystem/object/src/object.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace fs;
+
+TEST(ObjectTest, Empty) {
+  Object object;
+  EXPECT_TRUE(object.empty());
+  EXPECT_EQ(0, object.size());
+  EXPECT_TRUE(object.getExtents().empty());
+  EXPECT_EQ(File{}, object.str());
+  EXPECT_TRUE(Object{File{}}.getExtents().empty());
+}
+
+TEST(ObjectTest, FromFile) {
+  const File file{"I like trains"};
+  Object object{file};
+  EXPECT_FALSE(object.empty());
+  EXPECT_EQ(file.size(), object.size());
+  EXPECT_EQ(1, object.getExtents().size());
+  EXPECT_EQ(file, object);
+  EXPECT_EQ(file, object.str());
+}
+
+TEST(ObjectTest, BinaryContents) {
+  const File file{"\0\1\2\0", 4};
+  Object object{file};
+  EXPECT_EQ(4, object.size());
+  EXPECT_EQ(file, object);
+}
+
+TEST(ObjectTest, CopiesShareBuffer) {
+  Object object{File(100, 'x')};
+  const auto copy = object;
+  EXPECT_TRUE(object.isSameAs(copy));
+  EXPECT_EQ(2, object.getExtents().front().buffer.use_count());
+  EXPECT_FALSE(object.isSameAs(Object{File(100, 'x')}));
+}
+
+TEST(ObjectTest, OutlivesOriginal) {
+  Object copy;
+  {
+    Object object{File{"short lived"}};
+    copy = object;
+  }
+  EXPECT_EQ(File{"short lived"}, copy);
+}
+
+TEST(ObjectTest, ExternalBuffer) {
+  auto memory = std::shared_ptr<char>(new char[3]{'a', 'b', 'c'},
+                                      std::default_delete<char[]>());
+  Object object{memory, 2};
+  EXPECT_EQ(File{"ab"}, object);
+  EXPECT_EQ(memory.get(), object.getExtents().front().buffer.get());
+}
+
+TEST(ObjectTest, Append) {
+  Object object{File{"Hello"}};
+  const auto original = object;
+  object.append(Object{File{", "}});
+  object.append(Object{});
+  object.append(Object{File{"world"}});
+
+  EXPECT_EQ(File{"Hello, world"}, object);
+  EXPECT_EQ(12, object.size());
+  EXPECT_EQ(3, object.getExtents().size());
+
+  // Existing contents are shared, copies are not affected.
+  EXPECT_EQ(original.getExtents().front().buffer.get(),
+            object.getExtents().front().buffer.get());
+  EXPECT_EQ(File{"Hello"}, original);
+}
+
+TEST(ObjectTest, Slice) {
+  Object object{File{"abc"}};
+  object.append(Object{File{"defg"}});
+  object.append(Object{File{"hi"}});
+
+  EXPECT_EQ(File{"abcdefghi"}, object.slice(0, 100));
+  EXPECT_EQ(File{"cdefgh"}, object.slice(2, 6));
+  EXPECT_EQ(File{"e"}, object.slice(4, 1));
+  EXPECT_EQ(File{"hi"}, object.slice(7, 2));
+  EXPECT_TRUE(object.slice(9, 1).empty());
+  EXPECT_TRUE(object.slice(100, 1).empty());
+  EXPECT_TRUE(object.slice(3, 0).empty());
+  EXPECT_EQ(2, object.slice(2, 3).getExtents().size());
+}
+
+TEST(ObjectTest, Overwrite) {
+  Object object{File{"0123456789"}};
+  const auto original = object;
+
+  EXPECT_TRUE(object.overwrite(2, Object{File{"ab"}}));
+  EXPECT_EQ(File{"01ab456789"}, object);
+  EXPECT_TRUE(object.overwrite(0, Object{File{"X"}}));
+  EXPECT_EQ(File{"X1ab456789"}, object);
+  EXPECT_TRUE(object.overwrite(8, Object{File{"YZW"}}));
+  EXPECT_EQ(File{"X1ab4567YZW"}, object);
+  EXPECT_TRUE(object.overwrite(11, Object{File{"!"}}));
+  EXPECT_EQ(File{"X1ab4567YZW!"}, object);
+  EXPECT_FALSE(object.overwrite(13, Object{File{"?"}}));
+  EXPECT_EQ(File{"X1ab4567YZW!"}, object);
+  EXPECT_EQ(File{"0123456789"}, original);
+}
+
+TEST(ObjectTest, OverwriteTail) {
+  Object object{File{"abc"}};
+  object.append(Object{File{"def"}});
+  const auto head = object.getExtents().front().buffer.get();
+
+  // Writes reaching the end keep the extents before them.
+  EXPECT_TRUE(object.overwrite(4, Object{File{"EFG"}}));
+  EXPECT_EQ(File{"abcdEFG"}, object);
+  EXPECT_EQ(3, object.getExtents().size());
+  EXPECT_EQ(head, object.getExtents().front().buffer.get());
+}
+
+TEST(ObjectTest, Truncate) {
+  Object object{File{"abc"}};
+  object.append(Object{File{"def"}});
+  const auto copy = object;
+
+  object.truncate(4);
+  EXPECT_EQ(File{"abcd"}, object);
+  EXPECT_EQ(2, object.getExtents().size());
+  object.truncate(3);
+  EXPECT_EQ(File{"abc"}, object);
+  EXPECT_EQ(1, object.getExtents().size());
+  object.truncate(10);
+  EXPECT_EQ(File{"abc"}, object);
+  object.truncate(0);
+  EXPECT_TRUE(object.empty());
+  EXPECT_TRUE(object.getExtents().empty());
+  EXPECT_EQ(File{"abcdef"}, copy);
+}
+
+TEST(ObjectTest, OverwriteEmpty) {
+  Object object;
+  EXPECT_TRUE(object.overwrite(0, Object{File{"new"}}));
+  EXPECT_EQ(File{"new"}, object);
+  EXPECT_FALSE(Object{}.overwrite(1, Object{File{"new"}}));
+}
+
+TEST(ObjectTest, Compare) {
+  Object object{File{"ab"}};
+  object.append(Object{File{"cd"}});
+  EXPECT_EQ(File{"abcd"}, object);
+  EXPECT_FALSE(File{"abce"} == object);
+  EXPECT_FALSE(File{"abc"} == object);
+  EXPECT_FALSE(File{"abcde"} == object);
+}
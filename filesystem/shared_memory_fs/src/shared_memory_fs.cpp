@@ -0,0 +1,1218 @@
+#include "shared_memory_fs.hpp"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace fs {
+
+namespace {
+
+/// Marks a formatted segment ("SHMFS" and a format number).
+constexpr std::uint64_t kMagic{0x53484d4653000003};
+
+/// File contents up to this size are copied in and out of the segment under
+/// the mutex, larger ones with the mutex released.
+constexpr std::size_t kMaxLockedCopySize{64 * 1024};
+
+/// Number of heap free lists, one per power-of-two size class.
+constexpr std::size_t kSizeClasses{64};
+
+/// Alignment (and size granularity) of heap blocks.
+constexpr std::uint64_t kBlockAlignment{16};
+
+/// Heap block boundary tag size (header and footer are one word each).
+constexpr std::uint64_t kTagSize{sizeof(std::uint64_t)};
+
+/// Smallest heap block: tags, plus free list links while it is free.
+constexpr std::uint64_t kMinBlockSize{4 * kTagSize};
+
+/// Header flag of free heap blocks (block sizes are multiples of 16).
+constexpr std::uint64_t kFreeFlag{1};
+
+/// How long attaching waits for another process to format the segment.
+constexpr std::chrono::seconds kFormatTimeout{1};
+
+/**
+ * \brief Round a number up to a multiple of another.
+ *
+ * \param value Number to round.
+ * \param multiple Power of two.
+ *
+ * \return Rounded number.
+ */
+constexpr std::uint64_t roundUp(std::uint64_t value,
+                                std::uint64_t multiple) noexcept {
+  return (value + multiple - 1) & ~(multiple - 1);
+}
+
+/**
+ * \brief Return size class of a heap block.
+ *
+ * \param size Block size (non-zero).
+ *
+ * \return Binary logarithm of the size, rounded down.
+ */
+std::size_t getSizeClass(std::uint64_t size) noexcept {
+  return 63 - __builtin_clzll(size);
+}
+
+/**
+ * \brief Hash a path (FNV-1a), the same way in every process.
+ *
+ * \param path Path to hash.
+ *
+ * \return Non-zero hash (zero marks free index slots).
+ */
+std::uint64_t hashPath(std::string_view path) noexcept {
+  std::uint64_t hash{0xcbf29ce484222325};
+  for (const auto character : path) {
+    hash ^= static_cast<unsigned char>(character);
+    hash *= 0x100000001b3;
+  }
+
+  return (hash == 0) ? 1 : hash;
+}
+
+/**
+ * \brief Find the entry with the given path in an open-addressing table.
+ *
+ * \tparam Entry Table entry type (with hash, path and path_size fields).
+ *
+ * \param table First entry of the table.
+ * \param capacity Number of entries (a power of two).
+ * \param base Address of the segment.
+ * \param path Path to look up.
+ *
+ * \return Entry number, or nothing if there is no such entry.
+ */
+template <typename Entry>
+std::optional<std::uint64_t> findEntry(const Entry* table,
+                                       std::uint64_t capacity,
+                                       const char* base,
+                                       std::string_view path) noexcept {
+  const auto hash = hashPath(path);
+  const auto mask = capacity - 1;
+  for (auto index = hash & mask;; index = (index + 1) & mask) {
+    const auto& entry = table[index];
+    if (entry.hash == 0) {
+      return std::nullopt;
+    }
+    if ((entry.hash == hash) && (entry.path_size == path.size()) &&
+        (std::memcmp(base + entry.path, path.data(), path.size()) == 0)) {
+      return index;
+    }
+  }
+}
+
+/**
+ * \brief Return the first free entry of the probe sequence of a path hash.
+ *
+ * \note The table must have a free entry.
+ *
+ * \tparam Entry Table entry type (with a hash field).
+ *
+ * \param table First entry of the table.
+ * \param capacity Number of entries (a power of two).
+ * \param hash Path hash.
+ *
+ * \return Entry number.
+ */
+template <typename Entry>
+std::uint64_t findFreeEntry(const Entry* table, std::uint64_t capacity,
+                            std::uint64_t hash) noexcept {
+  const auto mask = capacity - 1;
+  auto index = hash & mask;
+  while (table[index].hash != 0) {
+    index = (index + 1) & mask;
+  }
+
+  return index;
+}
+
+/**
+ * \brief Free an entry of an open-addressing table.
+ *
+ * Entries further along the probe sequence are shifted back into the hole,
+ * unless their home entry lies after it.
+ *
+ * \tparam Entry Table entry type (with a hash field).
+ *
+ * \param table First entry of the table.
+ * \param capacity Number of entries (a power of two).
+ * \param index Entry number.
+ */
+template <typename Entry>
+void eraseEntry(Entry* table, std::uint64_t capacity,
+                std::uint64_t index) noexcept {
+  const auto mask = capacity - 1;
+  auto hole = index;
+  for (auto next = (index + 1) & mask; table[next].hash != 0;
+       next = (next + 1) & mask) {
+    const auto home = table[next].hash & mask;
+    const auto stays = (hole <= next) ? ((hole < home) && (home <= next))
+                                      : ((hole < home) || (home <= next));
+    if (!stays) {
+      table[hole] = table[next];
+      hole = next;
+    }
+  }
+
+  table[hole] = Entry{};
+}
+
+/**
+ * \brief Copy data out of the segment into an object.
+ *
+ * \param data Data to copy.
+ *
+ * \return Object holding a private copy of the data.
+ */
+Object copyOut(std::string_view data) {
+  if (data.empty()) {
+    return {};
+  }
+
+  std::shared_ptr<char> buffer{new char[data.size()],
+                               std::default_delete<char[]>()};
+  std::memcpy(buffer.get(), data.data(), data.size());
+  return {Buffer{std::move(buffer)}, data.size()};
+}
+
+/**
+ * \brief Return current time.
+ *
+ * \return Nanoseconds since the epoch of the system clock.
+ */
+std::int64_t now() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+/**
+ * \brief Segment header.
+ */
+struct SharedMemoryFs::Header {
+  std::atomic<std::uint64_t> magic;  ///< kMagic, once formatted.
+  std::uint64_t size;                ///< Segment size.
+  std::uint64_t index;               ///< Offset of the index.
+  std::uint64_t capacity;            ///< Index slots (a power of two).
+  std::uint64_t directories;         ///< Offset of the directory table.
+  std::uint64_t directory_count;     ///< Number of directories.
+  std::uint64_t max_objects;         ///< Maximum number of files.
+  std::uint64_t count;               ///< Number of files.
+  std::uint64_t next_version;        ///< Version of the next mutation.
+  std::uint64_t heap_begin;          ///< Offset of the first heap block.
+  std::uint64_t heap_top;            ///< End of the heap blocks in use.
+  std::uint64_t heap_end;            ///< End of the heap.
+  std::uint64_t used;                ///< Bytes of allocated heap blocks.
+
+  /// First free block of each size class (0 if none).
+  std::uint64_t free_lists[kSizeClasses];
+
+  bool dirty;    ///< The mutex is held by a mutation.
+  bool damaged;  ///< A process died in the middle of a mutation.
+
+  /// The directory table ran out of room, usage is no longer kept.
+  bool usage_dropped;
+
+  pthread_mutex_t mutex;  ///< Serializes all operations (process-shared).
+};
+
+/**
+ * \brief Index slot.
+ */
+struct SharedMemoryFs::Slot {
+  std::uint64_t hash;       ///< Path hash (0 if the slot is free).
+  std::uint64_t path;       ///< Offset of the path.
+  std::uint64_t path_size;  ///< Path length.
+
+  /// Offset of the file contents (0 if the file is empty). Contents start
+  /// with their reference count.
+  std::uint64_t data;
+  std::uint64_t size;       ///< File size.
+  std::uint64_t version;    ///< File version.
+  std::int64_t modified;    ///< Time of the last modification (ns).
+};
+
+/**
+ * \brief Directory table entry.
+ */
+struct SharedMemoryFs::Directory {
+  std::uint64_t hash;       ///< Path hash (0 if the entry is free).
+  std::uint64_t path;       ///< Offset of the path (ending with '/').
+  std::uint64_t path_size;  ///< Path length.
+  std::uint64_t objects;    ///< Number of files under the directory.
+  std::uint64_t bytes;      ///< Total size of the files.
+};
+
+/**
+ * \brief Scoped lock of the segment mutex.
+ */
+class SharedMemoryFs::Lock {
+ public:
+  /**
+   * \brief Lock the mutex (see lock()).
+   *
+   * \param header Header of the segment.
+   * \param mutation True if the segment is modified under the lock.
+   */
+  Lock(Header& header, bool mutation) noexcept : header_{header} {
+    lock(mutation);
+  }
+
+  ~Lock() {
+    if (locked_) {
+      unlock();
+    }
+  }
+
+  Lock(const Lock& other) = delete;
+  Lock(Lock&& other) = delete;
+  Lock& operator=(const Lock& other) = delete;
+  Lock& operator=(Lock&&) = delete;
+
+  /**
+   * \brief Lock the mutex, taking it over if its owner died.
+   *
+   * The segment is marked damaged if the owner died in the middle of a
+   * mutation.
+   *
+   * \param mutation True if the segment is modified under the lock.
+   */
+  void lock(bool mutation) noexcept {
+    if (pthread_mutex_lock(&header_.mutex) == EOWNERDEAD) {
+      header_.damaged = header_.damaged || header_.dirty;
+      pthread_mutex_consistent(&header_.mutex);
+    }
+
+    header_.dirty = mutation;
+    locked_ = true;
+  }
+
+  /**
+   * \brief Unlock the mutex.
+   */
+  void unlock() noexcept {
+    header_.dirty = false;
+    pthread_mutex_unlock(&header_.mutex);
+    locked_ = false;
+  }
+
+  /**
+   * \brief Check if the segment was damaged by a process dying.
+   *
+   * \return True if the segment is damaged, false otherwise.
+   */
+  [[nodiscard]] bool isDamaged() const noexcept { return header_.damaged; }
+
+ private:
+  Header& header_;      ///< Header of the locked segment.
+  bool locked_{false};  ///< The mutex is held.
+};
+
+SharedMemoryFs::SharedMemoryFs(const SharedMemoryFsConfig& config)
+    : name_{config.name},
+      upload_timeout_{config.upload_timeout},
+      upload_ids_{std::random_device{}()} {
+  auto descriptor = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  creator_ = descriptor >= 0;
+  if (!creator_ && (errno == EEXIST)) {
+    descriptor = shm_open(name_.c_str(), O_RDWR, 0);
+  }
+  if (descriptor < 0) {
+    throw std::runtime_error("Failed to open shared memory " + name_ + ": " +
+                             std::strerror(errno));
+  }
+
+  // The creator sizes the segment right after creating it.
+  size_ = config.size;
+  const auto deadline = std::chrono::steady_clock::now() + kFormatTimeout;
+  if (creator_ && (ftruncate(descriptor, static_cast<off_t>(size_)) != 0)) {
+    size_ = 0;
+  }
+  while (!creator_) {
+    struct stat status {};
+    if (fstat(descriptor, &status) != 0) {
+      size_ = 0;
+      break;
+    }
+    size_ = static_cast<std::size_t>(status.st_size);
+    if ((size_ > 0) || (std::chrono::steady_clock::now() >= deadline)) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+
+  if (size_ >= sizeof(Header)) {
+    auto* const address = mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                               MAP_SHARED, descriptor, 0);
+    base_ = (address != MAP_FAILED) ? static_cast<char*>(address) : nullptr;
+  }
+  close(descriptor);
+
+  try {
+    if (base_ == nullptr) {
+      throw std::runtime_error("Failed to map shared memory " + name_);
+    }
+
+    if (creator_) {
+      format(config.size, config.max_objects);
+    }
+
+    while (header().magic.load(std::memory_order_acquire) != kMagic) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        throw std::runtime_error("Not a filesystem segment: " + name_);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    if (header().size != size_) {
+      throw std::runtime_error("Inconsistent filesystem segment: " + name_);
+    }
+
+    if (Lock lock(header(), false); lock.isDamaged()) {
+      throw std::runtime_error("Damaged filesystem segment: " + name_);
+    }
+  } catch (...) {
+    if (base_ != nullptr) {
+      munmap(base_, size_);
+    }
+    if (creator_) {
+      shm_unlink(name_.c_str());
+    }
+    throw;
+  }
+}
+
+SharedMemoryFs::~SharedMemoryFs() { munmap(base_, size_); }
+
+std::pair<Status, Object> SharedMemoryFs::get(
+    const std::string& path) const noexcept {
+  auto [status, file, info] = getWithInfo(path);
+  return {status, std::move(file)};
+}
+
+std::tuple<Status, Object, FileInfo> SharedMemoryFs::getWithInfo(
+    const std::string& path) const noexcept {
+  Lock lock(header(), false);
+  if (lock.isDamaged()) {
+    return {Status::IoError, {}, {}};
+  }
+
+  const auto index = find(path);
+  if (!index) {
+    return {Status::FileNotFound, {}, {}};
+  }
+
+  const auto current = contents(*index);
+  if (current.size() <= kMaxLockedCopySize) {
+    return {Status::Success, copyOut(current), info(*index)};
+  }
+
+  // Large contents are copied with the mutex released, pinned by a reference.
+  const auto file_info = info(*index);
+  const auto pinned = slot(*index).data;
+  pin(pinned);
+  lock.unlock();
+  auto object = copyOut(current);
+  lock.lock(true);
+
+  // Dropping the reference frees the contents if the file was modified.
+  const_cast<SharedMemoryFs*>(this)->release(pinned);
+  return {Status::Success, std::move(object), file_info};
+}
+
+std::pair<Status, FileInfo> SharedMemoryFs::stat(
+    const std::string& path) const noexcept {
+  Lock lock(header(), false);
+  if (lock.isDamaged()) {
+    return {Status::IoError, {}};
+  }
+
+  const auto index = find(path);
+  if (!index) {
+    return {Status::FileNotFound, {}};
+  }
+
+  return {Status::Success, info(*index)};
+}
+
+Status SharedMemoryFs::add(const std::string& path,
+                           const File& file) noexcept {
+  Lock lock(header(), true);
+  if (lock.isDamaged()) {
+    return Status::IoError;
+  }
+
+  if (find(path)) {
+    return Status::AlreadyExists;
+  }
+
+  const auto data = store(lock, {file});
+  if (!data) {
+    return Status::IoError;
+  }
+
+  // The file may have been added while the contents were copied.
+  if (find(path)) {
+    release(*data);
+    return Status::AlreadyExists;
+  }
+
+  return insert(path, *data, file.size()) ? Status::Success : Status::IoError;
+}
+
+std::pair<Status, Version> SharedMemoryFs::put(
+    const std::string& path, const File& file,
+    const Precondition& precondition, std::optional<Checksum>) noexcept {
+  Lock lock(header(), true);
+  if (lock.isDamaged()) {
+    return {Status::IoError, 0};
+  }
+
+  auto index = find(path);
+  if (!satisfies(precondition, index ? std::optional{slot(*index).version}
+                                     : std::nullopt)) {
+    return {Status::PreconditionFailed, 0};
+  }
+
+  const auto data = store(lock, {file});
+  if (!data) {
+    return {Status::IoError, 0};
+  }
+
+  // The file may have been modified while the contents were copied.
+  index = find(path);
+  if (!satisfies(precondition, index ? std::optional{slot(*index).version}
+                                     : std::nullopt)) {
+    release(*data);
+    return {Status::PreconditionFailed, 0};
+  }
+
+  if (index) {
+    return {Status::Success, replace(*index, *data, file.size())};
+  }
+
+  const auto version = insert(path, *data, file.size());
+  return version ? std::pair{Status::Success, *version}
+                 : std::pair{Status::IoError, Version{0}};
+}
+
+UploadId SharedMemoryFs::createUpload(const std::string& path) noexcept {
+  std::scoped_lock lock(upload_mutex_);
+
+  UploadId upload{0};
+  while ((upload == 0) || (uploads_.count(upload) > 0)) {
+    upload = upload_ids_();
+  }
+
+  uploads_.emplace(upload,
+                   Upload{path, {}, std::chrono::steady_clock::now()});
+  return upload;
+}
+
+Status SharedMemoryFs::uploadPart(UploadId upload, const std::string& path,
+                                  std::size_t number,
+                                  const File& data) noexcept {
+  if ((number == 0) || (number > kMaxUploadParts)) {
+    return Status::InvalidRange;
+  }
+
+  // A replaced part is freed once the lock is released.
+  File replaced;
+  {
+    std::scoped_lock lock(upload_mutex_);
+
+    const auto found = uploads_.find(upload);
+    if ((found == uploads_.end()) || (found->second.path != path)) {
+      return Status::FileNotFound;
+    }
+
+    auto& current = found->second.parts[number];
+    replaced = std::move(current);
+    current = data;
+    found->second.last_activity = std::chrono::steady_clock::now();
+  }
+
+  return Status::Success;
+}
+
+std::pair<Status, Version> SharedMemoryFs::completeUpload(
+    UploadId upload, const std::string& path,
+    const Precondition& precondition) noexcept {
+  Upload completed;
+  {
+    std::scoped_lock lock(upload_mutex_);
+
+    const auto found = uploads_.find(upload);
+    if ((found == uploads_.end()) || (found->second.path != path)) {
+      return {Status::FileNotFound, 0};
+    }
+
+    completed = std::move(found->second);
+    uploads_.erase(found);
+  }
+
+  File file;
+  for (const auto& [number, part] : completed.parts) {
+    file += part;
+  }
+
+  const auto result = put(path, file, precondition);
+
+  // The client may retry with another precondition.
+  if (result.first != Status::Success) {
+    completed.last_activity = std::chrono::steady_clock::now();
+
+    std::scoped_lock lock(upload_mutex_);
+    uploads_.emplace(upload, std::move(completed));
+  }
+
+  return result;
+}
+
+Status SharedMemoryFs::abortUpload(UploadId upload,
+                                   const std::string& path) noexcept {
+  // Parts are freed once the lock is released.
+  Upload aborted;
+  {
+    std::scoped_lock lock(upload_mutex_);
+
+    const auto found = uploads_.find(upload);
+    if ((found == uploads_.end()) || (found->second.path != path)) {
+      return Status::FileNotFound;
+    }
+
+    aborted = std::move(found->second);
+    uploads_.erase(found);
+  }
+
+  return Status::Success;
+}
+
+std::size_t SharedMemoryFs::expireUploads() {
+  const auto deadline = std::chrono::steady_clock::now() - upload_timeout_;
+
+  // Parts are freed once the lock is released.
+  std::vector<Upload> expired;
+  {
+    std::scoped_lock lock(upload_mutex_);
+
+    for (auto upload = uploads_.begin(); upload != uploads_.end();) {
+      if (upload->second.last_activity <= deadline) {
+        expired.push_back(std::move(upload->second));
+        upload = uploads_.erase(upload);
+      } else {
+        upload++;
+      }
+    }
+  }
+
+  return expired.size();
+}
+
+Status SharedMemoryFs::append(const std::string& path,
+                              const File& data) noexcept {
+  Lock lock(header(), true);
+  if (lock.isDamaged()) {
+    return Status::IoError;
+  }
+
+  // Contents may be shared with copies, so they are never extended in place.
+  // Large contents are copied with the mutex released (the current ones
+  // pinned by a reference), so they are stored again if the file was
+  // modified in the meantime.
+  while (true) {
+    const auto index = find(path);
+    const auto version = index ? slot(*index).version : Version{0};
+    const auto pinned = index ? slot(*index).data : std::uint64_t{0};
+    const auto current = index ? contents(*index) : std::string_view{};
+    pin(pinned);
+    const auto stored = store(lock, {current, data});
+    release(pinned);
+    if (!stored) {
+      return Status::IoError;
+    }
+
+    const auto stored_index = find(path);
+    if (!index && !stored_index) {
+      return insert(path, *stored, data.size()) ? Status::Success
+                                                : Status::IoError;
+    }
+    if (index && stored_index && (slot(*stored_index).version == version)) {
+      replace(*stored_index, *stored, current.size() + data.size());
+      return Status::Success;
+    }
+
+    release(*stored);
+  }
+}
+
+Status SharedMemoryFs::write(const std::string& path, std::size_t offset,
+                             const File& data) noexcept {
+  Lock lock(header(), true);
+  if (lock.isDamaged()) {
+    return Status::IoError;
+  }
+
+  // Stored again if the file was modified while the contents were copied
+  // (see append()).
+  while (true) {
+    const auto index = find(path);
+    if (!index) {
+      return Status::FileNotFound;
+    }
+
+    const auto current = contents(*index);
+    if (offset > current.size()) {
+      return Status::InvalidRange;
+    }
+
+    const auto version = slot(*index).version;
+    const auto pinned = slot(*index).data;
+    const auto end = offset + data.size();
+    const auto tail =
+        (end < current.size()) ? current.substr(end) : std::string_view{};
+    pin(pinned);
+    const auto stored = store(lock, {current.substr(0, offset), data, tail});
+    release(pinned);
+    if (!stored) {
+      return Status::IoError;
+    }
+
+    const auto stored_index = find(path);
+    if (stored_index && (slot(*stored_index).version == version)) {
+      replace(*stored_index, *stored, std::max(end, current.size()));
+      return Status::Success;
+    }
+
+    release(*stored);
+  }
+}
+
+FileList SharedMemoryFs::list() const noexcept {
+  FileList list;
+  Lock lock(header(), false);
+  if (lock.isDamaged()) {
+    return list;
+  }
+
+  list.reserve(header().count);
+  for (std::uint64_t index = 0; index < header().capacity; index++) {
+    const auto& file = slot(index);
+    if (file.hash != 0) {
+      list.emplace_back(at(file.path), file.path_size);
+    }
+  }
+
+  return list;
+}
+
+Usage SharedMemoryFs::getUsage(const std::string& directory) const noexcept {
+  Usage usage;
+  Lock lock(header(), false);
+  if (lock.isDamaged()) {
+    return usage;
+  }
+
+  if (!header().usage_dropped) {
+    const auto found = findEntry(&this->directory(0), header().capacity,
+                                 base_, directory);
+    if (found) {
+      usage.objects = this->directory(*found).objects;
+      usage.bytes = this->directory(*found).bytes;
+    }
+    return usage;
+  }
+
+  for (std::uint64_t index = 0; index < header().capacity; index++) {
+    const auto& file = slot(index);
+    if ((file.hash != 0) &&
+        (std::string_view{at(file.path), file.path_size}.substr(
+             0, directory.size()) == directory)) {
+      usage.objects++;
+      usage.bytes += file.size;
+    }
+  }
+
+  return usage;
+}
+
+Status SharedMemoryFs::remove(const std::string& path) noexcept {
+  return remove(path, Precondition{});
+}
+
+Status SharedMemoryFs::remove(const std::string& path,
+                              const Precondition& precondition) noexcept {
+  const auto conditional = precondition.exists || precondition.version;
+
+  Lock lock(header(), true);
+  if (lock.isDamaged()) {
+    return Status::IoError;
+  }
+
+  const auto index = find(path);
+  if (conditional &&
+      !satisfies(precondition, index ? std::optional{slot(*index).version}
+                                     : std::nullopt)) {
+    return Status::PreconditionFailed;
+  }
+  if (!index) {
+    return Status::FileNotFound;
+  }
+
+  erase(*index);
+  return Status::Success;
+}
+
+std::size_t SharedMemoryFs::removePrefix(const std::string& prefix) noexcept {
+  Lock lock(header(), true);
+  if (lock.isDamaged()) {
+    return 0;
+  }
+
+  // Removing files moves other files within the index, so matching paths are
+  // collected first.
+  FileList paths;
+  for (std::uint64_t index = 0; index < header().capacity; index++) {
+    const auto& file = slot(index);
+    const std::string_view path{at(file.path), file.path_size};
+    if ((file.hash != 0) && (path.substr(0, prefix.size()) == prefix)) {
+      paths.emplace_back(path);
+    }
+  }
+
+  for (const auto& path : paths) {
+    erase(*find(path));
+  }
+
+  return paths.size();
+}
+
+Status SharedMemoryFs::copy(const std::string& source,
+                            const std::string& destination) noexcept {
+  Lock lock(header(), true);
+  if (lock.isDamaged()) {
+    return Status::IoError;
+  }
+
+  const auto index = find(source);
+  if (!index) {
+    return Status::FileNotFound;
+  }
+
+  if (find(destination)) {
+    return Status::AlreadyExists;
+  }
+
+  // Contents are shared, the copy only takes another reference.
+  const auto& file = slot(*index);
+  pin(file.data);
+
+  return insert(destination, file.data, file.size) ? Status::Success
+                                                   : Status::IoError;
+}
+
+Status SharedMemoryFs::rename(const std::string& source,
+                              const std::string& destination) noexcept {
+  Lock lock(header(), true);
+  if (lock.isDamaged()) {
+    return Status::IoError;
+  }
+
+  const auto index = find(source);
+  if (!index) {
+    return Status::FileNotFound;
+  }
+
+  if (find(destination)) {
+    return Status::AlreadyExists;
+  }
+
+  // The file is linked under the new path before it is unlinked from the old
+  // one, inserts never move other files within the index.
+  const auto& file = slot(*index);
+  pin(file.data);
+  if (!insert(destination, file.data, file.size)) {
+    return Status::IoError;
+  }
+
+  erase(*index);
+  return Status::Success;
+}
+
+std::size_t SharedMemoryFs::getUsedBytes() const noexcept {
+  Lock lock(header(), false);
+  return header().used;
+}
+
+bool SharedMemoryFs::destroy(const std::string& name) noexcept {
+  return shm_unlink(name.c_str()) == 0;
+}
+
+SharedMemoryFs::Header& SharedMemoryFs::header() const noexcept {
+  return *reinterpret_cast<Header*>(base_);
+}
+
+SharedMemoryFs::Slot& SharedMemoryFs::slot(std::uint64_t index) const noexcept {
+  return reinterpret_cast<Slot*>(at(header().index))[index];
+}
+
+SharedMemoryFs::Directory& SharedMemoryFs::directory(
+    std::uint64_t index) const noexcept {
+  return reinterpret_cast<Directory*>(at(header().directories))[index];
+}
+
+void SharedMemoryFs::format(std::size_t size, std::size_t max_objects) {
+  // At most half of the slots are ever used, so that probe sequences stay
+  // short.
+  std::uint64_t capacity{2};
+  while (capacity < 2 * std::max<std::uint64_t>(max_objects, 1)) {
+    capacity *= 2;
+  }
+
+  // The directory table has as many entries as the index.
+  const auto index = roundUp(sizeof(Header), 64);
+  const auto directories =
+      roundUp(index + capacity * sizeof(Slot), kBlockAlignment);
+  const auto heap_begin =
+      roundUp(directories + capacity * sizeof(Directory), kBlockAlignment);
+  if (heap_begin + kMinBlockSize > size) {
+    throw std::runtime_error("Shared memory segment too small: " + name_);
+  }
+
+  // The segment is zero-filled, so all index slots start free.
+  auto* const header = new (base_) Header{};
+  header->size = size;
+  header->index = index;
+  header->capacity = capacity;
+  header->directories = directories;
+  header->max_objects = max_objects;
+  header->next_version = 1;
+  header->heap_begin = heap_begin;
+  header->heap_top = heap_begin;
+  header->heap_end = size - (size - heap_begin) % kBlockAlignment;
+
+  pthread_mutexattr_t attributes;
+  pthread_mutexattr_init(&attributes);
+  pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+  const auto error = pthread_mutex_init(&header->mutex, &attributes);
+  pthread_mutexattr_destroy(&attributes);
+  if (error != 0) {
+    throw std::runtime_error("Failed to initialize shared memory mutex: " +
+                             name_);
+  }
+
+  // Processes attaching in the meantime wait for the segment to be formatted.
+  header->magic.store(kMagic, std::memory_order_release);
+}
+
+std::optional<std::uint64_t> SharedMemoryFs::find(
+    std::string_view path) const noexcept {
+  return findEntry(&slot(0), header().capacity, base_, path);
+}
+
+std::optional<Version> SharedMemoryFs::insert(std::string_view path,
+                                              std::uint64_t data,
+                                              std::uint64_t size) noexcept {
+  const auto stored_path = (header().count < header().max_objects)
+                               ? allocate(path.size())
+                               : std::uint64_t{0};
+  if (stored_path == 0) {
+    release(data);
+    return std::nullopt;
+  }
+  std::memcpy(at(stored_path), path.data(), path.size());
+
+  const auto hash = hashPath(path);
+  const auto index = findFreeEntry(&slot(0), header().capacity, hash);
+
+  const auto version = header().next_version++;
+  slot(index) = {hash, stored_path, path.size(), data, size, version, now()};
+  header().count++;
+  account(path, 1, static_cast<std::int64_t>(size));
+  return version;
+}
+
+void SharedMemoryFs::erase(std::uint64_t index) noexcept {
+  auto& file = slot(index);
+  account({at(file.path), file.path_size}, -1,
+          -static_cast<std::int64_t>(file.size));
+  release(file.data);
+  free(file.path);
+  header().count--;
+
+  eraseEntry(&slot(0), header().capacity, index);
+}
+
+Version SharedMemoryFs::replace(std::uint64_t index, std::uint64_t data,
+                                std::uint64_t size) noexcept {
+  auto& file = slot(index);
+  account({at(file.path), file.path_size}, 0,
+          static_cast<std::int64_t>(size) -
+              static_cast<std::int64_t>(file.size));
+  release(file.data);
+  file.data = data;
+  file.size = size;
+  file.version = header().next_version++;
+  file.modified = now();
+  return file.version;
+}
+
+void SharedMemoryFs::account(std::string_view path, std::int64_t objects,
+                             std::int64_t bytes) noexcept {
+  auto& segment = header();
+  for (auto end = path.find('/');
+       (end != std::string_view::npos) && !segment.usage_dropped;
+       end = path.find('/', end + 1)) {
+    const auto path_prefix = path.substr(0, end + 1);
+    auto index = findEntry(&directory(0), segment.capacity, base_, path_prefix);
+    if (!index) {
+      // At most half of the entries are used, as in the index.
+      const auto stored_path = (2 * segment.directory_count < segment.capacity)
+                                   ? allocate(path_prefix.size())
+                                   : std::uint64_t{0};
+      if (stored_path == 0) {
+        dropUsage();
+        return;
+      }
+      std::memcpy(at(stored_path), path_prefix.data(), path_prefix.size());
+
+      const auto hash = hashPath(path_prefix);
+      index = findFreeEntry(&directory(0), segment.capacity, hash);
+      directory(*index) = {hash, stored_path, path_prefix.size(), 0, 0};
+      segment.directory_count++;
+    }
+
+    // Sizes wrap around, so that negative changes are applied as they are.
+    auto& usage = directory(*index);
+    usage.objects += static_cast<std::uint64_t>(objects);
+    usage.bytes += static_cast<std::uint64_t>(bytes);
+    if (usage.objects == 0) {
+      free(usage.path);
+      segment.directory_count--;
+      eraseEntry(&directory(0), segment.capacity, *index);
+    }
+  }
+}
+
+void SharedMemoryFs::dropUsage() noexcept {
+  auto& segment = header();
+  for (std::uint64_t index = 0; index < segment.capacity; index++) {
+    if (directory(index).hash != 0) {
+      free(directory(index).path);
+      directory(index) = Directory{};
+    }
+  }
+
+  segment.directory_count = 0;
+  segment.usage_dropped = true;
+}
+
+std::optional<std::uint64_t> SharedMemoryFs::store(
+    Lock& lock, std::initializer_list<std::string_view> parts) noexcept {
+  std::size_t size{0};
+  for (const auto part : parts) {
+    size += part.size();
+  }
+  if (size == 0) {
+    return 0;
+  }
+
+  const auto data = allocate(sizeof(std::uint64_t) + size);
+  if (data == 0) {
+    return std::nullopt;
+  }
+
+  // The block is not linked into the index yet, so no other process touches
+  // it while large contents are copied with the mutex released.
+  const auto unlocked = size > kMaxLockedCopySize;
+  if (unlocked) {
+    lock.unlock();
+  }
+
+  *reinterpret_cast<std::uint64_t*>(at(data)) = 1;
+  auto* destination = at(data) + sizeof(std::uint64_t);
+  for (const auto part : parts) {
+    std::memcpy(destination, part.data(), part.size());
+    destination += part.size();
+  }
+
+  if (unlocked) {
+    lock.lock(true);
+    if (lock.isDamaged()) {
+      return std::nullopt;
+    }
+  }
+
+  return data;
+}
+
+void SharedMemoryFs::pin(std::uint64_t data) const noexcept {
+  if (data != 0) {
+    (*reinterpret_cast<std::uint64_t*>(at(data)))++;
+  }
+}
+
+void SharedMemoryFs::release(std::uint64_t data) noexcept {
+  // Damaged segments are left as they are.
+  if ((data == 0) || header().damaged) {
+    return;
+  }
+
+  auto& references = *reinterpret_cast<std::uint64_t*>(at(data));
+  if (--references == 0) {
+    free(data);
+  }
+}
+
+std::string_view SharedMemoryFs::contents(std::uint64_t index) const noexcept {
+  const auto& file = slot(index);
+  if (file.data == 0) {
+    return {};
+  }
+
+  return {at(file.data) + sizeof(std::uint64_t), file.size};
+}
+
+FileInfo SharedMemoryFs::info(std::uint64_t index) const noexcept {
+  const auto& file = slot(index);
+  return {file.size, file.version,
+          std::chrono::system_clock::time_point{
+              std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                  std::chrono::nanoseconds{file.modified})}};
+}
+
+std::uint64_t SharedMemoryFs::allocate(std::size_t size) noexcept {
+  auto& heap = header();
+  const auto needed =
+      std::max(roundUp(size + 2 * kTagSize, kBlockAlignment), kMinBlockSize);
+  const auto tag = [this](std::uint64_t offset) -> std::uint64_t& {
+    return *reinterpret_cast<std::uint64_t*>(at(offset));
+  };
+
+  // First fit within the size class of the request, any block of a larger
+  // class fits.
+  std::uint64_t block{0};
+  auto size_class = getSizeClass(needed);
+  for (auto free = heap.free_lists[size_class]; free != 0;
+       free = tag(free + kTagSize)) {
+    if ((tag(free) & ~kFreeFlag) >= needed) {
+      block = free;
+      break;
+    }
+  }
+  while ((block == 0) && (++size_class < kSizeClasses)) {
+    block = heap.free_lists[size_class];
+  }
+
+  auto block_size = needed;
+  if (block != 0) {
+    unlinkFree(block);
+    block_size = tag(block) & ~kFreeFlag;
+    if (block_size - needed >= kMinBlockSize) {
+      // The rest of the block stays free. Its neighbour is in use, free
+      // blocks are always merged.
+      const auto rest = block + needed;
+      tag(rest) = (block_size - needed) | kFreeFlag;
+      tag(rest + block_size - needed - kTagSize) = block_size - needed;
+      pushFree(rest);
+      block_size = needed;
+    }
+  } else if (heap.heap_top + needed <= heap.heap_end) {
+    block = heap.heap_top;
+    heap.heap_top += needed;
+  } else {
+    return 0;
+  }
+
+  tag(block) = block_size;
+  tag(block + block_size - kTagSize) = block_size;
+  heap.used += block_size;
+  return block + kTagSize;
+}
+
+void SharedMemoryFs::free(std::uint64_t payload) noexcept {
+  auto& heap = header();
+  const auto tag = [this](std::uint64_t offset) -> std::uint64_t& {
+    return *reinterpret_cast<std::uint64_t*>(at(offset));
+  };
+
+  auto block = payload - kTagSize;
+  auto size = tag(block);
+  heap.used -= size;
+
+  const auto next = block + size;
+  if ((next < heap.heap_top) && ((tag(next) & kFreeFlag) != 0)) {
+    unlinkFree(next);
+    size += tag(next) & ~kFreeFlag;
+  }
+
+  if (block > heap.heap_begin) {
+    const auto previous = block - tag(block - kTagSize);
+    if ((tag(previous) & kFreeFlag) != 0) {
+      unlinkFree(previous);
+      size += block - previous;
+      block = previous;
+    }
+  }
+
+  // Blocks at the end of the heap are returned to the unallocated space.
+  if (block + size == heap.heap_top) {
+    heap.heap_top = block;
+    return;
+  }
+
+  tag(block) = size | kFreeFlag;
+  tag(block + size - kTagSize) = size;
+  pushFree(block);
+}
+
+void SharedMemoryFs::pushFree(std::uint64_t block) noexcept {
+  auto* const links = reinterpret_cast<std::uint64_t*>(at(block + kTagSize));
+  auto& head =
+      header().free_lists[getSizeClass(
+          *reinterpret_cast<std::uint64_t*>(at(block)) & ~kFreeFlag)];
+
+  links[0] = head;  // Next block.
+  links[1] = 0;     // Previous block.
+  if (head != 0) {
+    reinterpret_cast<std::uint64_t*>(at(head + kTagSize))[1] = block;
+  }
+  head = block;
+}
+
+void SharedMemoryFs::unlinkFree(std::uint64_t block) noexcept {
+  const auto* const links =
+      reinterpret_cast<std::uint64_t*>(at(block + kTagSize));
+  const auto next = links[0];
+  const auto previous = links[1];
+
+  if (previous != 0) {
+    reinterpret_cast<std::uint64_t*>(at(previous + kTagSize))[0] = next;
+  } else {
+    header().free_lists[getSizeClass(
+        *reinterpret_cast<std::uint64_t*>(at(block)) & ~kFreeFlag)] = next;
+  }
+  if (next != 0) {
+    reinterpret_cast<std::uint64_t*>(at(next + kTagSize))[1] = previous;
+  }
+}
+
+}  // namespace fs
@@ -0,0 +1,430 @@
+#ifndef FILESYSTEM_SHARED_MEMORY_FS_SRC_SHARED_MEMORY_FS_HPP
+#define FILESYSTEM_SHARED_MEMORY_FS_SRC_SHARED_MEMORY_FS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+#include "filesystem/ifilesystem.hpp"
+
+namespace fs {
+
+/**
+ * \brief Shared-memory filesystem configuration.
+ */
+struct SharedMemoryFsConfig {
+  /// Name of the shared-memory segment (e.g. "/object_storage"). Processes
+  /// using the same name serve the same files.
+  std::string name;
+
+  /// Segment size (in bytes), fixed when the segment is created.
+  std::size_t size{64 * 1024 * 1024};
+
+  /// Maximum number of files, fixed when the segment is created.
+  std::size_t max_objects{64 * 1024};
+
+  /// Multipart uploads idle for longer are dropped by
+  /// SharedMemoryFs::expireUploads().
+  std::chrono::milliseconds upload_timeout{60 * 60 * 1000};
+};
+
+/**
+ * \brief Filesystem stored in a POSIX shared-memory segment.
+ *
+ * The index and all file contents live in a named segment, which any number
+ * of processes can attach to. The segment outlives them: a restarted process
+ * attaches to it again instead of reloading the files, and files are stored
+ * once no matter how many processes serve them. The segment is only removed
+ * by destroy().
+ *
+ * The segment is addressed by offsets, so that it may be mapped at different
+ * addresses in each process. It holds:
+ * - a header with a process-shared, robust mutex serializing all operations,
+ * - an open-addressing hash table (linear probing, backward-shift deletion)
+ *   with room for SharedMemoryFsConfig::max_objects files,
+ * - a table of the same kind, with the number and total size of the files
+ *   under every directory (see getUsage()),
+ * - a heap of paths and file contents, with boundary tags so that freed
+ *   blocks are merged with their free neighbours, and free lists segregated
+ *   by size class.
+ *
+ * Small file contents are copied in and out of the segment under the mutex.
+ * Larger ones are copied with the mutex released: contents being read are
+ * pinned by a reference, and new contents are only linked into the index
+ * once they are filled. Copies share contents until either of them is
+ * modified.
+ *
+ * If a process dies holding the mutex, the next process to lock it takes it
+ * over (see pthread_mutexattr_setrobust()). Mutations mark the segment while
+ * they hold the mutex, so a process dying in the middle of one leaves the
+ * segment marked damaged: operations fail (with IoError) from then on, and
+ * processes refuse to attach to it until it is destroyed. A process dying
+ * while it copies contents with the mutex released only loses their memory.
+ *
+ * Multipart uploads are staged in the memory of the process which created
+ * them, so all parts of an upload have to go through the same process. Only
+ * the completed file is stored in the segment.
+ *
+ * \note Every attached process must run the same build, the layout of the
+ * segment is not versioned beyond a format check.
+ */
+class SharedMemoryFs : public IFilesystem {
+ public:
+  /**
+   * \brief Attach to the shared-memory segment with the given name, creating
+   * it if it does not exist yet.
+   *
+   * \param config Filesystem configuration. Size and capacity are only used
+   * when creating the segment.
+   *
+   * \throw std::runtime_error If the segment cannot be created or mapped, it
+   * is not a filesystem segment, or it is damaged.
+   */
+  explicit SharedMemoryFs(const SharedMemoryFsConfig& config);
+
+  /**
+   * \brief Detach from the segment. The segment and its files are kept.
+   */
+  ~SharedMemoryFs() override;
+
+  // SharedMemoryFs is non-copyable and non-moveable, it owns the mapping of
+  // the segment.
+  SharedMemoryFs(const SharedMemoryFs& other) = delete;
+  SharedMemoryFs(SharedMemoryFs&& other) = delete;
+  SharedMemoryFs& operator=(const SharedMemoryFs& other) = delete;
+  SharedMemoryFs& operator=(SharedMemoryFs&&) = delete;
+
+  std::pair<Status, Object> get(
+      const std::string& path) const noexcept override;
+  std::tuple<Status, Object, FileInfo> getWithInfo(
+      const std::string& path) const noexcept override;
+  std::pair<Status, FileInfo> stat(
+      const std::string& path) const noexcept override;
+
+  /**
+   * \copydoc IFilesystem::add()
+   *
+   * Fails with IoError if the segment has no room for the file.
+   */
+  Status add(const std::string& path, const File& file) noexcept override;
+
+  /**
+   * \copydoc IFilesystem::put()
+   *
+   * Checksums are not kept.
+   */
+  std::pair<Status, Version> put(
+      const std::string& path, const File& file,
+      const Precondition& precondition,
+      std::optional<Checksum> checksum = std::nullopt) noexcept override;
+  UploadId createUpload(const std::string& path) noexcept override;
+  Status uploadPart(UploadId upload, const std::string& path,
+                    std::size_t number, const File& data) noexcept override;
+  std::pair<Status, Version> completeUpload(
+      UploadId upload, const std::string& path,
+      const Precondition& precondition) noexcept override;
+  Status abortUpload(UploadId upload,
+                     const std::string& path) noexcept override;
+  std::size_t expireUploads() override;
+  Status append(const std::string& path, const File& data) noexcept override;
+  Status write(const std::string& path, std::size_t offset,
+               const File& data) noexcept override;
+  FileList list() const noexcept override;
+  Status remove(const std::string& path) noexcept override;
+  Status remove(const std::string& path,
+                const Precondition& precondition) noexcept override;
+  std::size_t removePrefix(const std::string& prefix) noexcept override;
+  Status copy(const std::string& source,
+              const std::string& destination) noexcept override;
+  Status rename(const std::string& source,
+                const std::string& destination) noexcept override;
+
+  /**
+   * \copydoc IFilesystem::getUsage()
+   *
+   * Every change to a file updates all of its directories in the segment, so
+   * that this is a single lookup. The directory table has room for as many
+   * directories as files. Should the directories outnumber them (or the heap
+   * run out), usage is no longer kept and this walks the whole index under
+   * the segment mutex instead.
+   */
+  Usage getUsage(const std::string& directory) const noexcept override;
+
+  /**
+   * \brief Check if this filesystem created the segment.
+   *
+   * \return True if the segment was created, false if it already existed.
+   */
+  [[nodiscard]] bool isCreator() const noexcept { return creator_; }
+
+  /**
+   * \brief Return number of bytes of the segment's heap in use.
+   *
+   * \return Bytes taken by paths and file contents (including block
+   * overheads).
+   */
+  [[nodiscard]] std::size_t getUsedBytes() const noexcept;
+
+  /**
+   * \brief Remove a shared-memory segment. Processes still attached to it
+   * keep using it until they detach.
+   *
+   * \param name Name of the segment.
+   *
+   * \return True if the segment was removed, false if it did not exist.
+   */
+  static bool destroy(const std::string& name) noexcept;
+
+ private:
+  struct Header;
+  struct Slot;
+  struct Directory;
+  class Lock;
+
+  /**
+   * \brief Multipart upload in progress.
+   */
+  struct Upload {
+    std::string path;                   ///< Path of the file.
+    std::map<std::size_t, File> parts;  ///< Uploaded parts, by number.
+
+    /// Time of the last part upload.
+    std::chrono::steady_clock::time_point last_activity;
+  };
+
+  /// Maximum number of parts of a multipart upload.
+  static constexpr std::size_t kMaxUploadParts{10000};
+
+  /**
+   * \brief Return the segment header.
+   *
+   * \return Header at the start of the segment.
+   */
+  [[nodiscard]] Header& header() const noexcept;
+
+  /**
+   * \brief Return the index slot with the given number.
+   *
+   * \param index Slot number.
+   *
+   * \return Slot.
+   */
+  [[nodiscard]] Slot& slot(std::uint64_t index) const noexcept;
+
+  /**
+   * \brief Return the directory table entry with the given number.
+   *
+   * \param index Entry number.
+   *
+   * \return Directory table entry.
+   */
+  [[nodiscard]] Directory& directory(std::uint64_t index) const noexcept;
+
+  /**
+   * \brief Translate a segment offset to an address in this process.
+   *
+   * \param offset Offset from the start of the segment.
+   *
+   * \return Address.
+   */
+  [[nodiscard]] char* at(std::uint64_t offset) const noexcept {
+    return base_ + offset;
+  }
+
+  /**
+   * \brief Initialize a newly created segment.
+   *
+   * \param size Segment size (in bytes).
+   * \param max_objects Maximum number of files.
+   *
+   * \throw std::runtime_error If the segment is too small, or the mutex cannot
+   * be initialized.
+   */
+  void format(std::size_t size, std::size_t max_objects);
+
+  /**
+   * \brief Find the slot of a file.
+   *
+   * \note The segment mutex must be held.
+   *
+   * \param path Path to the file.
+   *
+   * \return Slot number, or nothing if there is no such file.
+   */
+  [[nodiscard]] std::optional<std::uint64_t> find(
+      std::string_view path) const noexcept;
+
+  /**
+   * \brief Add a file to the index.
+   *
+   * \note The segment mutex must be held, and there must be no file at the
+   * path.
+   *
+   * \param path Path to the file.
+   * \param data Offset of the file contents (0 if the file is empty).
+   * \param size File size.
+   *
+   * \return Version of the file, or nothing if the segment is full (the
+   * contents are released then).
+   */
+  std::optional<Version> insert(std::string_view path, std::uint64_t data,
+                                std::uint64_t size) noexcept;
+
+  /**
+   * \brief Remove a file from the index, releasing its path and contents.
+   *
+   * \note The segment mutex must be held.
+   *
+   * \param index Slot number of the file.
+   */
+  void erase(std::uint64_t index) noexcept;
+
+  /**
+   * \brief Replace contents of a file.
+   *
+   * \note The segment mutex must be held.
+   *
+   * \param index Slot number of the file.
+   * \param data Offset of the new contents (0 if the file is empty).
+   * \param size New file size.
+   *
+   * \return New version of the file.
+   */
+  Version replace(std::uint64_t index, std::uint64_t data,
+                  std::uint64_t size) noexcept;
+
+  /**
+   * \brief Account for a change to a file in the usage of its directories.
+   *
+   * \note The segment mutex must be held.
+   *
+   * \param path Path to the file.
+   * \param objects Change to the number of files (-1, 0 or 1).
+   * \param bytes Change to the total size of the files.
+   */
+  void account(std::string_view path, std::int64_t objects,
+               std::int64_t bytes) noexcept;
+
+  /**
+   * \brief Stop keeping directory usage, releasing the directory table.
+   *
+   * \note The segment mutex must be held.
+   */
+  void dropUsage() noexcept;
+
+  /**
+   * \brief Copy data to a new heap block holding file contents.
+   *
+   * \note The segment mutex must be held. It is released while large data is
+   * copied, so files have to be looked up again afterwards, and contents
+   * copied from the segment have to be pinned (see pin()).
+   *
+   * \param lock Lock of the segment mutex.
+   * \param parts Data to concatenate.
+   *
+   * \return Offset of the contents (0 for no data), or nothing if there is no
+   * room or the segment was damaged meanwhile.
+   */
+  std::optional<std::uint64_t> store(
+      Lock& lock, std::initializer_list<std::string_view> parts) noexcept;
+
+  /**
+   * \brief Take a reference to file contents, so that they are kept when the
+   * file is modified or removed.
+   *
+   * \note The segment mutex must be held.
+   *
+   * \param data Offset of the contents (0 for no data).
+   */
+  void pin(std::uint64_t data) const noexcept;
+
+  /**
+   * \brief Drop a reference to file contents, freeing them with the last one.
+   *
+   * \note The segment mutex must be held.
+   *
+   * \param data Offset of the contents (0 for no data).
+   */
+  void release(std::uint64_t data) noexcept;
+
+  /**
+   * \brief Return contents of a file.
+   *
+   * \note The segment mutex must be held.
+   *
+   * \param index Slot number of the file.
+   *
+   * \return File contents (valid while the mutex is held).
+   */
+  [[nodiscard]] std::string_view contents(std::uint64_t index) const noexcept;
+
+  /**
+   * \brief Return metadata of a file.
+   *
+   * \note The segment mutex must be held.
+   *
+   * \param index Slot number of the file.
+   *
+   * \return File metadata.
+   */
+  [[nodiscard]] FileInfo info(std::uint64_t index) const noexcept;
+
+  /**
+   * \brief Allocate a heap block.
+   *
+   * \note The segment mutex must be held.
+   *
+   * \param size Number of bytes needed.
+   *
+   * \return Offset of the block payload, or 0 if there is no room.
+   */
+  std::uint64_t allocate(std::size_t size) noexcept;
+
+  /**
+   * \brief Free a heap block, merging it with its free neighbours.
+   *
+   * \note The segment mutex must be held.
+   *
+   * \param payload Offset of the block payload.
+   */
+  void free(std::uint64_t payload) noexcept;
+
+  /**
+   * \brief Add a free block to the free list of its size class.
+   *
+   * \param block Offset of the block.
+   */
+  void pushFree(std::uint64_t block) noexcept;
+
+  /**
+   * \brief Take a free block off its free list.
+   *
+   * \param block Offset of the block.
+   */
+  void unlinkFree(std::uint64_t block) noexcept;
+
+  std::string name_;         ///< Name of the segment.
+  char* base_{nullptr};      ///< Address of the segment in this process.
+  std::size_t size_{0};      ///< Size of the mapping.
+  bool creator_{false};      ///< This filesystem created the segment.
+
+  /// Multipart uploads are dropped after being idle this long.
+  std::chrono::milliseconds upload_timeout_;
+
+  std::mutex upload_mutex_;                ///< Guards uploads in progress.
+  std::mt19937_64 upload_ids_;             ///< Source of upload identifiers.
+  std::map<UploadId, Upload> uploads_;     ///< Uploads in progress.
+};
+
+}  // namespace fs
+
+#endif  // FILESYSTEM_SHARED_MEMORY_FS_SRC_SHARED_MEMORY_FS_HPP
@@ -0,0 +1,348 @@
+#include "filesystem/shared_memory_fs/src/shared_memory_fs.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include "gtest/gtest.h"
+
+using namespace fs;
+
+/**
+ * \brief Shared-memory filesystem test fixture.
+ *
+ * Every test gets a segment of its own, removed once the test ends.
+ */
+class SharedMemoryFsTest : public ::testing::Test {
+ protected:
+  SharedMemoryFsTest() {
+    config_.name = "/shared_memory_fs_test_" + std::to_string(getpid());
+    config_.size = 1024 * 1024;
+    config_.max_objects = 1024;
+    SharedMemoryFs::destroy(config_.name);
+  }
+
+  ~SharedMemoryFsTest() override { SharedMemoryFs::destroy(config_.name); }
+
+  SharedMemoryFsConfig config_;  ///< Configuration of the test segment.
+};
+
+TEST_F(SharedMemoryFsTest, AddGet) {
+  SharedMemoryFs fs{config_};
+  EXPECT_TRUE(fs.isCreator());
+  EXPECT_EQ(Status::FileNotFound, fs.get("/a").first);
+
+  ASSERT_EQ(Status::Success, fs.add("/a", File{"contents"}));
+  ASSERT_EQ(Status::Success, fs.add("/empty", File{}));
+  EXPECT_EQ(Status::AlreadyExists, fs.add("/a", File{"other"}));
+
+  const auto [status, object, info] = fs.getWithInfo("/a");
+  ASSERT_EQ(Status::Success, status);
+  EXPECT_EQ(File{"contents"}, object);
+  EXPECT_EQ(8, info.size);
+  EXPECT_EQ(info.version, fs.stat("/a").second.version);
+  EXPECT_TRUE(fs.get("/empty").second.empty());
+
+  auto list = fs.list();
+  std::sort(list.begin(), list.end());
+  EXPECT_EQ((FileList{"/a", "/empty"}), list);
+}
+
+TEST_F(SharedMemoryFsTest, Modify) {
+  SharedMemoryFs fs{config_};
+  EXPECT_EQ(Status::FileNotFound, fs.write("/a", 0, File{"x"}));
+
+  ASSERT_EQ(Status::Success, fs.append("/a", File{"hello"}));
+  ASSERT_EQ(Status::Success, fs.append("/a", File{" world"}));
+  EXPECT_EQ(File{"hello world"}, fs.get("/a").second);
+
+  ASSERT_EQ(Status::Success, fs.write("/a", 6, File{"there!"}));
+  EXPECT_EQ(File{"hello there!"}, fs.get("/a").second);
+  ASSERT_EQ(Status::Success, fs.write("/a", 0, File{"J"}));
+  EXPECT_EQ(File{"Jello there!"}, fs.get("/a").second);
+  EXPECT_EQ(Status::InvalidRange, fs.write("/a", 13, File{"x"}));
+
+  ASSERT_EQ(Status::Success, fs.remove("/a"));
+  EXPECT_EQ(Status::FileNotFound, fs.remove("/a"));
+  EXPECT_TRUE(fs.list().empty());
+}
+
+TEST_F(SharedMemoryFsTest, Preconditions) {
+  SharedMemoryFs fs{config_};
+  const auto [status, version] = fs.put("/a", File{"1"}, {false, {}});
+  ASSERT_EQ(Status::Success, status);
+  EXPECT_EQ(Status::PreconditionFailed,
+            fs.put("/a", File{"2"}, {false, {}}).first);
+  EXPECT_EQ(Status::PreconditionFailed,
+            fs.put("/a", File{"2"}, {{}, version + 1}).first);
+
+  const auto replaced = fs.put("/a", File{"2"}, {{}, version});
+  ASSERT_EQ(Status::Success, replaced.first);
+  EXPECT_NE(version, replaced.second);
+  EXPECT_EQ(File{"2"}, fs.get("/a").second);
+
+  EXPECT_EQ(Status::PreconditionFailed, fs.remove("/a", {{}, version}));
+  EXPECT_EQ(Status::Success, fs.remove("/a", {{}, replaced.second}));
+}
+
+TEST_F(SharedMemoryFsTest, CopyRename) {
+  SharedMemoryFs fs{config_};
+  ASSERT_EQ(Status::Success, fs.add("/a", File{"contents"}));
+  ASSERT_EQ(Status::Success, fs.add("/b", File{"other"}));
+  const auto used = fs.getUsedBytes();
+
+  // Copies share contents until either of them is modified.
+  ASSERT_EQ(Status::Success, fs.copy("/a", "/c"));
+  EXPECT_EQ(Status::AlreadyExists, fs.copy("/a", "/b"));
+  EXPECT_EQ(Status::FileNotFound, fs.copy("/x", "/y"));
+  EXPECT_LT(fs.getUsedBytes() - used, 8 * 8);
+  ASSERT_EQ(Status::Success, fs.append("/c", File{"!"}));
+  EXPECT_EQ(File{"contents"}, fs.get("/a").second);
+  EXPECT_EQ(File{"contents!"}, fs.get("/c").second);
+
+  ASSERT_EQ(Status::Success, fs.rename("/a", "/d"));
+  EXPECT_EQ(Status::AlreadyExists, fs.rename("/b", "/d"));
+  EXPECT_EQ(Status::FileNotFound, fs.get("/a").first);
+  EXPECT_EQ(File{"contents"}, fs.get("/d").second);
+}
+
+TEST_F(SharedMemoryFsTest, RemovePrefix) {
+  SharedMemoryFs fs{config_};
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(Status::Success, fs.add("/dir/" + std::to_string(i), File{"x"}));
+    ASSERT_EQ(Status::Success, fs.add("/other/" + std::to_string(i), File{}));
+  }
+
+  EXPECT_EQ(100, fs.removePrefix("/dir/"));
+  EXPECT_EQ(100, fs.list().size());
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(Status::Success, fs.stat("/other/" + std::to_string(i)).first);
+  }
+}
+
+TEST_F(SharedMemoryFsTest, Usage) {
+  SharedMemoryFs fs{config_};
+  ASSERT_EQ(Status::Success, fs.add("/d/a", File{"abc"}));
+  ASSERT_EQ(Status::Success, fs.add("/d/e/b", File{"de"}));
+  ASSERT_EQ(Status::Success, fs.add("/f", File{"f"}));
+
+  EXPECT_EQ(3, fs.getUsage("/").objects);
+  EXPECT_EQ(6, fs.getUsage("/").bytes);
+  EXPECT_EQ(2, fs.getUsage("/d/").objects);
+  EXPECT_EQ(5, fs.getUsage("/d/").bytes);
+  EXPECT_EQ(0, fs.getUsage("/x/").objects);
+}
+
+TEST_F(SharedMemoryFsTest, UsageFollowsChanges) {
+  SharedMemoryFs fs{config_};
+  const auto used = fs.getUsedBytes();
+  ASSERT_EQ(Status::Success, fs.add("/d/a", File{"abc"}));
+  ASSERT_EQ(Status::Success, fs.append("/d/a", File{"de"}));
+  ASSERT_EQ(Status::Success, fs.copy("/d/a", "/e/a"));
+  ASSERT_EQ(Status::Success, fs.rename("/d/a", "/d/x/a"));
+
+  EXPECT_EQ(2, fs.getUsage("/").objects);
+  EXPECT_EQ(10, fs.getUsage("/").bytes);
+  EXPECT_EQ(1, fs.getUsage("/d/x/").objects);
+  EXPECT_EQ(5, fs.getUsage("/e/").bytes);
+
+  // Directories are dropped once they hold no files.
+  ASSERT_EQ(1, fs.removePrefix("/d/"));
+  ASSERT_EQ(Status::Success, fs.remove("/e/a"));
+  EXPECT_EQ(0, fs.getUsage("/").objects);
+  EXPECT_EQ(used, fs.getUsedBytes());
+}
+
+TEST_F(SharedMemoryFsTest, UsageOfManyDirectories) {
+  config_.max_objects = 8;
+  SharedMemoryFs fs{config_};
+
+  // Directories outnumber the files the segment was sized for.
+  for (int i = 0; i < 4; i++) {
+    const auto path = "/" + std::to_string(i) + "/a/b/c/" + std::to_string(i);
+    ASSERT_EQ(Status::Success, fs.add(path, File{"xy"}));
+  }
+
+  EXPECT_EQ(4, fs.getUsage("/").objects);
+  EXPECT_EQ(8, fs.getUsage("/").bytes);
+  EXPECT_EQ(1, fs.getUsage("/2/a/b/").objects);
+}
+
+TEST_F(SharedMemoryFsTest, Capacity) {
+  config_.max_objects = 4;
+  SharedMemoryFs fs{config_};
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(Status::Success, fs.add(std::to_string(i), File{"x"}));
+  }
+  EXPECT_EQ(Status::IoError, fs.add("4", File{"x"}));
+
+  // Files larger than the segment never fit.
+  ASSERT_EQ(Status::Success, fs.remove("0"));
+  EXPECT_EQ(Status::IoError, fs.add("0", File(config_.size, 'x')));
+  EXPECT_EQ(Status::Success, fs.add("0", File{"x"}));
+}
+
+TEST_F(SharedMemoryFsTest, MemoryReuse) {
+  SharedMemoryFs fs{config_};
+  const File file(100 * 1024, 'x');
+
+  // Freed blocks are merged, so that the segment fits as many files every
+  // time it is filled, whatever their sizes were before.
+  std::map<std::size_t, int> capacities;
+  for (int round = 0; round < 20; round++) {
+    int added{0};
+    const auto size = file.size() / (round % 4 + 1);
+    while (fs.add(std::to_string(added), file.substr(0, size)) ==
+           Status::Success) {
+      added++;
+    }
+    ASSERT_GT(added, 0);
+    ASSERT_EQ(added, capacities.emplace(size, added).first->second);
+
+    for (int i = 0; i < added; i++) {
+      ASSERT_EQ(Status::Success, fs.remove(std::to_string(i)));
+    }
+    ASSERT_EQ(0, fs.getUsedBytes());
+  }
+}
+
+TEST_F(SharedMemoryFsTest, Reattach) {
+  Version version{0};
+  {
+    SharedMemoryFs fs{config_};
+    ASSERT_EQ(Status::Success, fs.add("/a", File{"kept"}));
+    version = fs.stat("/a").second.version;
+  }
+
+  // Size and capacity of an existing segment are kept.
+  config_.size = 0;
+  SharedMemoryFs fs{config_};
+  EXPECT_FALSE(fs.isCreator());
+  EXPECT_EQ(File{"kept"}, fs.get("/a").second);
+
+  // Versions keep increasing across processes and restarts.
+  EXPECT_GT(fs.put("/a", File{"new"}, {}).second, version);
+}
+
+TEST_F(SharedMemoryFsTest, MultipleProcesses) {
+  SharedMemoryFs fs{config_};
+  ASSERT_EQ(Status::Success, fs.add("/parent", File{"parent"}));
+
+  const auto child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    // The child maps the segment at another address.
+    SharedMemoryFs attached{config_};
+    const auto read = attached.get("/parent").second == File{"parent"};
+    const auto added =
+        attached.add("/child", File{"child"}) == Status::Success;
+    _exit((read && added) ? 0 : 1);
+  }
+
+  int status{0};
+  ASSERT_EQ(child, waitpid(child, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+  EXPECT_EQ(File{"child"}, fs.get("/child").second);
+}
+
+TEST_F(SharedMemoryFsTest, LargeFiles) {
+  SharedMemoryFs fs{config_};
+  const auto used = fs.getUsedBytes();
+
+  // Large contents are copied with the mutex released.
+  File expected(200 * 1024, 'a');
+  ASSERT_EQ(Status::Success, fs.put("/a", expected, {}).first);
+  ASSERT_EQ(Status::Success, fs.append("/a", File(100 * 1024, 'b')));
+  ASSERT_EQ(Status::Success, fs.write("/a", 1000, File(100 * 1024, 'c')));
+  expected += File(100 * 1024, 'b');
+  expected.replace(1000, 100 * 1024, File(100 * 1024, 'c'));
+  EXPECT_EQ(expected, fs.get("/a").second);
+
+  ASSERT_EQ(Status::Success, fs.copy("/a", "/b"));
+  EXPECT_EQ(expected, fs.get("/b").second);
+  ASSERT_EQ(Status::Success, fs.remove("/a"));
+  ASSERT_EQ(Status::Success, fs.remove("/b"));
+  EXPECT_EQ(used, fs.getUsedBytes());
+}
+
+TEST_F(SharedMemoryFsTest, ConcurrentLargeAppends) {
+  config_.size = 8 * 1024 * 1024;
+  SharedMemoryFs fs{config_};
+  constexpr std::size_t kChunkSize{100 * 1024};
+  constexpr int kAppends{8};
+
+  const auto append = [](SharedMemoryFs& filesystem, char character) {
+    for (int i = 0; i < kAppends; i++) {
+      if (filesystem.append("/a", File(kChunkSize, character)) !=
+          Status::Success) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  const auto child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    SharedMemoryFs attached{config_};
+    _exit(append(attached, 'c') ? 0 : 1);
+  }
+
+  EXPECT_TRUE(append(fs, 'p'));
+  int status{0};
+  ASSERT_EQ(child, waitpid(child, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+
+  // No append is lost, and appended chunks are not interleaved.
+  const auto file = fs.get("/a").second;
+  ASSERT_EQ(2 * kAppends * kChunkSize, file.size());
+  const auto contents = file.str();
+  std::map<char, int> chunks;
+  for (std::size_t offset = 0; offset < contents.size();
+       offset += kChunkSize) {
+    const auto chunk = contents.substr(offset, kChunkSize);
+    ASSERT_EQ(std::string(kChunkSize, chunk.front()), chunk);
+    chunks[chunk.front()]++;
+  }
+  EXPECT_EQ((std::map<char, int>{{'c', kAppends}, {'p', kAppends}}), chunks);
+}
+
+TEST_F(SharedMemoryFsTest, Uploads) {
+  SharedMemoryFs fs{config_};
+  const auto upload = fs.createUpload("/a");
+  ASSERT_EQ(Status::Success, fs.uploadPart(upload, "/a", 2, File{"world"}));
+  ASSERT_EQ(Status::Success, fs.uploadPart(upload, "/a", 1, File{"hello "}));
+  EXPECT_EQ(Status::FileNotFound, fs.uploadPart(upload, "/b", 1, File{}));
+  EXPECT_EQ(Status::InvalidRange, fs.uploadPart(upload, "/a", 0, File{}));
+
+  ASSERT_EQ(Status::Success, fs.completeUpload(upload, "/a", {}).first);
+  EXPECT_EQ(File{"hello world"}, fs.get("/a").second);
+  EXPECT_EQ(Status::FileNotFound, fs.completeUpload(upload, "/a", {}).first);
+
+  const auto aborted = fs.createUpload("/b");
+  EXPECT_EQ(Status::Success, fs.abortUpload(aborted, "/b"));
+  EXPECT_EQ(Status::FileNotFound, fs.abortUpload(aborted, "/b"));
+
+  config_.upload_timeout = std::chrono::milliseconds{0};
+  SharedMemoryFs expiring{config_};
+  expiring.createUpload("/c");
+  EXPECT_EQ(1, expiring.expireUploads());
+}
+
+TEST_F(SharedMemoryFsTest, NotFilesystem) {
+  const auto descriptor =
+      shm_open(config_.name.c_str(), O_RDWR | O_CREAT, 0600);
+  ASSERT_GE(descriptor, 0);
+  ASSERT_EQ(0, ftruncate(descriptor, 4096));
+  close(descriptor);
+
+  EXPECT_THROW(SharedMemoryFs{config_}, std::runtime_error);
+}
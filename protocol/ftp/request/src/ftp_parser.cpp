@@ -30,6 +30,9 @@ const std::unordered_map<std::string, FtpCommand> FtpParser::kCommandMap = {
     {"PASS", FtpCommand::Pass}, {"USER", FtpCommand::User},
     {"PASV", FtpCommand::Pasv}, {"TYPE", FtpCommand::Type},
     {"CWD", FtpCommand::Cwd},   {"QUIT", FtpCommand::Quit},
+    {"APPE", FtpCommand::Appe}, {"RNFR", FtpCommand::Rnfr},
+    {"RNTO", FtpCommand::Rnto}, {"RMD", FtpCommand::Rmd},
+    {"SIZE", FtpCommand::Size}, {"STAT", FtpCommand::Stat},
 };
 
 }  // namespace request
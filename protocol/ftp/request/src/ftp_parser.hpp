@@ -21,6 +21,7 @@ enum class FtpCommand {
   List,
   Retr,
   Stor,
+  Appe,
   Dele,
   User,
   Pass,
@@ -28,6 +29,11 @@ enum class FtpCommand {
   Type,
   Cwd,
   Quit,
+  Rnfr,
+  Rnto,
+  Rmd,
+  Size,
+  Stat,
   Unrecognized,
 };
 
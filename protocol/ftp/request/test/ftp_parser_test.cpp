@@ -55,6 +55,15 @@ TEST(FtpParserTest, Stor) {
                   {"stor", "iClikeCtrainAAAAAAAAA_^-27163_very_loOO-ng"}));
 }
 
+TEST(FtpParserTest, Appe) {
+  std::string ftp_request{"APPE /logs/server.log\r\n"};
+  FtpParser ftp{ftp_request};
+  ASSERT_TRUE(ftp.isValid());
+  EXPECT_EQ(ftp.getCommand(), FtpCommand::Appe);
+  EXPECT_THAT(ftp.getTokens(),
+              ::testing::ElementsAreArray({"APPE", "/logs/server.log"}));
+}
+
 TEST(FtpParserTest, Dele) {
   std::string ftp_request{"Dele resume.doc\r\n"};
   FtpParser ftp{ftp_request};
@@ -112,4 +121,47 @@ TEST(FtpParserTest, Cwd) {
   ASSERT_TRUE(ftp.isValid());
   EXPECT_EQ(ftp.getCommand(), FtpCommand::Cwd);
   EXPECT_THAT(ftp.getTokens(), ::testing::ElementsAreArray({"CWD", "docker"}));
-}
\ No newline at end of file
+}
+
+TEST(FtpParserTest, Rnfr) {
+  std::string ftp_request{"RNFR build.tmp\r\n"};
+  FtpParser ftp{ftp_request};
+  ASSERT_TRUE(ftp.isValid());
+  EXPECT_EQ(ftp.getCommand(), FtpCommand::Rnfr);
+  EXPECT_THAT(ftp.getTokens(),
+              ::testing::ElementsAreArray({"RNFR", "build.tmp"}));
+}
+
+TEST(FtpParserTest, Rnto) {
+  std::string ftp_request{"rnto build.tar\r\n"};
+  FtpParser ftp{ftp_request};
+  ASSERT_TRUE(ftp.isValid());
+  EXPECT_EQ(ftp.getCommand(), FtpCommand::Rnto);
+  EXPECT_THAT(ftp.getTokens(),
+              ::testing::ElementsAreArray({"rnto", "build.tar"}));
+}
+
+TEST(FtpParserTest, Rmd) {
+  std::string ftp_request{"RMD build\r\n"};
+  FtpParser ftp{ftp_request};
+  ASSERT_TRUE(ftp.isValid());
+  EXPECT_EQ(ftp.getCommand(), FtpCommand::Rmd);
+  EXPECT_THAT(ftp.getTokens(), ::testing::ElementsAreArray({"RMD", "build"}));
+}
+
+TEST(FtpParserTest, Size) {
+  std::string ftp_request{"SIZE /team/x/\r\n"};
+  FtpParser ftp{ftp_request};
+  ASSERT_TRUE(ftp.isValid());
+  EXPECT_EQ(ftp.getCommand(), FtpCommand::Size);
+  EXPECT_THAT(ftp.getTokens(),
+              ::testing::ElementsAreArray({"SIZE", "/team/x/"}));
+}
+
+TEST(FtpParserTest, Stat) {
+  std::string ftp_request{"stat\r\n"};
+  FtpParser ftp{ftp_request};
+  ASSERT_TRUE(ftp.isValid());
+  EXPECT_EQ(ftp.getCommand(), FtpCommand::Stat);
+  EXPECT_THAT(ftp.getTokens(), ::testing::ElementsAreArray({"stat"}));
+}
@@ -1,5 +1,12 @@
 #include "http_parser.hpp"
 
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+
 #include "utils/src/utils.hpp"
 
 namespace protocol {
@@ -12,7 +19,12 @@ const std::unordered_map<std::string_view, HttpMethod> HttpParser::kMethodMap =
     {
         {"PUT", HttpMethod::Put},
         {"GET", HttpMethod::Get},
+        {"HEAD", HttpMethod::Head},
+        {"POST", HttpMethod::Post},
+        {"PATCH", HttpMethod::Patch},
         {"DELETE", HttpMethod::Delete},
+        {"COPY", HttpMethod::Copy},
+        {"MOVE", HttpMethod::Move},
 };
 
 HttpParser::HttpParser(const std::string& buffer) noexcept
@@ -47,19 +59,30 @@ void HttpParser::parseRequestLine(const std::vector<std::string_view>& lines) {
   const auto tokens = utils::split(lines[0], " ");
   method_ = kMethodMap.at(tokens[0]);
   uri_ = tokens[1];
+
+  if (const auto query = uri_.find('?'); query != std::string_view::npos) {
+    query_ = uri_.substr(query + 1);
+    uri_ = uri_.substr(0, query);
+  }
 }
 
 void HttpParser::parseHeaderFields(const std::vector<std::string_view>& lines) {
   for (auto line = lines.cbegin() + 1; line != lines.cend() - 2; line++) {
-    auto tokens = utils::split(*line, ":");
+    // Values may contain colons themselves (e.g. URIs), only the first one
+    // separates the name.
+    const auto separator = line->find(':');
+    if (separator == std::string_view::npos) {
+      throw std::invalid_argument{"Malformed header field"};
+    }
 
     // Remove leading whitespaces from value.
-    tokens[1].remove_prefix(tokens[1].find_first_not_of(' '));
+    auto value = line->substr(separator + 1);
+    value.remove_prefix(std::min(value.find_first_not_of(' '), value.size()));
 
     // Convert name to lowercase.
-    std::string name{tokens[0]};
+    std::string name{line->substr(0, separator)};
     utils::toLowerCase(name);
-    header_fields_[name] = tokens[1];
+    header_fields_[name] = value;
   }
 }
 
@@ -81,6 +104,102 @@ std::optional<HttpAuthInfo> HttpParser::getAuthInfo() const noexcept {
                       std::string{user_and_pass[1]}};
 }
 
+std::optional<HttpContentRange> HttpParser::getContentRange() const noexcept {
+  std::string key{kContentRangeKey};
+  const auto value = (*this)[key];
+  if (!value) {
+    return {};
+  }
+
+  // Expected format: "bytes <first>-<last>/<length or *>"
+  const auto unit_and_range = utils::split(*value, " ");
+  if ((unit_and_range.size() != 2) || (unit_and_range[0] != "bytes")) {
+    return {};
+  }
+
+  const auto range_and_length = utils::split(unit_and_range[1], "/");
+  if (range_and_length.size() != 2) {
+    return {};
+  }
+
+  const auto first_and_last = utils::split(range_and_length[0], "-");
+  if (first_and_last.size() != 2) {
+    return {};
+  }
+
+  const auto first = utils::toNumber(first_and_last[0]);
+  const auto last = utils::toNumber(first_and_last[1]);
+  if (!first || !last || (*first > *last)) {
+    return {};
+  }
+
+  return HttpContentRange{*first, *last};
+}
+
+std::optional<std::string_view> HttpParser::getDestination() const noexcept {
+  std::string key{kDestinationKey};
+  auto value = (*this)[key];
+  if (!value) {
+    return {};
+  }
+
+  // Strip scheme and authority of an absolute URI.
+  for (const std::string_view scheme : {"http://", "https://"}) {
+    if (value->substr(0, scheme.size()) == scheme) {
+      value->remove_prefix(scheme.size());
+      const auto path = value->find('/');
+      if (path == std::string_view::npos) {
+        return {};
+      }
+      value->remove_prefix(path);
+      break;
+    }
+  }
+
+  if (value->empty() || (value->front() != '/')) {
+    return {};
+  }
+
+  return value;
+}
+
+std::optional<std::chrono::system_clock::time_point>
+HttpParser::getIfModifiedSince() const noexcept {
+  std::string key{kIfModifiedSinceKey};
+  const auto value = (*this)[key];
+  if (!value) {
+    return {};
+  }
+
+  // Expected format: "<day-name>, <day> <month> <year> <hh>:<mm>:<ss> GMT"
+  std::tm time{};
+  std::istringstream stream{std::string{*value}};
+  stream.imbue(std::locale::classic());
+  stream >> std::get_time(&time, "%a, %d %b %Y %H:%M:%S GMT");
+  if (stream.fail()) {
+    return {};
+  }
+
+  return std::chrono::system_clock::from_time_t(timegm(&time));
+}
+
+std::optional<std::string_view> HttpParser::getQueryParameter(
+    std::string_view name) const noexcept {
+  auto query = query_;
+  while (!query.empty()) {
+    const auto end = std::min(query.find('&'), query.size());
+    const auto parameter = query.substr(0, end);
+    query.remove_prefix(std::min(end + 1, query.size()));
+
+    const auto separator = std::min(parameter.find('='), parameter.size());
+    if (parameter.substr(0, separator) == name) {
+      return parameter.substr(std::min(separator + 1, parameter.size()));
+    }
+  }
+
+  return {};
+}
+
 }  // namespace request
 }  // namespace http
 }  // namespace protocol
@@ -1,6 +1,8 @@
 #ifndef PROTOCOL_HTTP_REQUEST_SRC_HTTP_PARSER_HPP
 #define PROTOCOL_HTTP_REQUEST_SRC_HTTP_PARSER_HPP
 
+#include <chrono>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -19,8 +21,13 @@ namespace request {
  */
 enum class HttpMethod {
   Get,
+  Head,
   Put,
+  Post,
+  Patch,
   Delete,
+  Copy,
+  Move,
   Unrecognized,
 };
 
@@ -32,6 +39,15 @@ struct HttpAuthInfo {
   std::string password;  ///< Password
 };
 
+/**
+ * \brief HTTP content range (byte range of the message body within the
+ * resource).
+ */
+struct HttpContentRange {
+  std::size_t first;  ///< Position of the first byte (inclusive).
+  std::size_t last;   ///< Position of the last byte (inclusive).
+};
+
 /**
  * \brief HTTP request parser.
  *
@@ -67,12 +83,19 @@ class HttpParser : public IMemberAccess, public IValidate {
   inline HttpMethod getMethod() const noexcept { return method_; }
 
   /**
-   * \brief Return Uniform Resource Identifier (URI)
+   * \brief Return Uniform Resource Identifier (URI) path
    *
-   * \return URI.
+   * \return URI without the query string.
    */
   inline std::string_view getUri() const noexcept { return uri_; }
 
+  /**
+   * \brief Return Uniform Resource Identifier (URI) query string.
+   *
+   * \return URI query string (without the '?'), empty if there is none.
+   */
+  inline std::string_view getQuery() const noexcept { return query_; }
+
   /**
    * \brief Return HTTP resource size.
    *
@@ -97,6 +120,51 @@ class HttpParser : public IMemberAccess, public IValidate {
    */
   std::optional<HttpAuthInfo> getAuthInfo() const noexcept;
 
+  /**
+   * \brief Return HTTP content range.
+   *
+   * Only single byte ranges in the "bytes <first>-<last>/<length>" format are
+   * supported. The complete length may be unknown ("*").
+   *
+   * \return HTTP Content-Range header value, if present and valid.
+   */
+  std::optional<HttpContentRange> getContentRange() const noexcept;
+
+  /**
+   * \brief Return destination of a COPY or MOVE request.
+   *
+   * The destination is either an absolute URI ("http://host:port/path") or
+   * an absolute path.
+   *
+   * \return Path from the HTTP Destination header, if present and valid.
+   */
+  std::optional<std::string_view> getDestination() const noexcept;
+
+  /**
+   * \brief Return time of a conditional GET or HEAD request.
+   *
+   * Only the preferred HTTP date format ("Sun, 06 Nov 1994 08:49:37 GMT") is
+   * supported.
+   *
+   * \return Time from the HTTP If-Modified-Since header, if present and
+   * valid.
+   */
+  std::optional<std::chrono::system_clock::time_point> getIfModifiedSince()
+      const noexcept;
+
+  /**
+   * \brief Return value of a URI query parameter.
+   *
+   * Parameters are separated by '&'. Parameters without a value (e.g.
+   * "?recursive") have an empty one.
+   *
+   * \param name Parameter name.
+   *
+   * \return Value of the first parameter with the given name, if present.
+   */
+  std::optional<std::string_view> getQueryParameter(
+      std::string_view name) const noexcept;
+
  private:
   /// Mapping ftom HTTP request header field name to value.
   using HttpHeaderFields = std::unordered_map<std::string, std::string_view>;
@@ -107,6 +175,15 @@ class HttpParser : public IMemberAccess, public IValidate {
   /// HTTP request header name for getting the HTTP basic authentication info.
   static constexpr std::string_view kAuthenticationKey{"authorization"};
 
+  /// HTTP request header name for getting the message body byte range.
+  static constexpr std::string_view kContentRangeKey{"content-range"};
+
+  /// HTTP request header name for getting the COPY/MOVE destination.
+  static constexpr std::string_view kDestinationKey{"destination"};
+
+  /// HTTP request header name for getting the conditional request time.
+  static constexpr std::string_view kIfModifiedSinceKey{"if-modified-since"};
+
   /// Mapping from string representation of HTTP method to the decoded value.
   static const std::unordered_map<std::string_view, HttpMethod> kMethodMap;
 
@@ -115,7 +192,8 @@ class HttpParser : public IMemberAccess, public IValidate {
 
   bool valid_;                      ///< Is HTTP request valid?
   HttpMethod method_;               ///< HTTP request method
-  std::string_view uri_;            ///< HTTP URI
+  std::string_view uri_;            ///< HTTP URI (path only)
+  std::string_view query_;          ///< HTTP URI query string (after '?')
   std::size_t resource_size_;       ///< HTTP resource size.
   HttpHeaderFields header_fields_;  ///< HTTP header fields.
 };
@@ -101,6 +101,47 @@ TEST(HttpParserTest, Delete) {
   EXPECT_EQ(http.getResourceSize(), 0);
 }
 
+TEST(HttpParserTest, Patch) {
+  const std::string http_request{
+      "PATCH /logs/server.log HTTP/1.1\r\n"
+      "Content-Length: 5\r\n"
+      "Content-Range: bytes 10-14/*\r\n"
+      "\r\n"};
+
+  HttpParser http{http_request};
+  EXPECT_TRUE(http.isValid());
+  EXPECT_EQ(HttpMethod::Patch, http.getMethod());
+  EXPECT_EQ(http.getUri(), "/logs/server.log");
+  EXPECT_EQ(http.getResourceSize(), 5);
+  ASSERT_TRUE(http.getContentRange());
+  EXPECT_EQ(http.getContentRange()->first, 10);
+  EXPECT_EQ(http.getContentRange()->last, 14);
+}
+
+TEST(HttpParserTest, ContentRange) {
+  const auto content_range = [](const std::string& value) {
+    const std::string http_request{"PATCH /file HTTP/1.1\r\nContent-Range: " +
+                                   value + "\r\n\r\n"};
+    HttpParser http{http_request};
+    EXPECT_TRUE(http.isValid());
+    return http.getContentRange();
+  };
+
+  ASSERT_TRUE(content_range("bytes 0-0/1"));
+  EXPECT_EQ(content_range("bytes 0-0/1")->first, 0);
+  EXPECT_EQ(content_range("bytes 0-0/1")->last, 0);
+  ASSERT_TRUE(content_range("bytes 100-199/200"));
+  EXPECT_EQ(content_range("bytes 100-199/200")->first, 100);
+  EXPECT_EQ(content_range("bytes 100-199/200")->last, 199);
+
+  EXPECT_FALSE(content_range("bytes 10-9/*"));
+  EXPECT_FALSE(content_range("bytes */100"));
+  EXPECT_FALSE(content_range("bytes 0-9"));
+  EXPECT_FALSE(content_range("items 0-9/*"));
+  EXPECT_FALSE(content_range("bytes a-9/*"));
+  EXPECT_FALSE(HttpParser{"PATCH /file HTTP/1.1\r\n\r\n"}.getContentRange());
+}
+
 TEST(HttpParserTest, BasicAuthentication) {
   const std::string http_request{
       "DELETE /echo/delete/json HTTP/1.1\r\n"
@@ -154,7 +195,7 @@ TEST(HttpParserTest, BasicAuthenticationMissing) {
 
 TEST(HttpParserTest, MethodNotRecognised) {
   const std::string http_request{
-      "POST /index.html HTTP/1.1\r\n"
+      "OPTIONS /index.html HTTP/1.1\r\n"
       "\r\n"};
 
   const auto http = HttpParser(http_request);
@@ -162,3 +203,121 @@ TEST(HttpParserTest, MethodNotRecognised) {
   EXPECT_EQ(HttpMethod::Unrecognized, http.getMethod());
   EXPECT_EQ(http.getResourceSize(), 0);
 }
+
+TEST(HttpParserTest, HeaderValueWithColons) {
+  const std::string http_request{
+      "GET /index.html HTTP/1.1\r\n"
+      "Host: localhost:1670\r\n"
+      "\r\n"};
+
+  HttpParser http{http_request};
+  ASSERT_TRUE(http.isValid());
+  EXPECT_EQ(http["host"], "localhost:1670");
+}
+
+TEST(HttpParserTest, DestinationUri) {
+  const std::string http_request{
+      "MOVE /a/b.txt HTTP/1.1\r\n"
+      "Destination: http://localhost:1670/c/d.txt\r\n"
+      "\r\n"};
+
+  HttpParser http{http_request};
+  ASSERT_TRUE(http.isValid());
+  EXPECT_EQ(HttpMethod::Move, http.getMethod());
+  ASSERT_TRUE(http.getDestination());
+  EXPECT_EQ("/c/d.txt", *http.getDestination());
+}
+
+TEST(HttpParserTest, DestinationPath) {
+  const std::string http_request{
+      "COPY /a/b.txt HTTP/1.1\r\n"
+      "Destination: /c/d.txt\r\n"
+      "\r\n"};
+
+  HttpParser http{http_request};
+  ASSERT_TRUE(http.isValid());
+  EXPECT_EQ(HttpMethod::Copy, http.getMethod());
+  ASSERT_TRUE(http.getDestination());
+  EXPECT_EQ("/c/d.txt", *http.getDestination());
+}
+
+TEST(HttpParserTest, DestinationInvalid) {
+  for (const std::string destination :
+       {"c/d.txt", "http://localhost:1670", ""}) {
+    const std::string http_request{"COPY /a/b.txt HTTP/1.1\r\nDestination: " +
+                                   destination + "\r\n\r\n"};
+
+    HttpParser http{http_request};
+    ASSERT_TRUE(http.isValid());
+    EXPECT_FALSE(http.getDestination()) << destination;
+  }
+
+  const std::string http_request{"COPY /a/b.txt HTTP/1.1\r\n\r\n"};
+  HttpParser http{http_request};
+  ASSERT_TRUE(http.isValid());
+  EXPECT_FALSE(http.getDestination());
+}
+
+TEST(HttpParserTest, IfModifiedSince) {
+  const std::string http_request{
+      "HEAD /a/b.txt HTTP/1.1\r\n"
+      "If-Modified-Since: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+      "\r\n"};
+
+  HttpParser http{http_request};
+  ASSERT_TRUE(http.isValid());
+  EXPECT_EQ(HttpMethod::Head, http.getMethod());
+  ASSERT_TRUE(http.getIfModifiedSince());
+  EXPECT_EQ(std::chrono::system_clock::from_time_t(784111777),
+            *http.getIfModifiedSince());
+}
+
+TEST(HttpParserTest, IfModifiedSinceInvalid) {
+  for (const std::string time :
+       {"Sunday, 06-Nov-94 08:49:37 GMT", "784111777", ""}) {
+    const std::string http_request{"GET /a/b.txt HTTP/1.1\r\n"
+                                   "If-Modified-Since: " +
+                                   time + "\r\n\r\n"};
+
+    HttpParser http{http_request};
+    ASSERT_TRUE(http.isValid());
+    EXPECT_FALSE(http.getIfModifiedSince()) << time;
+  }
+}
+
+TEST(HttpParserTest, QueryParameters) {
+  const std::string http_request{
+      "DELETE /a/b/?recursive&since=42&x=1=2 HTTP/1.1\r\n\r\n"};
+
+  HttpParser http{http_request};
+  ASSERT_TRUE(http.isValid());
+  EXPECT_EQ("/a/b/", http.getUri());
+  ASSERT_TRUE(http.getQueryParameter("recursive"));
+  EXPECT_EQ("", *http.getQueryParameter("recursive"));
+  ASSERT_TRUE(http.getQueryParameter("since"));
+  EXPECT_EQ("42", *http.getQueryParameter("since"));
+  ASSERT_TRUE(http.getQueryParameter("x"));
+  EXPECT_EQ("1=2", *http.getQueryParameter("x"));
+  EXPECT_FALSE(http.getQueryParameter("recurs"));
+  EXPECT_EQ("recursive&since=42&x=1=2", http.getQuery());
+}
+
+TEST(HttpParserTest, NoQuery) {
+  const std::string http_request{"GET /a/b HTTP/1.1\r\n\r\n"};
+
+  HttpParser http{http_request};
+  ASSERT_TRUE(http.isValid());
+  EXPECT_EQ("/a/b", http.getUri());
+  EXPECT_FALSE(http.getQueryParameter("recursive"));
+  EXPECT_EQ("", http.getQuery());
+}
+
+TEST(HttpParserTest, Post) {
+  const std::string http_request{"POST /a/b?uploads HTTP/1.1\r\n\r\n"};
+
+  HttpParser http{http_request};
+  ASSERT_TRUE(http.isValid());
+  EXPECT_EQ(HttpMethod::Post, http.getMethod());
+  EXPECT_EQ("/a/b", http.getUri());
+  EXPECT_TRUE(http.getQueryParameter("uploads"));
+}
@@ -1,11 +1,25 @@
 #include "http_response.hpp"
 
+#include <array>
+#include <ctime>
+
 namespace protocol {
 
 namespace http {
 
 namespace response {
 
+std::string toHttpDate(std::chrono::system_clock::time_point time) {
+  const auto seconds = std::chrono::system_clock::to_time_t(time);
+  std::tm utc{};
+  gmtime_r(&seconds, &utc);
+
+  std::array<char, 32> buffer;
+  const auto size = std::strftime(buffer.data(), buffer.size(),
+                                  "%a, %d %b %Y %H:%M:%S GMT", &utc);
+  return {buffer.data(), size};
+}
+
 HttpResponse::HttpResponse(HttpStatus status) noexcept
 
     : HttpResponse{status,
@@ -38,6 +52,16 @@ HttpResponse::HttpResponse(HttpStatus status,
                            const HttpResponseHeaders& response_headers) noexcept
     : HttpResponse{status, kStatusToReason.at(status), response_headers, {}} {}
 
+HttpResponse::HttpResponse(HttpStatus status,
+                           const HttpResponseHeaders& response_headers,
+                           const HttpResource& resource) noexcept
+    : HttpResponse{status, kStatusToReason.at(status), response_headers,
+                   resource} {
+  response_headers_.emplace_back(kContentType, kContentTypeValue);
+  response_headers_.emplace_back(kContentLength,
+                                 std::to_string(resource.size()));
+}
+
 HttpResponse::HttpResponse(HttpStatus status, const std::string& reason_phrase,
                            const HttpResponseHeaders& response_headers,
                            const HttpResource& resource) noexcept
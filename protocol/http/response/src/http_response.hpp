@@ -1,6 +1,7 @@
 #ifndef PROTOCOL_HTTP_RESPONSE_SRC_HTTP_RESPONSE_HPP
 #define PROTOCOL_HTTP_RESPONSE_SRC_HTTP_RESPONSE_HPP
 
+#include <chrono>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -107,6 +108,16 @@ using HttpResponseHeader = std::pair<std::string, std::string>;
  */
 using HttpResponseHeaders = std::vector<HttpResponseHeader>;
 
+/**
+ * \brief Format time as an HTTP date (e.g. for the Last-Modified header).
+ *
+ * \param time Time to format (rounded down to seconds).
+ *
+ * \return HTTP date in the preferred format, e.g.
+ * "Sun, 06 Nov 1994 08:49:37 GMT".
+ */
+std::string toHttpDate(std::chrono::system_clock::time_point time);
+
 /**
  * \brief HTTP response.
  */
@@ -144,6 +155,18 @@ class HttpResponse : public ISerialize {
   HttpResponse(HttpStatus status,
                const HttpResponseHeaders& response_headers) noexcept;
 
+  /**
+   * \brief Create HTTP response with the given status, headers and resource.
+   *
+   * \note Content type and length headers are added after the given ones.
+   *
+   * \param status HTTP status.
+   * \param response_headers HTTP response headers.
+   * \param resource HTTP resource.
+   */
+  HttpResponse(HttpStatus status, const HttpResponseHeaders& response_headers,
+               const HttpResource& resource) noexcept;
+
   /**
    * \brief Create HTTP response with the given arguments.
    *
@@ -42,6 +42,19 @@ TEST(HttpResponseTest, StatusAndResponseHeadders) {
             "\r\n");
 }
 
+TEST(HttpResponseTest, StatusResponseHeadersAndResource) {
+  HttpResponseHeaders headers{{"ETag", "\"42\""}};
+  HttpResource resource{"http_ftp_server_project"};
+  HttpResponse http{HttpStatus::Ok, headers, resource};
+  ASSERT_EQ(std::string(http),
+            "HTTP/1.1 200 OK\r\n"
+            "ETag: \"42\"\r\n"
+            "Content-Type: application/octet-stream\r\n"
+            "Content-Length: 23\r\n"
+            "\r\n"
+            "http_ftp_server_project");
+}
+
 TEST(HttpResponseTest, PassAllParams) {
   HttpResponseHeaders headers{{"Content-Type", "text/html; charset=ISO-8859-1"},
                               {"Content-Encoding", "gzip"},
@@ -62,4 +75,11 @@ TEST(HttpResponseTest, PassAllParams) {
             "Date: Thu, 13 May 2004 10:17:14 GMT\r\n"
             "\r\n"
             "x");
-}
\ No newline at end of file
+}
+
+TEST(HttpResponseTest, HttpDate) {
+  const auto time = std::chrono::system_clock::from_time_t(784111777);
+  EXPECT_EQ("Sun, 06 Nov 1994 08:49:37 GMT", toHttpDate(time));
+  EXPECT_EQ("Sun, 06 Nov 1994 08:49:37 GMT",
+            toHttpDate(time + std::chrono::milliseconds{999}));
+}
@@ -0,0 +1,153 @@
+#include "follower.hpp"
+
+#include <boost/log/trivial.hpp>
+
+namespace replication {
+
+Follower::Follower(fs::MemoryFs& filesystem, const ReplicationConfig& config)
+    : filesystem_{filesystem}, config_{config} {}
+
+bool Follower::start() {
+  std::scoped_lock lock(mutex_);
+  if (running_) {
+    return true;
+  }
+
+  running_ = true;
+  worker_ = std::thread{[this] { run(); }};
+
+  BOOST_LOG_TRIVIAL(info) << "Replicating from primary at " << config_.address
+                          << ':' << config_.port;
+  return true;
+}
+
+void Follower::stop() {
+  {
+    std::scoped_lock lock(mutex_);
+    if (!running_) {
+      return;
+    }
+
+    running_ = false;
+
+    // Blocking reads return once the socket is shut down.
+    if (socket_) {
+      boost::system::error_code error_code{};
+      socket_->shutdown(Socket::shutdown_both, error_code);
+    }
+  }
+
+  wake_up_.notify_all();
+  worker_.join();
+}
+
+ReplicationStatus Follower::getStatus() const {
+  return {Role::Follower, filesystem_.getSequence(), connected_,
+          primary_sequence_, snapshots_};
+}
+
+void Follower::run() {
+  std::unique_lock lock(mutex_);
+  while (running_) {
+    lock.unlock();
+    try {
+      replicate();
+    } catch (const boost::system::system_error& error) {
+      if (connected_) {
+        BOOST_LOG_TRIVIAL(warning)
+            << "Disconnected from primary: " << error.what();
+      }
+    }
+
+    connected_ = false;
+    lock.lock();
+    socket_.reset();
+
+    // Wait a while before reconnecting.
+    wake_up_.wait_for(lock, config_.heartbeat_interval,
+                      [this] { return !running_; });
+  }
+}
+
+void Follower::replicate() {
+  auto socket = std::make_shared<Socket>(io_service_);
+  {
+    std::scoped_lock lock(mutex_);
+    if (!running_) {
+      return;
+    }
+    socket_ = socket;
+  }
+
+  socket->connect({boost::asio::ip::make_address(config_.address),
+                   config_.port});
+  socket->set_option(boost::asio::ip::tcp::no_delay(true));
+  {
+    // The follower may have been stopped before the socket was connected.
+    std::scoped_lock lock(mutex_);
+    if (!running_) {
+      return;
+    }
+  }
+
+  // A snapshot cut short by a lost connection is sent again in full.
+  snapshot_.reset();
+
+  Message hello{MessageType::Hello};
+  hello.payload.sequence = filesystem_.getSequence();
+  send(*socket, hello);
+  connected_ = true;
+  BOOST_LOG_TRIVIAL(info) << "Connected to primary, at sequence "
+                          << hello.payload.sequence;
+
+  while (true) {
+    handle(receive(*socket));
+
+    // Acknowledge once all received mutations were applied.
+    if (socket->available() == 0) {
+      Message ack{MessageType::Ack};
+      ack.payload.sequence = filesystem_.getSequence();
+      send(*socket, ack);
+    }
+  }
+}
+
+void Follower::handle(const Message& message) {
+  const auto sequence = message.payload.sequence;
+  switch (message.type) {
+    case MessageType::SnapshotBegin:
+      BOOST_LOG_TRIVIAL(info) << "Receiving snapshot at sequence " << sequence;
+      snapshot_.emplace();
+      break;
+    case MessageType::Mutation:
+      if (snapshot_) {
+        snapshot_->push_back(message.payload);
+      } else {
+        filesystem_.apply(message.payload);
+      }
+      break;
+    case MessageType::SnapshotEnd:
+      if (snapshot_) {
+        // Reads are served from the previous contents until the snapshot is
+        // swapped in.
+        filesystem_.load(sequence, *snapshot_);
+        snapshot_.reset();
+        snapshots_++;
+        BOOST_LOG_TRIVIAL(info) << "Loaded snapshot at sequence " << sequence;
+      }
+      break;
+    case MessageType::Heartbeat:
+      break;
+    default:
+      throw boost::system::system_error{
+          boost::system::errc::make_error_code(
+              boost::system::errc::protocol_error),
+          "Unexpected replication message"};
+  }
+
+  if (sequence > primary_sequence_) {
+    primary_sequence_ = sequence;
+  }
+}
+
+}  // namespace replication
@@ -0,0 +1,98 @@
+#ifndef REPLICATION_SRC_FOLLOWER_HPP
+#define REPLICATION_SRC_FOLLOWER_HPP
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "filesystem/memory_fs/src/memory_fs.hpp"
+#include "protocol.hpp"
+#include "replication.hpp"
+
+namespace replication {
+
+/**
+ * \brief Follower end of the replication stream.
+ *
+ * Connects to the primary (reconnecting whenever the connection is lost),
+ * announces the last mutation applied locally and applies the mutations (or
+ * the snapshot) shipped by the primary. Applied mutations are acknowledged
+ * whenever there is nothing more to read, so acknowledgements are batched
+ * under load. A snapshot is only loaded once it was received in full, so
+ * that the filesystem keeps serving reads while the follower catches up.
+ */
+class Follower : public IReplica {
+ public:
+  /**
+   * \brief Create a follower for the given filesystem.
+   *
+   * \param filesystem Filesystem to keep in sync with the primary.
+   * \param config Replication configuration.
+   */
+  Follower(fs::MemoryFs& filesystem, const ReplicationConfig& config);
+
+  ~Follower() override { stop(); }
+
+  // Follower is non-copyable and non-moveable, it owns a running thread.
+  Follower(const Follower& other) = delete;
+  Follower(Follower&& other) = delete;
+  Follower& operator=(const Follower& other) = delete;
+  Follower& operator=(Follower&&) = delete;
+
+  bool start() override;
+  void stop() override;
+  [[nodiscard]] ReplicationStatus getStatus() const override;
+  [[nodiscard]] inline Role getRole() const noexcept override {
+    return Role::Follower;
+  }
+
+ private:
+  /**
+   * \brief Follower thread main loop.
+   */
+  void run();
+
+  /**
+   * \brief Connect to the primary and apply mutations until disconnected.
+   *
+   * \throw boost::system::system_error On connection error.
+   */
+  void replicate();
+
+  /**
+   * \brief Handle a message received from the primary.
+   *
+   * \param message Received message.
+   */
+  void handle(const Message& message);
+
+  fs::MemoryFs& filesystem_;  ///< Filesystem to keep in sync.
+  ReplicationConfig config_;  ///< Replication configuration.
+
+  boost::asio::io_service io_service_;  ///< OS IO services.
+  std::thread worker_;                  ///< Follower thread.
+
+  bool running_{false};              ///< Is follower thread running?
+  std::mutex mutex_;                 ///< Protects running flag and socket.
+  std::condition_variable wake_up_;  ///< Wakes up the follower thread.
+  std::shared_ptr<Socket> socket_;   ///< Connection with the primary.
+
+  /// Snapshot being received (only accessed by the follower thread).
+  std::optional<std::vector<fs::Mutation>> snapshot_;
+
+  std::atomic<bool> connected_{false};     ///< Connected to the primary.
+  std::atomic<std::size_t> snapshots_{0};  ///< Number of snapshots loaded.
+
+  /// Last mutation known to be applied by the primary.
+  std::atomic<std::uint64_t> primary_sequence_{0};
+};
+
+}  // namespace replication
+
+#endif  // REPLICATION_SRC_FOLLOWER_HPP
@@ -0,0 +1,261 @@
+#include "primary.hpp"
+
+#include <sys/socket.h>
+
+#include <boost/log/trivial.hpp>
+
+namespace replication {
+
+Primary::Primary(fs::MemoryFs& filesystem, const ReplicationConfig& config)
+    : filesystem_{filesystem}, config_{config}, acceptor_{io_service_} {}
+
+bool Primary::start() {
+  boost::system::error_code error_code{};
+  const boost::asio::ip::tcp::endpoint endpoint{
+      boost::asio::ip::make_address(config_.address, error_code),
+      config_.port};
+  if (error_code) {
+    BOOST_LOG_TRIVIAL(error) << "Invalid replication address \""
+                             << config_.address
+                             << "\": " << error_code.message();
+    return false;
+  }
+
+  acceptor_.open(endpoint.protocol(), error_code);
+  if (!error_code) {
+    acceptor_.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true),
+                         error_code);
+  }
+  if (!error_code) {
+    acceptor_.bind(endpoint, error_code);
+  }
+  if (!error_code) {
+    acceptor_.listen(boost::asio::socket_base::max_listen_connections,
+                     error_code);
+  }
+  if (error_code) {
+    BOOST_LOG_TRIVIAL(error)
+        << "Failed to listen for followers: " << error_code.message();
+    acceptor_.close(error_code);
+    return false;
+  }
+
+  running_ = true;
+  acceptor_thread_ = std::thread{[this] { accept(); }};
+
+  BOOST_LOG_TRIVIAL(info) << "Replication primary listening at "
+                          << config_.address << ':' << getPort();
+  return true;
+}
+
+void Primary::stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+
+  // Blocking accept() returns once the listening socket is shut down.
+  ::shutdown(acceptor_.native_handle(), SHUT_RDWR);
+  acceptor_thread_.join();
+
+  std::list<std::unique_ptr<Link>> links;
+  {
+    std::scoped_lock lock(mutex_);
+    links.swap(links_);
+  }
+
+  for (auto& link : links) {
+    close(*link);
+    link->sender.join();
+    if (link->receiver.joinable()) {
+      link->receiver.join();
+    }
+  }
+
+  boost::system::error_code error_code{};
+  acceptor_.close(error_code);
+}
+
+ReplicationStatus Primary::getStatus() const {
+  const auto sequence = filesystem_.getSequence();
+  const auto now = std::chrono::steady_clock::now();
+
+  ReplicationStatus status{Role::Primary, sequence, true, sequence,
+                           snapshots_.load()};
+  std::scoped_lock lock(mutex_);
+  for (const auto& link : links_) {
+    if (link->closed) {
+      continue;
+    }
+
+    const auto acked = std::min(link->acked.load(), sequence);
+    const auto lag_time =
+        acked == sequence
+            ? std::chrono::milliseconds{0}
+            : std::chrono::duration_cast<std::chrono::milliseconds>(
+                  now - link->caught_up.load());
+    status.followers.push_back(
+        {link->address, acked, sequence - acked, lag_time});
+  }
+
+  return status;
+}
+
+std::uint16_t Primary::getPort() const noexcept {
+  boost::system::error_code error_code{};
+  const auto endpoint = acceptor_.local_endpoint(error_code);
+  return error_code ? 0 : endpoint.port();
+}
+
+void Primary::accept() {
+  while (running_) {
+    Socket socket{io_service_};
+    boost::system::error_code error_code{};
+    acceptor_.accept(socket, error_code);
+    if (error_code) {
+      if (running_) {
+        BOOST_LOG_TRIVIAL(error)
+            << "Failed to accept follower: " << error_code.message();
+        std::this_thread::sleep_for(config_.heartbeat_interval);
+      }
+      continue;
+    }
+
+    socket.set_option(boost::asio::ip::tcp::no_delay(true), error_code);
+
+    auto link = std::make_unique<Link>(std::move(socket));
+    const auto endpoint = link->socket.remote_endpoint(error_code);
+    link->address = endpoint.address().to_string() + ':' +
+                    std::to_string(endpoint.port());
+    link->caught_up = std::chrono::steady_clock::now();
+    BOOST_LOG_TRIVIAL(info) << "Follower connected: " << link->address;
+
+    std::list<std::unique_ptr<Link>> closed;
+    {
+      std::scoped_lock lock(mutex_);
+      for (auto it = links_.begin(); it != links_.end();) {
+        auto current = it++;
+        if ((*current)->closed) {
+          closed.splice(closed.end(), links_, current);
+        }
+      }
+
+      auto& added = *links_.emplace_back(std::move(link));
+      added.sender = std::thread{[this, &added] { send(added); }};
+    }
+
+    // Threads of closed connections are joined outside of the lock, a sender
+    // may still be waiting for mutations.
+    for (auto& link : closed) {
+      link->sender.join();
+      if (link->receiver.joinable()) {
+        link->receiver.join();
+      }
+    }
+  }
+}
+
+void Primary::send(Link& link) {
+  try {
+    const auto hello = receive(link.socket);
+    if (hello.type != MessageType::Hello) {
+      throw boost::system::system_error{
+          boost::system::errc::make_error_code(
+              boost::system::errc::protocol_error),
+          "Expected hello"};
+    }
+
+    auto since = hello.payload.sequence;
+    link.acked = since;
+
+    // Acknowledgements are received only after the hello, so that the
+    // receiver does not consume it. The receiver is joined after the sender.
+    link.receiver = std::thread{[this, &link] { receiveAcks(link); }};
+    while (running_ && !link.closed) {
+      auto mutations = filesystem_.getMutations(since, config_.batch_size,
+                                                config_.heartbeat_interval);
+      if (!mutations) {
+        BOOST_LOG_TRIVIAL(info) << "Sending snapshot to " << link.address
+                                << " (at sequence " << since << ')';
+        since = sendSnapshot(link);
+        continue;
+      }
+
+      if (mutations->empty()) {
+        Message heartbeat{MessageType::Heartbeat};
+        heartbeat.payload.sequence = filesystem_.getSequence();
+        replication::send(link.socket, heartbeat);
+        continue;
+      }
+
+      for (auto& mutation : *mutations) {
+        since = mutation.sequence;
+        replication::send(link.socket,
+                          {MessageType::Mutation, std::move(mutation)});
+      }
+    }
+  } catch (const boost::system::system_error& error) {
+    if (running_ && !link.closed) {
+      BOOST_LOG_TRIVIAL(warning) << "Follower " << link.address
+                                 << " disconnected: " << error.what();
+    }
+  }
+
+  close(link);
+}
+
+void Primary::receiveAcks(Link& link) {
+  try {
+    while (true) {
+      const auto ack = receive(link.socket);
+      if (ack.type != MessageType::Ack) {
+        continue;
+      }
+
+      link.acked = ack.payload.sequence;
+      if (ack.payload.sequence >= filesystem_.getSequence()) {
+        link.caught_up = std::chrono::steady_clock::now();
+      }
+    }
+  } catch (const boost::system::system_error&) {
+    // Connection closed (by either side).
+  }
+
+  close(link);
+}
+
+std::uint64_t Primary::sendSnapshot(Link& link) {
+  // Mutations made while the snapshot is taken are sent afterwards, they may
+  // or may not be reflected in the snapshot already.
+  const auto sequence = filesystem_.getSequence();
+
+  Message begin{MessageType::SnapshotBegin};
+  begin.payload.sequence = sequence;
+  replication::send(link.socket, begin);
+
+  for (const auto& path : filesystem_.list()) {
+    auto [status, object, info] = filesystem_.getWithInfo(path);
+    if (status != fs::Status::Success) {
+      continue;
+    }
+
+    replication::send(link.socket,
+                      {MessageType::Mutation,
+                       {sequence, fs::MutationType::Put, path, 0,
+                        std::move(object), info.checksum}});
+  }
+
+  Message end{MessageType::SnapshotEnd};
+  end.payload.sequence = sequence;
+  replication::send(link.socket, end);
+
+  snapshots_++;
+  return sequence;
+}
+
+void Primary::close(Link& link) noexcept {
+  link.closed = true;
+  boost::system::error_code error_code{};
+  link.socket.shutdown(Socket::shutdown_both, error_code);
+}
+
+}  // namespace replication
@@ -0,0 +1,148 @@
+#ifndef REPLICATION_SRC_PRIMARY_HPP
+#define REPLICATION_SRC_PRIMARY_HPP
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "filesystem/memory_fs/src/memory_fs.hpp"
+#include "protocol.hpp"
+#include "replication.hpp"
+
+namespace replication {
+
+/**
+ * \brief Primary end of the replication stream.
+ *
+ * Accepts follower connections and ships filesystem mutations to every
+ * follower, in sequence number order, asynchronously to the clients which
+ * made them. Each follower announces the last mutation it applied; if the
+ * mutation log no longer holds all mutations following it, the follower is
+ * sent a snapshot of the filesystem first.
+ *
+ * Snapshots are fuzzy: they are taken object by object without stopping
+ * writers, and tagged with the sequence number from before the first object
+ * was read. Since mutations are idempotent, replaying the mutations which
+ * follow that sequence number on top of the snapshot converges to the state
+ * of the primary.
+ *
+ * Each follower is served by two threads, one sending mutations and one
+ * receiving acknowledgements, which are used to report the replication lag.
+ */
+class Primary : public IReplica {
+ public:
+  /**
+   * \brief Create a primary for the given filesystem.
+   *
+   * \note The filesystem mutation log must be enabled.
+   *
+   * \param filesystem Filesystem to replicate.
+   * \param config Replication configuration.
+   */
+  Primary(fs::MemoryFs& filesystem, const ReplicationConfig& config);
+
+  ~Primary() override { stop(); }
+
+  // Primary is non-copyable and non-moveable, it owns running threads.
+  Primary(const Primary& other) = delete;
+  Primary(Primary&& other) = delete;
+  Primary& operator=(const Primary& other) = delete;
+  Primary& operator=(Primary&&) = delete;
+
+  bool start() override;
+  void stop() override;
+  [[nodiscard]] ReplicationStatus getStatus() const override;
+  [[nodiscard]] inline Role getRole() const noexcept override {
+    return Role::Primary;
+  }
+
+  /**
+   * \brief Return the port on which followers are accepted.
+   *
+   * \return Port number (0 if the primary is not running).
+   */
+  [[nodiscard]] std::uint16_t getPort() const noexcept;
+
+ private:
+  /**
+   * \brief Connection with a single follower.
+   */
+  struct Link {
+    /**
+     * \brief Create a link for an accepted connection.
+     *
+     * \param socket Connected socket.
+     */
+    explicit Link(Socket socket) noexcept : socket{std::move(socket)} {}
+
+    Socket socket;         ///< Connected socket.
+    std::string address;   ///< Follower address.
+    std::thread sender;    ///< Thread sending mutations.
+
+    /// Thread receiving acknowledgements (started by the sender).
+    std::thread receiver;
+
+    std::atomic<std::uint64_t> acked{0};  ///< Last acknowledged mutation.
+    std::atomic<bool> closed{false};      ///< Connection was closed.
+
+    /// Last time the follower acknowledged all mutations of the primary.
+    std::atomic<std::chrono::steady_clock::time_point> caught_up;
+  };
+
+  /**
+   * \brief Acceptor thread main loop.
+   */
+  void accept();
+
+  /**
+   * \brief Sender thread main loop.
+   *
+   * \param link Follower connection.
+   */
+  void send(Link& link);
+
+  /**
+   * \brief Receiver thread main loop.
+   *
+   * \param link Follower connection.
+   */
+  void receiveAcks(Link& link);
+
+  /**
+   * \brief Send a snapshot of the filesystem.
+   *
+   * \param link Follower connection.
+   *
+   * \return Sequence number of the snapshot.
+   */
+  std::uint64_t sendSnapshot(Link& link);
+
+  /**
+   * \brief Close a follower connection, waking up its threads.
+   *
+   * \param link Follower connection.
+   */
+  static void close(Link& link) noexcept;
+
+  fs::MemoryFs& filesystem_;  ///< Filesystem to replicate.
+  ReplicationConfig config_;  ///< Replication configuration.
+
+  boost::asio::io_service io_service_;       ///< OS IO services.
+  boost::asio::ip::tcp::acceptor acceptor_;  ///< Follower connection acceptor.
+  std::thread acceptor_thread_;              ///< Thread accepting followers.
+
+  std::atomic<bool> running_{false};       ///< Is primary running?
+  std::atomic<std::size_t> snapshots_{0};  ///< Number of snapshots sent.
+
+  mutable std::mutex mutex_;                ///< Protects follower links.
+  std::list<std::unique_ptr<Link>> links_;  ///< Follower connections.
+};
+
+}  // namespace replication
+
+#endif  // REPLICATION_SRC_PRIMARY_HPP
@@ -0,0 +1,125 @@
+#include "protocol.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace replication {
+
+namespace {
+
+template <typename T>
+void put(unsigned char*& position, T value) noexcept {
+  for (auto i = sizeof(T); i > 0; i--) {
+    position[i - 1] = static_cast<unsigned char>(value & 0xFF);
+    value >>= 8;
+  }
+  position += sizeof(T);
+}
+
+template <typename T>
+T take(const unsigned char*& position) noexcept {
+  T value{0};
+  for (std::size_t i = 0; i < sizeof(T); i++) {
+    value = (value << 8) | position[i];
+  }
+  position += sizeof(T);
+  return value;
+}
+
+[[noreturn]] void throwMalformed() {
+  throw boost::system::system_error{
+      boost::system::errc::make_error_code(
+          boost::system::errc::protocol_error),
+      "Malformed replication message"};
+}
+
+}  // namespace
+
+HeaderBuffer encode(const MessageHeader& header) noexcept {
+  HeaderBuffer buffer{};
+  auto* position = buffer.data();
+  put(position, static_cast<std::uint8_t>(header.type));
+  put(position, static_cast<std::uint8_t>(header.mutation));
+  put(position, header.sequence);
+  put(position, header.offset);
+  put(position, header.path_size);
+  put(position, header.data_size);
+  put(position, static_cast<std::uint8_t>(header.checksum.has_value()));
+  put(position, header.checksum.value_or(0));
+  return buffer;
+}
+
+std::optional<MessageHeader> decode(const HeaderBuffer& buffer) noexcept {
+  const auto* position = buffer.data();
+  const auto type = take<std::uint8_t>(position);
+  const auto mutation = take<std::uint8_t>(position);
+  if ((type < static_cast<std::uint8_t>(MessageType::Hello)) ||
+      (type > static_cast<std::uint8_t>(MessageType::Heartbeat)) ||
+      (mutation > static_cast<std::uint8_t>(fs::MutationType::Remove))) {
+    return std::nullopt;
+  }
+
+  MessageHeader header{static_cast<MessageType>(type),
+                       static_cast<fs::MutationType>(mutation)};
+  header.sequence = take<std::uint64_t>(position);
+  header.offset = take<std::uint64_t>(position);
+  header.path_size = take<std::uint32_t>(position);
+  header.data_size = take<std::uint64_t>(position);
+  const auto has_checksum = take<std::uint8_t>(position);
+  const auto checksum = take<fs::Checksum>(position);
+  if ((header.path_size > kMaxPathSize) || (has_checksum > 1)) {
+    return std::nullopt;
+  }
+
+  if (has_checksum) {
+    header.checksum = checksum;
+  }
+
+  return header;
+}
+
+void send(Socket& socket, const Message& message) {
+  const auto& mutation = message.payload;
+  const auto header = encode({message.type, mutation.type, mutation.sequence,
+                              mutation.offset,
+                              static_cast<std::uint32_t>(mutation.path.size()),
+                              mutation.data.size(), mutation.checksum});
+
+  std::vector<boost::asio::const_buffer> buffers;
+  buffers.reserve(2 + mutation.data.getExtents().size());
+  buffers.emplace_back(boost::asio::buffer(header));
+  buffers.emplace_back(boost::asio::buffer(mutation.path));
+  for (const auto& extent : mutation.data.getExtents()) {
+    buffers.emplace_back(extent.buffer.get(), extent.size);
+  }
+
+  boost::asio::write(socket, buffers);
+}
+
+Message receive(Socket& socket) {
+  HeaderBuffer buffer;
+  boost::asio::read(socket, boost::asio::buffer(buffer));
+  const auto header = decode(buffer);
+  if (!header) {
+    throwMalformed();
+  }
+
+  Message message{header->type,
+                  {header->sequence, header->mutation, {}, header->offset}};
+  auto& mutation = message.payload;
+  mutation.checksum = header->checksum;
+  mutation.path.resize(header->path_size);
+  boost::asio::read(socket, boost::asio::buffer(mutation.path));
+
+  if (header->data_size > 0) {
+    std::shared_ptr<char> data{new char[header->data_size],
+                               std::default_delete<char[]>()};
+    boost::asio::read(socket,
+                      boost::asio::buffer(data.get(), header->data_size));
+    mutation.data = fs::Object{std::move(data), header->data_size};
+  }
+
+  return message;
+}
+
+}  // namespace replication
@@ -0,0 +1,108 @@
+#ifndef REPLICATION_SRC_PROTOCOL_HPP
+#define REPLICATION_SRC_PROTOCOL_HPP
+
+#include <array>
+#include <boost/asio.hpp>
+#include <cstdint>
+#include <optional>
+
+#include "filesystem/memory_fs/src/mutation_log.hpp"
+
+namespace replication {
+
+using Socket = boost::asio::ip::tcp::socket;  ///< TCP socket
+
+/**
+ * \brief Replication message type.
+ */
+enum class MessageType : std::uint8_t {
+  Hello = 1,      ///< Follower -> primary: last mutation applied.
+  Ack,            ///< Follower -> primary: last mutation applied.
+  SnapshotBegin,  ///< Primary -> follower: snapshot of the given sequence.
+  SnapshotEnd,    ///< Primary -> follower: snapshot completed.
+  Mutation,       ///< Primary -> follower: single mutation.
+  Heartbeat,      ///< Primary -> follower: last mutation of the primary.
+};
+
+/**
+ * \brief Fixed-size part of a replication message.
+ */
+struct MessageHeader {
+  MessageType type;           ///< Message type.
+  fs::MutationType mutation;  ///< Mutation type (Mutation only).
+  std::uint64_t sequence;     ///< Sequence number.
+  std::uint64_t offset;       ///< Written data position (Mutation only).
+  std::uint32_t path_size;    ///< Path size (Mutation only).
+  std::uint64_t data_size;    ///< Data size (Mutation only).
+
+  /// Checksum of the stored object, if recorded (Put mutations only).
+  std::optional<fs::Checksum> checksum;
+};
+
+/// Size of an encoded message header (in bytes).
+constexpr std::size_t kHeaderSize{35};
+
+/// Largest path accepted in a message (in bytes).
+constexpr std::uint32_t kMaxPathSize{64 * 1024};
+
+/**
+ * \brief Encoded message header (fields in network byte order).
+ */
+using HeaderBuffer = std::array<unsigned char, kHeaderSize>;
+
+/**
+ * \brief Replication message.
+ *
+ * Every message carries a sequence number. The remaining mutation fields are
+ * only used by Mutation messages.
+ */
+struct Message {
+  MessageType type;      ///< Message type.
+  fs::Mutation payload;  ///< Sequence number and mutation.
+};
+
+/**
+ * \brief Encode a message header.
+ *
+ * \param header Message header.
+ *
+ * \return Encoded header.
+ */
+HeaderBuffer encode(const MessageHeader& header) noexcept;
+
+/**
+ * \brief Decode a message header.
+ *
+ * \param buffer Encoded header.
+ *
+ * \return Message header, or nothing if the header is malformed.
+ */
+std::optional<MessageHeader> decode(const HeaderBuffer& buffer) noexcept;
+
+/**
+ * \brief Send a message.
+ *
+ * Header, path and data extents are sent with a single gathering write, the
+ * data is not copied.
+ *
+ * \param socket Connected socket.
+ * \param message Message to send.
+ *
+ * \throw boost::system::system_error On socket error.
+ */
+void send(Socket& socket, const Message& message);
+
+/**
+ * \brief Receive a message, blocking until the whole message is read.
+ *
+ * \param socket Connected socket.
+ *
+ * \return Received message.
+ *
+ * \throw boost::system::system_error On socket error or malformed message.
+ */
+Message receive(Socket& socket);
+
+}  // namespace replication
+
+#endif  // REPLICATION_SRC_PROTOCOL_HPP
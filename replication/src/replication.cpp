@@ -0,0 +1,46 @@
+#include "replication.hpp"
+
+#include <sstream>
+
+namespace replication {
+
+namespace {
+
+const char* toString(Role role) noexcept {
+  switch (role) {
+    case Role::Primary:
+      return "primary";
+    case Role::Follower:
+      return "follower";
+    default:
+      return "none";
+  }
+}
+
+}  // namespace
+
+std::string toString(const ReplicationStatus& status) {
+  std::ostringstream stream;
+  stream << "role: " << toString(status.role) << '\n'
+         << "sequence: " << status.sequence << '\n'
+         << "connected: " << status.connected << '\n'
+         << "snapshots: " << status.snapshots << '\n';
+
+  if (status.role == Role::Follower) {
+    const auto lag = status.primary_sequence > status.sequence
+                         ? status.primary_sequence - status.sequence
+                         : 0;
+    stream << "primary_sequence: " << status.primary_sequence << '\n'
+           << "lag: " << lag << '\n';
+  }
+
+  for (const auto& follower : status.followers) {
+    stream << "follower: " << follower.address
+           << " acked=" << follower.acked_sequence << " lag=" << follower.lag
+           << " lag_ms=" << follower.lag_time.count() << '\n';
+  }
+
+  return stream.str();
+}
+
+}  // namespace replication
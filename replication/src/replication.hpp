@@ -0,0 +1,119 @@
+#ifndef REPLICATION_SRC_REPLICATION_HPP
+#define REPLICATION_SRC_REPLICATION_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace replication {
+
+/**
+ * \brief Replication role of an object storage server.
+ */
+enum class Role { None, Primary, Follower };
+
+/**
+ * \brief Replication configuration.
+ */
+struct ReplicationConfig {
+  Role role{Role::None};  ///< Replication role.
+
+  /// Primary: address to listen on for followers. Follower: primary address.
+  std::string address{"127.0.0.1"};
+
+  /// Primary: port to listen on for followers (0 picks any free port).
+  /// Follower: primary replication port.
+  std::uint16_t port{0};
+
+  /// Maximum time without any message from the primary. Followers also wait
+  /// this long between attempts to connect to the primary.
+  std::chrono::milliseconds heartbeat_interval{100};
+
+  /// Maximum number of mutations shipped to a follower at once.
+  std::size_t batch_size{256};
+
+  /// Number of most recent mutations kept by the primary. Followers falling
+  /// further behind catch up from a snapshot instead.
+  std::size_t log_size{65536};
+};
+
+/**
+ * \brief Replication state of a single follower, as seen by the primary.
+ */
+struct FollowerStatus {
+  std::string address;           ///< Follower address.
+  std::uint64_t acked_sequence;  ///< Last mutation applied by the follower.
+  std::uint64_t lag;             ///< Mutations not yet applied by follower.
+
+  /// Time since the follower was last up to date (0 if it is up to date).
+  std::chrono::milliseconds lag_time;
+};
+
+/**
+ * \brief Replication state of a server.
+ */
+struct ReplicationStatus {
+  Role role;               ///< Replication role.
+  std::uint64_t sequence;  ///< Last mutation applied locally.
+
+  /// Follower: connected to the primary. Primary: always true.
+  bool connected;
+
+  /// Follower: last mutation known to be applied by the primary.
+  std::uint64_t primary_sequence;
+
+  /// Number of snapshots sent (primary) or loaded (follower).
+  std::size_t snapshots;
+
+  /// Primary: connected followers.
+  std::vector<FollowerStatus> followers;
+};
+
+/**
+ * \brief Replica interface (one end of a replication stream).
+ */
+class IReplica {
+ public:
+  virtual ~IReplica() = default;
+
+  /**
+   * \brief Start replicating in the background.
+   *
+   * \return True if replication was started successfully, false otherwise.
+   */
+  virtual bool start() = 0;
+
+  /**
+   * \brief Stop replicating and wait for the background threads to finish.
+   */
+  virtual void stop() = 0;
+
+  /**
+   * \brief Return replication state.
+   *
+   * \return Replication status.
+   */
+  [[nodiscard]] virtual ReplicationStatus getStatus() const = 0;
+
+  /**
+   * \brief Return replication role.
+   *
+   * \return Replication role.
+   */
+  [[nodiscard]] virtual Role getRole() const noexcept = 0;
+};
+
+/**
+ * \brief Format replication status as human readable text.
+ *
+ * \param status Replication status.
+ *
+ * \return One "key: value" pair per line, followed by one line per follower.
+ */
+std::string toString(const ReplicationStatus& status);
+
+}  // namespace replication
+
+#endif  // REPLICATION_SRC_REPLICATION_HPP
@@ -0,0 +1,84 @@
+#include "replication/src/protocol.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace replication;
+
+TEST(ReplicationProtocol, HeaderRoundTrip) {
+  const MessageHeader header{MessageType::Mutation, fs::MutationType::Put,
+                             0x0102030405060708, 42, 7, 1ULL << 40,
+                             0x0a0b0c0d};
+  const auto buffer = encode(header);
+
+  // Fields are encoded in network byte order.
+  EXPECT_EQ(static_cast<unsigned char>(MessageType::Mutation), buffer[0]);
+  EXPECT_EQ(0x01, buffer[2]);
+  EXPECT_EQ(0x08, buffer[9]);
+
+  const auto decoded = decode(buffer);
+  ASSERT_TRUE(decoded);
+  EXPECT_EQ(header.type, decoded->type);
+  EXPECT_EQ(header.mutation, decoded->mutation);
+  EXPECT_EQ(header.sequence, decoded->sequence);
+  EXPECT_EQ(header.offset, decoded->offset);
+  EXPECT_EQ(header.path_size, decoded->path_size);
+  EXPECT_EQ(header.data_size, decoded->data_size);
+  EXPECT_EQ(header.checksum, decoded->checksum);
+
+  const auto unchecked = decode(encode({MessageType::Heartbeat}));
+  ASSERT_TRUE(unchecked);
+  EXPECT_FALSE(unchecked->checksum);
+}
+
+TEST(ReplicationProtocol, MalformedHeader) {
+  auto buffer = encode({MessageType::Hello, fs::MutationType::Put, 1, 0, 0, 0});
+  buffer[0] = 0;
+  EXPECT_FALSE(decode(buffer));
+
+  buffer = encode({MessageType::Mutation, fs::MutationType::Put, 1, 0,
+                   kMaxPathSize + 1, 0});
+  EXPECT_FALSE(decode(buffer));
+
+  buffer = encode({MessageType::Mutation, fs::MutationType::Put, 1, 0, 0, 0});
+  buffer[30] = 2;
+  EXPECT_FALSE(decode(buffer));
+}
+
+TEST(ReplicationProtocol, SendReceive) {
+  boost::asio::io_service io_service;
+  boost::asio::ip::tcp::acceptor acceptor{
+      io_service, {boost::asio::ip::make_address("127.0.0.1"), 0}};
+  Socket client{io_service};
+  Socket server{io_service};
+  client.connect(acceptor.local_endpoint());
+  acceptor.accept(server);
+
+  // Data made of several extents arrives as a single one.
+  fs::Object data{fs::File{"Hello "}};
+  data.append(fs::Object{fs::File{"world"}});
+  send(client, {MessageType::Mutation,
+                {5, fs::MutationType::Write, "/file", 3, data}});
+  send(client, {MessageType::Mutation,
+                {6, fs::MutationType::Put, "/put", 0, data, 0x0a0b0c0d}});
+  send(client, {MessageType::Heartbeat, {7}});
+
+  auto message = receive(server);
+  EXPECT_EQ(MessageType::Mutation, message.type);
+  EXPECT_EQ(5, message.payload.sequence);
+  EXPECT_EQ(fs::MutationType::Write, message.payload.type);
+  EXPECT_EQ("/file", message.payload.path);
+  EXPECT_EQ(3, message.payload.offset);
+  EXPECT_EQ(fs::File{"Hello world"}, message.payload.data);
+  EXPECT_FALSE(message.payload.checksum);
+
+  // Checksums recorded with puts are sent along.
+  message = receive(server);
+  EXPECT_EQ(fs::MutationType::Put, message.payload.type);
+  EXPECT_EQ(0x0a0b0c0d, message.payload.checksum);
+
+  message = receive(server);
+  EXPECT_EQ(MessageType::Heartbeat, message.type);
+  EXPECT_EQ(7, message.payload.sequence);
+  EXPECT_TRUE(message.payload.path.empty());
+  EXPECT_TRUE(message.payload.data.empty());
+}
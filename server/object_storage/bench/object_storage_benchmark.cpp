@@ -0,0 +1,229 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <cctype>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "server/object_storage/src/object_storage.hpp"
+
+using namespace server::object_storage;
+
+namespace {
+
+/// Address the servers under benchmark listen on.
+constexpr std::string_view kAddress{"127.0.0.1"};
+
+/// Port the server under benchmark listens on.
+constexpr std::uint16_t kPort{1690};
+
+/// Small object read by the benchmarks.
+constexpr std::string_view kObject{"{\"feature\": true}"};
+
+/// Request reading the small object.
+const std::string kGetRequest{"GET /bench HTTP/1.1\r\nHost: bench\r\n\r\n"};
+
+/**
+ * \brief Blocking HTTP client.
+ */
+class Client {
+ public:
+  /**
+   * \brief Connect to a server.
+   *
+   * \param port Server port number.
+   */
+  explicit Client(std::uint16_t port) : socket_{io_context_} {
+    socket_.connect(
+        {boost::asio::ip::make_address(std::string{kAddress}), port});
+    socket_.set_option(boost::asio::ip::tcp::no_delay(true));
+
+    // Connections are reset when closed, so that benchmarks opening many of
+    // them do not run out of ports held in TIME_WAIT.
+    socket_.set_option(boost::asio::socket_base::linger(true, 0));
+  }
+
+  /**
+   * \brief Send a request and wait for the entire response.
+   *
+   * \param request HTTP request.
+   *
+   * \return HTTP status code of the response.
+   */
+  int request(const std::string& request) {
+    send(request);
+    return receive();
+  }
+
+  /**
+   * \brief Send requests without waiting for responses.
+   *
+   * \param requests HTTP requests.
+   */
+  void send(const std::string& requests) {
+    boost::asio::write(socket_, boost::asio::buffer(requests));
+  }
+
+  /**
+   * \brief Wait for the entire response to the oldest request.
+   *
+   * \return HTTP status code of the response.
+   */
+  int receive() {
+    const auto header_size =
+        boost::asio::read_until(socket_, response_, "\r\n\r\n");
+    std::string header{boost::asio::buffers_begin(response_.data()),
+                       boost::asio::buffers_begin(response_.data()) +
+                           static_cast<std::ptrdiff_t>(header_size)};
+    response_.consume(header_size);
+    std::transform(header.begin(), header.end(), header.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+
+    std::size_t body_size{0};
+    const auto content_length = header.find("content-length:");
+    if (content_length != std::string::npos) {
+      body_size = std::stoul(header.substr(content_length + 15));
+    }
+    if (response_.size() < body_size) {
+      boost::asio::read(socket_, response_,
+                        boost::asio::transfer_exactly(body_size -
+                                                      response_.size()));
+    }
+    response_.consume(body_size);
+
+    // Status line: "HTTP/1.1 200 OK"
+    return std::stoi(header.substr(9, 3));
+  }
+
+ private:
+  boost::asio::io_context io_context_;   ///< OS IO services
+  boost::asio::ip::tcp::socket socket_;  ///< Connection to the server
+  boost::asio::streambuf response_;      ///< Buffered response data
+};
+
+/// Number of requests a pipelining client sends at once.
+constexpr std::size_t kPipelineDepth{16};
+
+/// Server under benchmark.
+std::unique_ptr<ObjectStorage> server;
+
+/**
+ * \brief Start the server using the threading model given by the benchmark
+ * argument, with a thread per CPU core, and store the small object.
+ *
+ * \param state Benchmark state (argument: shared IO service/thread per core).
+ */
+void startServer(const benchmark::State& state) {
+  ObjectStorageConfig config;
+  config.address = std::string{kAddress};
+  config.port = kPort;
+  config.log_level = LogLevel::Error;
+  config.threading_model = (state.range(0) == 0)
+                               ? ThreadingModel::Shared
+                               : ThreadingModel::ThreadPerCore;
+  server = std::make_unique<ObjectStorage>(config);
+  server->start(std::max(std::thread::hardware_concurrency(), 1U));
+  Client{kPort}.request("PUT /bench HTTP/1.1\r\nHost: bench\r\n"
+                        "Content-Length: " +
+                        std::to_string(kObject.size()) + "\r\n\r\n" +
+                        std::string{kObject});
+}
+
+/**
+ * \brief Stop the server.
+ *
+ * \param state Benchmark state.
+ */
+void stopServer(const benchmark::State&) { server.reset(); }
+
+}  // namespace
+
+/**
+ * \brief Rate of new connections, each reading the small object.
+ *
+ * \param state Benchmark state (argument: shared IO service/thread per core).
+ */
+static void BM_ConnectionRate(benchmark::State& state) {
+  for (auto _ : state) {
+    Client client{kPort};
+    if (client.request(kGetRequest) != 200) {
+      state.SkipWithError("Request failed");
+      break;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ConnectionRate)
+    ->ArgName("thread_per_core")
+    ->Arg(0)
+    ->Arg(1)
+    ->ThreadRange(1, 64)
+    ->Setup(startServer)
+    ->Teardown(stopServer)
+    ->UseRealTime();
+
+/**
+ * \brief Rate of small object reads over persistent connections (one per
+ * client thread).
+ *
+ * \param state Benchmark state (argument: shared IO service/thread per core).
+ */
+static void BM_Requests(benchmark::State& state) {
+  Client client{kPort};
+  for (auto _ : state) {
+    if (client.request(kGetRequest) != 200) {
+      state.SkipWithError("Request failed");
+      break;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Requests)
+    ->ArgName("thread_per_core")
+    ->Arg(0)
+    ->Arg(1)
+    ->ThreadRange(1, 64)
+    ->Setup(startServer)
+    ->Teardown(stopServer)
+    ->UseRealTime();
+
+/**
+ * \brief Rate of small object reads over persistent connections, with
+ * requests pipelined (sent in batches, before their responses arrive).
+ *
+ * \param state Benchmark state (argument: shared IO service/thread per core).
+ */
+static void BM_PipelinedRequests(benchmark::State& state) {
+  Client client{kPort};
+  std::string requests;
+  for (std::size_t i = 0; i < kPipelineDepth; i++) {
+    requests += kGetRequest;
+  }
+
+  for (auto _ : state) {
+    client.send(requests);
+    for (std::size_t i = 0; i < kPipelineDepth; i++) {
+      if (client.receive() != 200) {
+        state.SkipWithError("Request failed");
+        break;
+      }
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(kPipelineDepth));
+}
+BENCHMARK(BM_PipelinedRequests)
+    ->ArgName("thread_per_core")
+    ->Arg(0)
+    ->Arg(1)
+    ->ThreadRange(1, 64)
+    ->Setup(startServer)
+    ->Teardown(stopServer)
+    ->UseRealTime();
@@ -0,0 +1,96 @@
+#include "buckets.hpp"
+
+#include <stdexcept>
+
+namespace server {
+namespace object_storage {
+
+Buckets::Buckets(const fs::MemoryFsConfig& default_config,
+                 const std::vector<BucketConfig>& configs)
+    : default_{default_config} {
+  for (const auto& config : configs) {
+    if (config.name.empty() ||
+        (config.name.find('/') != std::string::npos)) {
+      throw std::invalid_argument("Invalid bucket name: " + config.name);
+    }
+
+    if (buckets_.count(config.name) > 0) {
+      throw std::invalid_argument("Duplicate bucket name: " + config.name);
+    }
+
+    if (config.shared) {
+      buckets_.emplace(config.name,
+                       std::make_unique<fs::SharedMemoryFs>(*config.shared));
+    } else {
+      buckets_.emplace(config.name, std::make_unique<fs::MemoryFs>(config.fs));
+    }
+  }
+}
+
+fs::IFilesystem& Buckets::route(std::string_view path) noexcept {
+  if (buckets_.empty() || path.empty() || (path.front() != '/')) {
+    return default_;
+  }
+
+  // Only files under the top-level directory belong to the bucket, not a file
+  // named after it.
+  const auto end = path.find('/', 1);
+  if (end == std::string_view::npos) {
+    return default_;
+  }
+
+  const auto bucket = buckets_.find(path.substr(1, end - 1));
+  return (bucket != buckets_.end()) ? *bucket->second : default_;
+}
+
+fs::FileList Buckets::list() const {
+  auto filepaths = default_.list();
+  for (const auto& [name, filesystem] : buckets_) {
+    auto bucket_filepaths = filesystem->list();
+    filepaths.insert(filepaths.end(),
+                     std::make_move_iterator(bucket_filepaths.begin()),
+                     std::make_move_iterator(bucket_filepaths.end()));
+  }
+
+  return filepaths;
+}
+
+std::size_t Buckets::removePrefix(const std::string& directory) noexcept {
+  if (directory != "/") {
+    return route(directory).removePrefix(directory);
+  }
+
+  auto count = default_.removePrefix(directory);
+  for (const auto& [name, filesystem] : buckets_) {
+    count += filesystem->removePrefix(directory);
+  }
+
+  return count;
+}
+
+fs::Usage Buckets::getUsage(const std::string& directory) noexcept {
+  if (directory != "/") {
+    return route(directory).getUsage(directory);
+  }
+
+  auto usage = default_.getUsage(directory);
+  for (const auto& [name, filesystem] : buckets_) {
+    const auto bucket_usage = filesystem->getUsage(directory);
+    usage.objects += bucket_usage.objects;
+    usage.bytes += bucket_usage.bytes;
+  }
+
+  return usage;
+}
+
+void Buckets::forEach(
+    const std::function<void(const std::string& name,
+                             fs::IFilesystem& filesystem)>& function) {
+  function({}, default_);
+  for (const auto& [name, filesystem] : buckets_) {
+    function(name, *filesystem);
+  }
+}
+
+}  // namespace object_storage
+}  // namespace server
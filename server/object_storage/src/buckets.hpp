@@ -0,0 +1,147 @@
+#ifndef SERVER_OBJECT_STORAGE_SRC_BUCKETS_HPP
+#define SERVER_OBJECT_STORAGE_SRC_BUCKETS_HPP
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "filesystem/ifilesystem.hpp"
+#include "filesystem/memory_fs/src/memory_fs.hpp"
+#include "filesystem/shared_memory_fs/src/shared_memory_fs.hpp"
+
+namespace server {
+namespace object_storage {
+
+/**
+ * \brief Bucket configuration.
+ */
+struct BucketConfig {
+  /// Bucket name, files under the top-level directory of the same name are
+  /// stored in the bucket (e.g. "/photos/a.jpg" in bucket "photos").
+  std::string name;
+
+  /// Configuration of the bucket's own filesystem (memory and disk budgets,
+  /// compaction, caching, write combining).
+  fs::MemoryFsConfig fs;
+
+  /// If set, the bucket is stored in a shared-memory segment, which other
+  /// server processes attach to by the same name (fs is ignored then).
+  std::optional<fs::SharedMemoryFsConfig> shared;
+};
+
+/**
+ * \brief Namespaces of a server, each stored in a filesystem of its own.
+ *
+ * Every bucket is a separate filesystem instance, with its own lock, index,
+ * memory arena and limits, so that load on one bucket does not slow down
+ * requests to the others. A bucket is either private to the process
+ * (MemoryFs), or shared by all processes attached to its segment
+ * (SharedMemoryFs). Files are routed to buckets by their top-level
+ * directory. Files outside of all buckets are stored in the default
+ * filesystem.
+ *
+ * Files keep their full paths within buckets, so that listings of buckets
+ * can be merged as they are.
+ */
+class Buckets {
+ public:
+  /**
+   * \brief Create the default filesystem and the given buckets.
+   *
+   * \param default_config Configuration of the default filesystem.
+   * \param configs Bucket configurations.
+   *
+   * \throw std::invalid_argument If a bucket name is empty, contains '/', or
+   * is used by more than one bucket.
+   * \throw std::runtime_error If a shared-memory segment cannot be attached
+   * to.
+   */
+  Buckets(const fs::MemoryFsConfig& default_config,
+          const std::vector<BucketConfig>& configs);
+
+  /**
+   * \brief Return the filesystem of files outside of all buckets.
+   *
+   * \return Default filesystem.
+   */
+  [[nodiscard]] fs::MemoryFs& getDefault() noexcept { return default_; }
+
+  /**
+   * \brief Return the filesystem storing the given path.
+   *
+   * \param path Absolute file path.
+   *
+   * \return Filesystem of the bucket named by the top-level directory of the
+   * path, or the default filesystem if there is no such bucket.
+   */
+  [[nodiscard]] fs::IFilesystem& route(std::string_view path) noexcept;
+
+  /**
+   * \brief Check if two paths are stored in the same filesystem.
+   *
+   * \param first Absolute file path.
+   * \param second Absolute file path.
+   *
+   * \return True if files can be copied and moved between the paths without
+   * transferring their contents, false otherwise.
+   */
+  [[nodiscard]] bool isSameBucket(std::string_view first,
+                                  std::string_view second) noexcept {
+    return &route(first) == &route(second);
+  }
+
+  /**
+   * \brief List files of all buckets.
+   *
+   * \return List of file paths (in no particular order).
+   */
+  [[nodiscard]] fs::FileList list() const;
+
+  /**
+   * \brief Remove all files under a directory.
+   *
+   * \param directory Directory path (ending with '/'). Removing the root
+   * directory empties all buckets.
+   *
+   * \return Number of removed files.
+   */
+  std::size_t removePrefix(const std::string& directory) noexcept;
+
+  /**
+   * \brief Return the number and total size of files under a directory.
+   *
+   * \param directory Directory path (ending with '/'). Usage of the root
+   * directory covers all buckets.
+   *
+   * \return Usage of the directory.
+   */
+  [[nodiscard]] fs::Usage getUsage(const std::string& directory) noexcept;
+
+  /**
+   * \brief Call a function for the default filesystem and every bucket.
+   *
+   * \param function Function called with the bucket name (empty for the
+   * default filesystem) and its filesystem.
+   */
+  void forEach(const std::function<void(const std::string& name,
+                                        fs::IFilesystem& filesystem)>&
+                   function);
+
+ private:
+  fs::MemoryFs default_;  ///< Files outside of all buckets.
+
+  /// Filesystems of buckets, by name (heterogeneous lookup, so that routing
+  /// a request does not allocate).
+  std::map<std::string, std::unique_ptr<fs::IFilesystem>, std::less<>>
+      buckets_;
+};
+
+}  // namespace object_storage
+}  // namespace server
+
+#endif  // SERVER_OBJECT_STORAGE_SRC_BUCKETS_HPP
@@ -2,6 +2,7 @@
 
 #include "protocol/ftp/response/src/ftp_response.hpp"
 #include "session.hpp"
+#include "utils/src/utils.hpp"
 
 namespace server {
 namespace object_storage {
@@ -20,7 +21,29 @@ void Session::handleFtp(const std::string& request) noexcept {
   BOOST_LOG_TRIVIAL(debug) << "FTP command:\n" << request;
   if (parser.isValid()) {
     const auto ftp_command = parser.getCommand();
-    ftp_handlers_.at(ftp_command)(parser);
+    // RNTO has to follow a successful RNFR right away.
+    if (ftp_command != FtpCommand::Rnto) {
+      rename_from_.clear();
+    }
+
+    if (isReadOnly() &&
+        ((ftp_command == FtpCommand::Stor) ||
+         (ftp_command == FtpCommand::Appe) ||
+         (ftp_command == FtpCommand::Dele) ||
+         (ftp_command == FtpCommand::Rnfr) ||
+         (ftp_command == FtpCommand::Rnto) ||
+         (ftp_command == FtpCommand::Rmd))) {
+      sendMessage(static_cast<std::string>(
+          FtpResponse(FtpReplyCode::ACTION_NOT_TAKEN, "Read-only replica")));
+    } else if (const auto* owner = getFtpRemoteOwner(parser)) {
+      // FTP has no redirects, the client has to reconnect to the owner.
+      sendMessage(static_cast<std::string>(FtpResponse(
+          FtpReplyCode::ACTION_NOT_TAKEN,
+          "Object stored on node " + owner->name + " (" + owner->address +
+              ':' + std::to_string(owner->port) + ')')));
+    } else {
+      ftp_handlers_.at(ftp_command)(parser);
+    }
     last_ftp_command_ = ftp_command;
   } else {
     sendMessage(static_cast<std::string>(
@@ -30,6 +53,37 @@ void Session::handleFtp(const std::string& request) noexcept {
   receiveMessage();
 }
 
+const cluster::Node* Session::getFtpRemoteOwner(
+    const protocol::ftp::request::FtpParser& parser) const noexcept {
+  if (parser.getTokens().size() != 2) {
+    return nullptr;
+  }
+
+  // Paths are resolved the same way as by the command handlers.
+  const std::string filename{parser.getTokens()[1]};
+  switch (parser.getCommand()) {
+    case FtpCommand::Retr:
+    case FtpCommand::Stor:
+    case FtpCommand::Appe:
+      return getRemoteOwner(current_working_dir_ + filename);
+    case FtpCommand::Rnfr:
+    case FtpCommand::Rnto:
+      return getRemoteOwner(getFtpPath(filename));
+    case FtpCommand::Dele:
+      return getRemoteOwner(filename);
+    default:
+      return nullptr;
+  }
+}
+
+std::string Session::getFtpPath(std::string_view filename) const {
+  if (!filename.empty() && (filename.front() == '/')) {
+    return std::string{filename};
+  }
+
+  return current_working_dir_ + std::string{filename};
+}
+
 void Session::handleFtpUser(const protocol::ftp::request::FtpParser& parser) {
   // Store the username until the PASS command is received.
   logged_in_user_.reset();
@@ -80,7 +134,7 @@ void Session::handleFtpList(const protocol::ftp::request::FtpParser& parser) {
                   "Listing all objects stored")));
 
   // Serialize the file list into a single text file.
-  const auto filepaths = filesystem_.list();
+  const auto filepaths = buckets_.list();
   const auto directory_listing = std::make_shared<fs::File>();
   for (const auto& filepath : filepaths) {
     *directory_listing += filepath + '\n';
@@ -91,21 +145,23 @@ void Session::handleFtpList(const protocol::ftp::request::FtpParser& parser) {
   auto data_socket = std::make_shared<Socket>(io_service_);
   ftp_data_acceptor_.async_accept(
       *data_socket,
-      ftp_data_serializer_.wrap([data_socket, directory_listing,
-                                 me = shared_from_this()](auto error_code) {
-        if (error_code) {
-          me->sendMessage(static_cast<std::string>(
-              FtpResponse(FtpReplyCode::TRANSFER_ABORTED,
-                          "Data transfer aborted: " + error_code.message())));
-          return;
-        }
-
-        me->ftp_data_socket_ = data_socket;
-        me->enqueueFtpDataHandler(directory_listing, data_socket);
-
-        // NULL pointer indicates end of transmission
-        me->enqueueFtpDataHandler({}, data_socket);
-      }));
+      boost::asio::bind_executor(
+          ftp_data_serializer_,
+          [data_socket, directory_listing,
+           me = shared_from_this()](auto error_code) {
+            if (error_code) {
+              me->sendMessage(static_cast<std::string>(FtpResponse(
+                  FtpReplyCode::TRANSFER_ABORTED,
+                  "Data transfer aborted: " + error_code.message())));
+              return;
+            }
+
+            me->ftp_data_socket_ = data_socket;
+            me->enqueueFtpDataHandler(directory_listing, data_socket);
+
+            // NULL pointer indicates end of transmission
+            me->enqueueFtpDataHandler({}, data_socket);
+          }));
 }
 
 void Session::handleFtpRetr(const protocol::ftp::request::FtpParser& parser) {
@@ -126,44 +182,77 @@ void Session::handleFtpRetr(const protocol::ftp::request::FtpParser& parser) {
                              std::string{parser.getTokens()[1]}};
   // Otherwise, get the file from the filesystem and send it in response (if
   // it was found).
-  const auto [status, file] = filesystem_.get(filepath);
+  getFile(filepath, [this](fs::Status status, const fs::Object& file,
+                           const fs::FileInfo&) {
+    switch (status) {
+      case fs::Status::Success:
+        sendMessage(static_cast<std::string>(
+            FtpResponse(FtpReplyCode::FILE_STATUS_OK_OPENING_DATA_CONNECTION,
+                        "Sending file")));
+        break;
+      default:
+        sendMessage(static_cast<std::string>(
+            FtpResponse(FtpReplyCode::ACTION_NOT_TAKEN, "File not found")));
+        return;
+    }
 
-  switch (status) {
-    case fs::Status::Success:
-      sendMessage(static_cast<std::string>(
-          FtpResponse(FtpReplyCode::FILE_STATUS_OK_OPENING_DATA_CONNECTION,
-                      "Sending file")));
-      break;
-    default:
-      sendMessage(static_cast<std::string>(
-          FtpResponse(FtpReplyCode::ACTION_NOT_TAKEN, "File not found")));
-      return;
+    // Wait for data connection from FTP client on the data socket. Once the
+    // connection is established send the list of files.
+    const auto file_to_send = std::make_shared<fs::File>(file.str());
+    const auto data_socket = std::make_shared<Socket>(io_service_);
+    ftp_data_acceptor_.async_accept(
+        *data_socket,
+        boost::asio::bind_executor(
+            ftp_data_serializer_,
+            [data_socket, file_to_send,
+             me = shared_from_this()](auto error_code) {
+              if (error_code) {
+                me->sendMessage(static_cast<std::string>(FtpResponse(
+                    FtpReplyCode::TRANSFER_ABORTED,
+                    "Data transfer aborted: " + error_code.message())));
+                return;
+              }
+
+              me->ftp_data_socket_ = data_socket;
+              me->enqueueFtpDataHandler(file_to_send, data_socket);
+
+              // NULL pointer indicates end of transmission
+              me->enqueueFtpDataHandler({}, data_socket);
+            }));
+  });
+}
+
+void Session::handleFtpStor(const protocol::ftp::request::FtpParser& parser) {
+  if (!logged_in_user_) {
+    sendMessage(static_cast<std::string>(
+        FtpResponse(FtpReplyCode::NOT_LOGGED_IN, "Not logged in")));
+    return;
   }
 
-  // Wait for data connection from FTP client on the data socket. Once the
-  // connection is established send the list of files.
-  const auto file_to_send = std::make_shared<fs::File>(file);
-  const auto data_socket = std::make_shared<Socket>(io_service_);
-  ftp_data_acceptor_.async_accept(
-      *data_socket,
-      ftp_data_serializer_.wrap([data_socket, file_to_send,
-                                 me = shared_from_this()](auto error_code) {
-        if (error_code) {
-          me->sendMessage(static_cast<std::string>(
-              FtpResponse(FtpReplyCode::TRANSFER_ABORTED,
-                          "Data transfer aborted: " + error_code.message())));
-          return;
-        }
+  if (parser.getTokens().size() != 2) {
+    sendMessage(static_cast<std::string>(FtpResponse(
+        FtpReplyCode::SYNTAX_ERROR_PARAMETERS, "No file specified")));
+    return;
+  }
 
-        me->ftp_data_socket_ = data_socket;
-        me->enqueueFtpDataHandler(file_to_send, data_socket);
+  if (!ftp_data_acceptor_.is_open()) {
+    sendMessage(static_cast<std::string>(
+        FtpResponse(FtpReplyCode::ERROR_OPENING_DATA_CONNECTION,
+                    "Faile to open data connection")));
+    return;
+  }
 
-        // NULL pointer indicates end of transmission
-        me->enqueueFtpDataHandler({}, data_socket);
-      }));
+  sendMessage(static_cast<std::string>(
+      FtpResponse{FtpReplyCode::FILE_STATUS_OK_OPENING_DATA_CONNECTION,
+                  "Ready to receive"}));
+
+  const auto filepath = std::make_shared<std::string>(
+      current_working_dir_ + std::string{parser.getTokens()[1]});
+  const auto file = std::make_shared<fs::File>();
+  acceptFile(file, filepath);
 }
 
-void Session::handleFtpStor(const protocol::ftp::request::FtpParser& parser) {
+void Session::handleFtpAppe(const protocol::ftp::request::FtpParser& parser) {
   if (!logged_in_user_) {
     sendMessage(static_cast<std::string>(
         FtpResponse(FtpReplyCode::NOT_LOGGED_IN, "Not logged in")));
@@ -179,7 +268,7 @@ void Session::handleFtpStor(const protocol::ftp::request::FtpParser& parser) {
   if (!ftp_data_acceptor_.is_open()) {
     sendMessage(static_cast<std::string>(
         FtpResponse(FtpReplyCode::ERROR_OPENING_DATA_CONNECTION,
-                    "Faile to open data connection")));
+                    "Failed to open data connection")));
     return;
   }
 
@@ -190,7 +279,7 @@ void Session::handleFtpStor(const protocol::ftp::request::FtpParser& parser) {
   const auto filepath = std::make_shared<std::string>(
       current_working_dir_ + std::string{parser.getTokens()[1]});
   const auto file = std::make_shared<fs::File>();
-  acceptFile(file, filepath);
+  acceptFile(file, filepath, true);
 }
 
 void Session::handleFtpDele(const protocol::ftp::request::FtpParser& parser) {
@@ -201,10 +290,11 @@ void Session::handleFtpDele(const protocol::ftp::request::FtpParser& parser) {
   }
 
   const auto& filepath = std::string{parser.getTokens()[1]};
-  const auto status = filesystem_.remove(filepath);
+  const auto status = buckets_.route(filepath).remove(filepath);
   switch (status) {
     case fs::Status::Success:
       BOOST_LOG_TRIVIAL(info) << "Deleted file: " << filepath;
+      profile(Access::Remove, filepath);
       sendMessage(static_cast<std::string>(
           FtpResponse(FtpReplyCode::FILE_ACTION_COMPLETED, "File deleted")));
       break;
@@ -278,5 +368,210 @@ void Session::handleFtpCwd(const protocol::ftp::request::FtpParser& parser) {
   }
 }
 
+void Session::handleFtpRnfr(const protocol::ftp::request::FtpParser& parser) {
+  if (!logged_in_user_) {
+    sendMessage(static_cast<std::string>(
+        FtpResponse(FtpReplyCode::NOT_LOGGED_IN, "Not logged in")));
+  } else if (parser.getTokens().size() != 2) {
+    sendMessage(static_cast<std::string>(FtpResponse(
+        FtpReplyCode::SYNTAX_ERROR_PARAMETERS, "No file specified")));
+  } else {
+    rename_from_ = getFtpPath(parser.getTokens()[1]);
+    sendMessage(static_cast<std::string>(
+        FtpResponse(FtpReplyCode::FILE_ACTION_NEEDS_FURTHER_INFO,
+                    "Ready for destination name")));
+  }
+}
+
+void Session::handleFtpRnto(const protocol::ftp::request::FtpParser& parser) {
+  if (!logged_in_user_) {
+    sendMessage(static_cast<std::string>(
+        FtpResponse(FtpReplyCode::NOT_LOGGED_IN, "Not logged in")));
+    return;
+  }
+
+  if (rename_from_.empty()) {
+    sendMessage(static_cast<std::string>(
+        FtpResponse(FtpReplyCode::COMMANDS_BAD_SEQUENCE,
+                    "Please specify file to rename first")));
+    return;
+  }
+
+  if (parser.getTokens().size() != 2) {
+    sendMessage(static_cast<std::string>(FtpResponse(
+        FtpReplyCode::SYNTAX_ERROR_PARAMETERS, "No file specified")));
+    return;
+  }
+
+  const auto source = std::move(rename_from_);
+  rename_from_.clear();
+  const auto destination = getFtpPath(parser.getTokens()[1]);
+  if (!buckets_.isSameBucket(source, destination)) {
+    sendMessage(static_cast<std::string>(
+        FtpResponse(FtpReplyCode::ACTION_NOT_TAKEN_FILENAME_NOT_ALLOWED,
+                    "Files cannot be moved between buckets")));
+    return;
+  }
+
+  // Renaming a file on disk reads it back first, which must not block the
+  // session.
+  modifyFile(
+      source,
+      [source, destination](fs::IFilesystem& filesystem) {
+        return filesystem.rename(source, destination);
+      },
+      [me = shared_from_this(), source, destination](fs::Status status) {
+        switch (status) {
+          case fs::Status::Success:
+            BOOST_LOG_TRIVIAL(info)
+                << "Renamed file: " << source << " -> " << destination;
+            me->sendMessage(static_cast<std::string>(FtpResponse(
+                FtpReplyCode::FILE_ACTION_COMPLETED, "File renamed")));
+            break;
+          case fs::Status::AlreadyExists:
+            me->sendMessage(static_cast<std::string>(
+                FtpResponse(FtpReplyCode::ACTION_NOT_TAKEN_FILENAME_NOT_ALLOWED,
+                            "File already exists")));
+            break;
+          default:
+            me->sendMessage(static_cast<std::string>(FtpResponse(
+                FtpReplyCode::ACTION_NOT_TAKEN, "Unable to rename file")));
+            break;
+        }
+      });
+}
+
+void Session::handleFtpRmd(const protocol::ftp::request::FtpParser& parser) {
+  if (!logged_in_user_) {
+    sendMessage(static_cast<std::string>(
+        FtpResponse(FtpReplyCode::NOT_LOGGED_IN, "Not logged in")));
+    return;
+  }
+
+  if (parser.getTokens().size() != 2) {
+    sendMessage(static_cast<std::string>(FtpResponse(
+        FtpReplyCode::SYNTAX_ERROR_PARAMETERS, "No directory specified")));
+    return;
+  }
+
+  auto directory = getFtpPath(parser.getTokens()[1]);
+  if (directory.back() != '/') {
+    directory += '/';
+  }
+
+  // Other cluster nodes are asked over HTTP, with the credentials of the
+  // logged in user.
+  std::optional<std::string> authorization;
+  if (authenticate_) {
+    authorization = "Basic " + utils::encode_base64(logged_in_user_->username +
+                                                    ':' +
+                                                    logged_in_user_->password);
+  }
+
+  removeDirectory(
+      directory, cluster_ != nullptr, authorization,
+      [this](std::optional<std::size_t> count) {
+        sendMessage(static_cast<std::string>(
+            count ? FtpResponse(FtpReplyCode::FILE_ACTION_COMPLETED,
+                                "Directory removed (" + std::to_string(*count) +
+                                    " file(s))")
+                  : FtpResponse(FtpReplyCode::ACTION_NOT_TAKEN,
+                                "Unable to remove directory on all nodes")));
+      });
+}
+
+void Session::handleFtpSize(const protocol::ftp::request::FtpParser& parser) {
+  if (!logged_in_user_) {
+    sendMessage(static_cast<std::string>(
+        FtpResponse(FtpReplyCode::NOT_LOGGED_IN, "Not logged in")));
+    return;
+  }
+
+  if (parser.getTokens().size() != 2) {
+    sendMessage(static_cast<std::string>(FtpResponse(
+        FtpReplyCode::SYNTAX_ERROR_PARAMETERS, "No file specified")));
+    return;
+  }
+
+  const auto path = getFtpPath(parser.getTokens()[1]);
+  if (path.back() != '/') {
+    const auto [status, info] = buckets_.route(path).stat(path);
+    if (status == fs::Status::Success) {
+      sendMessage(static_cast<std::string>(
+          FtpResponse(FtpReplyCode::FILE_STATUS, std::to_string(info.size))));
+      return;
+    }
+  }
+
+  const auto directory = getFtpDirectoryUsage(path);
+  sendMessage(static_cast<std::string>(
+      directory ? FtpResponse(FtpReplyCode::FILE_STATUS,
+                              std::to_string(directory->second.bytes))
+                : FtpResponse(FtpReplyCode::ACTION_NOT_TAKEN,
+                              "No such file or directory")));
+}
+
+void Session::handleFtpStat(const protocol::ftp::request::FtpParser& parser) {
+  if (!logged_in_user_) {
+    sendMessage(static_cast<std::string>(
+        FtpResponse(FtpReplyCode::NOT_LOGGED_IN, "Not logged in")));
+    return;
+  }
+
+  if (parser.getTokens().size() > 2) {
+    sendMessage(static_cast<std::string>(FtpResponse(
+        FtpReplyCode::SYNTAX_ERROR_PARAMETERS, "Too many arguments")));
+    return;
+  }
+
+  if (parser.getTokens().size() == 1) {
+    const auto usage = buckets_.getUsage("/");
+    sendMessage(static_cast<std::string>(FtpResponse(
+        FtpReplyCode::REPLY_SYSTEM_STATUS,
+        std::to_string(usage.objects) + " file(s), " +
+            std::to_string(usage.bytes) + " byte(s) stored")));
+    return;
+  }
+
+  const auto path = getFtpPath(parser.getTokens()[1]);
+  if (path.back() != '/') {
+    const auto [status, info] = buckets_.route(path).stat(path);
+    if (status == fs::Status::Success) {
+      sendMessage(static_cast<std::string>(
+          FtpResponse(FtpReplyCode::FILE_STATUS,
+                      path + ": " + std::to_string(info.size) + " byte(s)")));
+      return;
+    }
+  }
+
+  const auto directory = getFtpDirectoryUsage(path);
+  if (!directory) {
+    sendMessage(static_cast<std::string>(FtpResponse(
+        FtpReplyCode::ACTION_NOT_TAKEN, "No such file or directory")));
+    return;
+  }
+
+  const auto& [directory_path, usage] = *directory;
+  sendMessage(static_cast<std::string>(FtpResponse(
+      FtpReplyCode::DIRECTORY_STATUS,
+      directory_path + ": " + std::to_string(usage.objects) + " file(s), " +
+          std::to_string(usage.bytes) + " byte(s)")));
+}
+
+std::optional<std::pair<std::string, fs::Usage>>
+Session::getFtpDirectoryUsage(std::string path) {
+  if (path.back() != '/') {
+    path += '/';
+  }
+
+  // Directories only exist as prefixes of the files stored under them.
+  const auto usage = buckets_.getUsage(path);
+  if ((usage.objects == 0) && (path != "/")) {
+    return {};
+  }
+
+  return std::pair{std::move(path), usage};
+}
+
 }  // namespace object_storage
-}  // namespace server
\ No newline at end of file
+}  // namespace server
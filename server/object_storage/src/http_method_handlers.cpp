@@ -1,27 +1,252 @@
 #include <boost/log/trivial.hpp>
 
+#include <algorithm>
+#include <array>
+#include <string_view>
+
+#include "cluster/src/peer_client.hpp"
 #include "protocol/http/response/src/http_response.hpp"
 #include "session.hpp"
+#include "utils/src/utils.hpp"
 
 namespace server {
 namespace object_storage {
 
+using protocol::http::request::HttpMethod;
 using protocol::http::request::HttpParser;
 using protocol::http::response::HttpResource;
 using protocol::http::response::HttpResponse;
 using protocol::http::response::HttpResponseHeaders;
 using protocol::http::response::HttpStatus;
+using protocol::http::response::toHttpDate;
+
+namespace {
+
+/// Listings and reports generated on request (rather than stored objects).
+constexpr std::array<std::string_view, 6> kGeneratedResources{
+    "/", "/_replication", "/_changes", "/_du", "/_merkle", "/_profile"};
+
+/**
+ * \brief Check if a resource is generated on request.
+ *
+ * \param uri Resource URI.
+ *
+ * \return True if the resource is a listing or a report, false otherwise.
+ */
+bool isGeneratedResource(std::string_view uri) noexcept {
+  return std::find(kGeneratedResources.cbegin(), kGeneratedResources.cend(),
+                   uri) != kGeneratedResources.cend();
+}
+
+/**
+ * \brief Check if a request is served by any cluster node, whichever node
+ * owns its URI.
+ *
+ * \param parser Parsed request.
+ *
+ * \return True if the request is served locally, false otherwise.
+ */
+bool isServedByAnyNode(const HttpParser& parser) noexcept {
+  // Directories are deleted from all nodes by the node asked.
+  return isGeneratedResource(parser.getUri()) ||
+         ((parser.getMethod() == HttpMethod::Delete) &&
+          parser.getQueryParameter("recursive"));
+}
+
+/**
+ * \brief Return name of a mutation type, as reported by the change feed.
+ *
+ * \param type Mutation type.
+ *
+ * \return Mutation type name.
+ */
+std::string_view toString(fs::MutationType type) noexcept {
+  switch (type) {
+    case fs::MutationType::Put:
+      return "PUT";
+    case fs::MutationType::Write:
+      return "WRITE";
+    case fs::MutationType::Remove:
+      return "REMOVE";
+  }
+
+  return "UNKNOWN";
+}
+
+/**
+ * \brief Format a file version as a strong entity tag.
+ *
+ * \param version File version.
+ *
+ * \return Entity tag (with the quotes).
+ */
+std::string toEntityTag(fs::Version version) {
+  return '"' + std::to_string(version) + '"';
+}
+
+/**
+ * \brief Parse a strong entity tag naming a file version.
+ *
+ * \param tag Entity tag (with the quotes).
+ *
+ * \return File version, or nothing if the tag is weak or malformed.
+ */
+std::optional<fs::Version> parseEntityTag(std::string_view tag) noexcept {
+  if ((tag.size() < 2) || (tag.front() != '"') || (tag.back() != '"')) {
+    return {};
+  }
+
+  return utils::toNumber(tag.substr(1, tag.size() - 2));
+}
 
-void Session::handleHttp(std::string& request) noexcept {
-  auto status_line_size = request.size();
+/// Header carrying the CRC32C of a request or response body (base64 of the
+/// checksum in big-endian byte order).
+constexpr std::string_view kChecksumHeader{"x-amz-checksum-crc32c"};
 
-  // Read the rest of the HTTP request (excluding message body)
-  auto response_headers_size =
-      boost::asio::read_until(socket_, input_stream_, "\r\n\r\n");
-  std::istream stream(&input_stream_);
-  request.resize(request.size() + response_headers_size);
-  stream.read(&request[status_line_size], response_headers_size);
+/**
+ * \brief Format a checksum as the value of kChecksumHeader.
+ *
+ * \param checksum Checksum.
+ *
+ * \return Header value.
+ */
+std::string toChecksumHeader(fs::Checksum checksum) {
+  const char bytes[] = {static_cast<char>(checksum >> 24),
+                        static_cast<char>(checksum >> 16),
+                        static_cast<char>(checksum >> 8),
+                        static_cast<char>(checksum)};
+  return utils::encode_base64(std::string_view{bytes, sizeof(bytes)});
+}
+
+/**
+ * \brief Parse the value of kChecksumHeader.
+ *
+ * \param value Header value.
+ *
+ * \return Checksum, or nothing if the value is malformed.
+ */
+std::optional<fs::Checksum> parseChecksumHeader(std::string_view value) {
+  const auto bytes = utils::decode_base64(std::string{value});
+  if (!bytes || (bytes->size() != sizeof(fs::Checksum))) {
+    return {};
+  }
+
+  fs::Checksum checksum{0};
+  for (const auto byte : *bytes) {
+    checksum = (checksum << 8) | static_cast<unsigned char>(byte);
+  }
+  return checksum;
+}
+
+/**
+ * \brief Return validators of a file version.
+ *
+ * \param info File metadata.
+ *
+ * \return ETag and Last-Modified response headers, and the checksum of the
+ * contents if it was recorded.
+ */
+HttpResponseHeaders getValidators(const fs::FileInfo& info) {
+  HttpResponseHeaders headers{{"ETag", toEntityTag(info.version)},
+                              {"Last-Modified", toHttpDate(info.modified)}};
+  if (info.checksum) {
+    headers.emplace_back(std::string{kChecksumHeader},
+                         toChecksumHeader(*info.checksum));
+  }
+  return headers;
+}
+
+/**
+ * \brief Check if the client of a conditional GET (or HEAD) request already
+ * holds the current version of a file.
+ *
+ * If-None-Match takes precedence over If-Modified-Since. Entity tags are
+ * compared weakly, i.e. "W/" prefixes are ignored.
+ *
+ * \param parser Parsed HTTP request.
+ * \param info File metadata.
+ *
+ * \return True if the file was not modified, false otherwise.
+ */
+bool isNotModified(const HttpParser& parser, const fs::FileInfo& info) {
+  if (const auto if_none_match = parser["if-none-match"]) {
+    const auto current = toEntityTag(info.version);
+    for (auto tag : utils::split(*if_none_match, ",")) {
+      while (!tag.empty() && (tag.front() == ' ')) {
+        tag.remove_prefix(1);
+      }
+      while (!tag.empty() && (tag.back() == ' ')) {
+        tag.remove_suffix(1);
+      }
+      if (tag.substr(0, 2) == "W/") {
+        tag.remove_prefix(2);
+      }
+
+      if ((tag == "*") || (tag == current)) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  // HTTP dates have a resolution of one second.
+  const auto since = parser.getIfModifiedSince();
+  return since &&
+         (std::chrono::floor<std::chrono::seconds>(info.modified) <= *since);
+}
 
+/**
+ * \brief Build the precondition of a conditional mutation.
+ *
+ * Supports "If-Match: *", "If-Match: <entity tag>" and "If-None-Match: *".
+ *
+ * \param parser Parsed HTTP request.
+ *
+ * \return Precondition (empty if the request is unconditional), or nothing
+ * if it can never hold: weak or malformed entity tags never match, and
+ * If-None-Match is only supported with '*'.
+ */
+std::optional<fs::Precondition> getPrecondition(const HttpParser& parser) {
+  fs::Precondition precondition;
+
+  if (const auto if_match = parser["if-match"]) {
+    if (*if_match == "*") {
+      precondition.exists = true;
+    } else if (const auto version = parseEntityTag(*if_match)) {
+      precondition.version = version;
+    } else {
+      return {};
+    }
+  }
+
+  if (const auto if_none_match = parser["if-none-match"]) {
+    if ((*if_none_match != "*") || precondition.exists ||
+        precondition.version) {
+      return {};
+    }
+    precondition.exists = false;
+  }
+
+  return precondition;
+}
+
+/**
+ * \brief Return the multipart upload a request refers to.
+ *
+ * \param parser Parsed HTTP request.
+ *
+ * \return Identifier from the 'uploadId' query parameter, if present and
+ * valid.
+ */
+std::optional<fs::UploadId> getUploadId(const HttpParser& parser) noexcept {
+  const auto value = parser.getQueryParameter("uploadId");
+  return value ? utils::toNumber(*value) : std::nullopt;
+}
+
+}  // namespace
+
+void Session::handleHttp(const std::string& request) noexcept {
   BOOST_LOG_TRIVIAL(debug) << "HTTP request:\n" << request;
 
   // If request is valid, delegate it to the right handler based on the HTTP
@@ -36,6 +261,24 @@ void Session::handleHttp(std::string& request) noexcept {
         HttpResponse{HttpStatus::Unauthorized,
                      HttpResponseHeaders{{"WWW-Authenticate", "Basic"},
                                          {"Content-Length", "0"}}}));
+  } else if (isReadOnly() && (parser.getMethod() != HttpMethod::Get) &&
+             (parser.getMethod() != HttpMethod::Head)) {
+    BOOST_LOG_TRIVIAL(debug)
+        << "Refused write to read-only replica: " << parser.getUri();
+    rejectHttpRequest(
+        parser, static_cast<std::string>(HttpResponse{HttpStatus::Forbidden}));
+  } else if (const auto* owner = getRemoteOwner(parser.getUri());
+             owner && !isServedByAnyNode(parser)) {
+    // Objects owned by other cluster nodes are served by their owners.
+    auto location = "http://" + owner->address + ':' +
+                    std::to_string(owner->port) + std::string{parser.getUri()};
+    if (!parser.getQuery().empty()) {
+      location += '?' + std::string{parser.getQuery()};
+    }
+    const HttpResponseHeaders headers{{"Location", location},
+                                      {"Content-Length", "0"}};
+    rejectHttpRequest(parser, static_cast<std::string>(HttpResponse{
+                                  HttpStatus::TemporaryRedirect, headers}));
   } else {
     http_handlers_.at(parser.getMethod())(parser);
   }
@@ -58,10 +301,235 @@ bool Session::authHttpUser(const HttpParser& parser) noexcept {
   return true;
 }
 
+void Session::rejectHttpRequest(const HttpParser& parser,
+                                const std::string& response) {
+  if (parser.getResourceSize() > 0) {
+    receiveHttpBody(parser, [this, response](const std::shared_ptr<fs::File>&,
+                                             fs::Checksum) {
+      sendMessage(response);
+    });
+    return;
+  }
+
+  sendMessage(response);
+  receiveMessage();
+}
+
+void Session::listCluster(const HttpParser& parser) {
+  std::optional<std::string> authorization;
+  if (parser["authorization"]) {
+    authorization = std::string{*parser["authorization"]};
+  }
+
+  blocking_io_service_.post([me = shared_from_this(), authorization]() {
+    auto filepaths = me->buckets_.list();
+    bool complete{true};
+    for (const auto& node : me->cluster_->getNodes()) {
+      if (&node == &me->cluster_->getSelf()) {
+        continue;
+      }
+
+      const auto listing = cluster::listPeer(
+          node, authorization, me->cluster_->getRequestTimeout());
+      if (!listing) {
+        BOOST_LOG_TRIVIAL(error) << "Failed to list files of cluster node "
+                                 << node.name;
+        complete = false;
+        break;
+      }
+
+      for (const auto filepath : utils::split(*listing, "\n")) {
+        if (!filepath.empty()) {
+          filepaths.emplace_back(filepath);
+        }
+      }
+    }
+
+    std::sort(filepaths.begin(), filepaths.end());
+    std::string response;
+    for (const auto& filepath : filepaths) {
+      response += filepath + '\n';
+    }
+
+    boost::asio::post(me->serializer_, [me, complete,
+                                        response = std::move(response)]() {
+      me->sendMessage(static_cast<std::string>(
+          complete ? HttpResponse{HttpStatus::Ok, response}
+                   : HttpResponse{HttpStatus::BadGateway}));
+      me->receiveMessage();
+    });
+  });
+}
+
+void Session::getChanges(const HttpParser& parser) {
+  const auto since_value = parser.getQueryParameter("since");
+  const auto since =
+      since_value ? utils::toNumber(*since_value) : std::nullopt;
+
+  auto timeout = kChangesTimeout;
+  if (const auto timeout_value = parser.getQueryParameter("timeout")) {
+    const auto milliseconds = utils::toNumber(*timeout_value);
+    timeout = milliseconds ? std::min(std::chrono::milliseconds(*milliseconds),
+                                      kMaxChangesTimeout)
+                           : std::chrono::milliseconds{-1};
+  }
+
+  if (!since || (timeout.count() < 0)) {
+    sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::BadRequest}));
+    receiveMessage();
+    return;
+  }
+
+  sendChanges(*since, std::chrono::steady_clock::now() + timeout);
+}
+
+void Session::getUsage(const HttpParser& parser) {
+  std::string directory{parser.getQueryParameter("prefix").value_or("/")};
+  if (directory.empty() || (directory.front() != '/')) {
+    sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::BadRequest}));
+    receiveMessage();
+    return;
+  }
+
+  if (directory.back() != '/') {
+    directory += '/';
+  }
+
+  const auto usage = buckets_.getUsage(directory);
+  sendMessage(static_cast<std::string>(HttpResponse{
+      HttpStatus::Ok, "objects: " + std::to_string(usage.objects) +
+                          "\nbytes: " + std::to_string(usage.bytes) + '\n'}));
+  receiveMessage();
+}
+
+void Session::getMerkleNode(const HttpParser& parser) {
+  const auto& filesystem = buckets_.getDefault();
+  if (!filesystem.hasMerkleTree()) {
+    sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::NotFound}));
+    receiveMessage();
+    return;
+  }
+
+  const auto index_value = parser.getQueryParameter("node");
+  const auto index = index_value ? utils::toNumber(*index_value)
+                                 : std::optional<std::size_t>{1};
+  const auto node = index ? filesystem.getMerkleNode(*index) : std::nullopt;
+  if (!node) {
+    sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::BadRequest}));
+    receiveMessage();
+    return;
+  }
+
+  auto response =
+      std::to_string(node->index) + ' ' + std::to_string(node->digest) + '\n';
+  for (std::size_t child = 0; child < node->children.size(); child++) {
+    response += std::to_string(2 * node->index + child) + ' ' +
+                std::to_string(node->children[child]) + '\n';
+  }
+  for (const auto& [path, digest] : node->files) {
+    response += "file " + std::to_string(digest) + ' ' + path + '\n';
+  }
+
+  sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::Ok, response}));
+  receiveMessage();
+}
+
+void Session::getProfile(const HttpParser& parser) {
+  if (!profiler_) {
+    sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::NotFound}));
+    receiveMessage();
+    return;
+  }
+
+  // Accesses recorded between the report and the reset are lost, which is
+  // fine for a sample.
+  const auto report = profiler_->report();
+  if (parser.getQueryParameter("reset")) {
+    profiler_->reset();
+  }
+
+  sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::Ok, report}));
+  receiveMessage();
+}
+
+void Session::sendChanges(std::uint64_t since,
+                          std::chrono::steady_clock::time_point deadline) {
+  const auto mutations = buckets_.getDefault().getMutations(
+      since, kMaxChanges, std::chrono::milliseconds{0});
+  if (!mutations) {
+    sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::Gone}));
+    receiveMessage();
+    return;
+  }
+
+  if (mutations->empty() && (std::chrono::steady_clock::now() < deadline)) {
+    // The timer is cancelled early by the next mutation.
+    auto timer = std::make_shared<boost::asio::steady_timer>(io_service_);
+    timer->expires_at(deadline);
+    const auto wait = buckets_.getDefault().asyncWaitForMutations(
+        since, [me = shared_from_this(), timer] {
+          boost::asio::post(me->serializer_, [timer] { timer->cancel(); });
+        });
+    timer->async_wait(boost::asio::bind_executor(
+        serializer_,
+        [me = shared_from_this(), timer, since, deadline, wait](ErrorCode) {
+          me->buckets_.getDefault().cancelMutationWait(wait);
+          me->sendChanges(since, deadline);
+        }));
+    return;
+  }
+
+  std::string response;
+  for (const auto& mutation : *mutations) {
+    response += std::to_string(mutation.sequence) + ' ' +
+                std::string{toString(mutation.type)} + ' ' + mutation.path +
+                '\n';
+  }
+
+  sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::Ok, response}));
+  receiveMessage();
+}
+
 void Session::handleHttpGet(const HttpParser& parser) {
+  if ((parser.getUri() == "/_replication") && replica_) {
+    // Report the replication state (including lag) of this server.
+    sendMessage(static_cast<std::string>(HttpResponse{
+        HttpStatus::Ok, replication::toString(replica_->getStatus())}));
+
+    receiveMessage();
+    return;
+  }
+
+  if (parser.getUri() == "/_changes") {
+    getChanges(parser);
+    return;
+  }
+
+  if (parser.getUri() == "/_du") {
+    getUsage(parser);
+    return;
+  }
+
+  if (parser.getUri() == "/_merkle") {
+    getMerkleNode(parser);
+    return;
+  }
+
+  if (parser.getUri() == "/_profile") {
+    getProfile(parser);
+    return;
+  }
+
+  if ((parser.getUri() == "/") && cluster_ &&
+      !parser[std::string{cluster::kLocalRequestHeader}]) {
+    // Listing of a cluster node includes files stored on all nodes.
+    listCluster(parser);
+    return;
+  }
+
   if (parser.getUri() == "/") {
     // If request has 'GET /' format, list all files stored in the filesystem.
-    const auto filepaths = filesystem_.list();
+    const auto filepaths = buckets_.list();
     std::string response;
     for (const auto& filepath : filepaths) {
       response += filepath + '\n';
@@ -69,81 +537,405 @@ void Session::handleHttpGet(const HttpParser& parser) {
     sendMessage(
         static_cast<std::string>(HttpResponse{HttpStatus::Ok, response}));
 
-  } else {
-    // Otherwise, get the file from the filesystem and send it in response (if
-    // it was found).
-    const auto [status, file] = filesystem_.get(std::string{parser.getUri()});
+    receiveMessage();
+    return;
+  }
+
+  const auto filepath = std::string{parser.getUri()};
+
+  // Conditional requests are answered from the file metadata, without reading
+  // the file.
+  if (parser["if-none-match"] || parser["if-modified-since"]) {
+    const auto [status, info] = buckets_.route(filepath).stat(filepath);
+    if ((status == fs::Status::Success) && isNotModified(parser, info)) {
+      sendMessage(static_cast<std::string>(
+          HttpResponse{HttpStatus::NotModified, getValidators(info)}));
+      receiveMessage();
+      return;
+    }
+  }
+
+  // Otherwise, get the file from the filesystem and send it in response (if
+  // it was found).
+  getFile(filepath,
+          [this](fs::Status status, const fs::Object& file,
+                 const fs::FileInfo& info) {
+            switch (status) {
+              case fs::Status::Success:
+                sendMessage(static_cast<std::string>(HttpResponse{
+                    HttpStatus::Ok, getValidators(info), file.str()}));
+                break;
+              case fs::Status::FileNotFound:
+                sendMessage(static_cast<std::string>(
+                    HttpResponse{HttpStatus::NotFound}));
+                break;
+              default:
+                sendMessage(static_cast<std::string>(
+                    HttpResponse{HttpStatus::InternalServerError}));
+                break;
+            }
+
+            receiveMessage();
+          });
+}
+
+void Session::handleHttpHead(const HttpParser& parser) {
+  const auto filepath = std::string{parser.getUri()};
+  if (isGeneratedResource(filepath)) {
+    // Listings and reports are generated on request, only GET them.
+    sendMessage(static_cast<std::string>(HttpResponse{
+        HttpStatus::MethodNotAllowed,
+        HttpResponseHeaders{{"Allow", "GET"}, {"Content-Length", "0"}}}));
+    receiveMessage();
+    return;
+  }
+
+  const auto [status, info] = buckets_.route(filepath).stat(filepath);
+  switch (status) {
+    case fs::Status::Success: {
+      auto headers = getValidators(info);
+      if (isNotModified(parser, info)) {
+        sendMessage(static_cast<std::string>(
+            HttpResponse{HttpStatus::NotModified, headers}));
+        break;
+      }
+
+      // Same headers as a GET response, without the body.
+      headers.emplace_back("Content-Type", "application/octet-stream");
+      headers.emplace_back("Content-Length", std::to_string(info.size));
+      sendMessage(
+          static_cast<std::string>(HttpResponse{HttpStatus::Ok, headers}));
+      break;
+    }
+    case fs::Status::FileNotFound:
+      sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::NotFound}));
+      break;
+    default:
+      sendMessage(static_cast<std::string>(
+          HttpResponse{HttpStatus::InternalServerError}));
+      break;
+  }
+
+  receiveMessage();
+}
+
+void Session::receiveHttpBody(
+    const HttpParser& parser,
+    const std::function<void(const std::shared_ptr<fs::File>& body,
+                             fs::Checksum checksum)>& handler,
+    bool handler_resumes) {
+  // Checksum sent by the client, if any (empty if malformed, so that it never
+  // matches).
+  std::optional<std::optional<fs::Checksum>> expected;
+  if (const auto value = parser[std::string{kChecksumHeader}]) {
+    expected = parseChecksumHeader(*value);
+  }
+
+  if (parser["expect"] && (*parser["expect"] == "100-continue")) {
+    sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::Continue}));
+  }
+
+  const auto body_size = parser.getResourceSize();
+  auto body = std::make_shared<fs::File>();
+  body->resize(body_size);
+
+  // The start of the body may have arrived along with the header.
+  const auto buffered = consumeInput(body_size);
+  std::copy(buffered.begin(), buffered.end(), body->begin());
+
+  // Every chunk is checksummed as soon as it is read, while it is still in
+  // cache, rather than in a pass of its own over the whole body. The
+  // completion condition is called after each read but the last one, with
+  // the number of bytes read so far.
+  auto checksum = std::make_shared<std::pair<std::size_t, fs::Checksum>>();
+  const auto extend = [body, checksum](std::size_t length) {
+    auto& [checked, crc] = *checksum;
+    crc = fs::crc32c(std::string_view{*body}.substr(checked, length - checked),
+                     crc);
+    checked = length;
+  };
+  extend(buffered.size());
+  const auto checksum_chunks = [body, extend, offset = buffered.size()](
+                                   const ErrorCode& error_code,
+                                   std::size_t length) {
+    extend(offset + length);
+    return error_code ? 0
+                      : std::min<std::size_t>(
+                            body->size() - offset - length, kMaxBodyChunkSize);
+  };
+
+  boost::asio::async_read(
+      socket_, boost::asio::buffer(*body) + buffered.size(), checksum_chunks,
+      boost::asio::bind_executor(
+          serializer_,
+          [me = shared_from_this(), body, checksum, extend, expected,
+           handler, handler_resumes,
+           offset = buffered.size()](ErrorCode error_code,
+                                     std::size_t length) {
+            extend(offset + length);
+            if (error_code) {
+              me->sendMessage(static_cast<std::string>(
+                  HttpResponse{HttpStatus::InternalServerError}));
+            } else if (expected && (*expected != checksum->second)) {
+              BOOST_LOG_TRIVIAL(warning)
+                  << "Refused request body not matching its checksum";
+              me->sendMessage(static_cast<std::string>(
+                  HttpResponse{HttpStatus::BadRequest}));
+            } else {
+              handler(body, checksum->second);
+              if (handler_resumes) {
+                return;
+              }
+            }
+
+            me->receiveMessage();
+          }));
+}
+
+void Session::handleHttpPut(const HttpParser& parser) {
+  if (parser.getQueryParameter("uploadId")) {
+    uploadHttpPart(parser);
+    return;
+  }
+
+  const auto filepath = std::string{parser.getUri()};
+  const auto conditional = parser["if-match"] || parser["if-none-match"];
+
+  // Unconditional puts never replace existing files.
+  const auto precondition =
+      conditional ? getPrecondition(parser) : fs::Precondition{false};
+  if (!precondition) {
+    rejectHttpRequest(parser, static_cast<std::string>(HttpResponse{
+                                  HttpStatus::PreconditionFailed}));
+    return;
+  }
+
+  receiveHttpBody(parser, [this, filepath, conditional, precondition](
+                              const std::shared_ptr<fs::File>& file,
+                              fs::Checksum checksum) {
+    auto& filesystem = buckets_.route(filepath);
+    const auto [status, version] =
+        filesystem.put(filepath, *file, *precondition, checksum);
     switch (status) {
       case fs::Status::Success:
-        sendMessage(
-            static_cast<std::string>(HttpResponse{HttpStatus::Ok, file}));
+        BOOST_LOG_TRIVIAL(info) << "Saved file: " << filepath;
+        profile(Access::Write, filepath, file->size());
+        sendMessage(static_cast<std::string>(
+            HttpResponse{HttpStatus::Created,
+                         HttpResponseHeaders{{"ETag", toEntityTag(version)},
+                                             {"Content-Length", "0"}}}));
+        break;
+      case fs::Status::PreconditionFailed:
+        sendMessage(static_cast<std::string>(
+            HttpResponse{conditional ? HttpStatus::PreconditionFailed
+                                     : HttpStatus::NotFound}));
+        break;
+      default:
+        sendMessage(static_cast<std::string>(
+            HttpResponse{HttpStatus::InternalServerError}));
+        break;
+    }
+  });
+}
+
+void Session::handleHttpPost(const HttpParser& parser) {
+  const auto filepath = std::string{parser.getUri()};
+
+  if (parser.getQueryParameter("uploads")) {
+    receiveHttpBody(parser, [this, filepath](const std::shared_ptr<fs::File>&,
+                                             fs::Checksum) {
+      const auto upload = buckets_.route(filepath).createUpload(filepath);
+      BOOST_LOG_TRIVIAL(info)
+          << "Started upload " << upload << " of file: " << filepath;
+      sendMessage(static_cast<std::string>(
+          HttpResponse{HttpStatus::Ok, std::to_string(upload) + '\n'}));
+    });
+    return;
+  }
+
+  const auto upload = getUploadId(parser);
+  const auto conditional = parser["if-match"] || parser["if-none-match"];
+  const auto precondition =
+      conditional ? getPrecondition(parser) : fs::Precondition{false};
+  if (!upload) {
+    rejectHttpRequest(parser, static_cast<std::string>(
+                                  HttpResponse{HttpStatus::BadRequest}));
+    return;
+  }
+  if (!precondition) {
+    rejectHttpRequest(parser, static_cast<std::string>(HttpResponse{
+                                  HttpStatus::PreconditionFailed}));
+    return;
+  }
+
+  // The request body (if any) is ignored, the parts make up the file.
+  receiveHttpBody(parser, [this, filepath, upload, conditional, precondition](
+                              const std::shared_ptr<fs::File>&, fs::Checksum) {
+    const auto [status, version] = buckets_.route(filepath).completeUpload(
+        *upload, filepath, *precondition);
+    switch (status) {
+      case fs::Status::Success:
+        BOOST_LOG_TRIVIAL(info) << "Completed upload " << *upload
+                                << " of file: " << filepath;
+        sendMessage(static_cast<std::string>(
+            HttpResponse{HttpStatus::Created,
+                         HttpResponseHeaders{{"ETag", toEntityTag(version)},
+                                             {"Content-Length", "0"}}}));
         break;
       case fs::Status::FileNotFound:
         sendMessage(
             static_cast<std::string>(HttpResponse{HttpStatus::NotFound}));
         break;
+      case fs::Status::PreconditionFailed:
+        // Unconditional uploads never replace existing files. Unlike PUT,
+        // 404 is kept for uploads which do not exist.
+        sendMessage(static_cast<std::string>(
+            HttpResponse{conditional ? HttpStatus::PreconditionFailed
+                                     : HttpStatus::Conflict}));
+        break;
       default:
         sendMessage(static_cast<std::string>(
             HttpResponse{HttpStatus::InternalServerError}));
         break;
     }
-  }
-
-  receiveMessage();
+  });
 }
 
-void Session::handleHttpPut(const HttpParser& parser) {
-  if (parser["expect"] && (*parser["expect"] == "100-continue")) {
-    sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::Continue}));
-  }
+void Session::uploadHttpPart(const HttpParser& parser) {
+  const auto filepath = std::string{parser.getUri()};
+  const auto upload = getUploadId(parser);
+  const auto number_value = parser.getQueryParameter("partNumber");
+  const auto number =
+      number_value ? utils::toNumber(*number_value) : std::nullopt;
+
+  receiveHttpBody(parser, [this, filepath, upload, number](
+                              const std::shared_ptr<fs::File>& data,
+                              fs::Checksum) {
+    if (!upload || !number) {
+      sendMessage(
+          static_cast<std::string>(HttpResponse{HttpStatus::BadRequest}));
+      return;
+    }
+
+    auto& filesystem = buckets_.route(filepath);
+    switch (filesystem.uploadPart(*upload, filepath, *number, *data)) {
+      case fs::Status::Success:
+        BOOST_LOG_TRIVIAL(debug) << "Saved part " << *number << " of upload "
+                                 << *upload << ": " << filepath;
+        profile(Access::Write, filepath, data->size());
+        sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::Ok}));
+        break;
+      case fs::Status::FileNotFound:
+        sendMessage(
+            static_cast<std::string>(HttpResponse{HttpStatus::NotFound}));
+        break;
+      case fs::Status::InvalidRange:
+        sendMessage(
+            static_cast<std::string>(HttpResponse{HttpStatus::BadRequest}));
+        break;
+      default:
+        sendMessage(static_cast<std::string>(
+            HttpResponse{HttpStatus::InternalServerError}));
+        break;
+    }
+  });
+}
 
-  const auto file_size = parser.getResourceSize();
+void Session::handleHttpPatch(const HttpParser& parser) {
   const auto filepath = std::string{parser.getUri()};
-  auto file = std::make_shared<fs::File>();
-  file->resize(file_size);
+  const auto content_range = parser.getContentRange();
+  const auto body_size = parser.getResourceSize();
 
-  boost::asio::async_read(
-      socket_, boost::asio::buffer(*file),
-      boost::asio::transfer_exactly(file_size),
-      serializer_.wrap([me = shared_from_this(), file, filepath](
-                           ErrorCode error_code, std::size_t length) {
-        if (error_code) {
-          me->sendMessage(static_cast<std::string>(
-              HttpResponse{HttpStatus::InternalServerError}));
-        } else {
-          const auto status = me->filesystem_.add(std::string{filepath}, *file);
-          switch (status) {
-            case fs::Status::Success:
-              BOOST_LOG_TRIVIAL(info) << "Saved file: " << filepath;
-              me->sendMessage(
-                  static_cast<std::string>(HttpResponse{HttpStatus::Created}));
-              break;
-            case fs::Status::AlreadyExists:
-              me->sendMessage(
-                  static_cast<std::string>(HttpResponse{HttpStatus::NotFound}));
-              break;
-            default:
-              me->sendMessage(static_cast<std::string>(
-                  HttpResponse{HttpStatus::InternalServerError}));
-              break;
-          }
+  // The range (if given) must match the body exactly.
+  const auto range_valid =
+      !parser["content-range"] ||
+      (content_range &&
+       (content_range->last - content_range->first + 1 == body_size));
+
+  // Files on disk are modified asynchronously, the next request is received
+  // once the response is sent.
+  receiveHttpBody(
+      parser,
+      [this, filepath, content_range, range_valid](
+          const std::shared_ptr<fs::File>& body, fs::Checksum) {
+        if (!range_valid) {
+          sendMessage(
+              static_cast<std::string>(HttpResponse{HttpStatus::BadRequest}));
+          receiveMessage();
+          return;
         }
 
-        me->receiveMessage();
-      }));
+        modifyFile(
+            filepath,
+            [filepath, content_range, body](fs::IFilesystem& filesystem) {
+              return content_range
+                         ? filesystem.write(filepath, content_range->first,
+                                            *body)
+                         : filesystem.append(filepath, *body);
+            },
+            [me = shared_from_this(), filepath, body](fs::Status status) {
+              switch (status) {
+                case fs::Status::Success:
+                  BOOST_LOG_TRIVIAL(info) << "Updated file: " << filepath;
+                  me->profile(Access::Write, filepath, body->size());
+                  me->sendMessage(
+                      static_cast<std::string>(HttpResponse{HttpStatus::Ok}));
+                  break;
+                case fs::Status::FileNotFound:
+                  me->sendMessage(static_cast<std::string>(
+                      HttpResponse{HttpStatus::NotFound}));
+                  break;
+                case fs::Status::InvalidRange:
+                  me->sendMessage(static_cast<std::string>(
+                      HttpResponse{HttpStatus::RangeNotSatisfiable}));
+                  break;
+                default:
+                  me->sendMessage(static_cast<std::string>(
+                      HttpResponse{HttpStatus::InternalServerError}));
+                  break;
+              }
+
+              me->receiveMessage();
+            });
+      },
+      true);
 }
 
 void Session::handleHttpDelete(const HttpParser& parser) {
+  if (parser.getQueryParameter("recursive")) {
+    deleteDirectory(parser);
+    return;
+  }
+
   const auto& filepath = std::string{parser.getUri()};
-  const auto status = filesystem_.remove(filepath);
+  const auto precondition = getPrecondition(parser);
+  fs::Status status{fs::Status::PreconditionFailed};
+  if (parser.getQueryParameter("uploadId")) {
+    // Aborts a multipart upload, the file itself is left alone.
+    const auto upload = getUploadId(parser);
+    status = upload ? buckets_.route(filepath).abortUpload(*upload, filepath)
+                    : fs::Status::FileNotFound;
+  } else if (precondition) {
+    status = buckets_.route(filepath).remove(filepath, *precondition);
+  }
   switch (status) {
     case fs::Status::Success:
-      BOOST_LOG_TRIVIAL(info) << "Deleted file: " << filepath;
+      BOOST_LOG_TRIVIAL(info) << (parser.getQueryParameter("uploadId")
+                                      ? "Aborted upload of file: "
+                                      : "Deleted file: ")
+                              << filepath;
+      if (!parser.getQueryParameter("uploadId")) {
+        profile(Access::Remove, filepath);
+      }
       sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::Ok}));
       break;
     case fs::Status::FileNotFound:
       sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::NotFound}));
       break;
+    case fs::Status::PreconditionFailed:
+      sendMessage(static_cast<std::string>(
+          HttpResponse{HttpStatus::PreconditionFailed}));
+      break;
     default:
       sendMessage(static_cast<std::string>(
           HttpResponse{HttpStatus::InternalServerError}));
@@ -153,5 +945,91 @@ void Session::handleHttpDelete(const HttpParser& parser) {
   receiveMessage();
 }
 
+void Session::deleteDirectory(const HttpParser& parser) {
+  const auto directory = std::string{parser.getUri()};
+  if (directory.back() != '/') {
+    // Only whole directories are removed, not every path with this prefix.
+    sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::BadRequest}));
+    receiveMessage();
+    return;
+  }
+
+  std::optional<std::string> authorization;
+  if (parser["authorization"]) {
+    authorization = std::string{*parser["authorization"]};
+  }
+
+  const auto fan_out =
+      cluster_ && !parser[std::string{cluster::kLocalRequestHeader}];
+  removeDirectory(directory, fan_out, authorization,
+                  [this](std::optional<std::size_t> count) {
+                    sendMessage(static_cast<std::string>(
+                        count ? HttpResponse{HttpStatus::Ok,
+                                             std::to_string(*count) + '\n'}
+                              : HttpResponse{HttpStatus::BadGateway}));
+                    receiveMessage();
+                  });
+}
+
+void Session::handleHttpCopy(const HttpParser& parser) {
+  const auto filepath = std::string{parser.getUri()};
+  const auto destination = parser.getDestination();
+  const auto move = parser.getMethod() == HttpMethod::Move;
+
+  if (!destination) {
+    sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::BadRequest}));
+    receiveMessage();
+    return;
+  }
+
+  if (getRemoteOwner(*destination)) {
+    // Contents are never transferred, so the destination has to be local.
+    sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::BadGateway}));
+    receiveMessage();
+    return;
+  }
+
+  if (!buckets_.isSameBucket(filepath, *destination)) {
+    // Neither are contents transferred between buckets.
+    sendMessage(static_cast<std::string>(HttpResponse{HttpStatus::BadGateway}));
+    receiveMessage();
+    return;
+  }
+
+  modifyFile(
+      filepath,
+      [filepath, move, destination = std::string{*destination}](
+          fs::IFilesystem& filesystem) {
+        return move ? filesystem.rename(filepath, destination)
+                    : filesystem.copy(filepath, destination);
+      },
+      [me = shared_from_this(), filepath, move,
+       destination = std::string{*destination}](fs::Status status) {
+        switch (status) {
+          case fs::Status::Success:
+            BOOST_LOG_TRIVIAL(info)
+                << (move ? "Moved file: " : "Copied file: ") << filepath
+                << " -> " << destination;
+            me->sendMessage(
+                static_cast<std::string>(HttpResponse{HttpStatus::Created}));
+            break;
+          case fs::Status::FileNotFound:
+            me->sendMessage(
+                static_cast<std::string>(HttpResponse{HttpStatus::NotFound}));
+            break;
+          case fs::Status::AlreadyExists:
+            me->sendMessage(static_cast<std::string>(
+                HttpResponse{HttpStatus::PreconditionFailed}));
+            break;
+          default:
+            me->sendMessage(static_cast<std::string>(
+                HttpResponse{HttpStatus::InternalServerError}));
+            break;
+        }
+
+        me->receiveMessage();
+      });
+}
+
 }  // namespace object_storage
 }  // namespace server
\ No newline at end of file
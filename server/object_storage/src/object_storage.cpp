@@ -1,23 +1,144 @@
 #include "object_storage.hpp"
 
+#include <pthread.h>
+
 #include <boost/log/expressions.hpp>
 #include <boost/log/trivial.hpp>
 
+#include "replication/src/follower.hpp"
+#include "replication/src/primary.hpp"
 #include "session.hpp"
 
 namespace server {
 
 namespace object_storage {
 
+namespace {
+
+/// Socket option letting many sockets listen on the same port. Connections
+/// are spread over the sockets by the kernel.
+using ReusePort =
+    boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+/**
+ * \brief Adjust filesystem configuration to the replication role.
+ *
+ * \param fs_config In-memory file storage configuration.
+ * \param replication_config Replication configuration.
+ *
+ * \return Filesystem configuration.
+ */
+fs::MemoryFsConfig configureFs(
+    fs::MemoryFsConfig fs_config,
+    const replication::ReplicationConfig& replication_config) {
+  // The primary ships mutations to followers from its mutation log.
+  if (replication_config.role == replication::Role::Primary) {
+    fs_config.log.max_entries =
+        std::max(fs_config.log.max_entries, replication_config.log_size);
+  }
+
+  return fs_config;
+}
+
+/**
+ * \brief Create the replication stream end for the given role.
+ *
+ * \param filesystem Filesystem to replicate.
+ * \param config Replication configuration.
+ *
+ * \return Replication stream end (nullptr if replication is disabled).
+ */
+std::unique_ptr<replication::IReplica> createReplica(
+    fs::MemoryFs& filesystem, const replication::ReplicationConfig& config) {
+  switch (config.role) {
+    case replication::Role::Primary:
+      return std::make_unique<replication::Primary>(filesystem, config);
+    case replication::Role::Follower:
+      return std::make_unique<replication::Follower>(filesystem, config);
+    default:
+      return nullptr;
+  }
+}
+
+/**
+ * \brief Return number of threads needed for blocking operations.
+ *
+ * \param fs_config In-memory file storage configuration.
+ * \param cluster_config Cluster configuration.
+ * \param bucket_configs Bucket configurations.
+ *
+ * \return Number of threads serving blocking operations.
+ */
+std::size_t getBlockingThreadCount(
+    const fs::MemoryFsConfig& fs_config,
+    const cluster::ClusterConfig& cluster_config,
+    const std::vector<BucketConfig>& bucket_configs) {
+  // Directory removals hold the filesystem lock in many short steps, so they
+  // are always taken off the network threads.
+  std::size_t thread_count{1};
+  if (fs_config.disk.enabled) {
+    thread_count = std::max(thread_count, fs_config.disk.io_threads);
+  }
+  for (const auto& bucket_config : bucket_configs) {
+    if (bucket_config.fs.disk.enabled) {
+      thread_count = std::max(thread_count, bucket_config.fs.disk.io_threads);
+    }
+  }
+  if (!cluster_config.nodes.empty()) {
+    // Listings of other cluster nodes are fetched with blocking requests.
+    thread_count = std::max<std::size_t>(thread_count, 2);
+  }
+
+  return thread_count;
+}
+
+/**
+ * \brief Pin a thread to a CPU core.
+ *
+ * \param thread Thread to pin.
+ * \param index Index of the thread (threads beyond the number of cores wrap
+ * around).
+ */
+void pinThread(std::thread& thread, std::size_t index) noexcept {
+  const auto core_count =
+      std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(index % core_count, &cpu_set);
+  if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set),
+                             &cpu_set) != 0) {
+    BOOST_LOG_TRIVIAL(warning) << "Failed to pin thread " << index
+                               << " to a CPU core";
+  }
+}
+
+}  // namespace
+
 ObjectStorage::ObjectStorage(const std::string& address, uint16_t port,
                              LogLevel log_level, bool authenticate,
                              PortRange ftp_port_range)
-    : address_{address},
-      port_{port},
-      log_level_{log_level},
+    : ObjectStorage{ObjectStorageConfig{address, port, log_level, authenticate,
+                                        ftp_port_range}} {}
+
+ObjectStorage::ObjectStorage(const ObjectStorageConfig& config)
+    : buckets_{configureFs(config.fs, config.replication), config.buckets},
+      replica_{createReplica(buckets_.getDefault(), config.replication)},
+      cluster_{config.cluster.nodes.empty()
+                   ? nullptr
+                   : std::make_unique<cluster::Cluster>(config.cluster)},
+      profiler_{config.profiler.enabled
+                    ? std::make_unique<Profiler>(config.profiler)
+                    : nullptr},
+      profile_path_{config.profiler.dump_path},
+      address_{config.address},
+      port_{config.port},
+      log_level_{config.log_level},
+      threading_model_{config.threading_model},
+      blocking_thread_count_{getBlockingThreadCount(config.fs, config.cluster,
+                                                    config.buckets)},
       acceptor_{io_service_},
-      authenticate_{authenticate},
-      ftp_port_range_{ftp_port_range} {
+      authenticate_{config.authenticate},
+      ftp_port_range_{config.ftp_port_range} {
   setUpLogging();
   BOOST_LOG_TRIVIAL(info) << "User authentication: " << authenticate_;
 }
@@ -35,35 +156,131 @@ bool ObjectStorage::start(std::size_t thread_count) {
     return false;
   }
 
-  if (!configureAcceptor()) {
+  if (acceptor_.is_open() || !cores_.empty()) {
+    BOOST_LOG_TRIVIAL(error) << "Server is already started";
     return false;
   }
 
+  if (threading_model_ == ThreadingModel::Shared) {
+    if (!configureAcceptor(acceptor_, port_)) {
+      acceptor_.close();
+      return false;
+    }
+    acceptConnection(acceptor_, io_service_);
+  } else {
+    // The first thread binds the port (picking a free one if there is none
+    // configured), the others listen on the same one. All sockets are set up
+    // before any is accepted on, so that a failure leaves none listening.
+    auto port = port_;
+    for (size_t i = 0; i < thread_count; i++) {
+      auto& core = *cores_.emplace_back(std::make_unique<Core>());
+      if (!configureAcceptor(core.acceptor, port)) {
+        cores_.clear();
+        return false;
+      }
+      port = core.acceptor.local_endpoint().port();
+    }
+
+    for (auto& core : cores_) {
+      for (size_t j = 0; j < kAcceptsPerCore; j++) {
+        acceptConnection(core->acceptor, core->io_service);
+      }
+    }
+  }
+
+  if (replica_ && !replica_->start()) {
+    return false;
+  }
+
+  upload_timer_.emplace(cores_.empty() ? io_service_
+                                       : cores_.front()->io_service);
+  expireUploads();
+
   for (size_t i = 0; i < thread_count; i++) {
-    workers_.emplace_back([this] { io_service_.run(); });
+    if (cores_.empty()) {
+      workers_.emplace_back([this] { io_service_.run(); });
+    } else {
+      workers_.emplace_back([&core = *cores_[i]] { core.io_service.run(); });
+      pinThread(workers_.back(), i);
+    }
+  }
+
+  // Reads of objects from disk are served by dedicated threads, so that they
+  // do not block the workers.
+  blocking_work_.emplace(blocking_io_service_);
+  for (size_t i = 0; i < blocking_thread_count_; i++) {
+    blocking_workers_.emplace_back([this] { blocking_io_service_.run(); });
   }
 
   BOOST_LOG_TRIVIAL(info) << "Server running with " << thread_count
-                          << " thread(s)";
+                          << " thread(s)"
+                          << (cores_.empty() ? "" : " (thread per core)");
 
   BOOST_LOG_TRIVIAL(info) << "Server listening at "
-                          << acceptor_.local_endpoint().address() << ':'
-                          << acceptor_.local_endpoint().port();
+                          << getAcceptor().local_endpoint().address() << ':'
+                          << getAcceptor().local_endpoint().port();
 
   BOOST_LOG_TRIVIAL(info) << "FTP client port numbers "
                           << ftp_port_range_.min_port << '-'
                           << ftp_port_range_.max_port;
 
+  if (cluster_) {
+    BOOST_LOG_TRIVIAL(info)
+        << "Cluster node " << cluster_->getSelf().name << " of "
+        << cluster_->getNodes().size() << " node(s)";
+  }
+
   return true;
 }
 
 void ObjectStorage::stop() {
   BOOST_LOG_TRIVIAL(info) << "Stopping server...";
+  if (replica_) {
+    replica_->stop();
+  }
+
   io_service_.stop();
+  for (auto& core : cores_) {
+    core->io_service.stop();
+  }
 
   for (auto& thread : workers_) {
     thread.join();
   }
+
+  buckets_.forEach([](const std::string& name, fs::IFilesystem& filesystem) {
+    // Shared-memory buckets have no object cache.
+    const auto* memory_fs = dynamic_cast<fs::MemoryFs*>(&filesystem);
+    if (memory_fs == nullptr) {
+      return;
+    }
+
+    const auto cache_stats = memory_fs->getCacheStats();
+    for (std::size_t i = 0; i < cache_stats.size(); i++) {
+      const auto lookups = cache_stats[i].hits + cache_stats[i].misses;
+      BOOST_LOG_TRIVIAL(info)
+          << "Object cache of thread " << i
+          << (name.empty() ? std::string{} : " (bucket " + name + ')') << ": "
+          << cache_stats[i].hits << " hit(s) out of " << lookups
+          << " lookup(s)";
+    }
+  });
+
+  blocking_work_.reset();
+  blocking_io_service_.stop();
+  for (auto& thread : blocking_workers_) {
+    thread.join();
+  }
+
+  if (profiler_ && !profile_path_.empty()) {
+    if (profiler_->dump(profile_path_)) {
+      BOOST_LOG_TRIVIAL(info) << "Workload profile written to "
+                              << profile_path_;
+    } else {
+      BOOST_LOG_TRIVIAL(error) << "Failed to write workload profile to "
+                               << profile_path_;
+    }
+  }
 }
 
 bool ObjectStorage::addUser(const std::string& username,
@@ -81,10 +298,10 @@ bool ObjectStorage::addUser(const std::string& username,
   return user_added;
 }
 
-bool ObjectStorage::configureAcceptor() {
+bool ObjectStorage::configureAcceptor(Acceptor& acceptor, std::uint16_t port) {
   ErrorCode error_code{};
   const Endpoint endpoint{boost::asio::ip::make_address(address_, error_code),
-                          port_};
+                          port};
 
   if (error_code) {
     BOOST_LOG_TRIVIAL(error) << "Failed to create address from string \""
@@ -92,48 +309,66 @@ bool ObjectStorage::configureAcceptor() {
     return false;
   }
 
-  acceptor_.open(endpoint.protocol(), error_code);
+  acceptor.open(endpoint.protocol(), error_code);
   if (error_code) {
     BOOST_LOG_TRIVIAL(error)
         << "Failed to open acceptor: " << error_code.message();
     return false;
   }
 
-  acceptor_.set_option(Acceptor::reuse_address(true), error_code);
+  acceptor.set_option(Acceptor::reuse_address(true), error_code);
   if (error_code) {
     BOOST_LOG_TRIVIAL(error)
         << "Failed to set reuse_address option: " << error_code.message();
     return false;
   }
 
-  acceptor_.bind(endpoint, error_code);
+  // Every thread listens on a socket of its own, so that connections are
+  // accepted without contention.
+  if (threading_model_ == ThreadingModel::ThreadPerCore) {
+    acceptor.set_option(ReusePort(true), error_code);
+    if (error_code) {
+      BOOST_LOG_TRIVIAL(error)
+          << "Failed to set reuse_port option: " << error_code.message();
+      return false;
+    }
+  }
+
+  acceptor.bind(endpoint, error_code);
   if (error_code) {
     BOOST_LOG_TRIVIAL(error)
         << "Failed to bind acceptor: " << error_code.message();
     return false;
   }
 
-  acceptor_.listen(boost::asio::socket_base::max_listen_connections,
-                   error_code);
+  acceptor.listen(boost::asio::socket_base::max_listen_connections,
+                  error_code);
   if (error_code) {
     BOOST_LOG_TRIVIAL(error)
         << "Failed to listen on acceptor: " << error_code.message();
     return false;
   }
 
-  auto session = std::make_shared<Session>(io_service_, users_, authenticate_,
-                                           filesystem_, ftp_port_range_);
-
-  acceptor_.async_accept(session->getSocket(),
-                         [this, session](auto error_code) {
-                           acceptConnection(session, error_code);
-                         });
-
   return true;
 }
 
-void ObjectStorage::acceptConnection(const std::shared_ptr<Session>& session,
-                                     ErrorCode const& error_code) {
+void ObjectStorage::acceptConnection(Acceptor& acceptor,
+                                     IOService& io_service) {
+  auto session = std::make_shared<Session>(
+      io_service, blocking_io_service_, users_, authenticate_, buckets_,
+      ftp_port_range_, replica_.get(), cluster_.get(), profiler_.get(),
+      threading_model_ == ThreadingModel::ThreadPerCore);
+
+  acceptor.async_accept(
+      session->getSocket(),
+      [this, &acceptor, &io_service, session](auto error_code) {
+        startSession(acceptor, io_service, session, error_code);
+      });
+}
+
+void ObjectStorage::startSession(Acceptor& acceptor, IOService& io_service,
+                                 const std::shared_ptr<Session>& session,
+                                 ErrorCode const& error_code) {
   if (error_code) {
     BOOST_LOG_TRIVIAL(error)
         << "Failed to accept session: " << error_code.message();
@@ -141,14 +376,36 @@ void ObjectStorage::acceptConnection(const std::shared_ptr<Session>& session,
   }
 
   session->start();
+  acceptConnection(acceptor, io_service);
+}
 
-  auto new_session = std::make_shared<Session>(
-      io_service_, users_, authenticate_, filesystem_, ftp_port_range_);
+std::uint16_t ObjectStorage::getPort() const noexcept {
+  ErrorCode error_code{};
+  const auto endpoint = getAcceptor().local_endpoint(error_code);
+  return error_code ? port_ : endpoint.port();
+}
+
+const Acceptor& ObjectStorage::getAcceptor() const noexcept {
+  return cores_.empty() ? acceptor_ : cores_.front()->acceptor;
+}
+
+void ObjectStorage::expireUploads() {
+  std::size_t expired{0};
+  buckets_.forEach(
+      [&expired](const std::string&, fs::IFilesystem& filesystem) {
+        expired += filesystem.expireUploads();
+      });
+  if (expired > 0) {
+    BOOST_LOG_TRIVIAL(info) << "Abandoned multipart uploads dropped: "
+                            << expired;
+  }
 
-  acceptor_.async_accept(new_session->getSocket(),
-                         [this, new_session](auto error_code) {
-                           acceptConnection(new_session, error_code);
-                         });
+  upload_timer_->expires_after(kUploadSweepInterval);
+  upload_timer_->async_wait([this](auto error_code) {
+    if (!error_code) {
+      expireUploads();
+    }
+  });
 }
 
 void ObjectStorage::setUpLogging() noexcept {
@@ -3,11 +3,18 @@
 
 #include <atomic>
 #include <boost/asio.hpp>
+#include <chrono>
 #include <memory>
+#include <optional>
 #include <string>
 #include <thread>
+#include <vector>
 
+#include "buckets.hpp"
+#include "cluster/src/cluster.hpp"
 #include "filesystem/memory_fs/src/memory_fs.hpp"
+#include "profiler.hpp"
+#include "replication/src/replication.hpp"
 #include "server/iserver.hpp"
 #include "session.hpp"
 #include "user/database/src/user_database.hpp"
@@ -23,6 +30,60 @@ using ThreadPool = std::vector<std::thread>;
  */
 enum class LogLevel : int { Trace = 0, Debug, Info, Warning, Error, Eatal };
 
+/**
+ * \brief Assignment of connections to server threads.
+ */
+enum class ThreadingModel {
+  /// All threads run one shared IO service and serve all connections, the
+  /// handlers of each connection are serialized by strands.
+  Shared,
+
+  /// Every thread runs an IO service of its own, with its own listening socket
+  /// (SO_REUSEPORT) on the server port. Connections are served by the thread
+  /// which accepted them, without strands.
+  ThreadPerCore
+};
+
+/**
+ * \brief Object storage server configuration.
+ */
+struct ObjectStorageConfig {
+  std::string address{"0.0.0.0"};  ///< IPv4 address.
+
+  /// Port on which the server listens for new connections (any free port if
+  /// 0, see ObjectStorage::getPort()).
+  std::uint16_t port{21};
+
+  /// Logging level used by the server (logging verbosity).
+  LogLevel log_level{LogLevel::Info};
+
+  bool authenticate{false};  ///< Enable/disable user authentication.
+
+  /// Client port numbers to use for FTP (inclusive range). All client ports
+  /// outside of the range are assumed HTTP.
+  PortRange ftp_port_range{2000, 3000};
+
+  /// In-memory file storage configuration (of files outside of all buckets).
+  fs::MemoryFsConfig fs;
+
+  /// Replication configuration. Followers serve reads only, all writes go to
+  /// the primary.
+  replication::ReplicationConfig replication;
+
+  /// Cluster configuration. Nodes of a cluster only serve the files they own,
+  /// and redirect clients to the owners of the other files.
+  cluster::ClusterConfig cluster;
+
+  /// Buckets, each stored in a filesystem of its own (see Buckets). Only
+  /// files outside of all buckets are replicated.
+  std::vector<BucketConfig> buckets;
+
+  ProfilerConfig profiler;  ///< Workload profiler configuration.
+
+  /// Assignment of connections to server threads.
+  ThreadingModel threading_model{ThreadingModel::Shared};
+};
+
 /**
  * \brief Object storage server implementation.
  *
@@ -53,6 +114,17 @@ class ObjectStorage : public IServer {
                          bool authenticate = false,
                          PortRange ftp_port_range = {2000, 3000});
 
+  /**
+   * \brief Create an object storage server instance with the given
+   * configuration.
+   *
+   * \param config Server configuration.
+   *
+   * \throw std::invalid_argument If the cluster or bucket configuration is
+   * invalid.
+   */
+  explicit ObjectStorage(const ObjectStorageConfig& config);
+
   // No use case for copying and moving for now.
   ObjectStorage(ObjectStorage&&) = delete;
   ObjectStorage& operator=(ObjectStorage&&) = delete;
@@ -63,7 +135,15 @@ class ObjectStorage : public IServer {
 
   bool start(std::size_t thread_count = 1) override;
 
-  inline std::uint16_t getPort() const noexcept override { return port_; };
+
+  /**
+   * \copydoc IServer::getPort()
+   *
+   * Once the server is listening, this is the port it is bound to (a free
+   * port picked by the OS if it was configured with port 0).
+   */
+  std::uint16_t getPort() const noexcept override;
+
   inline std::string getAddress() const noexcept override { return address_; }
   bool addUser(const std::string& username,
                const std::string& password) noexcept override;
@@ -74,39 +154,127 @@ class ObjectStorage : public IServer {
    */
   void stop();
 
+  /**
+   * \brief IO services and listening socket of a thread (thread-per-core
+   * model only).
+   */
+  struct Core {
+    /**
+     * \brief Create IO services run by a single thread.
+     */
+    Core() : io_service{1}, acceptor{io_service} {}
+
+    IOService io_service;  ///< OS IO services
+    Acceptor acceptor;     ///< TCP connection acceptor
+  };
+
   /**
    * \brief Set up TCP connection acceptor on HTTP/FTP socket.
    *
+   * \param acceptor Acceptor to set up.
+   * \param port Port to bind the acceptor to (any free port if 0).
+   *
    * \return True if server is ready to accept connections, false otherwise.
    */
-  bool configureAcceptor();
+  bool configureAcceptor(Acceptor& acceptor, std::uint16_t port);
 
   /**
-   * \brief Accept connection request from client on the HTTP/FTP command
+   * \brief Wait for a connection request from client on the HTTP/FTP command
    * socket.
    *
    * \note This method is asynchronous.
    *
+   * \param acceptor Acceptor to accept the connection with.
+   * \param io_service OS IO services to serve the connection with.
+   */
+  void acceptConnection(Acceptor& acceptor, IOService& io_service);
+
+  /**
+   * \brief Start the session of an accepted connection, and wait for the next
+   * connection request.
+   *
+   * \param acceptor Acceptor which accepted the connection.
+   * \param io_service OS IO services serving the connection.
    * \param session Session created for the connection.
    * \param error_code Error code.
    */
-  void acceptConnection(const std::shared_ptr<Session>& session,
-                        ErrorCode const& error_code);
+  void startSession(Acceptor& acceptor, IOService& io_service,
+                    const std::shared_ptr<Session>& session,
+                    ErrorCode const& error_code);
+
+  /**
+   * \brief Return the acceptor the server listens on (the acceptor of the
+   * first thread in the thread-per-core model).
+   *
+   * \return TCP connection acceptor.
+   */
+  const Acceptor& getAcceptor() const noexcept;
+
+  /**
+   * \brief Drop abandoned multipart uploads, and schedule the next sweep.
+   *
+   * \note This method is asynchronous.
+   */
+  void expireUploads();
 
   /**
    * \brief Set up server logging.
    */
   void setUpLogging() noexcept;
 
+  /// Interval between sweeps of abandoned multipart uploads.
+  static constexpr std::chrono::seconds kUploadSweepInterval{10};
+
+  /// Number of connection requests each thread waits for at once in the
+  /// thread-per-core model, so that bursts of connections are not accepted
+  /// one by one.
+  static constexpr std::size_t kAcceptsPerCore{4};
+
   user::UserDatabase users_;  ///< Server users
-  fs::MemoryFs filesystem_;   ///< In-memory file storage
+  Buckets buckets_;           ///< In-memory file storage
+
+  /// Replication stream end (if replication is enabled).
+  std::unique_ptr<replication::IReplica> replica_;
+
+  /// Cluster this server is a node of (if clustering is enabled).
+  std::unique_ptr<cluster::Cluster> cluster_;
+
+  /// Workload profiler (if profiling is enabled).
+  std::unique_ptr<Profiler> profiler_;
+
+  /// File the profile is written to when the server stops (none if empty).
+  std::string profile_path_;
+
   std::string address_;       ///< IPv4 addres used by the server
   const uint16_t port_;       ///< Server port number
   LogLevel log_level_;        ///< Server logging level
 
   ThreadPool workers_;        ///< Server worker threads
-  IOService io_service_;      ///< OS IO services
-  Acceptor acceptor_;         ///< TCP connection acceptor
+  IOService io_service_;      ///< OS IO services (shared threading model)
+
+  /// Assignment of connections to server threads.
+  const ThreadingModel threading_model_;
+
+  /// IO services and listening sockets of the threads (thread-per-core model).
+  std::vector<std::unique_ptr<Core>> cores_;
+
+  /// Schedules sweeps of abandoned multipart uploads (on the IO services of
+  /// the first worker thread).
+  std::optional<boost::asio::steady_timer> upload_timer_;
+
+  /// Number of threads serving blocking filesystem operations.
+  std::size_t blocking_thread_count_;
+
+  /// Threads serving blocking operations (e.g. disk reads, cluster listing).
+  ThreadPool blocking_workers_;
+
+  /// OS IO services for blocking filesystem operations.
+  IOService blocking_io_service_;
+
+  /// Keeps blocking IO service running while there is no work queued.
+  std::optional<IOService::work> blocking_work_;
+
+  Acceptor acceptor_;         ///< TCP connection acceptor (shared model)
   const bool authenticate_;   ///< Authenticate users
   PortRange ftp_port_range_;  ///< Port numbers to use for FTP.
 };
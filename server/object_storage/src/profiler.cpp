@@ -0,0 +1,192 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <fstream>
+#include <limits>
+#include <map>
+
+namespace server {
+namespace object_storage {
+
+namespace {
+
+/// Number of accesses the current thread skips before the next sample.
+thread_local std::size_t skipped_accesses{0};
+
+/**
+ * \brief Scramble the bits of a number (finalizer of SplitMix64).
+ *
+ * \param value Number to scramble.
+ *
+ * \return Scrambled number.
+ */
+std::uint64_t mix(std::uint64_t value) noexcept {
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+  return value ^ (value >> 31);
+}
+
+/**
+ * \brief Return the size bucket of an object.
+ *
+ * \param size Object size.
+ *
+ * \return Bit width of the size (0 for empty objects).
+ */
+std::size_t getSizeBucket(std::size_t size) noexcept {
+  return (size == 0) ? 0 : 64 - __builtin_clzll(size);
+}
+
+}  // namespace
+
+Profiler::Profiler(const ProfilerConfig& config)
+    : config_{config},
+      sketch_(std::max<std::size_t>(config.sketch_width, 1) *
+              std::max<std::size_t>(config.sketch_depth, 1)) {
+  config_.sampling_interval = std::max<std::size_t>(config_.sampling_interval,
+                                                    1);
+  config_.sketch_width = std::max<std::size_t>(config_.sketch_width, 1);
+  config_.sketch_depth = std::max<std::size_t>(config_.sketch_depth, 1);
+}
+
+void Profiler::record(Access access, std::string_view path,
+                      std::size_t size) {
+  if (skipped_accesses > 0) {
+    skipped_accesses--;
+    return;
+  }
+  skipped_accesses = config_.sampling_interval - 1;
+
+  std::scoped_lock lock(mutex_);
+  samples_++;
+  if (access != Access::Remove) {
+    sizes_[getSizeBucket(size)]++;
+  }
+
+  const auto prefix = getPrefix(path);
+  auto counts = prefixes_.find(std::string{prefix});
+  if (counts == prefixes_.end()) {
+    const auto key = (prefixes_.size() < config_.max_prefixes)
+                         ? std::string{prefix}
+                         : std::string{"*"};
+    counts = prefixes_.try_emplace(key).first;
+  }
+
+  switch (access) {
+    case Access::Read:
+      counts->second.reads++;
+      break;
+    case Access::Write:
+      counts->second.writes++;
+      break;
+    case Access::Remove:
+      counts->second.removes++;
+      break;
+  }
+
+  countKey(path);
+}
+
+std::string Profiler::report() const {
+  std::scoped_lock lock(mutex_);
+  std::string report = "samples: " + std::to_string(samples_) + '\n' +
+                       "sampling_interval: " +
+                       std::to_string(config_.sampling_interval) + '\n';
+
+  for (std::size_t bucket = 0; bucket < sizes_.size(); bucket++) {
+    if (sizes_[bucket] == 0) {
+      continue;
+    }
+
+    const std::uint64_t low = (bucket == 0) ? 0 : 1ULL << (bucket - 1);
+    const std::uint64_t high =
+        (bucket == 64) ? std::numeric_limits<std::uint64_t>::max()
+                       : (low == 0) ? 0 : 2 * low - 1;
+    report += "size " + std::to_string(low) + '-' + std::to_string(high) +
+              ": " + std::to_string(sizes_[bucket]) + '\n';
+  }
+
+  const std::map<std::string, PrefixCounts> prefixes{prefixes_.begin(),
+                                                     prefixes_.end()};
+  for (const auto& [prefix, counts] : prefixes) {
+    report += "prefix " + prefix + " reads: " + std::to_string(counts.reads) +
+              " writes: " + std::to_string(counts.writes) +
+              " removes: " + std::to_string(counts.removes) + '\n';
+  }
+
+  auto hot_keys = hot_keys_;
+  std::sort(hot_keys.begin(), hot_keys.end(), std::greater<>{});
+  for (const auto& [estimate, path] : hot_keys) {
+    report += "hot " + std::to_string(estimate) + ' ' + path + '\n';
+  }
+
+  return report;
+}
+
+bool Profiler::dump(const std::string& path) const {
+  std::ofstream file{path, std::ios::trunc};
+  file << report();
+  file.close();
+  return !file.fail();
+}
+
+void Profiler::reset() {
+  std::scoped_lock lock(mutex_);
+  samples_ = 0;
+  sizes_.fill(0);
+  prefixes_.clear();
+  std::fill(sketch_.begin(), sketch_.end(), 0);
+  hot_keys_.clear();
+}
+
+std::string_view Profiler::getPrefix(std::string_view path) const noexcept {
+  // The file name itself is never part of the prefix.
+  std::size_t end{0};
+  for (std::size_t depth = 0; depth < config_.prefix_depth; depth++) {
+    const auto slash = path.find('/', end + 1);
+    if (slash == std::string_view::npos) {
+      break;
+    }
+    end = slash;
+  }
+
+  return (end == 0) ? std::string_view{"/"} : path.substr(0, end);
+}
+
+void Profiler::countKey(std::string_view path) {
+  // Rows index the sketch with independent hashes, derived from one hash of
+  // the path.
+  const auto hash = std::hash<std::string_view>{}(path);
+  auto estimate = std::numeric_limits<std::uint64_t>::max();
+  for (std::size_t row = 0; row < config_.sketch_depth; row++) {
+    const auto column = mix(hash + row * 0x9e3779b97f4a7c15) %
+                        config_.sketch_width;
+    auto& counter = sketch_[row * config_.sketch_width + column];
+    counter++;
+    estimate = std::min(estimate, counter);
+  }
+
+  if (config_.top_keys == 0) {
+    return;
+  }
+
+  const auto hot_key = std::find_if(
+      hot_keys_.begin(), hot_keys_.end(),
+      [path](const HotKey& key) { return key.second == path; });
+  if (hot_key != hot_keys_.end()) {
+    hot_key->first = estimate;
+    std::make_heap(hot_keys_.begin(), hot_keys_.end(), std::greater<>{});
+  } else if (hot_keys_.size() < config_.top_keys) {
+    hot_keys_.emplace_back(estimate, path);
+    std::push_heap(hot_keys_.begin(), hot_keys_.end(), std::greater<>{});
+  } else if (estimate > hot_keys_.front().first) {
+    // The coldest key makes room for this one.
+    std::pop_heap(hot_keys_.begin(), hot_keys_.end(), std::greater<>{});
+    hot_keys_.back() = {estimate, std::string{path}};
+    std::push_heap(hot_keys_.begin(), hot_keys_.end(), std::greater<>{});
+  }
+}
+
+}  // namespace object_storage
+}  // namespace server
@@ -0,0 +1,174 @@
+#ifndef SERVER_OBJECT_STORAGE_SRC_PROFILER_HPP
+#define SERVER_OBJECT_STORAGE_SRC_PROFILER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace server {
+namespace object_storage {
+
+/**
+ * \brief Workload profiler configuration.
+ */
+struct ProfilerConfig {
+  /// Profile the requests served.
+  bool enabled{false};
+
+  /// One in this many accesses is recorded (per thread).
+  std::size_t sampling_interval{64};
+
+  /// Number of hot keys reported.
+  std::size_t top_keys{16};
+
+  /// Number of counters in each row of the access frequency sketch.
+  std::size_t sketch_width{2048};
+
+  /// Number of rows of the access frequency sketch.
+  std::size_t sketch_depth{4};
+
+  /// Number of leading directories making up a prefix (e.g. "/photos" for
+  /// 1, "/photos/2024" for 2).
+  std::size_t prefix_depth{1};
+
+  /// Maximum number of prefixes told apart. Accesses to further prefixes are
+  /// counted under "*".
+  std::size_t max_prefixes{1024};
+
+  /// File the profile is written to once the server stops (none if empty).
+  std::string dump_path;
+};
+
+/**
+ * \brief Kind of a profiled access.
+ */
+enum class Access { Read, Write, Remove };
+
+/**
+ * \brief Sampled workload profile of a server.
+ *
+ * The profiler records a sample of the accesses served: one in
+ * ProfilerConfig::sampling_interval accesses of each thread. Skipped accesses
+ * only decrement a thread-local counter, so that the profiler stays cheap on
+ * the request path. Sampled accesses update, under a lock:
+ *  - a histogram of object sizes, in power-of-two buckets,
+ *  - numbers of reads, writes and removes per prefix,
+ *  - a count-min sketch of access frequencies, and a min-heap of the keys
+ *    with the highest estimates.
+ *
+ * All counts reported are numbers of samples, multiply them by the sampling
+ * interval to estimate numbers of accesses. Hot key estimates may only
+ * overcount, by a margin which shrinks as the sketch grows.
+ */
+class Profiler {
+ public:
+  /**
+   * \brief Create a profiler.
+   *
+   * \param config Profiler configuration.
+   */
+  explicit Profiler(const ProfilerConfig& config);
+
+  /**
+   * \brief Record an access (if it is sampled).
+   *
+   * \param access Kind of the access.
+   * \param path Path of the accessed file.
+   * \param size Size of the object read or written (ignored for removes).
+   */
+  void record(Access access, std::string_view path, std::size_t size);
+
+  /**
+   * \brief Return the profile as text.
+   *
+   * The profile has one line per item, e.g.:
+   * \code
+   * samples: 1200
+   * sampling_interval: 64
+   * size 1024-2047: 800
+   * prefix /photos reads: 1000 writes: 150 removes: 2
+   * hot 310 /photos/cat.jpg
+   * \endcode
+   * Size buckets and prefixes are sorted, hot keys are sorted by decreasing
+   * estimate.
+   *
+   * \return Profile.
+   */
+  [[nodiscard]] std::string report() const;
+
+  /**
+   * \brief Write the profile (see report()) to a file.
+   *
+   * \param path File path.
+   *
+   * \return True if the profile was written, false otherwise.
+   */
+  bool dump(const std::string& path) const;
+
+  /**
+   * \brief Drop everything recorded so far.
+   */
+  void reset();
+
+ private:
+  /**
+   * \brief Accesses to the files under a prefix.
+   */
+  struct PrefixCounts {
+    std::size_t reads{0};    ///< Number of sampled reads.
+    std::size_t writes{0};   ///< Number of sampled writes.
+    std::size_t removes{0};  ///< Number of sampled removes.
+  };
+
+  /// Hot key candidate (estimated access count, path).
+  using HotKey = std::pair<std::uint64_t, std::string>;
+
+  /// Number of object size buckets (one per bit width of a size).
+  static constexpr std::size_t kSizeBuckets{65};
+
+  /**
+   * \brief Return the prefix of a path.
+   *
+   * \param path File path.
+   *
+   * \return Leading ProfilerConfig::prefix_depth directories of the path ("/"
+   * for files in the root directory).
+   */
+  std::string_view getPrefix(std::string_view path) const noexcept;
+
+  /**
+   * \brief Count an access in the sketch and update the hot keys.
+   *
+   * \param path Path of the accessed file.
+   */
+  void countKey(std::string_view path);
+
+  ProfilerConfig config_;  ///< Profiler configuration.
+
+  mutable std::mutex mutex_;  ///< Protects everything below.
+  std::size_t samples_{0};    ///< Number of sampled accesses.
+
+  /// Numbers of sampled objects, by bit width of their size.
+  std::array<std::size_t, kSizeBuckets> sizes_{};
+
+  /// Sampled accesses per prefix.
+  std::unordered_map<std::string, PrefixCounts> prefixes_;
+
+  /// Count-min sketch of access frequencies (sketch_depth rows of
+  /// sketch_width counters).
+  std::vector<std::uint64_t> sketch_;
+
+  /// Keys with the highest estimates (min-heap on the estimates).
+  std::vector<HotKey> hot_keys_;
+};
+
+}  // namespace object_storage
+}  // namespace server
+
+#endif  // SERVER_OBJECT_STORAGE_SRC_PROFILER_HPP
@@ -3,6 +3,10 @@
 
 #include <boost/log/trivial.hpp>
 
+#include <algorithm>
+#include <tuple>
+
+#include "cluster/src/peer_client.hpp"
 #include "protocol/detector/src/protocol_detector.hpp"
 #include "protocol/ftp/response/src/ftp_response.hpp"
 #include "protocol/http/response/src/http_response.hpp"
@@ -15,25 +19,55 @@ using protocol::ftp::request::FtpParser;
 using protocol::ftp::response::FtpReplyCode;
 using protocol::ftp::response::FtpResponse;
 using protocol::http::request::HttpMethod;
+using protocol::http::response::HttpResponse;
+using protocol::http::response::HttpStatus;
 
 using user::User;
 
 namespace server {
 namespace object_storage {
 
-Session::Session(IOService& io_service, const user::UserDatabase& user_database,
-                 bool authenticate, fs::MemoryFs& filesystem,
-                 PortRange ftp_port_range)
+namespace {
+
+/**
+ * \brief Create an executor serializing execution of session handlers.
+ *
+ * \param io_service OS IO services running the handlers.
+ * \param thread_confined The IO services are run by a single thread.
+ *
+ * \return Strand, or the IO services themselves if they are run by a single
+ * thread (their handlers never run concurrently anyway).
+ */
+Executor createSerializer(IOService& io_service, bool thread_confined) {
+  if (thread_confined) {
+    return io_service.get_executor();
+  }
+
+  return boost::asio::make_strand(io_service);
+}
+
+}  // namespace
+
+Session::Session(IOService& io_service, IOService& blocking_io_service,
+                 const user::UserDatabase& user_database, bool authenticate,
+                 Buckets& buckets, PortRange ftp_port_range,
+                 const replication::IReplica* replica,
+                 const cluster::Cluster* cluster, Profiler* profiler,
+                 bool thread_confined)
     :  // ------------------ COMMON ------------------
       user_database_{user_database},
       authenticate_{authenticate},
-      filesystem_{filesystem},
+      buckets_{buckets},
+      replica_{replica},
+      cluster_{cluster},
+      profiler_{profiler},
       io_service_{io_service},
+      blocking_io_service_{blocking_io_service},
       socket_{io_service_},
-      serializer_{io_service_},
+      serializer_{createSerializer(io_service_, thread_confined)},
       // ------------------ FTP ------------------
       ftp_data_acceptor_{io_service},
-      ftp_data_serializer_{io_service},
+      ftp_data_serializer_{createSerializer(io_service_, thread_confined)},
       ftp_port_range_{ftp_port_range},
       last_ftp_command_{FtpCommand::Unrecognized},
       current_working_dir_{'/'},
@@ -48,6 +82,8 @@ Session::Session(IOService& io_service, const user::UserDatabase& user_database,
            std::bind(&Session::handleFtpRetr, this, std::placeholders::_1)},
           {FtpCommand::Stor,
            std::bind(&Session::handleFtpStor, this, std::placeholders::_1)},
+          {FtpCommand::Appe,
+           std::bind(&Session::handleFtpAppe, this, std::placeholders::_1)},
           {FtpCommand::Dele,
            std::bind(&Session::handleFtpDele, this, std::placeholders::_1)},
           {FtpCommand::Pasv,
@@ -58,15 +94,35 @@ Session::Session(IOService& io_service, const user::UserDatabase& user_database,
            std::bind(&Session::handleFtpQuit, this, std::placeholders::_1)},
           {FtpCommand::Cwd,
            std::bind(&Session::handleFtpCwd, this, std::placeholders::_1)},
+          {FtpCommand::Rnfr,
+           std::bind(&Session::handleFtpRnfr, this, std::placeholders::_1)},
+          {FtpCommand::Rnto,
+           std::bind(&Session::handleFtpRnto, this, std::placeholders::_1)},
+          {FtpCommand::Rmd,
+           std::bind(&Session::handleFtpRmd, this, std::placeholders::_1)},
+          {FtpCommand::Size,
+           std::bind(&Session::handleFtpSize, this, std::placeholders::_1)},
+          {FtpCommand::Stat,
+           std::bind(&Session::handleFtpStat, this, std::placeholders::_1)},
       },
       // ------------------ HTTP ------------------
       http_handlers_{
           {HttpMethod::Get,
            std::bind(&Session::handleHttpGet, this, std::placeholders::_1)},
+          {HttpMethod::Head,
+           std::bind(&Session::handleHttpHead, this, std::placeholders::_1)},
           {HttpMethod::Put,
            std::bind(&Session::handleHttpPut, this, std::placeholders::_1)},
+          {HttpMethod::Post,
+           std::bind(&Session::handleHttpPost, this, std::placeholders::_1)},
+          {HttpMethod::Patch,
+           std::bind(&Session::handleHttpPatch, this, std::placeholders::_1)},
           {HttpMethod::Delete,
            std::bind(&Session::handleHttpDelete, this, std::placeholders::_1)},
+          {HttpMethod::Copy,
+           std::bind(&Session::handleHttpCopy, this, std::placeholders::_1)},
+          {HttpMethod::Move,
+           std::bind(&Session::handleHttpCopy, this, std::placeholders::_1)},
       } {}
 
 Session::~Session() {
@@ -80,7 +136,8 @@ void Session::start() {
   BOOST_LOG_TRIVIAL(info) << "Client connected: " << getClientInfo();
 
   setTcpNoDelay();
-  serializer_.post([me = shared_from_this()]() { me->receiveMessage(); });
+  boost::asio::post(serializer_,
+                    [me = shared_from_this()]() { me->receiveMessage(); });
 
   // Send 'ready for new user' message only if we know that the client is FTP.
   const auto client_port = socket_.remote_endpoint().port();
@@ -113,64 +170,153 @@ std::string Session::getClientInfo() const noexcept {
 }
 
 void Session::receiveMessage() {
-  // Asynchronously read input request until CRLF symbol is found. The CRLF is
-  // shared between HTTP (end of request line) and FTP (end of entire
-  // request).
-  boost::asio::async_read_until(
-      socket_, input_stream_, "\r\n",
-      serializer_.wrap([me = shared_from_this()](ErrorCode error_code,
-                                                 std::size_t header_length) {
-        if (error_code) {
-          if (error_code == boost::asio::error::eof) {
-            BOOST_LOG_TRIVIAL(info)
-                << "Connection closed by " << me->getClientInfo();
-          } else {
-            BOOST_LOG_TRIVIAL(error)
-                << "Failed to read HTTP/FTP request header: "
-                << error_code.message();
-          }
-
-          me->ftp_data_acceptor_.close(error_code);
-          me->ftp_data_serializer_.post([me]() { me->closeFtpDataSocket(); });
-          me->receiveMessage();
-        } else {
-          // Process packet to determine if if is HTTP or FTP.
-          std::istream stream(&(me->input_stream_));
-          std::string packet;
-          packet.resize(header_length);
-          stream.read(&packet[0], header_length);
-          BOOST_LOG_TRIVIAL(trace) << "Received message:\n" << packet;
-          const auto app_layer_protocol = detectProtocol(packet);
-
-          switch (app_layer_protocol) {
-            case AppLayerProtocol::Http:
-              me->handleHttp(packet);
-              break;
-
-            case AppLayerProtocol::Ftp:
-              me->handleFtp(packet);
-              break;
-          }
-        }
-      }));
+  // Handlers of buffered messages request the next message before they
+  // return, so the messages are framed in a loop rather than recursively.
+  if (framing_) {
+    message_requested_ = true;
+    return;
+  }
+
+  framing_ = true;
+  do {
+    message_requested_ = false;
+    if (!frameMessage()) {
+      readMessage();
+      break;
+    }
+  } while (message_requested_);
+  framing_ = false;
+}
+
+bool Session::frameMessage() {
+  const std::string_view input{input_buffer_.data() + input_begin_,
+                               input_end_ - input_begin_};
+
+  // The CRLF is shared between HTTP (end of request line) and FTP (end of
+  // entire request).
+  const auto line_end = input.find("\r\n");
+  if (line_end == std::string_view::npos) {
+    input_scanned_ = input.size();
+    return false;
+  }
+
+  const std::string line{input.substr(0, line_end + 2)};
+  if (detectProtocol(line) == AppLayerProtocol::Ftp) {
+    consumeInput(line.size());
+    BOOST_LOG_TRIVIAL(trace) << "Received message:\n" << line;
+    handleFtp(line);
+    return true;
+  }
+
+  // HTTP request header ends with an empty line. Only the input received
+  // since the last search (and the 3 bytes before, which may start the empty
+  // line) is searched.
+  const auto header_end = input.find(
+      "\r\n\r\n", std::max(input_scanned_, std::size_t{3}) - 3);
+  if (header_end == std::string_view::npos) {
+    input_scanned_ = input.size();
+    return false;
+  }
+
+  const std::string request{consumeInput(header_end + 4)};
+  BOOST_LOG_TRIVIAL(trace) << "Received message:\n" << request;
+  handleHttp(request);
+  return true;
+}
+
+void Session::readMessage() {
+  // Unhandled input is moved to the front of the buffer, and the buffer only
+  // grows if a message does not fit.
+  if (input_begin_ > 0) {
+    std::copy(input_buffer_.begin() + input_begin_,
+              input_buffer_.begin() + input_end_, input_buffer_.begin());
+    input_end_ -= input_begin_;
+    input_begin_ = 0;
+  }
+
+  if (input_end_ == input_buffer_.size()) {
+    if (input_buffer_.size() >= kMaxMessageSize) {
+      BOOST_LOG_TRIVIAL(error)
+          << "Request too large from " << getClientInfo();
+      if (detectProtocol({input_buffer_.begin(), input_buffer_.end()}) ==
+          AppLayerProtocol::Http) {
+        sendMessage(static_cast<std::string>(HttpResponse{
+            HttpStatus::RequestHeaderFieldsTooLarge}));
+      }
+
+      // No more requests are read, the connection is closed once the session
+      // is done.
+      return;
+    }
+
+    input_buffer_.resize(std::clamp(2 * input_buffer_.size(),
+                                    kInputBufferSize, kMaxMessageSize));
+  }
+
+  socket_.async_read_some(
+      boost::asio::buffer(input_buffer_.data() + input_end_,
+                          input_buffer_.size() - input_end_),
+      boost::asio::bind_executor(
+          serializer_,
+          [me = shared_from_this()](ErrorCode error_code, std::size_t length) {
+            if (error_code) {
+              if (error_code == boost::asio::error::eof) {
+                BOOST_LOG_TRIVIAL(info)
+                    << "Connection closed by " << me->getClientInfo();
+              } else {
+                BOOST_LOG_TRIVIAL(error)
+                    << "Failed to read HTTP/FTP request header: "
+                    << error_code.message();
+              }
+
+              me->ftp_data_acceptor_.close(error_code);
+              boost::asio::post(me->ftp_data_serializer_,
+                                [me]() { me->closeFtpDataSocket(); });
+              return;
+            }
+
+            me->input_end_ += length;
+            me->receiveMessage();
+          }));
+}
+
+std::string_view Session::consumeInput(std::size_t size) noexcept {
+  size = std::min(size, input_end_ - input_begin_);
+  const std::string_view data{input_buffer_.data() + input_begin_, size};
+  input_begin_ += size;
+  input_scanned_ = 0;
+  if (input_begin_ == input_end_) {
+    input_begin_ = 0;
+    input_end_ = 0;
+  }
+
+  return data;
 }
 
 void Session::sendMessageHandler() {
-  BOOST_LOG_TRIVIAL(trace) << "Sending message:\n" << output_queue_.front();
+  // Everything queued so far goes out with a single vectored write. The
+  // queue keeps the messages in place while they are written (deque
+  // elements never move).
+  output_buffers_.clear();
+  for (const auto& message : output_queue_) {
+    BOOST_LOG_TRIVIAL(trace) << "Sending message:\n" << message;
+    output_buffers_.emplace_back(boost::asio::buffer(message));
+  }
 
-  // Get the next message from send queue and send it asynchronously.
   boost::asio::async_write(
-      socket_, boost::asio::buffer(output_queue_.front()),
-      serializer_.wrap(
-          [me = shared_from_this()](ErrorCode error_code, std::size_t) {
+      socket_, output_buffers_,
+      boost::asio::bind_executor(
+          serializer_,
+          [me = shared_from_this(), count = output_queue_.size()](
+              ErrorCode error_code, std::size_t) {
             if (!error_code) {
-              me->output_queue_.pop_front();
+              me->output_queue_.erase(me->output_queue_.begin(),
+                                      me->output_queue_.begin() + count);
 
-              // If there are more messages to send, trigger this handler again.
-              // Otherwise, the thread enqueueing a new message will trigger
-              // this handler.
-              const auto write_in_progress = !me->output_queue_.empty();
-              if (write_in_progress) {
+              // If more messages were queued meanwhile, send them all.
+              // Otherwise, the next message queued triggers this handler.
+              me->output_pending_ = !me->output_queue_.empty();
+              if (me->output_pending_) {
                 me->sendMessageHandler();
               }
             } else {
@@ -181,18 +327,127 @@ void Session::sendMessageHandler() {
           }));
 }
 
-void Session::sendMessage(const std::string& message) {
-  // Put the message to the send queue. If the send queue was empty before
-  // manually trigger the asynchronous send handler execution.
-  serializer_.post([me = shared_from_this(), message]() {
-    const bool write_in_progress = !me->output_queue_.empty();
-    me->output_queue_.push_back(message);
-    if (!write_in_progress) {
-      me->sendMessageHandler();
+void Session::sendMessage(std::string message) {
+  // Put the message to the send queue right away if called on the
+  // serializer. The queue is written once the current handler returns, so
+  // that all the messages it queues (e.g. responses to pipelined requests)
+  // are sent together.
+  boost::asio::dispatch(serializer_, [me = shared_from_this(),
+                                      message = std::move(message)]() mutable {
+    me->output_queue_.push_back(std::move(message));
+    if (!me->output_pending_) {
+      me->output_pending_ = true;
+      boost::asio::post(me->serializer_, [me]() { me->sendMessageHandler(); });
     }
   });
 }
 
+void Session::profile(Access access, std::string_view filepath,
+                      std::size_t size) {
+  if (profiler_) {
+    profiler_->record(access, filepath, size);
+  }
+}
+
+void Session::getFile(
+    const std::string& filepath,
+    const std::function<void(fs::Status status, const fs::Object& file,
+                             const fs::FileInfo& info)>& handler) {
+  const auto result = buckets_.route(filepath).tryGet(filepath);
+  if (result) {
+    if (std::get<fs::Status>(*result) == fs::Status::Success) {
+      profile(Access::Read, filepath, std::get<fs::Object>(*result).size());
+    }
+    std::apply(handler, *result);
+    return;
+  }
+
+  // Reading from disk would block, so hand it over to the blocking IO
+  // services and come back with the result.
+  blocking_io_service_.post([me = shared_from_this(), filepath, handler]() {
+    auto [status, file, info] =
+        me->buckets_.route(filepath).getWithInfo(filepath);
+    boost::asio::post(me->serializer_, [me, filepath, status = status,
+                                        file = std::move(file), info = info,
+                                        handler]() {
+      if (status == fs::Status::Success) {
+        me->profile(Access::Read, filepath, file.size());
+      }
+      handler(status, file, info);
+    });
+  });
+}
+
+void Session::modifyFile(
+    const std::string& filepath,
+    const std::function<fs::Status(fs::IFilesystem& filesystem)>& operation,
+    const std::function<void(fs::Status status)>& handler) {
+  auto& filesystem = buckets_.route(filepath);
+  if (!filesystem.isOnDisk(filepath)) {
+    handler(operation(filesystem));
+    return;
+  }
+
+  // Reading the file from disk would block, so hand it over to the blocking
+  // IO services and come back with the result.
+  blocking_io_service_.post(
+      [me = shared_from_this(), &filesystem, operation, handler]() {
+        const auto status = operation(filesystem);
+        boost::asio::post(me->serializer_,
+                          [me, status, handler]() { handler(status); });
+      });
+}
+
+void Session::removeDirectory(
+    const std::string& directory, bool fan_out,
+    const std::optional<std::string>& authorization,
+    const std::function<void(std::optional<std::size_t> count)>& handler) {
+  blocking_io_service_.post([me = shared_from_this(), directory, fan_out,
+                             authorization, handler]() {
+    std::optional<std::size_t> count{me->buckets_.removePrefix(directory)};
+    BOOST_LOG_TRIVIAL(info)
+        << "Deleted " << *count << " file(s) under: " << directory;
+
+    // Remaining nodes are still cleaned up if one of them fails.
+    if (fan_out) {
+      const auto& self = me->cluster_->getSelf();
+      for (const auto& node : me->cluster_->getNodes()) {
+        if (node.name == self.name) {
+          continue;
+        }
+
+        const auto removed = cluster::removePeerDirectory(
+            node, directory, authorization,
+            me->cluster_->getRequestTimeout());
+        if (!removed) {
+          BOOST_LOG_TRIVIAL(error)
+              << "Failed to delete files of cluster node " << node.name;
+          count.reset();
+        } else if (count) {
+          *count += *removed;
+        }
+      }
+    }
+
+    boost::asio::post(me->serializer_,
+                      [me, count, handler]() { handler(count); });
+  });
+}
+
+bool Session::isReadOnly() const noexcept {
+  return (replica_ != nullptr) &&
+         (replica_->getRole() == replication::Role::Follower);
+}
+
+const cluster::Node* Session::getRemoteOwner(
+    std::string_view filepath) const noexcept {
+  if ((cluster_ == nullptr) || cluster_->isLocal(filepath)) {
+    return nullptr;
+  }
+
+  return &cluster_->getOwner(filepath);
+}
+
 void Session::closeFtpDataSocket() noexcept {
   ErrorCode error_code;
   auto data_socket = ftp_data_socket_.lock();
@@ -203,7 +458,8 @@ void Session::closeFtpDataSocket() noexcept {
 }
 
 void Session::sendFtpDataHandler(const std::shared_ptr<Socket>& data_socket) {
-  ftp_data_serializer_.post([me = shared_from_this(), data_socket]() {
+  boost::asio::post(ftp_data_serializer_, [me = shared_from_this(),
+                                           data_socket]() {
     // Get the next file from FTP data socket send queue.
     const auto data = me->ftp_data_buffer_.front();
 
@@ -212,7 +468,8 @@ void Session::sendFtpDataHandler(const std::shared_ptr<Socket>& data_socket) {
       // this handler so that the next file can be sent.
       boost::asio::async_write(
           *data_socket, boost::asio::buffer(*data),
-          me->ftp_data_serializer_.wrap(
+          boost::asio::bind_executor(
+              me->ftp_data_serializer_,
               [me, data, data_socket](ErrorCode error_code, std::size_t) {
                 me->ftp_data_buffer_.pop_front();
 
@@ -243,7 +500,8 @@ void Session::sendFtpDataHandler(const std::shared_ptr<Socket>& data_socket) {
 void Session::enqueueFtpDataHandler(
     const std::shared_ptr<fs::File>& file,
     const std::shared_ptr<Socket>& data_socket) {
-  ftp_data_serializer_.post([me = shared_from_this(), file, data_socket]() {
+  boost::asio::post(ftp_data_serializer_, [me = shared_from_this(), file,
+                                           data_socket]() {
     // Enqueue the file for sending and trigger the send handler if the are no
     // pending writes.
     const auto write_in_progress = (!me->ftp_data_buffer_.empty());
@@ -255,68 +513,101 @@ void Session::enqueueFtpDataHandler(
 }
 
 void Session::acceptFile(const std::shared_ptr<fs::File>& file,
-                         const std::shared_ptr<std::string>& filepath) {
+                         const std::shared_ptr<std::string>& filepath,
+                         bool append) {
   auto data_socket = std::make_shared<Socket>(io_service_);
 
   // Once the connection request comes, start asynchronously receiving the file.
   ftp_data_acceptor_.async_accept(
       *data_socket,
-      ftp_data_serializer_.wrap([data_socket, file, filepath,
-                                 me = shared_from_this()](auto error_code) {
-        if (error_code) {
-          me->sendMessage(static_cast<std::string>(
-              FtpResponse(FtpReplyCode::TRANSFER_ABORTED,
-                          "Data transfer aborted: " + error_code.message())));
-          return;
-        }
+      boost::asio::bind_executor(
+          ftp_data_serializer_,
+          [data_socket, file, filepath, append,
+           me = shared_from_this()](auto error_code) {
+            if (error_code) {
+              me->sendMessage(static_cast<std::string>(FtpResponse(
+                  FtpReplyCode::TRANSFER_ABORTED,
+                  "Data transfer aborted: " + error_code.message())));
+              return;
+            }
 
-        me->ftp_data_socket_ = data_socket;
-        me->receiveFile(file, filepath, data_socket);
-      }));
+            me->ftp_data_socket_ = data_socket;
+            me->receiveFile(file, filepath, data_socket, append,
+                            std::make_shared<fs::Checksum>(0));
+          }));
 }
 
 void Session::receiveFile(const std::shared_ptr<fs::File>& file,
                           const std::shared_ptr<std::string>& filepath,
-                          const std::shared_ptr<Socket>& socket) {
+                          const std::shared_ptr<Socket>& socket, bool append,
+                          const std::shared_ptr<fs::Checksum>& checksum) {
   auto buffer = std::make_shared<fs::File>();
   buffer->resize(1024 * 1024 * 1);
 
   boost::asio::async_read(
       *socket, boost::asio::buffer(*buffer),
       boost::asio::transfer_at_least(buffer->size()),
-      ftp_data_serializer_.wrap(
-          [me = shared_from_this(), file, filepath, socket, buffer](
-              ErrorCode error_code, std::size_t length) {
+      boost::asio::bind_executor(
+          ftp_data_serializer_,
+          [me = shared_from_this(), file, filepath, socket, buffer, append,
+           checksum](ErrorCode error_code, std::size_t length) {
+            // Each chunk is checksummed as it is appended, while it is still
+            // in cache. Appended data is not, its checksum is not recorded.
             buffer->resize(length);
+            if (!append) {
+              *checksum = fs::crc32c(*buffer, *checksum);
+            }
             if (error_code) {
               if (length > 0) {
                 file->append(*buffer);
               }
-              me->saveFile(file, filepath);
+              me->saveFile(file, filepath, append, *checksum);
             } else if (length > 0) {
-              me->receiveFile(file, filepath, socket);
+              me->receiveFile(file, filepath, socket, append, checksum);
               file->append(*buffer);
             }
           }));
 }
 
 void Session::saveFile(const std::shared_ptr<fs::File>& file,
-                       const std::shared_ptr<std::string>& filepath) {
-  ftp_data_serializer_.post([me = shared_from_this(), file, filepath]() {
-    const auto status = me->filesystem_.add(*filepath, *file);
-    switch (status) {
-      case fs::Status::Success:
-        BOOST_LOG_TRIVIAL(info) << "Saved file: " << *filepath;
-        me->sendMessage(static_cast<std::string>(
-            FtpResponse{FtpReplyCode::CLOSING_DATA_CONNECTION, "File saved"}));
-        break;
-      default:
-        me->sendMessage(static_cast<std::string>(FtpResponse(
-            FtpReplyCode::FILE_ACTION_NOT_TAKEN, "File not saved")));
-        break;
+                       const std::shared_ptr<std::string>& filepath,
+                       bool append, fs::Checksum checksum) {
+  boost::asio::post(ftp_data_serializer_, [me = shared_from_this(), file,
+                                           filepath, append, checksum]() {
+    const auto handler = [me, file, filepath](fs::Status status) {
+      switch (status) {
+        case fs::Status::Success:
+          BOOST_LOG_TRIVIAL(info) << "Saved file: " << *filepath;
+          me->profile(Access::Write, *filepath, file->size());
+          me->sendMessage(static_cast<std::string>(FtpResponse{
+              FtpReplyCode::CLOSING_DATA_CONNECTION, "File saved"}));
+          break;
+        default:
+          me->sendMessage(static_cast<std::string>(FtpResponse(
+              FtpReplyCode::FILE_ACTION_NOT_TAKEN, "File not saved")));
+          break;
+      }
+
+      boost::asio::post(me->ftp_data_serializer_,
+                        [me]() { me->closeFtpDataSocket(); });
+    };
+
+    // The checksum of an appended file is not known.
+    if (append) {
+      me->modifyFile(*filepath,
+                     [file, filepath](fs::IFilesystem& filesystem) {
+                       return filesystem.append(*filepath, *file);
+                     },
+                     handler);
+      return;
     }
 
-    me->closeFtpDataSocket();
+    // New files are put rather than added, so that their checksum is recorded
+    // along with them.
+    auto& filesystem = me->buckets_.route(*filepath);
+    handler(filesystem
+                .put(*filepath, *file, fs::Precondition{false}, checksum)
+                .first);
   });
 }
 
@@ -2,14 +2,21 @@
 #define SERVER_OBJECT_STORAGE_SRC_SESSION_HPP
 
 #include <boost/asio.hpp>
+#include <chrono>
 #include <deque>
 #include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
+#include "buckets.hpp"
+#include "cluster/src/cluster.hpp"
 #include "filesystem/memory_fs/src/memory_fs.hpp"
+#include "profiler.hpp"
 #include "protocol/ftp/request/src/ftp_parser.hpp"
 #include "protocol/http/request/src/http_parser.hpp"
+#include "replication/src/replication.hpp"
 #include "user/database/src/user_database.hpp"
 
 namespace server {
@@ -24,6 +31,7 @@ using FtpHandler = std::function<void(
     const protocol::ftp::request::FtpParser&)>;   ///< FTP request handler
 using ErrorCode = boost::system::error_code;      ///< Error code
 using Endpoint = boost::asio::ip::tcp::endpoint;  ///< TCP endpoint
+using Executor = boost::asio::any_io_executor;    ///< Handler executor
 
 /**
  * \brief Range of port ID values.
@@ -39,14 +47,25 @@ class Session : public std::enable_shared_from_this<Session> {
    * \brief Create a new session.
    *
    * \param io_service OS IO services.
+   * \param blocking_io_service OS IO services for blocking filesystem
+   * operations.
    * \param user_database Users recognized by the server.
    * \param authenticate Enable/disable user authentication.
-   * \param filesystem Filesystem to manage.
+   * \param buckets Filesystems to manage (files are routed to buckets by
+   * their top-level directory).
    * \param ftp_port_range Port numbers to use by clients for FTP.
-   */
-  Session(IOService& io_service, const user::UserDatabase& user_database,
-          bool authenticate, fs::MemoryFs& filesystem,
-          PortRange ftp_port_range);
+   * \param replica Replication stream end (nullptr if not replicated).
+   * \param cluster Cluster this server is a node of (nullptr if none).
+   * \param profiler Workload profiler (nullptr if profiling is disabled).
+   * \param thread_confined The IO services are run by a single thread, so
+   * handlers of the session need no strands to be serialized.
+   */
+  Session(IOService& io_service, IOService& blocking_io_service,
+          const user::UserDatabase& user_database, bool authenticate,
+          Buckets& buckets, PortRange ftp_port_range,
+          const replication::IReplica* replica = nullptr,
+          const cluster::Cluster* cluster = nullptr,
+          Profiler* profiler = nullptr, bool thread_confined = false);
 
   // Disable copy and move since we are inheriting from shared_from_this
   Session(const Session&) = delete;
@@ -89,12 +108,41 @@ class Session : public std::enable_shared_from_this<Session> {
   /**
    * \brief Handler for receiving messages on HTTP/FTP socket.
    *
+   * Messages already in the input buffer are handled right away, the socket
+   * is only read once the buffer runs out of complete messages.
+   *
    * \note This method is asynchronous.
    */
   void receiveMessage();
 
   /**
-   * \brief Take the next message from send queue and transmit it.
+   * \brief Handle the next message of the input buffer (FTP request, or HTTP
+   * request header), if it is complete.
+   *
+   * \return True if a message was handled, false if more data is needed.
+   */
+  bool frameMessage();
+
+  /**
+   * \brief Read more data from HTTP/FTP socket into the input buffer, and
+   * resume framing once it arrives.
+   *
+   * \note This method is asynchronous.
+   */
+  void readMessage();
+
+  /**
+   * \brief Take data from the front of the input buffer.
+   *
+   * \param size Number of bytes to take (at most the number buffered).
+   *
+   * \return Data taken, valid until the next read into the buffer.
+   */
+  std::string_view consumeInput(std::size_t size) noexcept;
+
+  /**
+   * \brief Transmit all messages of the send queue with a single vectored
+   * write.
    *
    * \note This method is asynchronous.
    */
@@ -104,11 +152,80 @@ class Session : public std::enable_shared_from_this<Session> {
    * \brief Send message on HTTP/FTP socket.
    *
    * \note The message is put on the send queue and will be transmitted
-   * asynchronously.
+   * asynchronously, along with the other messages queued by the current
+   * handler.
    *
    * \param message Message to send.
    */
-  void sendMessage(const std::string& message);
+  void sendMessage(std::string message);
+
+  /**
+   * \brief Get file from the filesystem.
+   *
+   * \note Files which are not resident in memory are read asynchronously on
+   * the blocking IO services. The handler is always called on the HTTP/FTP
+   * socket serializer.
+   *
+   * \param filepath Path to the file to get.
+   * \param handler Handler to call with the result, the file and its
+   * metadata.
+   */
+  void getFile(const std::string& filepath,
+               const std::function<void(fs::Status status,
+                                        const fs::Object& file,
+                                        const fs::FileInfo& info)>& handler);
+
+  /**
+   * \brief Modify a file in the filesystem.
+   *
+   * \note Files stored on disk are read back before they are modified, so
+   * they are modified on the blocking IO services and the handler is called
+   * on the HTTP/FTP socket serializer. Other files are modified right away,
+   * the handler is called before this method returns.
+   *
+   * \param filepath Path to the file to modify.
+   * \param operation Modification to make to the filesystem holding the file.
+   * \param handler Handler to call with the status of the modification.
+   */
+  void modifyFile(const std::string& filepath,
+                  const std::function<fs::Status(fs::IFilesystem& filesystem)>&
+                      operation,
+                  const std::function<void(fs::Status status)>& handler);
+
+  /**
+   * \brief Remove all files under a directory from the filesystem.
+   *
+   * \note Files are removed on the blocking IO services, along with other
+   * cluster nodes (if requested). The handler is called on the HTTP/FTP socket
+   * serializer.
+   *
+   * \param directory Directory path (ending with '/').
+   * \param fan_out Remove files stored on other cluster nodes as well.
+   * \param authorization Value of the Authorization header to forward to other
+   * cluster nodes (if any).
+   * \param handler Handler to call with the number of removed files, or nothing
+   * if some cluster node could not be reached.
+   */
+  void removeDirectory(
+      const std::string& directory, bool fan_out,
+      const std::optional<std::string>& authorization,
+      const std::function<void(std::optional<std::size_t> count)>& handler);
+
+  /**
+   * \brief Check if the filesystem is read-only (replicated from a primary).
+   *
+   * \return True if clients are not allowed to modify the filesystem.
+   */
+  bool isReadOnly() const noexcept;
+
+  /**
+   * \brief Find the cluster node owning the given path, unless it is local.
+   *
+   * \param filepath Path to the file.
+   *
+   * \return Owner of the file, or nullptr if the file belongs to this server.
+   */
+  const cluster::Node* getRemoteOwner(std::string_view filepath) const noexcept;
 
   // ------------------ FTP ------------------
   /**
@@ -143,9 +260,11 @@ class Session : public std::enable_shared_from_this<Session> {
    *
    * \param file Buffer where the incoming file will be saved.
    * \param filepath Path where the received file will be saved.
+   * \param append Append to the existing file instead of creating a new one.
    */
   void acceptFile(const std::shared_ptr<fs::File>& file,
-                  const std::shared_ptr<std::string>& filepath);
+                  const std::shared_ptr<std::string>& filepath,
+                  bool append = false);
 
   /**
    * \brief Receive data on the given socket.
@@ -155,10 +274,15 @@ class Session : public std::enable_shared_from_this<Session> {
    * \param file Buffer where the received file will be saved.
    * \param filepath Path where the received file will be saved.
    * \param socket Socket on which the data will be received.
+   * \param append Append to the existing file instead of creating a new one.
+   * \param checksum Checksum of the data received so far, extended with every
+   * chunk received (unless appending, the checksum of the whole file is not
+   * known then).
    */
   void receiveFile(const std::shared_ptr<fs::File>& file,
                    const std::shared_ptr<std::string>& filepath,
-                   const std::shared_ptr<Socket>& socket);
+                   const std::shared_ptr<Socket>& socket, bool append,
+                   const std::shared_ptr<fs::Checksum>& checksum);
 
   /**
    * \brief Save file to the filesystem.
@@ -167,9 +291,12 @@ class Session : public std::enable_shared_from_this<Session> {
    *
    * \param file File to save.
    * \param filepath Path in the filesystem, where the file will be saved.
+   * \param append Append to the existing file instead of creating a new one.
+   * \param checksum Checksum of the file, recorded with new files.
    */
   void saveFile(const std::shared_ptr<fs::File>& file,
-                const std::shared_ptr<std::string>& filepath);
+                const std::shared_ptr<std::string>& filepath, bool append,
+                fs::Checksum checksum);
 
   /**
    * \brief Handle FTP request.
@@ -213,6 +340,13 @@ class Session : public std::enable_shared_from_this<Session> {
    */
   void handleFtpStor(const protocol::ftp::request::FtpParser& parser);
 
+  /**
+   * \brief Handle FTP APPE command.
+   *
+   * \param parser Parsed FTP request.
+   */
+  void handleFtpAppe(const protocol::ftp::request::FtpParser& parser);
+
   /**
    * \brief Handle FTP DELE command.
    *
@@ -248,6 +382,85 @@ class Session : public std::enable_shared_from_this<Session> {
    */
   void handleFtpCwd(const protocol::ftp::request::FtpParser& parser);
 
+  /**
+   * \brief Handle FTP RNFR command.
+   *
+   * \param parser Parsed FTP request.
+   */
+  void handleFtpRnfr(const protocol::ftp::request::FtpParser& parser);
+
+  /**
+   * \brief Handle FTP RNTO command.
+   *
+   * \param parser Parsed FTP request.
+   */
+  void handleFtpRnto(const protocol::ftp::request::FtpParser& parser);
+
+  /**
+   * \brief Handle FTP RMD command.
+   *
+   * Removes all files under the directory (on all cluster nodes).
+   *
+   * \param parser Parsed FTP request.
+   */
+  void handleFtpRmd(const protocol::ftp::request::FtpParser& parser);
+
+  /**
+   * \brief Handle FTP SIZE command.
+   *
+   * Replies with the size of a file, or the total size of the files under a
+   * directory.
+   *
+   * \param parser Parsed FTP request.
+   */
+  void handleFtpSize(const protocol::ftp::request::FtpParser& parser);
+
+  /**
+   * \brief Handle FTP STAT command.
+   *
+   * Replies with the size of a file, or the number and total size of the
+   * files under a directory (all files if no path is given).
+   *
+   * \param parser Parsed FTP request.
+   */
+  void handleFtpStat(const protocol::ftp::request::FtpParser& parser);
+
+  /**
+   * \brief Return usage of the directory an FTP path refers to.
+   *
+   * \note Usage is read from the filesystems of this server only, in cluster
+   * mode as well.
+   *
+   * \param path Absolute path of the directory (with or without the trailing
+   * '/').
+   *
+   * \return Directory path (ending with '/') and its usage, or nothing if
+   * there are no files under the directory (other than the root).
+   */
+  std::optional<std::pair<std::string, fs::Usage>> getFtpDirectoryUsage(
+      std::string path);
+
+  /**
+   * \brief Find the cluster node owning the file an FTP command refers to,
+   * unless it is local.
+   *
+   * \param parser Parsed FTP request.
+   *
+   * \return Owner of the file, or nullptr if the command does not refer to a
+   * file or the file belongs to this server.
+   */
+  const cluster::Node* getFtpRemoteOwner(
+      const protocol::ftp::request::FtpParser& parser) const noexcept;
+
+  /**
+   * \brief Resolve a path given to an FTP command.
+   *
+   * \param filename Absolute path, or path relative to the working directory.
+   *
+   * \return Absolute path.
+   */
+  std::string getFtpPath(std::string_view filename) const;
+
   /**
    * \brief Set up connection acceptor on FTP data socket.
    *
@@ -259,9 +472,9 @@ class Session : public std::enable_shared_from_this<Session> {
   /**
    * \brief Handle HTTP request.
    *
-   * \param request Request to handle.
+   * \param request Request to handle (request line and header).
    */
-  void handleHttp(std::string& request) noexcept;
+  void handleHttp(const std::string& request) noexcept;
 
   /**
    * \brief Authenticate HTTP user.
@@ -278,6 +491,137 @@ class Session : public std::enable_shared_from_this<Session> {
    */
   bool authHttpUser(const protocol::http::request::HttpParser& parser) noexcept;
 
+  /**
+   * \brief Respond to HTTP request without handling it.
+   *
+   * \note Request body (if any) is read and dropped, so that the connection
+   * can be reused.
+   *
+   * \param parser Parsed HTTP request.
+   * \param response Response to send.
+   */
+  void rejectHttpRequest(const protocol::http::request::HttpParser& parser,
+                         const std::string& response);
+
+  /**
+   * \brief List files stored on all cluster nodes.
+   *
+   * \note Other nodes are queried on the blocking IO services.
+   *
+   * \param parser Parsed HTTP request.
+   */
+  void listCluster(const protocol::http::request::HttpParser& parser);
+
+  /**
+   * \brief Delete all files under the directory given by a
+   * 'DELETE <directory>/?recursive' request.
+   *
+   * The response holds the number of deleted files. Within a cluster, files
+   * are deleted from all nodes.
+   *
+   * \param parser Parsed HTTP request.
+   */
+  void deleteDirectory(const protocol::http::request::HttpParser& parser);
+
+  /**
+   * \brief Respond to a 'GET /_changes?since=<sequence>[&timeout=<ms>]'
+   * long-poll request with mutations following the given sequence number.
+   *
+   * The response holds one "<sequence> <PUT|WRITE|REMOVE> <path>" line per
+   * mutation. It is sent as soon as there are mutations to report, or empty
+   * on timeout. Consumers which fell behind the mutation log get 410 Gone and
+   * have to list all files again.
+   *
+   * \param parser Parsed HTTP request.
+   */
+  void getChanges(const protocol::http::request::HttpParser& parser);
+
+  /**
+   * \brief Respond to a 'GET /_du[?prefix=<directory>]' request with the
+   * number and total size of files under a directory (all files by default).
+   *
+   * The response holds "objects: <count>" and "bytes: <size>" lines. Usage is
+   * kept up to date by the filesystems, the files are not scanned. In cluster
+   * mode, only files stored on this node are counted.
+   *
+   * \param parser Parsed HTTP request.
+   */
+  void getUsage(const protocol::http::request::HttpParser& parser);
+
+  /**
+   * \brief Respond to a 'GET /_merkle[?node=<index>]' request with a node of
+   * the Merkle tree of the files (the root by default).
+   *
+   * The response starts with a "<index> <digest>" line for the node, followed
+   * by the same for both children of an inner node (2 * index and
+   * 2 * index + 1), or by a "file <digest> <path>" line for every file of a
+   * leaf. Two servers are compared by walking their trees from the root and
+   * only descending into nodes whose digests differ. Only files outside of
+   * buckets are covered, and only if the tree is enabled (404 Not Found
+   * otherwise).
+   *
+   * \param parser Parsed HTTP request.
+   */
+  void getMerkleNode(const protocol::http::request::HttpParser& parser);
+
+  /**
+   * \brief Send the workload profile of this server (see Profiler::report()),
+   * or 404 Not Found if profiling is disabled.
+   *
+   * The profile is cleared once sent if the "reset" query parameter is given,
+   * so that consecutive requests profile consecutive periods.
+   *
+   * \param parser Parsed HTTP request.
+   */
+  void getProfile(const protocol::http::request::HttpParser& parser);
+
+  /**
+   * \brief Record an access in the workload profile (if profiling is
+   * enabled).
+   *
+   * \param access Kind of the access.
+   * \param filepath Path of the accessed file.
+   * \param size Size of the object read or written.
+   */
+  void profile(Access access, std::string_view filepath,
+               std::size_t size = 0);
+
+  /**
+   * \brief Send mutations following the given sequence number, once there are
+   * any or the deadline passes.
+   *
+   * \note Waiting does not block: the response is sent by a timer, which is
+   * cancelled early by the next mutation.
+   *
+   * \param since Sequence number of the last mutation already seen.
+   * \param deadline Time at which an empty response is sent.
+   */
+  void sendChanges(std::uint64_t since,
+                   std::chrono::steady_clock::time_point deadline);
+
+  /**
+   * \brief Receive HTTP request body.
+   *
+   * \note This method is asynchronous. The handler is called on the HTTP/FTP
+   * socket serializer, only if the whole body was received. Otherwise, an
+   * error response is sent.
+   *
+   * The body is checksummed as it arrives, and checked against the
+   * x-amz-checksum-crc32c header if the client sent one (400 Bad Request if it
+   * does not match).
+   *
+   * \param parser Parsed HTTP request.
+   * \param handler Handler to call with the received body and its checksum.
+   * \param handler_resumes The handler receives the next message itself,
+   * once it is done. Otherwise, it is received as soon as the handler
+   * returns.
+   */
+  void receiveHttpBody(
+      const protocol::http::request::HttpParser& parser,
+      const std::function<void(const std::shared_ptr<fs::File>& body,
+                               fs::Checksum checksum)>& handler,
+      bool handler_resumes = false);
+
   /**
    * \brief Handle HTTP GET request.
    *
@@ -285,6 +629,15 @@ class Session : public std::enable_shared_from_this<Session> {
    */
   void handleHttpGet(const protocol::http::request::HttpParser& parser);
 
+  /**
+   * \brief Handle HTTP HEAD request.
+   *
+   * \note Only the file metadata is looked up, the file is never read.
+   *
+   * \param parser Parsed HTTP request.
+   */
+  void handleHttpHead(const protocol::http::request::HttpParser& parser);
+
   /**
    * \brief Handle HTTP PUT request.
    *
@@ -292,6 +645,35 @@ class Session : public std::enable_shared_from_this<Session> {
    */
   void handleHttpPut(const protocol::http::request::HttpParser& parser);
 
+  /**
+   * \brief Handle HTTP POST request.
+   *
+   * 'POST <path>?uploads' starts a multipart upload and responds with its
+   * identifier. 'POST <path>?uploadId=<id>' completes the upload, with the
+   * same (conditional) semantics as PUT.
+   *
+   * \param parser Parsed HTTP request.
+   */
+  void handleHttpPost(const protocol::http::request::HttpParser& parser);
+
+  /**
+   * \brief Store a part of a multipart upload given by a
+   * 'PUT <path>?uploadId=<id>&partNumber=<number>' request.
+   *
+   * \param parser Parsed HTTP request.
+   */
+  void uploadHttpPart(const protocol::http::request::HttpParser& parser);
+
+  /**
+   * \brief Handle HTTP PATCH request.
+   *
+   * Request body is appended to the file, or written at the position given by
+   * the Content-Range header (if present).
+   *
+   * \param parser Parsed HTTP request.
+   */
+  void handleHttpPatch(const protocol::http::request::HttpParser& parser);
+
   /**
    * \brief Handle HTTP DELETE request.
    *
@@ -299,30 +681,87 @@ class Session : public std::enable_shared_from_this<Session> {
    */
   void handleHttpDelete(const protocol::http::request::HttpParser& parser);
 
+  /**
+   * \brief Handle HTTP COPY and MOVE requests.
+   *
+   * The file is copied (or moved) to the path given by the Destination
+   * header, without transferring its contents.
+   *
+   * \param parser Parsed HTTP request.
+   */
+  void handleHttpCopy(const protocol::http::request::HttpParser& parser);
+
+  /// Maximum number of mutations sent in a single change feed response.
+  static constexpr std::size_t kMaxChanges{1000};
+
+  /// Change feed long-poll timeout used if the client does not give one.
+  static constexpr std::chrono::milliseconds kChangesTimeout{30000};
+
+  /// Maximum change feed long-poll timeout.
+  static constexpr std::chrono::milliseconds kMaxChangesTimeout{300000};
+
+  /// Maximum number of request body bytes read (and checksummed) at once.
+  static constexpr std::size_t kMaxBodyChunkSize{64 * 1024};
+
+  /// Initial size of the input buffer (enough for most requests).
+  static constexpr std::size_t kInputBufferSize{4 * 1024};
+
+  /// Maximum size of an FTP request or HTTP request header.
+  static constexpr std::size_t kMaxMessageSize{64 * 1024};
+
   // ------------------ COMMON ------------------
   const user::UserDatabase& user_database_;  ///< User database
   const bool authenticate_;                  ///< Authenticate users
-  fs::MemoryFs& filesystem_;                 ///< In-memory file storage
+  Buckets& buckets_;                         ///< In-memory file storage
+  const replication::IReplica* replica_;     ///< Replication stream end
+  const cluster::Cluster* cluster_;          ///< Cluster membership
+  Profiler* profiler_;                       ///< Workload profiler
   IOService& io_service_;                    ///< OS IO services
+  IOService& blocking_io_service_;           ///< Blocking OS IO services
   Socket socket_;                            ///< HTTP/FTP socket
   std::string client_address_;               ///< Client IPv4 addres
   std::uint16_t client_port_;                ///< Client port number
 
-  /// Serializer for handler execution on HTTP/FTP socket
-  IOService::strand serializer_;
+  /// Serializer for handler execution on HTTP/FTP socket (a strand, or the IO
+  /// services themselves if the session is thread confined).
+  Executor serializer_;
+
+  /// Buffer for reading messages from HTTP/FTP socket, reused by all
+  /// messages of the connection.
+  std::vector<char> input_buffer_;
+
+  /// Start of the input data not handled yet.
+  std::size_t input_begin_{0};
 
-  /// Buffer for reading messages from HTTP/FTP socket
-  boost::asio::streambuf input_stream_;
+  /// End of the input data.
+  std::size_t input_end_{0};
+
+  /// Number of unhandled input bytes already searched for the end of the next
+  /// message (it is not searched for twice).
+  std::size_t input_scanned_{0};
+
+  /// Messages are being framed. Messages requested meanwhile are framed by
+  /// the same loop, rather than by nested calls.
+  bool framing_{false};
+
+  /// The next message was requested while framing.
+  bool message_requested_{false};
 
   /// Output message queue storing HTTP/FTP responses ready to be sent.
   std::deque<std::string> output_queue_;
 
+  /// Buffers of the messages being written (reused by all writes).
+  std::vector<boost::asio::const_buffer> output_buffers_;
+
+  /// Messages are being written, or a write of the queue is scheduled.
+  bool output_pending_{false};
+
   // ------------------ FTP ------------------
   /// Acceptor for FTP data socket connections
   Acceptor ftp_data_acceptor_;
 
   /// Serializer for handler execution on FTP data socket
-  IOService::strand ftp_data_serializer_;
+  Executor ftp_data_serializer_;
 
   /// FTP data socket
   std::weak_ptr<Socket> ftp_data_socket_;
@@ -348,6 +787,9 @@ class Session : public std::enable_shared_from_this<Session> {
   /// Current user's working directory.
   std::string current_working_dir_;
 
+  /// Path of the file to rename (given by the last RNFR command).
+  std::string rename_from_;
+
   /// Mapping from FTP command to the corresponding handler function.
   const std::unordered_map<protocol::ftp::request::FtpCommand, FtpHandler>
       ftp_handlers_;
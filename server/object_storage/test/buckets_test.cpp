@@ -0,0 +1,101 @@
+#include "server/object_storage/src/buckets.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace server::object_storage;
+
+/**
+ * \brief Create buckets named "a" and "b".
+ *
+ * \return Buckets.
+ */
+std::vector<BucketConfig> getConfigs() {
+  std::vector<BucketConfig> configs(2);
+  configs[0].name = "a";
+  configs[1].name = "b";
+  configs[1].fs.inline_threshold = 0;
+  return configs;
+}
+
+TEST(BucketsTest, NoBuckets) {
+  Buckets buckets{{}, {}};
+  EXPECT_EQ(&buckets.getDefault(), &buckets.route("/a/b"));
+  EXPECT_TRUE(buckets.isSameBucket("/a/b", "/c"));
+}
+
+TEST(BucketsTest, InvalidNames) {
+  std::vector<BucketConfig> configs(1);
+  EXPECT_THROW((Buckets{{}, configs}), std::invalid_argument);
+
+  configs[0].name = "a/b";
+  EXPECT_THROW((Buckets{{}, configs}), std::invalid_argument);
+
+  configs = getConfigs();
+  configs[1].name = "a";
+  EXPECT_THROW((Buckets{{}, configs}), std::invalid_argument);
+}
+
+TEST(BucketsTest, Route) {
+  Buckets buckets{{}, getConfigs()};
+  auto& a = buckets.route("/a/x");
+  auto& b = buckets.route("/b/x/y");
+  EXPECT_NE(&a, &b);
+  EXPECT_NE(&buckets.getDefault(), &a);
+  EXPECT_NE(&buckets.getDefault(), &b);
+  EXPECT_EQ(&a, &buckets.route("/a/"));
+
+  // Files named after buckets, and directories sharing a prefix with them,
+  // are not in the buckets.
+  EXPECT_EQ(&buckets.getDefault(), &buckets.route("/a"));
+  EXPECT_EQ(&buckets.getDefault(), &buckets.route("/ab/x"));
+  EXPECT_EQ(&buckets.getDefault(), &buckets.route("a/x"));
+  EXPECT_EQ(&buckets.getDefault(), &buckets.route("/"));
+
+  EXPECT_TRUE(buckets.isSameBucket("/a/x", "/a/y/z"));
+  EXPECT_FALSE(buckets.isSameBucket("/a/x", "/b/x"));
+  EXPECT_FALSE(buckets.isSameBucket("/a/x", "/x"));
+}
+
+TEST(BucketsTest, Isolation) {
+  Buckets buckets{{}, getConfigs()};
+  for (const auto* path : {"/a/x", "/b/x", "/c/x"}) {
+    ASSERT_EQ(fs::Status::Success,
+              buckets.route(path).add(path, fs::File{path}));
+  }
+
+  EXPECT_EQ(fs::FileList{"/a/x"}, buckets.route("/a/x").list());
+  EXPECT_EQ(fs::FileList{"/c/x"}, buckets.getDefault().list());
+  EXPECT_EQ(fs::File{"/b/x"}, buckets.route("/b/x").get("/b/x").second);
+  EXPECT_EQ(fs::Status::FileNotFound,
+            buckets.getDefault().get("/b/x").first);
+
+  auto filepaths = buckets.list();
+  std::sort(filepaths.begin(), filepaths.end());
+  EXPECT_EQ((fs::FileList{"/a/x", "/b/x", "/c/x"}), filepaths);
+
+  std::vector<std::string> names;
+  buckets.forEach([&names](const std::string& name, fs::IFilesystem&) {
+    names.push_back(name);
+  });
+  EXPECT_EQ((std::vector<std::string>{"", "a", "b"}), names);
+}
+
+TEST(BucketsTest, RemovePrefix) {
+  Buckets buckets{{}, getConfigs()};
+  for (const auto* path : {"/a/x", "/a/y", "/b/x", "/c/x"}) {
+    ASSERT_EQ(fs::Status::Success,
+              buckets.route(path).add(path, fs::File{path}));
+  }
+
+  EXPECT_EQ(2, buckets.removePrefix("/a/"));
+  EXPECT_EQ(0, buckets.removePrefix("/a/"));
+  EXPECT_EQ(2, buckets.list().size());
+
+  EXPECT_EQ(2, buckets.removePrefix("/"));
+  EXPECT_TRUE(buckets.list().empty());
+}
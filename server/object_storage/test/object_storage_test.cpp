@@ -34,6 +34,63 @@ TEST(ObjectStorageTest, Start) {
   EXPECT_TRUE(server.start());
 }
 
+TEST(ObjectStorageTest, ConstructorConfig) {
+  ObjectStorageConfig config;
+  config.address = "127.0.0.1";
+  config.port = 80;
+  ObjectStorage server{config};
+  EXPECT_EQ("127.0.0.1", server.getAddress());
+  EXPECT_EQ(80, server.getPort());
+}
+
+TEST(ObjectStorageTest, StartThreadPerCore) {
+  ObjectStorageConfig config;
+  config.address = "127.0.0.1";
+  config.port = 1671;
+  config.log_level = LogLevel::Error;
+  config.threading_model = ThreadingModel::ThreadPerCore;
+  ObjectStorage server{config};
+  EXPECT_TRUE(server.start(4));
+  EXPECT_FALSE(server.start(4));
+
+  // The port is still taken by the listening sockets of the first server.
+  ObjectStorage shared_server{"127.0.0.1", 1671, LogLevel::Error};
+  EXPECT_FALSE(shared_server.start());
+}
+
+TEST(ObjectStorageTest, StartThreadPerCoreAnyPort) {
+  ObjectStorageConfig config;
+  config.address = "127.0.0.1";
+  config.port = 0;
+  config.log_level = LogLevel::Error;
+  config.threading_model = ThreadingModel::ThreadPerCore;
+  ObjectStorage server{config};
+  ASSERT_TRUE(server.start(4));
+  EXPECT_NE(0, server.getPort());
+
+  // All threads listen on the port picked for the first one.
+  ObjectStorage shared_server{"127.0.0.1", server.getPort(), LogLevel::Error};
+  EXPECT_FALSE(shared_server.start());
+}
+
+TEST(ObjectStorageTest, RestartThreadPerCore) {
+  ObjectStorageConfig config;
+  config.address = "127.0.0.1";
+  config.port = 1672;
+  config.log_level = LogLevel::Error;
+  config.threading_model = ThreadingModel::ThreadPerCore;
+  ObjectStorage server{config};
+  {
+    ObjectStorage shared_server{"127.0.0.1", 1672, LogLevel::Error};
+    ASSERT_TRUE(shared_server.start());
+    EXPECT_FALSE(server.start(4));
+  }
+
+  // A failed start leaves nothing listening, the server starts once the port
+  // is free.
+  EXPECT_TRUE(server.start(4));
+}
+
 TEST(ObjectStorageTest, StartZeroThreads) {
   ObjectStorage server{};
   EXPECT_FALSE(server.start(0));
@@ -0,0 +1,133 @@
+#include "server/object_storage/src/profiler.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+
+using namespace server::object_storage;
+
+/**
+ * \brief Create configuration of a profiler recording every access.
+ *
+ * \return Profiler configuration.
+ */
+ProfilerConfig getConfig() {
+  ProfilerConfig config;
+  config.enabled = true;
+  config.sampling_interval = 1;
+  config.top_keys = 2;
+  return config;
+}
+
+TEST(ProfilerTest, Empty) {
+  const Profiler profiler{getConfig()};
+  EXPECT_EQ("samples: 0\nsampling_interval: 1\n", profiler.report());
+}
+
+TEST(ProfilerTest, Sizes) {
+  Profiler profiler{getConfig()};
+  profiler.record(Access::Read, "/a", 0);
+  profiler.record(Access::Write, "/a", 1);
+  profiler.record(Access::Read, "/a", 1024);
+  profiler.record(Access::Read, "/a", 2047);
+  profiler.record(Access::Remove, "/a", 4096);
+
+  const auto report = profiler.report();
+  EXPECT_NE(std::string::npos, report.find("samples: 5\n"));
+  EXPECT_NE(std::string::npos, report.find("size 0-0: 1\n"));
+  EXPECT_NE(std::string::npos, report.find("size 1-1: 1\n"));
+  EXPECT_NE(std::string::npos, report.find("size 1024-2047: 2\n"));
+
+  // Removes have no size.
+  EXPECT_EQ(std::string::npos, report.find("size 4096"));
+}
+
+TEST(ProfilerTest, Prefixes) {
+  auto config = getConfig();
+  config.max_prefixes = 3;
+  Profiler profiler{config};
+  profiler.record(Access::Read, "/photos/a.jpg", 1);
+  profiler.record(Access::Read, "/photos/2024/b.jpg", 1);
+  profiler.record(Access::Write, "/photos/c.jpg", 1);
+  profiler.record(Access::Remove, "/file", 0);
+  profiler.record(Access::Write, "/logs/a", 1);
+  profiler.record(Access::Write, "/other/a", 1);
+
+  const auto report = profiler.report();
+  EXPECT_NE(std::string::npos,
+            report.find("prefix * reads: 0 writes: 1 removes: 0\n"));
+  EXPECT_NE(std::string::npos,
+            report.find("prefix / reads: 0 writes: 0 removes: 1\n"));
+  EXPECT_NE(std::string::npos,
+            report.find("prefix /photos reads: 2 writes: 1 removes: 0\n"));
+  EXPECT_NE(std::string::npos,
+            report.find("prefix /logs reads: 0 writes: 1 removes: 0\n"));
+
+  config.prefix_depth = 2;
+  Profiler deeper{config};
+  deeper.record(Access::Read, "/photos/2024/b.jpg", 1);
+  deeper.record(Access::Read, "/photos/a.jpg", 1);
+  EXPECT_NE(std::string::npos, deeper.report().find("prefix /photos/2024 "));
+  EXPECT_NE(std::string::npos, deeper.report().find("prefix /photos "));
+}
+
+TEST(ProfilerTest, HotKeys) {
+  Profiler profiler{getConfig()};
+  for (int i = 0; i < 100; i++) {
+    profiler.record(Access::Read, "/cold/" + std::to_string(i), 1);
+    if (i % 2 == 0) {
+      profiler.record(Access::Read, "/hot", 1);
+    }
+    if (i % 4 == 0) {
+      profiler.record(Access::Write, "/warm", 1);
+    }
+  }
+
+  // Hot keys are listed hottest first.
+  std::istringstream report{profiler.report()};
+  std::string line;
+  std::string hot_keys;
+  while (std::getline(report, line)) {
+    if (line.rfind("hot ", 0) == 0) {
+      hot_keys += line + '\n';
+    }
+  }
+  EXPECT_EQ("hot 50 /hot\nhot 25 /warm\n", hot_keys);
+
+  profiler.reset();
+  EXPECT_EQ("samples: 0\nsampling_interval: 1\n", profiler.report());
+}
+
+TEST(ProfilerTest, Sampling) {
+  auto config = getConfig();
+  config.sampling_interval = 10;
+  Profiler profiler{config};
+  for (int i = 0; i < 1000; i++) {
+    profiler.record(Access::Read, "/a", 1);
+  }
+
+  const auto report = profiler.report();
+  EXPECT_NE(std::string::npos, report.find("samples: 100\n"));
+  EXPECT_NE(std::string::npos, report.find("hot 100 /a\n"));
+}
+
+TEST(ProfilerTest, Dump) {
+  Profiler profiler{getConfig()};
+  profiler.record(Access::Write, "/a", 1);
+
+  const auto path =
+      (std::filesystem::temp_directory_path() / "profiler_test_dump.txt")
+          .string();
+  ASSERT_TRUE(profiler.dump(path));
+  std::ifstream file{path};
+  std::stringstream contents;
+  contents << file.rdbuf();
+  EXPECT_EQ(profiler.report(), contents.str());
+  std::remove(path.c_str());
+
+  EXPECT_FALSE(profiler.dump("/nonexistent/directory/profile.txt"));
+}
@@ -0,0 +1,220 @@
+#include "integration_tests.hpp"
+
+#include <fstream>
+#include <future>
+#include <set>
+#include <sstream>
+
+#include "cluster/src/cluster.hpp"
+
+using namespace server::object_storage;
+using namespace test;
+using namespace test::http;
+
+namespace {
+
+/// HTTP/FTP ports of the cluster nodes used for testing.
+constexpr std::array<std::uint16_t, 3> kNodePortIds{1670, 1671, 1672};
+
+/// Static cluster configuration file used for testing.
+constexpr std::string_view kClusterConfigFile{"/tmp/object_store_cluster"};
+
+/**
+ * \brief Run HTTP request against the given node.
+ *
+ * \param port Node port.
+ * \param uri Uniform Resource Identifier.
+ * \param method HTTP method (use uppercase)
+ * \param filename Local file to use for download/upload.
+ * \param flags Additional flags to pass to curl.
+ *
+ * \return HTTP status code returned by the server.
+ */
+int request(std::uint16_t port, const std::string& uri,
+            const std::string& method,
+            const std::string& filename = std::string{kOutFileName},
+            const std::string& flags = "") {
+  return curl(uri, method, false, filename, std::string{kUsername},
+              std::string{kPassword}, std::string{kHostname}, port, flags);
+}
+
+/**
+ * \brief Read contents of the scratch file.
+ *
+ * \return Scratch file contents.
+ */
+std::string readOutFile() {
+  std::ifstream file{std::string{kOutFileName}};
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+/**
+ * \brief Cluster integration test fixture.
+ *
+ * Runs several cluster nodes on localhost, in the same process. Membership
+ * is loaded from a static configuration file, as by a real deployment.
+ */
+class ClusterIntegrationTest : public ::testing::Test {
+ protected:
+  /**
+   * \brief Test setup.
+   *
+   * Write the cluster configuration file and start all nodes.
+   */
+  void SetUp() override {
+    {
+      std::ofstream file{std::string{kClusterConfigFile}};
+      file << "# Test cluster\nvirtual_nodes 64\n";
+      for (std::size_t i = 0; i < kNodePortIds.size(); i++) {
+        file << "node node" << i << ' ' << kHostname << ' ' << kNodePortIds[i]
+             << '\n';
+      }
+    }
+
+    auto config = getServerConfig();
+    config.cluster =
+        cluster::loadClusterConfig(std::string{kClusterConfigFile});
+    for (std::size_t i = 0; i < kNodePortIds.size(); i++) {
+      config.port = kNodePortIds[i];
+      config.cluster.self = "node" + std::to_string(i);
+      nodes_.push_back(std::make_unique<ObjectStorage>(config));
+      ASSERT_TRUE(nodes_.back()->start(2));
+    }
+
+    cluster_ = std::make_unique<cluster::Cluster>(config.cluster);
+  }
+
+  /**
+   * \brief Return port of the node owning the given key.
+   *
+   * \param key Object key.
+   *
+   * \return Port of the owner.
+   */
+  std::uint16_t getOwnerPort(const std::string& key) const {
+    return cluster_->getOwner(key).port;
+  }
+
+  /// Cluster nodes.
+  std::vector<std::unique_ptr<ObjectStorage>> nodes_;
+
+  /// Cluster membership (as seen by the last node).
+  std::unique_ptr<cluster::Cluster> cluster_;
+};
+
+}  // namespace
+
+TEST_F(ClusterIntegrationTest, Redirect) {
+  const std::string file{"test/data/example.json"};
+  ASSERT_TRUE(std::filesystem::exists(file));
+
+  // Find a key owned by the second node.
+  std::string uri{"/object0"};
+  for (int i = 1; getOwnerPort(uri) != kNodePortIds[1]; i++) {
+    uri = "/object" + std::to_string(i);
+  }
+
+  // Other nodes redirect to the owner, the owner serves the request.
+  ASSERT_EQ(307, request(kNodePortIds[0], uri, "PUT", file));
+  ASSERT_EQ(307, request(kNodePortIds[2], uri, "GET"));
+  ASSERT_EQ(201, request(kNodePortIds[0], uri, "PUT", file, " -L"));
+  ASSERT_EQ(200, request(kNodePortIds[1], uri, "GET"));
+  ASSERT_TRUE(compareFiles(file, std::string{kOutFileName}));
+
+  ASSERT_EQ(200, request(kNodePortIds[2], uri, "GET", std::string{kOutFileName},
+                         " -L"));
+  ASSERT_TRUE(compareFiles(file, std::string{kOutFileName}));
+
+  ASSERT_EQ(200, request(kNodePortIds[0], uri, "DELETE",
+                         std::string{kOutFileName}, " -L"));
+  ASSERT_EQ(404, request(kNodePortIds[1], uri, "GET"));
+}
+
+TEST_F(ClusterIntegrationTest, ListAll) {
+  const std::string file{"test/data/example.json"};
+  ASSERT_TRUE(std::filesystem::exists(file));
+
+  // Keys are spread over all nodes.
+  std::vector<std::string> uris;
+  std::set<std::uint16_t> owners;
+  for (int i = 0; i < 30; i++) {
+    uris.push_back("/file" + std::to_string(i));
+    owners.insert(getOwnerPort(uris.back()));
+    ASSERT_EQ(201, request(kNodePortIds[i % kNodePortIds.size()], uris.back(),
+                           "PUT", file, " -L"));
+  }
+  ASSERT_EQ(kNodePortIds.size(), owners.size());
+
+  // Listing of any node includes files of all nodes.
+  std::sort(uris.begin(), uris.end());
+  std::string expected;
+  for (const auto& uri : uris) {
+    expected += uri + '\n';
+  }
+
+  for (const auto port : kNodePortIds) {
+    ASSERT_EQ(200, request(port, "/", "GET"));
+    EXPECT_EQ(expected, readOutFile());
+  }
+}
+
+TEST_F(ClusterIntegrationTest, DeleteDirectory) {
+  const std::string file{"test/data/example.json"};
+  ASSERT_TRUE(std::filesystem::exists(file));
+
+  for (int i = 0; i < 30; i++) {
+    ASSERT_EQ(201, request(kNodePortIds[0], "/dir/file" + std::to_string(i),
+                           "PUT", file, " -L"));
+  }
+  ASSERT_EQ(201, request(kNodePortIds[0], "/other", "PUT", file, " -L"));
+
+  // Files are deleted from all nodes, whichever node is asked.
+  ASSERT_EQ(200, request(kNodePortIds[1], "/dir/?recursive", "DELETE",
+                         std::string{kOutFileName},
+                         " -o " + std::string{kOutFileName}));
+  EXPECT_EQ("30\n", readOutFile());
+  for (const auto port : kNodePortIds) {
+    ASSERT_EQ(200, request(port, "/", "GET"));
+    EXPECT_EQ("/other\n", readOutFile());
+  }
+}
+
+TEST_F(ClusterIntegrationTest, ConcurrentDeletes) {
+  // Nodes do not send deletes to themselves, which would take up the blocking
+  // threads needed to serve them.
+  std::vector<std::future<int>> deletes;
+  for (int i = 0; i < 8; i++) {
+    deletes.push_back(std::async(std::launch::async, [i]() {
+      return request(kNodePortIds[0], "/dir" + std::to_string(i) +
+                                          "/?recursive",
+                     "DELETE", std::string{kOutFileName}, " -o /dev/null");
+    }));
+  }
+
+  for (auto& result : deletes) {
+    EXPECT_EQ(200, result.get());
+  }
+}
+
+TEST_F(ClusterIntegrationTest, RecursiveOnlyDeletes) {
+  const std::string file{"test/data/example.json"};
+  ASSERT_TRUE(std::filesystem::exists(file));
+
+  // Find a key owned by the second node.
+  std::string uri{"/object0"};
+  for (int i = 1; getOwnerPort(uri) != kNodePortIds[1]; i++) {
+    uri = "/object" + std::to_string(i);
+  }
+
+  // Only deleting a directory is served by any node.
+  ASSERT_EQ(307, request(kNodePortIds[0], uri + "?recursive", "PUT", file));
+  ASSERT_EQ(307, request(kNodePortIds[0], uri + "?recursive", "GET"));
+  ASSERT_EQ(404, request(kNodePortIds[1], uri, "GET"));
+}
+
+TEST_F(ClusterIntegrationTest, NodeDown) {
+  nodes_.pop_back();
+  ASSERT_EQ(502, request(kNodePortIds[0], "/", "GET"));
+}
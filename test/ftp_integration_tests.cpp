@@ -1,5 +1,8 @@
 #include "integration_tests.hpp"
 
+#include <chrono>
+#include <thread>
+
 using namespace server::object_storage;
 using namespace test;
 using namespace test::ftp;
@@ -30,6 +33,19 @@ TEST_P(IntegrationTest, UploadDownload) {
   ASSERT_TRUE(compareFiles(file_to_upload, std::string{kOutFileName}));
 }
 
+TEST_P(IntegrationTest, UploadAppend) {
+  const std::string file_to_upload("test/data/example.json");
+  const std::string expected_file("/tmp/object_store_expected");
+  const std::string uri("/logs/example.json");
+  concatenateFiles(expected_file, {file_to_upload, file_to_upload});
+
+  ASSERT_TRUE(std::filesystem::exists(file_to_upload));
+  ASSERT_EQ(0, curl(TestScenario::Appe, uri, authenticate_, file_to_upload));
+  ASSERT_EQ(0, curl(TestScenario::Appe, uri, authenticate_, file_to_upload));
+  ASSERT_EQ(0, curl(TestScenario::Retr, uri, authenticate_));
+  ASSERT_TRUE(compareFiles(expected_file, std::string{kOutFileName}));
+}
+
 TEST_P(IntegrationTest, UploadDelete) {
   const std::string file_to_upload("test/data/example.json");
   const std::string uri("/data/example.json");
@@ -77,6 +93,37 @@ TEST_P(IntegrationTest, GetFileNotFound) {
   ASSERT_EQ(0, std::filesystem::file_size(kOutFileName));
 }
 
+TEST_P(IntegrationTest, Rename) {
+  const std::string file_to_upload("test/data/example.json");
+  const std::string uri("/build/example.tmp");
+  const std::string new_uri("/build/example.json");
+
+  ASSERT_TRUE(std::filesystem::exists(file_to_upload));
+  ASSERT_EQ(0, curl(TestScenario::Stor, uri, authenticate_, file_to_upload));
+  ASSERT_EQ(0, curl(TestScenario::Rename, uri, authenticate_, new_uri));
+  ASSERT_EQ(550, curl(TestScenario::Rename, uri, authenticate_, new_uri));
+  ASSERT_EQ(0, curl(TestScenario::List, "", authenticate_));
+  ASSERT_EQ(new_uri.size() + 1, std::filesystem::file_size(kOutFileName));
+  ASSERT_EQ(0, curl(TestScenario::Retr, new_uri, authenticate_));
+  ASSERT_TRUE(compareFiles(file_to_upload, std::string{kOutFileName}));
+}
+
+TEST_P(IntegrationTest, RemoveDirectory) {
+  const std::string file_to_upload("test/data/example.json");
+  const std::string kept_uri("/build.json");
+
+  ASSERT_TRUE(std::filesystem::exists(file_to_upload));
+  for (const std::string uri : {"/build/a.json", "/build/sub/b.json"}) {
+    ASSERT_EQ(0, curl(TestScenario::Stor, uri, authenticate_, file_to_upload));
+  }
+  ASSERT_EQ(0,
+            curl(TestScenario::Stor, kept_uri, authenticate_, file_to_upload));
+
+  ASSERT_EQ(0, curl(TestScenario::Rmd, "build", authenticate_));
+  ASSERT_EQ(0, curl(TestScenario::List, "", authenticate_));
+  ASSERT_EQ(kept_uri.size() + 1, std::filesystem::file_size(kOutFileName));
+}
+
 TEST_P(IntegrationTest, MultipleLargeFiles) {
   std::vector<std::string> files{
       "test/data/the_office_theme.mp3",
@@ -155,6 +202,119 @@ TEST_P(IntegrationTest, UserNoParam) {
                                  " --ftp-alternative-to-user \"USER\""));
 }
 
+TEST(BucketsIntegrationTest, Routing) {
+  std::vector<BucketConfig> buckets(1);
+  buckets[0].name = "build";
+  auto config = getServerConfig();
+  config.buckets = buckets;
+  ObjectStorage server{config};
+  ASSERT_TRUE(server.start(2));
+
+  const std::string file_to_upload("test/data/example.json");
+  const std::string bucket_uri("/build/example.json");
+  const std::string uri("/example.json");
+  ASSERT_TRUE(std::filesystem::exists(file_to_upload));
+  ASSERT_EQ(0, curl(TestScenario::Stor, bucket_uri, false, file_to_upload));
+  ASSERT_EQ(0, curl(TestScenario::Stor, uri, false, file_to_upload));
+  ASSERT_EQ(0, curl(TestScenario::List, ""));
+  ASSERT_EQ(bucket_uri.size() + uri.size() + 2,
+            std::filesystem::file_size(kOutFileName));
+
+  // Files stay in their buckets.
+  ASSERT_EQ(553, curl(TestScenario::Rename, bucket_uri, false, "/moved.json"));
+  ASSERT_EQ(0, curl(TestScenario::Rename, bucket_uri, false, "/build/a.json"));
+  ASSERT_EQ(0, curl(TestScenario::Retr, "/build/a.json"));
+  ASSERT_TRUE(compareFiles(file_to_upload, std::string{kOutFileName}));
+
+  ASSERT_EQ(0, curl(TestScenario::Rmd, "build"));
+  ASSERT_EQ(0, curl(TestScenario::List, ""));
+  ASSERT_EQ(uri.size() + 1, std::filesystem::file_size(kOutFileName));
+}
+
+TEST(TieredIntegrationTest, RenameDiskResident) {
+  auto config = getServerConfig();
+  config.fs.disk.enabled = true;
+  config.fs.disk.memory_budget = 0;
+  config.fs.disk.interval = std::chrono::milliseconds{1};
+  config.fs.log.max_entries = 16;
+  ObjectStorage server{config};
+  ASSERT_TRUE(server.start(1));
+
+  const std::string file{"test/data/example.json"};
+  ASSERT_TRUE(std::filesystem::exists(file));
+  ASSERT_EQ(0, curl(TestScenario::Stor, "/a.json", false, file));
+
+  // Let the migrator move the file to disk, then rename it.
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  ASSERT_EQ(0, curl(TestScenario::Rename, "/a.json", false, "/b.json"));
+  ASSERT_EQ(550, curl(TestScenario::Rename, "/a.json", false, "/c.json"));
+  ASSERT_EQ(0, curl(TestScenario::Retr, "/b.json"));
+  ASSERT_TRUE(compareFiles(file, std::string{kOutFileName}));
+}
+
+/**
+ * \brief Run an FTP command and return the server reply to it.
+ *
+ * \param scenario Test scenario (Size or Stat).
+ * \param uri Path given to the command.
+ *
+ * \return Reply line (e.g. "213 1024"), empty if there was none.
+ */
+std::string getReply(TestScenario scenario, const std::string& uri) {
+  // Replies are found in the verbose output of curl, following the command.
+  curl(scenario, uri, false, std::string{kOutFileName}, std::string{kUsername},
+       std::string{kPassword}, std::string{kHostname}, kServerPortId,
+       " -v --stderr " + std::string{kOutFileName});
+
+  std::ifstream output{std::string{kOutFileName}};
+  const auto command = uri.empty() ? std::string{"> STAT"}
+                       : scenario == TestScenario::Size ? "> SIZE " + uri
+                                                        : "> STAT " + uri;
+  auto sent = false;
+  for (std::string line; std::getline(output, line);) {
+    sent = sent || (line.rfind(command, 0) == 0);
+    if (sent && (line.rfind("< ", 0) == 0)) {
+      line.erase(0, 2);
+      if (!line.empty() && (line.back() == '\r')) {
+        line.pop_back();
+      }
+      return line;
+    }
+  }
+
+  return {};
+}
+
+TEST(UsageIntegrationTest, SizeAndStat) {
+  ObjectStorage server{std::string{kHostname}, kServerPortId,
+                       kServerLogLevel};
+  ASSERT_TRUE(server.start(1));
+
+  const std::string file{"test/data/example.json"};
+  ASSERT_TRUE(std::filesystem::exists(file));
+  const auto size = std::filesystem::file_size(file);
+  for (const std::string uri : {"/team/x/a", "/team/x/b", "/c"}) {
+    ASSERT_EQ(0, curl(TestScenario::Stor, uri, false, file));
+  }
+
+  EXPECT_EQ("213 " + std::to_string(size),
+            getReply(TestScenario::Size, "/team/x/a"));
+  EXPECT_EQ("213 " + std::to_string(2 * size),
+            getReply(TestScenario::Size, "/team/x"));
+  EXPECT_EQ("213 " + std::to_string(2 * size),
+            getReply(TestScenario::Size, "/team/"));
+  EXPECT_EQ("550 No such file or directory",
+            getReply(TestScenario::Size, "/other/"));
+
+  EXPECT_EQ("211 3 file(s), " + std::to_string(3 * size) + " byte(s) stored",
+            getReply(TestScenario::Stat, ""));
+  EXPECT_EQ("212 /team/x/: 2 file(s), " + std::to_string(2 * size) +
+                " byte(s)",
+            getReply(TestScenario::Stat, "/team/x/"));
+  EXPECT_EQ("213 /c: " + std::to_string(size) + " byte(s)",
+            getReply(TestScenario::Stat, "/c"));
+}
+
 /**
  * \brief Instantiate parametrized ObjectStorage FTP test suite
  *
@@ -162,6 +322,22 @@ TEST_P(IntegrationTest, UserNoParam) {
  * 1. Thread count used by the ObjectStorage server.
  * 2. User authentication disabled/enabled.
  */
+TEST(ThreadPerCoreIntegrationTest, UploadDownload) {
+  auto config = getServerConfig();
+  config.threading_model = ThreadingModel::ThreadPerCore;
+  ObjectStorage server{config};
+  ASSERT_TRUE(server.start(3));
+
+  // Control and data connections of a session are served by one thread.
+  const std::string file_to_upload("test/data/bmw_picture.jpeg");
+  for (int i = 0; i < 6; i++) {
+    const auto uri = "/cores/" + std::to_string(i) + ".jpeg";
+    ASSERT_EQ(0, curl(TestScenario::Stor, uri, false, file_to_upload));
+    ASSERT_EQ(0, curl(TestScenario::Retr, uri, false));
+    ASSERT_TRUE(compareFiles(file_to_upload, std::string{kOutFileName}));
+  }
+}
+
 INSTANTIATE_TEST_SUITE_P(Ftp, IntegrationTest,
                          ::testing::Values(TestParams{1, false},
                                            TestParams{8, false},
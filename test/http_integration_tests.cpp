@@ -1,5 +1,18 @@
 #include "integration_tests.hpp"
 
+#include <unistd.h>
+
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include "filesystem/object/src/checksum.hpp"
+#include "utils/src/utils.hpp"
+
 using namespace server::object_storage;
 using namespace test;
 using namespace test::http;
@@ -7,7 +20,10 @@ using namespace test::http;
 TEST_P(IntegrationTest, StartStop) {}
 
 TEST_P(IntegrationTest, Unsupported) {
-  ASSERT_EQ(400, curl("/", "HEAD", authenticate_));
+  ASSERT_EQ(400, curl("/", "OPTIONS", authenticate_, std::string{kOutFileName},
+                      std::string{kUsername}, std::string{kPassword},
+                      std::string{kHostname}, kServerPortId,
+                      " -o " + std::string{kOutFileName}));
   ASSERT_EQ(0, std::filesystem::file_size(kOutFileName));
 }
 
@@ -77,6 +93,335 @@ TEST_P(IntegrationTest, GetFileNotFound) {
   ASSERT_EQ(404, curl(uri_download, "GET", authenticate_));
 }
 
+TEST_P(IntegrationTest, CopyMove) {
+  const std::string file_to_upload("test/data/example.json");
+  const std::string uri("/build/example.tmp");
+  const auto destination = [](const std::string& path) {
+    return " -H \"Destination: http://" + std::string{kHostname} + ':' +
+           std::to_string(kServerPortId) + path + '\"';
+  };
+
+  ASSERT_TRUE(std::filesystem::exists(file_to_upload));
+  ASSERT_EQ(201, curl(uri, "PUT", authenticate_, file_to_upload));
+  ASSERT_EQ(201, curl(uri, "COPY", authenticate_, std::string{kOutFileName},
+                      std::string{kUsername}, std::string{kPassword},
+                      std::string{kHostname}, kServerPortId,
+                      destination("/build/copy.json")));
+  ASSERT_EQ(201, curl(uri, "MOVE", authenticate_, std::string{kOutFileName},
+                      std::string{kUsername}, std::string{kPassword},
+                      std::string{kHostname}, kServerPortId,
+                      " -H \"Destination: /build/example.json\""));
+  ASSERT_EQ(412, curl("/build/copy.json", "MOVE", authenticate_,
+                      std::string{kOutFileName}, std::string{kUsername},
+                      std::string{kPassword}, std::string{kHostname},
+                      kServerPortId, destination("/build/example.json")));
+  ASSERT_EQ(400, curl("/build/copy.json", "COPY", authenticate_));
+
+  ASSERT_EQ(404, curl(uri, "GET", authenticate_));
+  ASSERT_EQ(200, curl("/build/copy.json", "GET", authenticate_));
+  ASSERT_TRUE(compareFiles(file_to_upload, std::string{kOutFileName}));
+  ASSERT_EQ(200, curl("/build/example.json", "GET", authenticate_));
+  ASSERT_TRUE(compareFiles(file_to_upload, std::string{kOutFileName}));
+}
+
+TEST_P(IntegrationTest, DeleteDirectory) {
+  const std::string file_to_upload("test/data/example.json");
+
+  ASSERT_TRUE(std::filesystem::exists(file_to_upload));
+  for (const std::string uri :
+       {"/build/a.json", "/build/sub/b.json", "/build.json"}) {
+    ASSERT_EQ(201, curl(uri, "PUT", authenticate_, file_to_upload));
+  }
+
+  // The response holds the number of deleted files.
+  const auto delete_directory = [this](const std::string& uri) {
+    return curl(uri, "DELETE", authenticate_, std::string{kOutFileName},
+                std::string{kUsername}, std::string{kPassword},
+                std::string{kHostname}, kServerPortId,
+                " -o " + std::string{kOutFileName});
+  };
+
+  ASSERT_EQ(400, delete_directory("/build?recursive"));
+  ASSERT_EQ(200, delete_directory("/build/?recursive"));
+  std::string count;
+  std::getline(std::ifstream{std::string{kOutFileName}}, count);
+  ASSERT_EQ("2", count);
+  ASSERT_EQ(404, curl("/build/a.json", "GET", authenticate_));
+  ASSERT_EQ(404, curl("/build/sub/b.json", "GET", authenticate_));
+  ASSERT_EQ(200, curl("/build.json", "GET", authenticate_));
+}
+
+TEST_P(IntegrationTest, ConditionalWrite) {
+  const std::string file_to_upload("test/data/example.json");
+  const std::string headers_file("/tmp/object_store_headers");
+  const std::string uri("/lock.json");
+
+  ASSERT_TRUE(std::filesystem::exists(file_to_upload));
+
+  // Entity tag of the last response, as dumped by curl.
+  const auto get_entity_tag = [&headers_file]() {
+    std::ifstream headers{headers_file};
+    for (std::string line; std::getline(headers, line);) {
+      if (line.rfind("ETag: ", 0) == 0) {
+        return line.substr(6, line.find('\r') - 6);
+      }
+    }
+    return std::string{};
+  };
+
+  const auto request = [&](const std::string& method,
+                           const std::string& header) {
+    return curl(uri, method, authenticate_, file_to_upload,
+                std::string{kUsername}, std::string{kPassword},
+                std::string{kHostname}, kServerPortId,
+                " -D " + headers_file + " -H '" + header + "'");
+  };
+
+  // Create only if there is no such file yet.
+  ASSERT_EQ(201, request("PUT", "If-None-Match: *"));
+  const auto created = get_entity_tag();
+  ASSERT_FALSE(created.empty());
+  ASSERT_EQ(412, request("PUT", "If-None-Match: *"));
+
+  // Replace only the version that was read.
+  ASSERT_EQ(200, curl(uri, "GET", authenticate_, std::string{kOutFileName},
+                      std::string{kUsername}, std::string{kPassword},
+                      std::string{kHostname}, kServerPortId,
+                      " -D " + headers_file));
+  ASSERT_EQ(created, get_entity_tag());
+  ASSERT_EQ(412, request("PUT", "If-Match: \"0\""));
+  ASSERT_EQ(412, request("PUT", "If-Match: W/" + created));
+  ASSERT_EQ(201, request("PUT", "If-Match: " + created));
+  const auto replaced = get_entity_tag();
+  ASSERT_NE(created, replaced);
+  ASSERT_EQ(412, request("PUT", "If-Match: " + created));
+
+  ASSERT_EQ(412, request("DELETE", "If-Match: " + created));
+  ASSERT_EQ(200, request("DELETE", "If-Match: " + replaced));
+  ASSERT_EQ(412, request("DELETE", "If-Match: *"));
+  ASSERT_EQ(404, curl(uri, "GET", authenticate_));
+}
+
+TEST_P(IntegrationTest, ConditionalGet) {
+  const std::string file_to_upload("test/data/example.json");
+  const std::string headers_file("/tmp/object_store_headers");
+  const std::string uri("/cached.json");
+
+  ASSERT_TRUE(std::filesystem::exists(file_to_upload));
+  ASSERT_EQ(201, curl(uri, "PUT", authenticate_, file_to_upload));
+
+  // Value of a header of the last response, as dumped by curl.
+  const auto get_header = [](const std::string& filename,
+                             const std::string& name) {
+    std::ifstream headers{filename};
+    for (std::string line; std::getline(headers, line);) {
+      if (line.rfind(name + ": ", 0) == 0) {
+        return line.substr(name.size() + 2,
+                           line.find('\r') - name.size() - 2);
+      }
+    }
+    return std::string{};
+  };
+
+  const auto request = [&](const std::string& method,
+                           const std::string& header) {
+    return curl(uri, method, authenticate_, std::string{kOutFileName},
+                std::string{kUsername}, std::string{kPassword},
+                std::string{kHostname}, kServerPortId,
+                " -D " + headers_file + " -H '" + header + "'");
+  };
+
+  ASSERT_EQ(200, request("GET", "If-None-Match: \"0\""));
+  const auto entity_tag = get_header(headers_file, "ETag");
+  const auto last_modified = get_header(headers_file, "Last-Modified");
+  ASSERT_FALSE(entity_tag.empty());
+  ASSERT_FALSE(last_modified.empty());
+
+  // Unchanged files are not sent again.
+  std::filesystem::remove(kOutFileName);
+  ASSERT_EQ(304, request("GET", "If-None-Match: \"0\", W/" + entity_tag));
+  ASSERT_TRUE(!std::filesystem::exists(kOutFileName) ||
+              (std::filesystem::file_size(kOutFileName) == 0));
+  ASSERT_EQ(304, request("GET", "If-Modified-Since: " + last_modified));
+  ASSERT_EQ(200, request("GET", "If-Modified-Since: "
+                                "Sun, 06 Nov 1994 08:49:37 GMT"));
+  ASSERT_EQ(std::filesystem::file_size(file_to_upload),
+            std::filesystem::file_size(kOutFileName));
+
+  // HEAD responses only hold the headers.
+  ASSERT_EQ(200, curl(uri, "HEAD", authenticate_));
+  ASSERT_EQ(std::to_string(std::filesystem::file_size(file_to_upload)),
+            get_header(std::string{kOutFileName}, "Content-Length"));
+  ASSERT_EQ(entity_tag, get_header(std::string{kOutFileName}, "ETag"));
+  ASSERT_EQ(304, request("HEAD", "If-None-Match: " + entity_tag));
+  ASSERT_EQ(404, curl("/missing.json", "HEAD", authenticate_));
+
+  // A new version is sent again.
+  ASSERT_EQ(200, curl(uri, "PATCH", authenticate_, file_to_upload));
+  ASSERT_EQ(200, request("GET", "If-None-Match: " + entity_tag));
+  ASSERT_EQ(200, curl(uri, "DELETE", authenticate_));
+}
+
+TEST_P(IntegrationTest, Checksums) {
+  const std::string file_to_upload("test/data/example.json");
+  const std::string headers_file("/tmp/object_store_headers");
+  const std::string uri("/checked.json");
+
+  std::ifstream input{file_to_upload};
+  const std::string contents{std::istreambuf_iterator<char>{input}, {}};
+  ASSERT_FALSE(contents.empty());
+
+  // Checksum header value of the given contents.
+  const auto to_header = [](const std::string& data) {
+    const auto checksum = fs::crc32c(data);
+    const char bytes[] = {static_cast<char>(checksum >> 24),
+                          static_cast<char>(checksum >> 16),
+                          static_cast<char>(checksum >> 8),
+                          static_cast<char>(checksum)};
+    return utils::encode_base64(std::string_view{bytes, sizeof(bytes)});
+  };
+
+  const auto request = [&](const std::string& method,
+                           const std::string& header) {
+    return curl(uri, method, authenticate_,
+                (method == "PUT") ? file_to_upload : std::string{kOutFileName},
+                std::string{kUsername}, std::string{kPassword},
+                std::string{kHostname}, kServerPortId,
+                " -D " + headers_file + " -H '" + header + "'");
+  };
+
+  // Bodies which do not match their checksum are refused.
+  ASSERT_EQ(400, request("PUT", "x-amz-checksum-crc32c: " +
+                                    to_header(contents + "x")));
+  ASSERT_EQ(400, request("PUT", "x-amz-checksum-crc32c: !"));
+  ASSERT_EQ(404, curl(uri, "GET", authenticate_));
+
+  ASSERT_EQ(201,
+            request("PUT", "x-amz-checksum-crc32c: " + to_header(contents)));
+  ASSERT_EQ(200, request("GET", "Accept: */*"));
+  ASSERT_TRUE(compareFiles(file_to_upload, std::string{kOutFileName}));
+
+  // The checksum is recorded with the file, whether it was sent or not.
+  ASSERT_EQ(200, curl(uri, "DELETE", authenticate_));
+  ASSERT_EQ(201, request("PUT", "Accept: */*"));
+  ASSERT_EQ(200, request("HEAD", "Accept: */*"));
+  std::ifstream headers{headers_file};
+  std::string checksum;
+  for (std::string line; std::getline(headers, line);) {
+    if (line.rfind("x-amz-checksum-crc32c: ", 0) == 0) {
+      checksum = line.substr(23, line.find('\r') - 23);
+    }
+  }
+  EXPECT_EQ(to_header(contents), checksum);
+}
+
+TEST_P(IntegrationTest, MultipartUpload) {
+  const std::string file_to_upload("test/data/example.json");
+  const std::string response_file("/tmp/object_store_response");
+  const std::string part_file("/tmp/object_store_part");
+  const std::string uri("/parts.json");
+
+  ASSERT_TRUE(std::filesystem::exists(file_to_upload));
+
+  // Split the file into two parts.
+  std::ifstream input{file_to_upload, std::ios::binary};
+  const std::string contents{std::istreambuf_iterator<char>{input}, {}};
+  const auto split = contents.size() / 2;
+  const auto upload_part = [&](const std::string& upload,
+                               std::size_t number) {
+    std::ofstream{part_file, std::ios::binary}
+        << ((number == 1) ? contents.substr(0, split)
+                          : contents.substr(split));
+    return curl(uri + "?uploadId=" + upload +
+                    "&partNumber=" + std::to_string(number),
+                "PUT", authenticate_, part_file);
+  };
+
+  const auto start_upload = [&]() {
+    std::filesystem::remove(response_file);
+    EXPECT_EQ(200, curl(uri + "?uploads", "POST", authenticate_,
+                        file_to_upload, std::string{kUsername},
+                        std::string{kPassword}, std::string{kHostname},
+                        kServerPortId, " -o " + response_file));
+    std::string upload;
+    std::ifstream{response_file} >> upload;
+    return upload;
+  };
+
+  // Parts may come in any order, nothing is stored until completion.
+  const auto upload = start_upload();
+  ASSERT_FALSE(upload.empty());
+  ASSERT_EQ(200, upload_part(upload, 2));
+  ASSERT_EQ(200, upload_part(upload, 1));
+  ASSERT_EQ(400, upload_part(upload, 0));
+  ASSERT_EQ(404, curl(uri, "GET", authenticate_));
+  ASSERT_EQ(201, curl(uri + "?uploadId=" + upload, "POST", authenticate_,
+                      std::string{kOutFileName}, std::string{kUsername},
+                      std::string{kPassword}, std::string{kHostname},
+                      kServerPortId, " -o /dev/null"));
+
+  ASSERT_EQ(200, curl(uri, "GET", authenticate_));
+  std::ifstream output{std::string{kOutFileName}, std::ios::binary};
+  ASSERT_EQ(contents,
+            std::string(std::istreambuf_iterator<char>{output}, {}));
+
+  // Completed and aborted uploads are gone.
+  ASSERT_EQ(404, upload_part(upload, 1));
+  const auto aborted = start_upload();
+  ASSERT_EQ(200, upload_part(aborted, 1));
+  ASSERT_EQ(200, curl(uri + "?uploadId=" + aborted, "DELETE", authenticate_));
+  ASSERT_EQ(404, upload_part(aborted, 1));
+  ASSERT_EQ(200, curl(uri, "DELETE", authenticate_));
+}
+
+TEST_P(IntegrationTest, UploadAppend) {
+  const std::string file_to_upload("test/data/example.json");
+  const std::string expected_file("/tmp/object_store_expected");
+  const std::string uri("/logs/example.json");
+  concatenateFiles(expected_file, {file_to_upload, file_to_upload});
+
+  ASSERT_TRUE(std::filesystem::exists(file_to_upload));
+  ASSERT_EQ(201, curl(uri, "PUT", authenticate_, file_to_upload));
+  ASSERT_EQ(200, curl(uri, "PATCH", authenticate_, file_to_upload));
+  ASSERT_EQ(200, curl(uri, "GET", authenticate_));
+  ASSERT_TRUE(compareFiles(expected_file, std::string{kOutFileName}));
+}
+
+TEST_P(IntegrationTest, AppendCreates) {
+  const std::string file_to_upload("test/data/example.json");
+  const std::string uri("/logs/example.json");
+
+  ASSERT_TRUE(std::filesystem::exists(file_to_upload));
+  ASSERT_EQ(200, curl(uri, "PATCH", authenticate_, file_to_upload));
+  ASSERT_EQ(200, curl(uri, "GET", authenticate_));
+  ASSERT_TRUE(compareFiles(file_to_upload, std::string{kOutFileName}));
+}
+
+TEST_P(IntegrationTest, RangedWrite) {
+  const std::string file_to_upload("test/data/example.json");
+  const std::string expected_file("/tmp/object_store_expected");
+  const std::string uri("/logs/example.json");
+  concatenateFiles(expected_file, {file_to_upload, file_to_upload});
+
+  ASSERT_TRUE(std::filesystem::exists(file_to_upload));
+  const auto size = std::filesystem::file_size(file_to_upload);
+  const auto patch = [&](std::size_t offset) {
+    return curl(uri, "PATCH", authenticate_, file_to_upload,
+                std::string{kUsername}, std::string{kPassword},
+                std::string{kHostname}, kServerPortId,
+                " -H \"Content-Range: bytes " + std::to_string(offset) + '-' +
+                    std::to_string(offset + size - 1) + "/*\"");
+  };
+
+  ASSERT_EQ(404, patch(0));
+  ASSERT_EQ(201, curl(uri, "PUT", authenticate_, file_to_upload));
+  ASSERT_EQ(416, patch(size + 1));
+  ASSERT_EQ(200, patch(size));
+  ASSERT_EQ(200, patch(0));
+  ASSERT_EQ(200, curl(uri, "GET", authenticate_));
+  ASSERT_TRUE(compareFiles(expected_file, std::string{kOutFileName}));
+}
+
 TEST_P(IntegrationTest, MultipleLargeFiles) {
   std::vector<std::string> files{
       "test/data/the_office_theme.mp3",
@@ -114,6 +459,395 @@ TEST_P(IntegrationTest, NotAuthorized) {
                               std::string{kOutFileName}, username, password));
 }
 
+TEST(TieredIntegrationTest, DiskResident) {
+  auto config = getServerConfig();
+  config.fs.disk.enabled = true;
+  config.fs.disk.memory_budget = 0;
+  config.fs.disk.interval = std::chrono::milliseconds{1};
+
+  ObjectStorage server{config};
+  ASSERT_TRUE(server.start(2));
+
+  const std::vector<std::string> files{"test/data/example.json",
+                                       "test/data/bmw_picture.jpeg"};
+  for (const auto& file : files) {
+    ASSERT_TRUE(std::filesystem::exists(file));
+    ASSERT_EQ(201, curl("/" + file, "PUT", false, file));
+  }
+
+  // Let the migrator move everything to disk, then read it back.
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  for (const auto& file : files) {
+    ASSERT_EQ(200, curl("/" + file, "GET"));
+    ASSERT_TRUE(compareFiles(file, std::string{kOutFileName}));
+  }
+
+  ASSERT_EQ(404, curl("/does/not/exist", "GET"));
+}
+
+TEST(TieredIntegrationTest, ModifyDiskResident) {
+  auto config = getServerConfig();
+  config.fs.disk.enabled = true;
+  config.fs.disk.memory_budget = 0;
+  config.fs.disk.interval = std::chrono::milliseconds{1};
+
+  ObjectStorage server{config};
+  ASSERT_TRUE(server.start(2));
+
+  const std::string file{"test/data/example.json"};
+  ASSERT_TRUE(std::filesystem::exists(file));
+  ASSERT_EQ(201, curl("/a.json", "PUT", false, file));
+
+  // Let the migrator move the file to disk, then move and append to it.
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  ASSERT_EQ(201, curl("/a.json", "MOVE", false, std::string{kOutFileName},
+                      std::string{kUsername}, std::string{kPassword},
+                      std::string{kHostname}, kServerPortId,
+                      " -H \"Destination: /b.json\""));
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  ASSERT_EQ(200, curl("/b.json", "PATCH", false, file));
+
+  ASSERT_EQ(404, curl("/a.json", "GET"));
+  ASSERT_EQ(200, curl("/b.json", "GET"));
+  std::ifstream input{file};
+  const std::string contents{std::istreambuf_iterator<char>{input}, {}};
+  std::ifstream output{std::string{kOutFileName}};
+  EXPECT_EQ(contents + contents,
+            std::string(std::istreambuf_iterator<char>{output}, {}));
+}
+
+TEST(ChangeFeedIntegrationTest, LongPoll) {
+  auto config = getServerConfig();
+  config.fs.log.max_entries = 2;
+
+  ObjectStorage server{config};
+  ASSERT_TRUE(server.start(2));
+
+  const std::string file{"test/data/example.json"};
+  const std::string changes_file{"/tmp/object_store_changes"};
+  ASSERT_TRUE(std::filesystem::exists(file));
+  const auto read_changes = [&changes_file]() {
+    std::ifstream changes{changes_file};
+    return std::string{std::istreambuf_iterator<char>{changes}, {}};
+  };
+
+  // Nothing changed within the timeout.
+  ASSERT_EQ(200, curl("/_changes?since=0&timeout=10", "GET", false,
+                      changes_file));
+  EXPECT_EQ("", read_changes());
+
+  // A waiting consumer is woken up by the next change.
+  auto poll = std::async(std::launch::async, [&changes_file]() {
+    return curl("/_changes?since=0", "GET", false, changes_file);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  ASSERT_EQ(201, curl("/a", "PUT", false, file));
+  ASSERT_EQ(200, poll.get());
+  EXPECT_EQ("1 PUT /a\n", read_changes());
+
+  ASSERT_EQ(200, curl("/a", "DELETE"));
+  ASSERT_EQ(200, curl("/_changes?since=1", "GET", false, changes_file));
+  EXPECT_EQ("2 REMOVE /a\n", read_changes());
+
+  // Consumers which fell behind the log have to list all files again.
+  ASSERT_EQ(201, curl("/b", "PUT", false, file));
+  ASSERT_EQ(410, curl("/_changes?since=0", "GET", false, changes_file));
+  ASSERT_EQ(400, curl("/_changes", "GET", false, changes_file));
+}
+
+TEST(BucketsIntegrationTest, Routing) {
+  std::vector<BucketConfig> buckets(2);
+  buckets[0].name = "photos";
+  buckets[1].name = "logs";
+  buckets[1].fs.cache.slots = 16;
+  auto config = getServerConfig();
+  config.buckets = buckets;
+  ObjectStorage server{config};
+  ASSERT_TRUE(server.start(2));
+
+  const std::string file{"test/data/example.json"};
+  ASSERT_TRUE(std::filesystem::exists(file));
+  for (const std::string uri : {"/photos/a", "/logs/a", "/a"}) {
+    ASSERT_EQ(201, curl(uri, "PUT", false, file));
+    ASSERT_EQ(200, curl(uri, "GET"));
+    ASSERT_TRUE(compareFiles(file, std::string{kOutFileName}));
+  }
+
+  // The listing covers all buckets.
+  ASSERT_EQ(200, curl("/", "GET"));
+  std::ifstream listing{std::string{kOutFileName}};
+  std::vector<std::string> filepaths;
+  for (std::string line; std::getline(listing, line);) {
+    filepaths.push_back(line);
+  }
+  std::sort(filepaths.begin(), filepaths.end());
+  EXPECT_EQ((std::vector<std::string>{"/a", "/logs/a", "/photos/a"}),
+            filepaths);
+
+  // Files are copied and moved within buckets only.
+  ASSERT_EQ(502, curl("/photos/a", "COPY", false, std::string{kOutFileName},
+                      std::string{kUsername}, std::string{kPassword},
+                      std::string{kHostname}, kServerPortId,
+                      " -H \"Destination: /logs/b\""));
+  ASSERT_EQ(201, curl("/photos/a", "MOVE", false, std::string{kOutFileName},
+                      std::string{kUsername}, std::string{kPassword},
+                      std::string{kHostname}, kServerPortId,
+                      " -H \"Destination: /photos/b\""));
+  ASSERT_EQ(200, curl("/photos/b", "GET"));
+
+  // Removing a bucket's directory leaves the other buckets alone.
+  ASSERT_EQ(200, curl("/photos/?recursive", "DELETE", false,
+                      std::string{kOutFileName}, std::string{kUsername},
+                      std::string{kPassword}, std::string{kHostname},
+                      kServerPortId, " -o " + std::string{kOutFileName}));
+  std::string count;
+  std::getline(std::ifstream{std::string{kOutFileName}}, count);
+  EXPECT_EQ("1", count);
+  ASSERT_EQ(404, curl("/photos/b", "GET"));
+  ASSERT_EQ(200, curl("/logs/a", "GET"));
+  ASSERT_EQ(200, curl("/a", "GET"));
+}
+
+TEST(BucketsIntegrationTest, SharedMemory) {
+  std::vector<BucketConfig> buckets(1);
+  buckets[0].name = "shared";
+  buckets[0].shared.emplace();
+  buckets[0].shared->name = "/http_integration_tests_" +
+                            std::to_string(getpid());
+  buckets[0].shared->size = 1024 * 1024;
+  buckets[0].shared->max_objects = 1024;
+  fs::SharedMemoryFs::destroy(buckets[0].shared->name);
+
+  // Two servers (standing in for two processes) serve the same bucket, while
+  // files outside of it stay private.
+  const auto other_port = static_cast<uint16_t>(kServerPortId + 1);
+  auto config = getServerConfig();
+  config.buckets = buckets;
+  ObjectStorage first{config};
+  config.port = other_port;
+  config.ftp_port_range = {3000, 4000};
+  ObjectStorage second{config};
+  ASSERT_TRUE(first.start(1));
+  ASSERT_TRUE(second.start(1));
+
+  const std::string file{"test/data/example.json"};
+  ASSERT_TRUE(std::filesystem::exists(file));
+  const auto curl_second = [&file](const std::string& uri,
+                                   const std::string& method) {
+    return curl(uri, method, false,
+                method == "PUT" ? file : std::string{kOutFileName},
+                std::string{kUsername}, std::string{kPassword},
+                std::string{kHostname}, other_port);
+  };
+
+  ASSERT_EQ(201, curl("/shared/a", "PUT", false, file));
+  ASSERT_EQ(201, curl("/a", "PUT", false, file));
+  ASSERT_EQ(200, curl_second("/shared/a", "GET"));
+  ASSERT_TRUE(compareFiles(file, std::string{kOutFileName}));
+  ASSERT_EQ(404, curl_second("/a", "GET"));
+
+  ASSERT_EQ(200, curl_second("/shared/a", "DELETE"));
+  ASSERT_EQ(404, curl("/shared/a", "GET"));
+
+  // The servers keep their mappings until they are destroyed.
+  fs::SharedMemoryFs::destroy(buckets[0].shared->name);
+}
+
+TEST(UsageIntegrationTest, DiskUsage) {
+  std::vector<BucketConfig> buckets(1);
+  buckets[0].name = "team";
+  auto config = getServerConfig();
+  config.buckets = buckets;
+  ObjectStorage server{config};
+  ASSERT_TRUE(server.start(1));
+
+  const std::string file{"test/data/example.json"};
+  ASSERT_TRUE(std::filesystem::exists(file));
+  const auto size = std::filesystem::file_size(file);
+  for (const std::string uri : {"/team/x/a", "/team/x/b", "/team/y", "/c"}) {
+    ASSERT_EQ(201, curl(uri, "PUT", false, file));
+  }
+
+  const auto read_usage = []() {
+    std::ifstream output{std::string{kOutFileName}};
+    return std::string{std::istreambuf_iterator<char>{output},
+                       std::istreambuf_iterator<char>{}};
+  };
+  const auto usage = [](std::size_t objects, std::size_t bytes) {
+    return "objects: " + std::to_string(objects) +
+           "\nbytes: " + std::to_string(bytes) + '\n';
+  };
+
+  ASSERT_EQ(200, curl("/_du", "GET"));
+  EXPECT_EQ(usage(4, 4 * size), read_usage());
+  ASSERT_EQ(200, curl("/_du?prefix=/team/x", "GET"));
+  EXPECT_EQ(usage(2, 2 * size), read_usage());
+  ASSERT_EQ(200, curl("/_du?prefix=/team/", "GET"));
+  EXPECT_EQ(usage(3, 3 * size), read_usage());
+
+  ASSERT_EQ(200, curl("/team/x/a", "DELETE"));
+  ASSERT_EQ(200, curl("/_du?prefix=/team/x/", "GET"));
+  EXPECT_EQ(usage(1, size), read_usage());
+  ASSERT_EQ(200, curl("/_du?prefix=/none/", "GET"));
+  EXPECT_EQ(usage(0, 0), read_usage());
+  ASSERT_EQ(400, curl("/_du?prefix=team", "GET"));
+}
+
+TEST(MerkleIntegrationTest, Diff) {
+  auto config = getServerConfig();
+  config.fs.merkle.leaves = 64;
+  const auto other_port = static_cast<uint16_t>(kServerPortId + 1);
+  ObjectStorage first{config};
+  config.port = other_port;
+  config.ftp_port_range = {3000, 4000};
+  ObjectStorage second{config};
+  ASSERT_TRUE(first.start(1));
+  ASSERT_TRUE(second.start(1));
+
+  const std::string file{"test/data/example.json"};
+  const std::string other_file{"test/data/toto.jpeg"};
+  const auto put = [](uint16_t port, const std::string& uri,
+                      const std::string& path) {
+    return curl(uri, "PUT", false, path, std::string{kUsername},
+                std::string{kPassword}, std::string{kHostname}, port);
+  };
+  for (int i = 0; i < 20; i++) {
+    const auto uri = "/" + std::to_string(i);
+    ASSERT_EQ(201, put(kServerPortId, uri, file));
+    ASSERT_EQ(201, put(other_port, uri, file));
+  }
+
+  // Node lines of both servers, by index.
+  const auto get_node = [](uint16_t port, std::size_t index) {
+    std::vector<std::string> lines;
+    const auto status =
+        curl("/_merkle?node=" + std::to_string(index), "GET", false,
+             std::string{kOutFileName}, std::string{kUsername},
+             std::string{kPassword}, std::string{kHostname}, port);
+    EXPECT_EQ(200, status);
+    std::ifstream output{std::string{kOutFileName}};
+    for (std::string line; std::getline(output, line);) {
+      lines.push_back(line);
+    }
+    return lines;
+  };
+
+  // Files which differ are found by descending only into nodes whose digests
+  // differ.
+  const auto diff = [&get_node, other_port]() {
+    std::set<std::string> paths;
+    std::vector<std::size_t> pending{1};
+    while (!pending.empty()) {
+      const auto index = pending.back();
+      pending.pop_back();
+      const auto left = get_node(kServerPortId, index);
+      const auto right = get_node(other_port, index);
+      if (left.empty() || (left.front() == right.front())) {
+        continue;
+      }
+
+      for (const auto* lines : {&left, &right}) {
+        const auto& other = (lines == &left) ? right : left;
+        for (const auto& line : *lines) {
+          if (std::find(other.begin(), other.end(), line) != other.end()) {
+            continue;
+          }
+
+          std::istringstream fields{line};
+          std::string first;
+          std::string digest;
+          fields >> first >> digest;
+          if (first == "file") {
+            std::string path;
+            fields >> path;
+            paths.insert(path);
+          } else if ((lines == &left) && (std::stoul(first) != index)) {
+            pending.push_back(std::stoul(first));
+          }
+        }
+      }
+    }
+    return paths;
+  };
+
+  EXPECT_TRUE(diff().empty());
+  ASSERT_EQ(200, curl("/7", "DELETE", false, std::string{kOutFileName},
+                      std::string{kUsername}, std::string{kPassword},
+                      std::string{kHostname}, other_port));
+  ASSERT_EQ(201, put(other_port, "/7", other_file));
+  ASSERT_EQ(201, put(kServerPortId, "/new", file));
+  EXPECT_EQ((std::set<std::string>{"/7", "/new"}), diff());
+
+  ASSERT_EQ(400, curl("/_merkle?node=0", "GET"));
+  ASSERT_EQ(400, curl("/_merkle?node=128", "GET"));
+  ASSERT_EQ(405, curl("/_merkle", "HEAD"));
+
+  // Servers without the tree do not serve it.
+  const auto disabled_port = static_cast<uint16_t>(kServerPortId + 2);
+  ObjectStorage disabled{std::string{kHostname}, disabled_port,
+                         kServerLogLevel, false, {4000, 5000}};
+  ASSERT_TRUE(disabled.start(1));
+  ASSERT_EQ(404, curl("/_merkle", "GET", false, std::string{kOutFileName},
+                      std::string{kUsername}, std::string{kPassword},
+                      std::string{kHostname}, disabled_port));
+}
+
+TEST(ProfilerIntegrationTest, Profile) {
+  auto config = getServerConfig();
+  config.profiler.enabled = true;
+  config.profiler.sampling_interval = 1;
+  config.profiler.dump_path = std::string{kOutFileName} + ".profile";
+  {
+    ObjectStorage server{config};
+    ASSERT_TRUE(server.start(1));
+
+    const std::string file{"test/data/example.json"};
+    for (int i = 0; i < 3; i++) {
+      ASSERT_EQ(201, curl("/photos/" + std::to_string(i), "PUT", false, file));
+    }
+    for (int i = 0; i < 4; i++) {
+      ASSERT_EQ(200, curl("/photos/1", "GET"));
+    }
+    ASSERT_EQ(200, curl("/photos/2", "DELETE"));
+    ASSERT_EQ(404, curl("/photos/2", "GET"));
+
+    ASSERT_EQ(200, curl("/_profile", "GET"));
+    std::ifstream output{std::string{kOutFileName}};
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(output, line);) {
+      lines.push_back(line);
+    }
+    const auto has_line = [&lines](const std::string& line) {
+      return std::find(lines.begin(), lines.end(), line) != lines.end();
+    };
+    EXPECT_TRUE(has_line("samples: 8"));
+    EXPECT_TRUE(has_line("prefix /photos reads: 4 writes: 3 removes: 1"));
+    EXPECT_TRUE(has_line("hot 5 /photos/1"));
+
+    ASSERT_EQ(405, curl("/_profile", "HEAD"));
+    ASSERT_EQ(200, curl("/_profile?reset", "GET"));
+    ASSERT_EQ(200, curl("/_profile", "GET"));
+    std::ifstream reset_output{std::string{kOutFileName}};
+    std::string line;
+    std::getline(reset_output, line);
+    EXPECT_EQ("samples: 0", line);
+    ASSERT_EQ(200, curl("/photos/1", "GET"));
+  }
+
+  // The profile is written out once the server stops.
+  std::ifstream dump{config.profiler.dump_path};
+  std::string line;
+  std::getline(dump, line);
+  EXPECT_EQ("samples: 1", line);
+  std::remove(config.profiler.dump_path.c_str());
+
+  // Servers without the profiler do not serve it.
+  ObjectStorage disabled{std::string{kHostname}, kServerPortId,
+                         kServerLogLevel, false, {2000, 3000}};
+  ASSERT_TRUE(disabled.start(1));
+  ASSERT_EQ(404, curl("/_profile", "GET"));
+}
+
 /**
  * \brief Instantiate parametrized ObjectStorage HTTP test suite
  *
@@ -121,6 +855,97 @@ TEST_P(IntegrationTest, NotAuthorized) {
  * 1. Thread count used by the ObjectStorage server.
  * 2. User authentication disabled/enabled.
  */
+/**
+ * \brief Open a raw connection to the test server.
+ *
+ * \param io_context IO services of the connection.
+ *
+ * \return Connected socket.
+ */
+boost::asio::ip::tcp::socket connect(boost::asio::io_context& io_context) {
+  boost::asio::ip::tcp::socket socket{io_context};
+  socket.connect({boost::asio::ip::make_address(std::string{kHostname}),
+                  kServerPortId});
+  return socket;
+}
+
+TEST(FramingIntegrationTest, SlowClient) {
+  ObjectStorage server{std::string{kHostname}, kServerPortId, kServerLogLevel};
+  ASSERT_TRUE(server.start(1));
+
+  // A client sending its header slowly does not hold up the only thread.
+  boost::asio::io_context io_context;
+  auto slow_client = connect(io_context);
+  boost::asio::write(slow_client,
+                     boost::asio::buffer(std::string{"GET /a HTTP/1.1\r\n"}));
+  const std::string file{"test/data/example.json"};
+  ASSERT_EQ(201, curl("/a", "PUT", false, file));
+
+  boost::asio::write(slow_client,
+                     boost::asio::buffer(std::string{"Host: test\r\n\r\n"}));
+  boost::asio::streambuf response;
+  boost::asio::read_until(slow_client, response, "\r\n");
+  EXPECT_EQ("HTTP/1.1 200 OK\r\n",
+            std::string(boost::asio::buffers_begin(response.data()),
+                        boost::asio::buffers_begin(response.data()) + 17));
+}
+
+TEST(FramingIntegrationTest, Pipelining) {
+  ObjectStorage server{std::string{kHostname}, kServerPortId, kServerLogLevel};
+  ASSERT_TRUE(server.start(1));
+
+  // Body and the following requests arrive along with the first header.
+  boost::asio::io_context io_context;
+  auto client = connect(io_context);
+  boost::asio::write(client, boost::asio::buffer(std::string{
+                                 "PUT /a HTTP/1.1\r\nContent-Length: 5\r\n\r\n"
+                                 "helloGET /a HTTP/1.1\r\n\r\n"
+                                 "DELETE /a HTTP/1.1\r\n\r\n"}));
+
+  // Responses to PUT and GET (ending with the body), then DELETE.
+  boost::asio::streambuf buffer;
+  const auto read = [&client, &buffer](const std::string& delimiter) {
+    const auto size = boost::asio::read_until(client, buffer, delimiter);
+    std::string data(size, '\0');
+    buffer.sgetn(&data[0], static_cast<std::streamsize>(size));
+    return data;
+  };
+  const auto put_get = read("hello");
+  EXPECT_EQ(0, put_get.find("HTTP/1.1 201 Created\r\n"));
+  EXPECT_NE(std::string::npos, put_get.find("\r\n\r\nHTTP/1.1 200 OK\r\n"));
+  EXPECT_EQ(0, read("\r\n\r\n").find("HTTP/1.1 200 OK\r\n"));
+}
+
+TEST(ThreadPerCoreIntegrationTest, ConcurrentClients) {
+  auto config = getServerConfig();
+  config.threading_model = ThreadingModel::ThreadPerCore;
+  ObjectStorage server{config};
+  ASSERT_TRUE(server.start(4));
+
+  // Connections are spread over the threads, each serving its own.
+  const std::string file{"test/data/example.json"};
+  std::vector<std::future<bool>> clients;
+  for (int i = 0; i < 8; i++) {
+    clients.push_back(std::async(std::launch::async, [i, &file] {
+      const auto uri = "/cores/" + std::to_string(i);
+      const auto output = std::string{kOutFileName} + std::to_string(i);
+      const auto uploaded = curl(uri, "PUT", false, file) == 201;
+      const auto downloaded = curl(uri, "GET", false, output) == 200;
+      const auto equal = compareFiles(file, output);
+      std::remove(output.c_str());
+      return uploaded && downloaded && equal;
+    }));
+  }
+  for (auto& client : clients) {
+    EXPECT_TRUE(client.get());
+  }
+
+  ASSERT_EQ(200, curl("/", "GET"));
+  std::ifstream listing{std::string{kOutFileName}};
+  EXPECT_EQ(8, std::count(std::istreambuf_iterator<char>(listing),
+                          std::istreambuf_iterator<char>(), '\n'));
+}
+
 INSTANTIATE_TEST_SUITE_P(Http, IntegrationTest,
                          ::testing::Values(TestParams{1, false},
                                            TestParams{8, false},
@@ -10,6 +10,7 @@
 #include <ostream>
 #include <string>
 #include <tuple>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "server/object_storage/src/object_storage.hpp"
@@ -39,6 +40,23 @@ static constexpr server::object_storage::LogLevel kServerLogLevel{
 /// authentication.
 using TestParams = std::tuple<std::size_t, bool>;
 
+/**
+ * \brief Return the configuration of a server under test.
+ *
+ * \param port Server port number.
+ *
+ * \return Configuration of a server listening on kHostname and logging at
+ * kServerLogLevel.
+ */
+server::object_storage::ObjectStorageConfig getServerConfig(
+    std::uint16_t port = kServerPortId) {
+  server::object_storage::ObjectStorageConfig config;
+  config.address = std::string{kHostname};
+  config.port = port;
+  config.log_level = kServerLogLevel;
+  return config;
+}
+
 /**
  * \brief Check if two files are binary equal.
  *
@@ -66,6 +84,21 @@ bool compareFiles(const std::string& path1, const std::string& path2) {
                     std::istreambuf_iterator<char>(file2.rdbuf()));
 }
 
+/**
+ * \brief Concatenate files into a new file.
+ *
+ * \param output Path to the file to create.
+ * \param inputs Paths to the files to concatenate.
+ */
+void concatenateFiles(const std::string& output,
+                      const std::vector<std::string>& inputs) {
+  std::ofstream out(output, std::ofstream::binary | std::ofstream::trunc);
+  for (const auto& input : inputs) {
+    std::ifstream in(input, std::ifstream::binary);
+    out << in.rdbuf();
+  }
+}
+
 /**
  * \brief Execute the command provided and capture stdout.
  *
@@ -149,6 +182,7 @@ static constexpr std::uint16_t kMaxHttpClientPortId{51000};
  * \param password Password to authenticate.
  * \param host Hostname to use.
  * \param port Port ID to use.
+ * \param flags Additional flags to pass to curl.
  *
  * \return HTTP status code returned by the server.
  */
@@ -158,18 +192,20 @@ int curl(const std::string& uri, const std::string& method,
          const std::string& username = std::string{kUsername},
          const std::string& password = std::string{kPassword},
          const std::string& host = std::string{kHostname},
-         std::uint16_t port = kServerPortId)
+         std::uint16_t port = kServerPortId, std::string flags = "")
 
 {
   static constexpr std::array<std::string_view, 2> kHttpDownloadMethods{"GET",
                                                                         "HEAD"};
 
-  static constexpr std::array<std::string_view, 2> kHttpUploadMethods{"PUT",
-                                                                      "POST"};
+  static constexpr std::array<std::string_view, 3> kHttpUploadMethods{
+      "PUT", "POST", "PATCH"};
 
   std::string command{"curl -s -S"};
-  command += " http://" + host + ':' + std::to_string(port) + uri;
-  command += " -X " + method;
+  // Quoted, so that query strings get past the shell.
+  command += " 'http://" + host + ':' + std::to_string(port) + uri + '\'';
+  // HEAD responses announce the size of a body which never follows.
+  command += (method == "HEAD") ? std::string{" --head"} : " -X " + method;
 
   // If HTTP method is for downloading a file, provide the output file.
   // Otherwise, if HTTP method is for uploading file, provide the input file.
@@ -190,6 +226,8 @@ int curl(const std::string& uri, const std::string& method,
   command += "  --local-port " + std::to_string(kMinHttpClientPortId) + '-' +
              std::to_string(kMaxHttpClientPortId);
 
+  command += flags;
+
   // Make curl output only HTTP status code returned by the server.
   command += " -w \"%{http_code}\n\" ";
 
@@ -213,7 +251,12 @@ enum class TestScenario {
   List,
   Retr,
   Stor,
+  Appe,
   Dele,
+  Rename,
+  Rmd,
+  Size,
+  Stat,
   NotSupported,
   ParamMissing,
 };
@@ -224,7 +267,7 @@ enum class TestScenario {
  * \param scenario Test scenario.
  * \param uri Uniform Resource Identifier.
  * \param authenticate Use FTP login, or not.
- * \param filename Local file to use for download/upload.
+ * \param filename Local file to use for download/upload (new path for rename).
  * \param username Username to authenticate.
  * \param password Password to authenticate.
  * \param host Hostname to use.
@@ -252,6 +295,21 @@ int curl(TestScenario scenario, const std::string& uri,
     case TestScenario::Dele:
       command += " -Q \"DELE " + uri + '\"';
       break;
+    case TestScenario::Rename:
+      // Drop the listing curl requests after the commands.
+      command += " -Q \"RNFR " + uri + "\" -Q \"RNTO " + filename + '\"';
+      command += " -o /dev/null";
+      break;
+    case TestScenario::Rmd:
+      command += " -Q \"RMD " + uri + "\" -o /dev/null";
+      break;
+    case TestScenario::Size:
+      command += " -Q \"SIZE " + uri + "\" -o /dev/null";
+      break;
+    case TestScenario::Stat:
+      command += " -Q \"STAT" + (uri.empty() ? uri : ' ' + uri) +
+                 "\" -o /dev/null";
+      break;
     case TestScenario::NotSupported:
       command += " -Q \"REIN\"";
       break;
@@ -262,8 +320,14 @@ int curl(TestScenario scenario, const std::string& uri,
       command += uri;
       command += " -T " + filename;
       break;
+    case TestScenario::Appe:
+      command += uri;
+      command += " -T " + filename + " --append";
+      break;
     case TestScenario::Retr:
-      command += uri + " -o " + filename;
+      // Skip the SIZE command curl sends first, so that a missing file is
+      // reported by RETR.
+      command += uri + " -o " + filename + " --ignore-content-length";
       break;
     default:
       break;
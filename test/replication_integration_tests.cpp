@@ -0,0 +1,210 @@
+#include "integration_tests.hpp"
+
+#include <chrono>
+#include <functional>
+#include <sstream>
+#include <thread>
+
+using namespace server::object_storage;
+using namespace test;
+using namespace test::http;
+
+namespace {
+
+/// HTTP ports of the followers used for testing.
+constexpr std::array<std::uint16_t, 2> kFollowerPortIds{1671, 1672};
+
+/// Port on which the primary accepts followers.
+constexpr std::uint16_t kReplicationPortId{1680};
+
+/**
+ * \brief Wait until the condition holds.
+ *
+ * \param condition Condition to check.
+ *
+ * \return True if condition holds, false if it did not hold within 10 seconds.
+ */
+bool waitFor(const std::function<bool()>& condition) {
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds{10};
+  while (std::chrono::steady_clock::now() < deadline) {
+    if (condition()) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+  }
+
+  return false;
+}
+
+/**
+ * \brief Run HTTP request against the given server.
+ *
+ * \param port Server port.
+ * \param uri Uniform Resource Identifier.
+ * \param method HTTP method (use uppercase)
+ * \param filename Local file to use for download/upload.
+ *
+ * \return HTTP status code returned by the server.
+ */
+int request(std::uint16_t port, const std::string& uri,
+            const std::string& method,
+            const std::string& filename = std::string{kOutFileName}) {
+  return curl(uri, method, false, filename, std::string{kUsername},
+              std::string{kPassword}, std::string{kHostname}, port);
+}
+
+/**
+ * \brief Read replication status of the given server.
+ *
+ * \param port Server port.
+ *
+ * \return Replication status report.
+ */
+std::string getReplicationStatus(std::uint16_t port) {
+  if (request(port, "/_replication", "GET") != 200) {
+    return {};
+  }
+
+  std::ifstream file{std::string{kOutFileName}};
+  std::stringstream status;
+  status << file.rdbuf();
+  return status.str();
+}
+
+/**
+ * \brief Replication integration test fixture.
+ *
+ * Runs a primary and followers on localhost, in the same process.
+ */
+class ReplicationIntegrationTest : public ::testing::Test {
+ protected:
+  /**
+   * \brief Start a primary keeping the given number of mutations.
+   *
+   * \param log_size Number of mutations kept by the primary.
+   */
+  void startPrimary(std::size_t log_size = 65536) {
+    auto config = getServerConfig();
+    config.replication.role = replication::Role::Primary;
+    config.replication.port = kReplicationPortId;
+    config.replication.log_size = log_size;
+
+    primary_ = std::make_unique<ObjectStorage>(config);
+    ASSERT_TRUE(primary_->start(2));
+  }
+
+  /**
+   * \brief Start a follower of the primary.
+   *
+   * \param port Follower HTTP port.
+   */
+  void startFollower(std::uint16_t port) {
+    auto config = getServerConfig(port);
+    config.replication.role = replication::Role::Follower;
+    config.replication.address = std::string{kHostname};
+    config.replication.port = kReplicationPortId;
+    config.replication.heartbeat_interval = std::chrono::milliseconds{20};
+
+    followers_.push_back(std::make_unique<ObjectStorage>(config));
+    ASSERT_TRUE(followers_.back()->start(2));
+  }
+
+  /// Primary server.
+  std::unique_ptr<ObjectStorage> primary_;
+
+  /// Follower servers.
+  std::vector<std::unique_ptr<ObjectStorage>> followers_;
+};
+
+}  // namespace
+
+TEST_F(ReplicationIntegrationTest, Replicate) {
+  startPrimary();
+  for (const auto port : kFollowerPortIds) {
+    startFollower(port);
+  }
+
+  const std::string file{"test/data/example.json"};
+  const std::string uri{"/replicated.json"};
+  ASSERT_TRUE(std::filesystem::exists(file));
+  ASSERT_EQ(201, request(kServerPortId, uri, "PUT", file));
+
+  for (const auto port : kFollowerPortIds) {
+    ASSERT_TRUE(waitFor([&] { return request(port, uri, "GET") == 200; }));
+    ASSERT_TRUE(compareFiles(file, std::string{kOutFileName}));
+  }
+
+  // Appends are replicated as well.
+  const std::string appended{"/tmp/object_store_appended"};
+  concatenateFiles(appended, {file, file});
+  ASSERT_EQ(200, request(kServerPortId, uri, "PATCH", file));
+  for (const auto port : kFollowerPortIds) {
+    ASSERT_TRUE(waitFor([&] {
+      return (request(port, uri, "GET") == 200) &&
+             compareFiles(appended, std::string{kOutFileName});
+    }));
+  }
+
+  ASSERT_EQ(200, request(kServerPortId, uri, "DELETE"));
+  for (const auto port : kFollowerPortIds) {
+    ASSERT_TRUE(waitFor([&] { return request(port, uri, "GET") == 404; }));
+  }
+
+  // Both followers acknowledged everything.
+  ASSERT_TRUE(waitFor([] {
+    const auto status = getReplicationStatus(kServerPortId);
+    std::size_t followers{0};
+    for (auto position = status.find(" lag=0 ");
+         position != std::string::npos;
+         position = status.find(" lag=0 ", position + 1)) {
+      followers++;
+    }
+    return followers == kFollowerPortIds.size();
+  }));
+}
+
+TEST_F(ReplicationIntegrationTest, ReadOnlyFollower) {
+  startPrimary();
+  startFollower(kFollowerPortIds[0]);
+
+  const std::string file{"test/data/example.json"};
+  ASSERT_EQ(403, request(kFollowerPortIds[0], "/file.json", "PUT", file));
+  ASSERT_EQ(403, request(kFollowerPortIds[0], "/file.json", "DELETE"));
+  ASSERT_EQ(404, request(kFollowerPortIds[0], "/file.json", "GET"));
+
+  const auto status = getReplicationStatus(kFollowerPortIds[0]);
+  EXPECT_NE(std::string::npos, status.find("role: follower"));
+}
+
+TEST_F(ReplicationIntegrationTest, SnapshotCatchUp) {
+  // The primary keeps only a few mutations, a late follower has to catch up
+  // from a snapshot.
+  startPrimary(2);
+
+  const std::string file{"test/data/bmw_picture.jpeg"};
+  ASSERT_TRUE(std::filesystem::exists(file));
+  for (int i = 0; i < 5; i++) {
+    ASSERT_EQ(201, request(kServerPortId, "/" + std::to_string(i), "PUT",
+                           file));
+  }
+
+  startFollower(kFollowerPortIds[0]);
+  for (int i = 0; i < 5; i++) {
+    ASSERT_TRUE(waitFor([&] {
+      return request(kFollowerPortIds[0], "/" + std::to_string(i), "GET") ==
+             200;
+    }));
+    ASSERT_TRUE(compareFiles(file, std::string{kOutFileName}));
+  }
+
+  const auto status = getReplicationStatus(kServerPortId);
+  EXPECT_NE(std::string::npos, status.find("snapshots: 1"));
+
+  // Mutations made after the snapshot are shipped from the log.
+  ASSERT_EQ(200, request(kServerPortId, "/0", "DELETE"));
+  ASSERT_TRUE(waitFor(
+      [&] { return request(kFollowerPortIds[0], "/0", "GET") == 404; }));
+  EXPECT_NE(std::string::npos,
+            getReplicationStatus(kFollowerPortIds[0]).find("lag: 0"));
+}
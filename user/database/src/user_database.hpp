@@ -1,6 +1,7 @@
 #ifndef USER_DATABASE_SRC_USER_DATABASE_HPP
 #define USER_DATABASE_SRC_USER_DATABASE_HPP
 
+#include <mutex>
 #include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
@@ -1,6 +1,7 @@
 #include "utils.hpp"
 
 #include <algorithm>
+#include <charconv>
 
 namespace utils {
 
@@ -33,6 +34,17 @@ void toUpperCase(std::string& text) noexcept {
   std::transform(text.begin(), text.end(), text.begin(), ::toupper);
 }
 
+std::optional<std::size_t> toNumber(std::string_view text) noexcept {
+  std::size_t number{};
+  const auto* end = text.data() + text.size();
+  const auto [last, error] = std::from_chars(text.data(), end, number);
+  if (text.empty() || (error != std::errc{}) || (last != end)) {
+    return {};
+  }
+
+  return number;
+}
+
 std::optional<std::string> decode_base64(const std::string& input) {
   static constexpr unsigned char kDecodingTable[] = {
       64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
@@ -88,4 +100,30 @@ std::optional<std::string> decode_base64(const std::string& input) {
   return output;
 }
 
-}  // namespace utils
\ No newline at end of file
+std::string encode_base64(std::string_view input) {
+  static constexpr std::string_view kEncodingTable{
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"};
+
+  std::string output;
+  output.reserve((input.size() + 2) / 3 * 4);
+
+  for (std::size_t i = 0; i < input.size(); i += 3) {
+    const auto remaining = input.size() - i;
+    std::uint32_t triple = static_cast<unsigned char>(input[i]) << 2 * 8;
+    if (remaining > 1) {
+      triple |= static_cast<unsigned char>(input[i + 1]) << 1 * 8;
+    }
+    if (remaining > 2) {
+      triple |= static_cast<unsigned char>(input[i + 2]) << 0 * 8;
+    }
+
+    output += kEncodingTable[(triple >> 3 * 6) & 0x3F];
+    output += kEncodingTable[(triple >> 2 * 6) & 0x3F];
+    output += remaining > 1 ? kEncodingTable[(triple >> 1 * 6) & 0x3F] : '=';
+    output += remaining > 2 ? kEncodingTable[(triple >> 0 * 6) & 0x3F] : '=';
+  }
+
+  return output;
+}
+
+}  // namespace utils
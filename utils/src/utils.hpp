@@ -32,6 +32,15 @@ void toLowerCase(std::string& text) noexcept;
  */
 void toUpperCase(std::string& text) noexcept;
 
+/**
+ * \brief Convert string to an unsigned decimal number.
+ *
+ * \param text Input string (digits only).
+ *
+ * \return Number, if the whole string was converted successfully.
+ */
+std::optional<std::size_t> toNumber(std::string_view text) noexcept;
+
 /**
  * \brief Decode a base64-encoded string
  *
@@ -41,6 +50,15 @@ void toUpperCase(std::string& text) noexcept;
  */
 std::optional<std::string> decode_base64(const std::string& input);
 
+/**
+ * \brief Encode a string in base64
+ *
+ * \param input Input string.
+ *
+ * \return String encoded in Base 64 (padded with '=').
+ */
+std::string encode_base64(std::string_view input);
+
 }  // namespace utils
 
 #endif  // UTILS_SRC_UTILS_HPP
@@ -82,6 +82,20 @@ TEST(ToLowerCase, SpecialChars) {
   EXPECT_EQ("_a1be*z/ ", str);
 }
 
+TEST(ToNumber, Valid) {
+  EXPECT_EQ(0, toNumber("0"));
+  EXPECT_EQ(1670, toNumber("1670"));
+  EXPECT_EQ(18446744073709551615ULL, toNumber("18446744073709551615"));
+}
+
+TEST(ToNumber, Invalid) {
+  EXPECT_FALSE(toNumber(""));
+  EXPECT_FALSE(toNumber("-1"));
+  EXPECT_FALSE(toNumber("12a"));
+  EXPECT_FALSE(toNumber(" 12"));
+  EXPECT_FALSE(toNumber("18446744073709551616"));
+}
+
 TEST(DecodeBase64, Decode) {
   std::string str{"_A1Be*Z/ "};
   toLowerCase(str);
@@ -92,4 +106,13 @@ TEST(DecodeBase64, Decode) {
 
   EXPECT_FALSE(decode_base64("I like trains"));
   EXPECT_FALSE(decode_base64("admin:4321"));
-}
\ No newline at end of file
+}
+
+TEST(EncodeBase64, Encode) {
+  EXPECT_EQ("", encode_base64(""));
+  EXPECT_EQ("TWFueSBoYW5kcyBtYWtlIGxpZ2h0IHdvcmsu",
+            encode_base64("Many hands make light work."));
+  EXPECT_EQ("bGlnaHQgd29y", encode_base64("light wor"));
+  EXPECT_EQ("YWRtaW46NDMyMQ==", encode_base64("admin:4321"));
+  EXPECT_EQ("admin:4321", decode_base64(encode_base64("admin:4321")));
+}